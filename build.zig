@@ -243,6 +243,11 @@ pub fn build(b: *Build) !void {
             .flags = cppflags.items,
         });
 
+        dxc_exe.addCSourceFile(.{
+            .file = b.path("tools/clang/tools/dxclib/dxcserver.cpp"),
+            .flags = cppflags.items,
+        });
+
         dxc_exe.addIncludePath(b.path("tools/clang/tools"));
 
         llvmconf.addConfigHeaders(b, dxc_exe);
@@ -259,6 +264,64 @@ pub fn build(b: *Build) !void {
 
         const install_dxc_step = b.step("dxc", "Build and install dxc.exe");
         install_dxc_step.dependOn(&b.addInstallArtifact(dxc_exe, .{}).step);
+
+        const dxscan_exe = b.addExecutable(.{
+            .name = "dxscan",
+            .optimize = optimize,
+            .target = target,
+        });
+
+        dxscan_exe.addCSourceFile(.{
+            .file = b.path("tools/clang/tools/dxscan/dxscan.cpp"),
+            .flags = cppflags.items,
+        });
+
+        llvmconf.addConfigHeaders(b, dxscan_exe);
+        addIncludes(b, dxscan_exe);
+
+        dxscan_exe.defineCMacro("NDEBUG", ""); // disable assertions
+
+        dxscan_exe.linkLibrary(dxcompiler);
+
+        b.installArtifact(dxscan_exe);
+
+        const install_dxscan_step = b.step("dxscan", "Build and install dxscan.exe");
+        install_dxscan_step.dependOn(&b.addInstallArtifact(dxscan_exe, .{}).step);
+
+        const bench_exe = b.addExecutable(.{
+            .name = "dxc-bench",
+            .optimize = optimize,
+            .target = target,
+        });
+
+        bench_exe.addCSourceFile(.{
+            .file = b.path("tools/clang/tools/dxc-bench/dxc-bench.cpp"),
+            .flags = cppflags.items,
+        });
+
+        llvmconf.addConfigHeaders(b, bench_exe);
+        addIncludes(b, bench_exe);
+
+        bench_exe.defineCMacro("NDEBUG", ""); // disable assertions
+
+        bench_exe.linkLibrary(dxcompiler);
+
+        b.installArtifact(bench_exe);
+
+        const install_bench_step = b.step("dxc-bench", "Build and install dxc-bench.exe");
+        install_bench_step.dependOn(&b.addInstallArtifact(bench_exe, .{}).step);
+
+        // zig build bench [-- dxc-bench options] runs the corpus and installs
+        // the results as dxc-bench.json.
+        const run_bench = b.addRunArtifact(bench_exe);
+        run_bench.addFileArg(b.path("tools/clang/tools/dxc-bench/corpus/corpus.txt"));
+        run_bench.addArg("-o");
+        const bench_results = run_bench.addOutputFileArg("dxc-bench.json");
+        if (b.args) |args| run_bench.addArgs(args);
+        run_bench.has_side_effects = true;
+
+        const bench_step = b.step("bench", "Run the dxc-bench corpus");
+        bench_step.dependOn(&b.addInstallFile(bench_results, "dxc-bench.json").step);
     }
 
 // -------------
@@ -1215,6 +1278,7 @@ const lib_support_cpp_sources = [_][]const u8{
     "lib/Support/ScaledNumber.cpp",
     "lib/Support/Locale.cpp",
     "lib/Support/TimeProfiler.cpp",
+    "lib/Support/ContentionProfiler.cpp",
     "lib/Support/FileUtilities.cpp",
     "lib/Support/TimeValue.cpp",
     "lib/Support/TargetRegistry.cpp",
@@ -1410,6 +1474,8 @@ const tools_clang_lib_spirv = [_][]const u8{
     "tools/clang/lib/SPIRV/SpirvEmitter.cpp",
     "tools/clang/lib/SPIRV/SpirvBuilder.cpp",
     "tools/clang/lib/SPIRV/FeatureManager.cpp",
+    "tools/clang/lib/SPIRV/FusedVisitor.cpp",
+    "tools/clang/lib/SPIRV/LegalizationCache.cpp",
     "tools/clang/lib/SPIRV/SpirvModule.cpp",
     "tools/clang/lib/SPIRV/BlockReadableOrder.cpp",
     "tools/clang/lib/SPIRV/SignaturePackingUtil.cpp",
@@ -179,6 +179,11 @@ private:
   };
   OpCodeCacheItem m_OpCodeClassCache[(unsigned)OpCodeClass::NumOpClasses];
   std::unordered_map<const llvm::Function *, OpCodeClass> m_FunctionToOpClass;
+  // GetOpFunc results indexed by opcode and overload slot, for the slots that
+  // stand for a single type (void through i64). Filled lazily in front of
+  // m_OpCodeClassCache, which remains the authoritative list.
+  llvm::Function *m_OpFuncCache[(unsigned)OpCode::NumOpCodes]
+                               [kUserDefineTypeSlot];
   void UpdateCache(OpCodeClass opClass, llvm::Type *Ty, llvm::Function *F);
 
 private:
@@ -199,6 +204,7 @@ private:
   static const char *m_TypePrefix;
   static const char *m_MatrixTypePrefix;
   static unsigned GetTypeSlot(llvm::Type *pType);
+  static unsigned GetOpFuncCacheSlot(llvm::Type *pType);
   static const char *GetOverloadTypeName(unsigned TypeSlot);
   static llvm::StringRef GetTypeName(llvm::Type *Ty, std::string &str);
   static llvm::StringRef ConstructOverloadName(llvm::Type *Ty,
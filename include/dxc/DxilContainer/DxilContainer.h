@@ -291,6 +291,17 @@ struct DxilCompilerVersion {
 //        char Content[ ContentSizeInBytes ]
 //        (0-3 zero bytes to align to a 4-byte boundary)
 //
+// If CompressType is ZlibPerEntry, each entry is compressed on its own so
+// that readers can decompress one file without touching the others:
+//
+//     DxilSourceInfo_SourceContentsIndexEntry Index[ Count ]
+//     char CompressedEntry0[ Index[0].CompressedSizeInBytes ]
+//     ...
+//     char CompressedEntryN[ Index[N].CompressedSizeInBytes ]
+//
+// Each compressed entry decompresses to one
+// DxilSourceInfo_SourcesContentsEntry as laid out above.
+//
 // ================ 3. Args ==================================
 //
 //   DxilSourceInfo_Args
@@ -371,7 +382,11 @@ struct DxilSourceInfo_SourceNamesEntry {
   // boundary.
 };
 
-enum class DxilSourceInfo_SourceContentsCompressType : uint16_t { None, Zlib };
+enum class DxilSourceInfo_SourceContentsCompressType : uint16_t {
+  None,
+  Zlib,
+  ZlibPerEntry,
+};
 
 struct DxilSourceInfo_SourceContents {
   uint32_t AlignedSizeInBytes; // Size of the entry including this header.
@@ -399,6 +414,13 @@ struct DxilSourceInfo_SourceContentsEntry {
   // 4-byte boundary.
 };
 
+struct DxilSourceInfo_SourceContentsIndexEntry {
+  uint32_t Offset; // Offset of the compressed entry from the end of the index.
+  uint32_t CompressedSizeInBytes;   // Size of the compressed entry.
+  uint32_t UncompressedSizeInBytes; // Size of the entry once decompressed,
+                                    // including its header and padding.
+};
+
 #pragma pack(pop)
 
 enum class DxilShaderPDBInfoVersion : uint16_t {
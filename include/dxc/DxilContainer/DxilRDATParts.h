@@ -15,15 +15,19 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <set>
-#include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace hlsl {
 
+// Maps the contents of strings, byte sequences and records to their offset or
+// index. Keys are copied once into an arena and each entry keeps its full
+// hash, so probing rarely compares contents and nothing is freed one by one.
+typedef llvm::StringMap<uint32_t, llvm::BumpPtrAllocator> RDATContentMap;
+
 class RDATPart {
 public:
   virtual uint32_t GetPartSize() const { return 0; }
@@ -36,7 +40,7 @@ public:
 
 class StringBufferPart : public RDATPart {
 private:
-  std::unordered_map<std::string, uint32_t> m_Map;
+  RDATContentMap m_Map;
   std::vector<llvm::StringRef> m_List;
   size_t m_Size = 0;
 
@@ -111,7 +115,7 @@ public:
 
 class RawBytesPart : public RDATPart {
 private:
-  std::unordered_map<std::string, uint32_t> m_Map;
+  RDATContentMap m_Map;
   std::vector<llvm::StringRef> m_List;
   size_t m_Size = 0;
 
@@ -136,7 +140,7 @@ class RDATTable : public RDATPart {
 protected:
   // m_map is map of records to their index.
   // Used to alias identical records.
-  std::unordered_map<std::string, uint32_t> m_map;
+  RDATContentMap m_map;
   std::vector<llvm::StringRef> m_rows;
   size_t m_RecordStride = 0;
   bool m_bDeduplicationEnabled = false;
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,7 @@ class CallInst;
 class Function;
 class Module;
 class Type;
+class Value;
 } // namespace llvm
 
 // Combines DXIL raytracing shaders together into a compute shader.
@@ -58,6 +60,11 @@ public:
   // 3 - dump intermediate stages of SFT to file
   void setDebugOutputLevel(int val);
 
+  // 0 - transform shaders on up to one thread per hardware thread
+  // 1 - transform shaders one at a time on the calling thread
+  // n - transform shaders on up to n threads
+  void setThreadCount(unsigned val);
+
   // Returns the entry state id for each of shaderNames. The transformations
   // are performed in place on the module.
   void compile(std::vector<int> &shaderEntryStateIds,
@@ -81,6 +88,7 @@ private:
   unsigned m_maxAttributeSize = 0;
   bool m_findCalledShaders = false;
   int m_debugOutputLevel = 0;
+  unsigned m_threadCount = 0;
 
   StringToFuncMap m_shaderMap;
 
@@ -95,6 +103,16 @@ private:
                             int baseStateId,
                             const std::vector<std::string> &shaderNames,
                             llvm::Type *runtimeDataArgTy);
+  // Transforms each shader in its own module and LLVMContext on a pool of
+  // threads, then links the results back in shaderNames order. Returns false
+  // without changing the module when the shaders cannot be split apart, only
+  // one thread may be used, or the debug output level requires the
+  // transforms to run one at a time.
+  bool transformShadersInParallel(
+      const std::vector<std::string> &shaderNames,
+      const std::set<llvm::Value *> &resources,
+      std::vector<std::vector<llvm::Function *>> &stateFunctions,
+      std::vector<unsigned int> &stackSizes);
   void createLaunchParams(llvm::Function *func);
   void createStack(llvm::Function *func);
   void createStateDispatch(llvm::Function *func,
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcMallocAccountant.h                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides an IMalloc that keeps per-phase allocation statistics.           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/DenseMap.h"
+#include <mutex>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace hlsl {
+
+/// Forwards to another IMalloc and records how many bytes are allocated
+/// through it, attributing each allocation to the allocating thread's
+/// DxcMallocPhase.
+///
+/// The accountant remembers the size of every block it allocates, so blocks
+/// may be freed through either allocator: blocks it does not know about are
+/// simply forwarded. Objects that escape the compile may keep the accountant
+/// alive and free through it from other threads, so it is thread-safe.
+class DxcMallocAccountant : public IMalloc {
+public:
+  struct Stats {
+    uint64_t AllocCount = 0; // Alloc and Realloc calls.
+    uint64_t AllocBytes = 0; // Bytes requested by those calls.
+    uint64_t PeakBytes = 0;  // Highest live byte count seen.
+  };
+
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcMallocAccountant)
+
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override;
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override;
+  void STDMETHODCALLTYPE Free(void *pv) override;
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override;
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override;
+  void STDMETHODCALLTYPE HeapMinimize(void) override;
+
+  /// Statistics for the whole lifetime of the accountant. PeakBytes is the
+  /// highest number of bytes that were live at once.
+  Stats GetTotals() const;
+
+  /// Statistics for allocations made in the given phase. PeakBytes is the
+  /// highest number of bytes live at once, counting all phases, while the
+  /// phase was current.
+  Stats GetPhaseStats(DxcMallocPhase phase) const;
+
+  /// Writes the totals and phase statistics as a JSON object.
+  /// includesOperatorNew tells readers whether C++ allocations were routed
+  /// through the thread's IMalloc, or only explicit IMalloc calls counted.
+  void WriteJson(llvm::raw_ostream &OS, bool includesOperatorNew) const;
+
+  static const char *GetPhaseName(DxcMallocPhase phase);
+
+  static const unsigned kNumPhases = (unsigned)DxcMallocPhase::LastPhase + 1;
+
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+  void Track(void *pv, SIZE_T cb);
+  bool Untrack(void *pv);
+
+  mutable std::mutex m_Lock;
+  // Sizes of the live blocks allocated through the accountant. The map
+  // itself is always allocated from m_pMalloc.
+  llvm::DenseMap<void *, SIZE_T> m_Sizes;
+  uint64_t m_LiveBytes = 0;
+  Stats m_Totals;
+  Stats m_Phases[kNumPhases];
+};
+
+} // namespace hlsl
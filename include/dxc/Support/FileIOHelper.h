@@ -149,6 +149,13 @@ HRESULT DxcCreateBlobFromFile(IMalloc *pMalloc, LPCWSTR pFileName,
 HRESULT DxcCreateBlobFromFile(LPCWSTR pFileName, UINT32 *pCodePage,
                               IDxcBlobEncoding **ppBlobEncoding) throw();
 
+// Maps the file into memory instead of reading it onto the heap; encoding is
+// unknown. Pages are copy-on-write, so writes to the buffer never reach the
+// file, but the file must not be replaced or truncated while the blob is
+// alive, so this is only for callers that never write to the file they read.
+HRESULT DxcCreateBlobFromMappedFile(IMalloc *pMalloc, LPCWSTR pFileName,
+                                    IDxcBlobEncoding **ppBlobEncoding) throw();
+
 // Given a blob, creates a subrange view.
 HRESULT DxcCreateBlobFromBlob(IDxcBlob *pBlob, UINT32 offset, UINT32 length,
                               IDxcBlob **ppResult) throw();
@@ -79,6 +79,41 @@ private:
   IMalloc *pPrior;
 };
 
+// Phases of a compilation, used to attribute allocations when a
+// DxcMallocAccountant is installed (see DxcMallocAccountant.h) and lock
+// acquisitions when contention is profiled (see ContentionProfiler.h). The
+// phase is tracked per thread and has no effect otherwise.
+enum class DxcMallocPhase : unsigned {
+  Other,
+  Parse,
+  Sema,
+  CodeGen,
+  HLPasses,
+  DxilPasses,
+  Validation,
+  Container,
+  LastPhase = Container
+};
+
+DxcMallocPhase DxcGetThreadMallocPhase() throw();
+void DxcSetThreadMallocPhase(DxcMallocPhase phase) throw();
+
+// Sets the thread's allocation phase for the lifetime of the object.
+class DxcThreadMallocPhase {
+public:
+  explicit DxcThreadMallocPhase(DxcMallocPhase phase) throw()
+      : prior(DxcGetThreadMallocPhase()) {
+    DxcSetThreadMallocPhase(phase);
+  }
+  ~DxcThreadMallocPhase() { DxcSetThreadMallocPhase(prior); }
+
+private:
+  DxcThreadMallocPhase(const DxcThreadMallocPhase &) = delete;
+  DxcThreadMallocPhase &operator=(const DxcThreadMallocPhase &) = delete;
+
+  DxcMallocPhase prior;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Error handling support.
 void CheckLLVMErrorCode(const std::error_code &ec);
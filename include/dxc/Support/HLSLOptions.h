@@ -25,7 +25,10 @@
 
 #include "dxc/dxcapi.h"
 
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 
 namespace llvm {
@@ -157,6 +160,11 @@ public:
   llvm::StringRef ImportBindingTable;         // OPT_import_binding_table
   llvm::StringRef BindingTableDefine;         // OPT_binding_table_define
   llvm::StringRef DiagnosticsFormat;          // OPT_fdiagnostics_format
+  llvm::StringRef BatchFile;                  // OPT_batch
+  llvm::StringRef BatchDependencyFile;        // OPT_batch_deps
+  unsigned BatchJobs = 0;                     // OPT_batch_jobs
+  llvm::StringRef ServerAddress;              // OPT_server
+  llvm::StringRef ConnectAddress;             // OPT_connect
   unsigned DefaultTextCodePage = DXC_CP_UTF8; // OPT_encoding
 
   bool AllResourcesBound = false;         // OPT_all_resources_bound
@@ -207,6 +215,7 @@ public:
   bool EmbedDebug = false;                   // OPT Qembed_debug
   bool SourceInDebugModule = false;          // OPT Zs
   bool SourceOnlyDebug = false;              // OPT Qsource_only_debug
+  bool CompressSourcesPerFile = false;       // OPT Qsource_compress_per_file
   bool PdbInPrivate = false;                 // OPT Qpdb_in_private
   bool StripRootSignature = false;           // OPT_Qstrip_rootsignature
   bool StripPrivate = false;                 // OPT_Qstrip_priv
@@ -231,10 +240,13 @@ public:
   bool ForceZeroStoreLifetimes = false; // OPT_force_zero_store_lifetimes
   bool EnableLifetimeMarkers = false;   // OPT_enable_lifetime_markers
   bool ForceDisableLocTracking = false; // OPT_fdisable_loc_tracking
+  bool DiscardTeardown = false;         // OPT_fdiscard_teardown
   bool NewInlining = false;             // OPT_fnew_inlining_behavior
   bool TimeReport = false;              // OPT_ftime_report
   std::string TimeTrace = "";           // OPT_ftime_trace[EQ]
   unsigned TimeTraceGranularity = 500;  // OPT_ftime_trace_granularity_EQ
+  std::string MemoryReport = "";        // OPT_fmemory_report[EQ]
+  std::string ContentionReport = "";    // OPT_fcontention_report[EQ]
   bool VerifyDiagnostics = false;       // OPT_verify
 
   // Optimization pass enables, disables and selects
@@ -294,6 +306,89 @@ public:
   }
 };
 
+/// Use this class to tokenize an argument list against the option table once
+/// and read it into any number of DxcOpts afterwards. A parsed list can be
+/// cloned with different -D values without converting or parsing the other
+/// arguments again, which is what permutation builds need: the same long
+/// argument vector compiled many times with only the defines changing.
+///
+/// A DxcOpts read from a DxcParsedArgs refers to its strings, so the parsed
+/// list must outlive it (same contract as MainArgs).
+class DxcParsedArgs : public std::enable_shared_from_this<DxcParsedArgs> {
+public:
+  DxcParsedArgs(const DxcParsedArgs &) = delete;
+  DxcParsedArgs &operator=(const DxcParsedArgs &) = delete;
+
+  /// Parses the given arguments. Parse errors are not reported here; they are
+  /// reported by ReadDxcOpts like for a regular MainArgs.
+  static std::shared_ptr<const DxcParsedArgs>
+  Parse(const llvm::opt::OptTable *optionTable, unsigned flagsToInclude,
+        const MainArgs &argStrings);
+
+  /// Returns a copy of this list with the -D values replaced by the given
+  /// ones, in command-line order. Returns nullptr if the number of values
+  /// doesn't match the number of -D arguments.
+  std::shared_ptr<const DxcParsedArgs>
+  CloneWithDefines(llvm::ArrayRef<llvm::StringRef> defineValues) const;
+
+  /// Stable key for the argument list that ignores the -D values, so clones
+  /// share the key of the list they were made from.
+  uint64_t GetHash() const { return m_hash; }
+  unsigned GetFlagsToInclude() const { return m_flagsToInclude; }
+  llvm::ArrayRef<const char *> getArrayRef() const { return m_argv; }
+
+  /// Returns a new argument list equivalent to the one produced by parsing.
+  llvm::opt::InputArgList CloneArgList(unsigned &missingArgIndex,
+                                       unsigned &missingArgCount) const;
+
+  /// Token index and offset of each -D value, in command-line order.
+  typedef std::pair<unsigned, unsigned> DefineValueLoc;
+  llvm::ArrayRef<DefineValueLoc> GetDefineValueLocs() const {
+    return m_defineValues;
+  }
+
+private:
+  DxcParsedArgs() = default;
+  void ComputeHash();
+
+  // Parsed list this one was cloned from; owns the strings not owned here.
+  std::shared_ptr<const DxcParsedArgs> m_base;
+  MainArgs m_strings; // All tokens for a parsed list, -D tokens for a clone.
+  llvm::SmallVector<const char *, 8> m_argv;
+  llvm::SmallVector<DefineValueLoc, 4> m_defineValues;
+  std::unique_ptr<llvm::opt::InputArgList> m_args;
+  unsigned m_flagsToInclude = 0;
+  unsigned m_missingArgIndex = 0;
+  unsigned m_missingArgCount = 0;
+  uint64_t m_hash = 0;
+};
+
+/// Use this class to remember the most recently parsed argument lists. An
+/// argument list that matches a cached one except for its -D values is cloned
+/// from it instead of being converted and parsed again.
+class DxcParsedArgsCache {
+public:
+  DxcParsedArgsCache(unsigned flagsToInclude, size_t maxEntries = 16)
+      : m_flagsToInclude(flagsToInclude), m_maxEntries(maxEntries) {}
+
+  /// Returns the parsed form of the given arguments; throws on conversion
+  /// errors like MainArgs.
+  std::shared_ptr<const DxcParsedArgs>
+  GetOrParse(const llvm::opt::OptTable *optionTable,
+             llvm::ArrayRef<LPCWSTR> args);
+
+private:
+  struct Entry {
+    uint64_t Key;
+    std::vector<std::wstring> WideArgs;
+    std::shared_ptr<const DxcParsedArgs> Parsed;
+  };
+  std::mutex m_lock;
+  std::list<Entry> m_entries; // Most recently used first.
+  unsigned m_flagsToInclude;
+  size_t m_maxEntries;
+};
+
 /// Use this class to convert a StringRef into a wstring, handling empty values
 /// as nulls.
 class StringRefWide {
@@ -311,6 +406,11 @@ int ReadDxcOpts(const llvm::opt::OptTable *optionTable, unsigned flagsToInclude,
                 const MainArgs &argStrings, DxcOpts &opts,
                 llvm::raw_ostream &errors);
 
+/// Reads all options from an already parsed argument list, populates opts,
+/// and validates reporting errors and warnings.
+int ReadDxcOpts(const DxcParsedArgs &parsedArgs, DxcOpts &opts,
+                llvm::raw_ostream &errors);
+
 /// Sets up the specified DxcDllSupport instance as per the given options.
 int SetupDxcDllSupport(const DxcOpts &opts, dxc::DxcDllSupport &dxcSupport,
                        llvm::raw_ostream &errors);
@@ -99,6 +99,10 @@ struct SpirvCodeGenOptions {
 
   bool printAll; // Dump SPIR-V module before each pass and after the last one.
 
+  /// Directory shared by compilations to reuse legalized and optimized
+  /// modules. Empty if the legalization cache is disabled.
+  std::string legalizationCacheDir;
+
   // String representation of all command line options and input file.
   std::string clOptions;
   std::string inputFile;
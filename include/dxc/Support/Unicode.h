@@ -17,15 +17,17 @@
 #include <specstrings.h>
 #else
 // MultiByteToWideChar which is a Windows-specific method.
-// This is a very simplistic implementation for non-Windows platforms. This
-// implementation completely ignores CodePage and dwFlags.
+// This implementation for non-Windows platforms converts from UTF-8 to UTF-32
+// and ignores CodePage and dwFlags; malformed input always fails with
+// ERROR_NO_UNICODE_TRANSLATION.
 int MultiByteToWideChar(uint32_t CodePage, uint32_t dwFlags,
                         const char *lpMultiByteStr, int cbMultiByte,
                         wchar_t *lpWideCharStr, int cchWideChar);
 
 // WideCharToMultiByte is a Windows-specific method.
-// This is a very simplistic implementation for non-Windows platforms. This
-// implementation completely ignores CodePage and dwFlags.
+// This implementation for non-Windows platforms converts from UTF-32 to UTF-8
+// and ignores CodePage and dwFlags; surrogates and values above U+10FFFF
+// always fail with ERROR_NO_UNICODE_TRANSLATION.
 int WideCharToMultiByte(uint32_t CodePage, uint32_t dwFlags,
                         const wchar_t *lpWideCharStr, int cchWideChar,
                         char *lpMultiByteStr, int cbMultiByte,
@@ -77,6 +79,18 @@ bool WideToUTF8String(const wchar_t *pWide, std::string *pUTF8);
 
 std::string WideToUTF8StringOrThrow(const wchar_t *pWide);
 
+// Returns true if all cb bytes of text are 7-bit ASCII, which is encoded the
+// same in UTF-8 and in every ANSI code page.
+bool IsASCII(const char *text, size_t cb);
+
+// Returns true if the cb bytes of text are well-formed UTF-8: no truncated or
+// overlong sequences, surrogates, or code points above U+10FFFF.
+bool IsValidUTF8(const char *text, size_t cb);
+
+// Widens cb bytes of ASCII text into pWide, which must have room for cb
+// characters.
+void ASCIIToWide(const char *text, size_t cb, wchar_t *pWide);
+
 bool IsStarMatchUTF8(const char *pMask, size_t maskLen, const char *pName,
                      size_t nameLen);
 bool IsStarMatchWide(const wchar_t *pMask, size_t maskLen, const wchar_t *pName,
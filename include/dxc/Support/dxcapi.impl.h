@@ -16,6 +16,8 @@
 #include "dxc/dxcapi.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <limits>
 
 // Simple adaptor for IStream. Can probably do better.
 class raw_stream_ostream : public llvm::raw_ostream {
@@ -33,6 +35,35 @@ public:
   ~raw_stream_ostream() override { flush(); }
 };
 
+// Adaptor for a caller-provided IStream. Write failures are not thrown out of
+// the printers; the first one is kept and later writes are dropped, so check
+// GetStatus after flushing.
+class raw_istream_ostream : public llvm::raw_ostream {
+private:
+  CComPtr<IStream> m_pStream;
+  uint64_t m_Pos = 0;
+  HRESULT m_Status = S_OK;
+  void write_impl(const char *Ptr, size_t Size) override {
+    while (Size && SUCCEEDED(m_Status)) {
+      ULONG cbToWrite =
+          (ULONG)std::min<size_t>(Size, std::numeric_limits<ULONG>::max());
+      ULONG cbWritten = 0;
+      m_Status = m_pStream->Write(Ptr, cbToWrite, &cbWritten);
+      if (SUCCEEDED(m_Status) && cbWritten == 0)
+        m_Status = E_FAIL;
+      Ptr += cbWritten;
+      Size -= cbWritten;
+      m_Pos += cbWritten;
+    }
+  }
+  uint64_t current_pos() const override { return m_Pos; }
+
+public:
+  raw_istream_ostream(IStream *pStream) : m_pStream(pStream) {}
+  ~raw_istream_ostream() override { flush(); }
+  HRESULT GetStatus() const { return m_Status; }
+};
+
 namespace {
 HRESULT TranslateUtf8StringForOutput(LPCSTR pStr, SIZE_T size, UINT32 codePage,
                                      IDxcBlobEncoding **ppBlobEncoding) {
@@ -106,6 +137,8 @@ inline DxcOutputType DxcGetOutputType(DXC_OUT_KIND kind) {
   case DXC_OUT_REMARKS:
   case DXC_OUT_TIME_REPORT:
   case DXC_OUT_TIME_TRACE:
+  case DXC_OUT_MEMORY_REPORT:
+  case DXC_OUT_CONTENTION_REPORT:
     return DxcOutputType_Text;
   default:
     return DxcOutputType_None;
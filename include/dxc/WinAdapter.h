@@ -145,6 +145,7 @@
 #define ERROR_NOT_FOUND ENOTSUP
 #define ERROR_UNHANDLED_EXCEPTION EBADF
 #define ERROR_BROKEN_PIPE EPIPE
+#define ERROR_NO_UNICODE_TRANSLATION EILSEQ
 
 // Used by HRESULT <--> WIN32 error code conversion
 #define SEVERITY_ERROR 1
@@ -753,8 +753,13 @@ typedef enum DXC_OUT_KIND {
       12, ///< IDxcBlobUtf8 or IDxcBlobWide - text directed at stdout.
   DXC_OUT_TIME_TRACE =
       13, ///< IDxcBlobUtf8 or IDxcBlobWide - text directed at stdout.
+  DXC_OUT_MEMORY_REPORT = 14, ///< IDxcBlobUtf8 or IDxcBlobWide - JSON
+                              ///< allocation statistics, per compile phase.
+  DXC_OUT_CONTENTION_REPORT =
+      15, ///< IDxcBlobUtf8 or IDxcBlobWide - JSON lock contention
+          ///< statistics, per compile phase.
 
-  DXC_OUT_LAST = DXC_OUT_TIME_TRACE, ///< Last value for a counter.
+  DXC_OUT_LAST = DXC_OUT_CONTENTION_REPORT, ///< Last value for a counter.
 
   DXC_OUT_NUM_ENUMS,
   DXC_OUT_FORCE_DWORD = 0xFFFFFFFF
@@ -876,6 +881,49 @@ struct IDxcCompiler3 : public IUnknown {
       ) = 0;
 };
 
+// Sections of the disassembly, for DxcDisassembleOptions::Sections.
+static const UINT32 DxcDisassembleSection_Header =
+    0x1; // Feature info, debug name and hash.
+static const UINT32 DxcDisassembleSection_Signatures = 0x2;
+static const UINT32 DxcDisassembleSection_RuntimeInfo =
+    0x4; // Pipeline state validation info.
+static const UINT32 DxcDisassembleSection_Resources =
+    0x8; // Buffer definitions and resource bindings.
+static const UINT32 DxcDisassembleSection_ViewId = 0x10;
+static const UINT32 DxcDisassembleSection_Subobjects = 0x20;
+static const UINT32 DxcDisassembleSection_Module = 0x40; // LLVM IR.
+static const UINT32 DxcDisassembleSection_All = 0x7f;
+
+/// \brief Selects what IDxcCompiler4::DisassembleToStream writes.
+struct DxcDisassembleOptions {
+  UINT32 Sections; ///< Combination of DxcDisassembleSection_* flags.
+  UINT32 FunctionCount; ///< Number of names in pFunctionNames, 0 for all.
+  /// Names of the functions whose bodies are printed in the Module section.
+  /// Other functions are printed as declarations and their bodies are never
+  /// loaded. Names that do not match a function are ignored.
+  const LPCSTR *pFunctionNames;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler4, "B1820EC1-C4E5-48A6-A800-4C36F720786D")
+/// \brief Interface to the DirectX Shader Compiler.
+///
+/// Use DxcCreateInstance with CLSID_DxcCompiler to obtain an instance of this
+/// interface.
+struct IDxcCompiler4 : public IDxcCompiler3 {
+  /// \brief Disassemble a program into a caller-provided stream.
+  ///
+  /// The text is the same as the one from IDxcCompiler3::Disassemble, but it
+  /// is written to pOutput as it is produced instead of being accumulated in
+  /// a blob, so large libraries can be disassembled in bounded memory.
+  virtual HRESULT STDMETHODCALLTYPE DisassembleToStream(
+      _In_ const DxcBuffer
+          *pObject, ///< Program to disassemble: dxil container or bitcode.
+      _In_opt_ const DxcDisassembleOptions
+          *pOptions, ///< Sections and functions to print, null for all.
+      _In_ IStream *pOutput ///< Stream that receives the UTF-8 text.
+      ) = 0;
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit =
     1; // Validator is allowed to update shader blob in-place.
@@ -1066,6 +1114,49 @@ struct IDxcOptimizer : public IUnknown {
                _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcOptimizerSession,
+                      "A0DEC228-F662-4220-B03E-9B9594FBF71A")
+/// \brief A module kept loaded between successive runs of optimizer passes.
+///
+/// Instances of this can be obtained via IDxcOptimizer2::CreateSession. A
+/// session and the sessions forked from it share state and must not be used
+/// concurrently.
+struct IDxcOptimizerSession : public IUnknown {
+  /// \brief Runs passes on the module of this session.
+  ///
+  /// \param ppOptions Passes and flags, as for IDxcOptimizer::RunOptimizer.
+  ///
+  /// \param ppOutputText Text printed by the passes, including the module
+  /// itself when -S is given.
+  virtual HRESULT STDMETHODCALLTYPE
+  RunPasses(_In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+            _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+
+  /// \brief Serializes the current module as bitcode.
+  virtual HRESULT STDMETHODCALLTYPE
+  GetModule(_COM_Outptr_ IDxcBlob **ppOutputModule) = 0;
+
+  /// \brief Creates a session with a copy of the current module, for example
+  /// to keep a snapshot or to try out different passes.
+  virtual HRESULT STDMETHODCALLTYPE
+  Fork(_COM_Outptr_ IDxcOptimizerSession **ppSession) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcOptimizer2, "00BE8A0B-806D-4ECC-90F4-512B42E1F519")
+/// \brief Interface to DxcOptimizer.
+///
+/// Use DxcCreateInstance with CLSID_DxcOptimizer to obtain an instance of this.
+struct IDxcOptimizer2 : public IDxcOptimizer {
+  /// \brief Loads a module once so that several pass lists can be applied to
+  /// it without parsing and serializing it in between.
+  ///
+  /// \param pBlob A DXIL container, DXIL program or LLVM IR, as accepted by
+  /// IDxcOptimizer::RunOptimizer.
+  virtual HRESULT STDMETHODCALLTYPE
+  CreateSession(IDxcBlob *pBlob,
+                _COM_Outptr_ IDxcOptimizerSession **ppSession) = 0;
+};
+
 static const UINT32 DxcVersionInfoFlags_None = 0;
 static const UINT32 DxcVersionInfoFlags_Debug = 1; // Matches VS_FF_DEBUG
 static const UINT32 DxcVersionInfoFlags_Internal =
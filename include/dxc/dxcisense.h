@@ -154,7 +154,9 @@ typedef enum DxcTranslationUnitFlags {
   DxcTranslationUnitFlags_Incomplete = 0x02,
 
   // Used to indicate that the translation unit should be built with an
-  // implicit precompiled header for the preamble.
+  // implicit precompiled header for the preamble. For HLSL, this parses only
+  // the declarations of included files, so diagnostics within function bodies
+  // of included files are not reported.
   DxcTranslationUnitFlags_PrecompiledPreamble = 0x04,
 
   // Used to indicate that the translation unit should cache some
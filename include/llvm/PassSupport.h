@@ -33,9 +33,14 @@ namespace llvm {
 
 class TargetMachine;
 
+// HLSL Change - Pass constructors run this on every instantiation, from every
+// compiling thread. Only try the compare-and-swap, which takes the flag's
+// cache line exclusively, until initialization is seen to be complete.
 #define CALL_ONCE_INITIALIZATION(function) \
   static volatile sys::cas_flag initialized = 0; \
-  sys::cas_flag old_val = sys::CompareAndSwap(&initialized, 1, 0); \
+  sys::cas_flag old_val = initialized; \
+  if (old_val != 2) \
+    old_val = sys::CompareAndSwap(&initialized, 1, 0); \
   if (old_val == 0) { \
     function(Registry); \
     sys::MemoryFence(); \
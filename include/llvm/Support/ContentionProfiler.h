@@ -0,0 +1,152 @@
+//===- llvm/Support/ContentionProfiler.h - Contention Profiler -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - Records how often a thread acquires the locks that
+// concurrent compiles share, how often it finds them held and how long it
+// waits, attributed to the thread's current compilation phase.
+//
+// Profiling is per thread: a compile begins a profile on its own thread and
+// only its own acquisitions are recorded. When no profile is active, a
+// profiled acquisition costs one thread-local load more than a plain one.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_CONTENTION_PROFILER_H
+#define LLVM_SUPPORT_CONTENTION_PROFILER_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <chrono>
+
+namespace llvm {
+
+class raw_ostream;
+
+/// Locks shared between compiles that run on different threads.
+enum class ContentionSite : unsigned {
+  ManagedStatic, ///< Construction of a ManagedStatic on first use.
+  PassRegistry,  ///< The PassRegistry reader lock (not taken on Windows).
+  DxilLibrary,   ///< The dxil.dll loader.
+  ArgsCache,     ///< The parsed argument cache of a compiler object.
+  LastSite = ArgsCache
+};
+
+/// Counters for one site in one phase.
+struct ContentionCounters {
+  uint64_t Acquisitions = 0;
+  /// Acquisitions that found the lock held. Reader locks can not tell, and
+  /// only count acquisitions and wait time.
+  uint64_t Contended = 0;
+  /// Time spent acquiring, whether or not the lock was held.
+  uint64_t WaitNanoseconds = 0;
+};
+
+/// The counters recorded by one profile. Phases are numbered by the client
+/// (dxcompiler uses DxcMallocPhase); the current phase of each thread is set
+/// with contentionProfilerSetPhase.
+struct ContentionProfile {
+  static const unsigned kNumSites = (unsigned)ContentionSite::LastSite + 1;
+  static const unsigned kMaxPhases = 16;
+  ContentionCounters Counters[kMaxPhases][kNumSites];
+};
+
+extern LLVM_THREAD_LOCAL ContentionProfile *ContentionProfilerInstance;
+
+/// Starts recording the calling thread's acquisitions into \p Profile.
+void contentionProfilerBegin(ContentionProfile &Profile);
+
+/// Stops recording the calling thread's acquisitions.
+void contentionProfilerEnd();
+
+/// Is a profile active on the calling thread?
+inline bool contentionProfilerEnabled() {
+  return ContentionProfilerInstance != nullptr;
+}
+
+/// Sets the phase the calling thread's acquisitions are attributed to.
+void contentionProfilerSetPhase(unsigned Phase);
+
+/// Records one acquisition on the calling thread, if a profile is active.
+void contentionProfilerRecord(ContentionSite Site, bool Contended,
+                              std::chrono::steady_clock::duration Wait);
+
+/// Returns the name \p Site is reported under.
+const char *getContentionSiteName(ContentionSite Site);
+
+/// Writes \p Profile as JSON. Only phases below \p NumPhases that recorded
+/// an acquisition are listed, under the names \p PhaseName returns.
+void writeContentionProfile(raw_ostream &OS, const ContentionProfile &Profile,
+                            unsigned NumPhases,
+                            function_ref<const char *(unsigned)> PhaseName);
+
+/// Locks \p M, which must have lock and try_lock, recording the acquisition
+/// against \p Site.
+template <typename MutexT>
+inline void lockProfiled(MutexT &M, ContentionSite Site) {
+  if (LLVM_LIKELY(ContentionProfilerInstance == nullptr)) {
+    M.lock();
+    return;
+  }
+  if (M.try_lock()) {
+    contentionProfilerRecord(Site, false,
+                             std::chrono::steady_clock::duration::zero());
+    return;
+  }
+  std::chrono::steady_clock::time_point Start =
+      std::chrono::steady_clock::now();
+  M.lock();
+  contentionProfilerRecord(Site, true,
+                           std::chrono::steady_clock::now() - Start);
+}
+
+/// Acquires a lock by calling \p Acquire, recording the acquisition and the
+/// time it took against \p Site. For locks without try_lock.
+template <typename AcquireFn>
+inline void acquireProfiled(ContentionSite Site, AcquireFn Acquire) {
+  if (LLVM_LIKELY(ContentionProfilerInstance == nullptr)) {
+    Acquire();
+    return;
+  }
+  std::chrono::steady_clock::time_point Start =
+      std::chrono::steady_clock::now();
+  Acquire();
+  contentionProfilerRecord(Site, false,
+                           std::chrono::steady_clock::now() - Start);
+}
+
+/// Records the calling thread's acquisitions into a profile for the lifetime
+/// of the object.
+class ContentionProfileScope {
+  ContentionProfileScope(const ContentionProfileScope &) = delete;
+  ContentionProfileScope &operator=(const ContentionProfileScope &) = delete;
+
+public:
+  explicit ContentionProfileScope(ContentionProfile &Profile) {
+    contentionProfilerBegin(Profile);
+  }
+  ~ContentionProfileScope() { contentionProfilerEnd(); }
+};
+
+/// Like std::lock_guard, with the acquisition recorded against a site.
+template <typename MutexT> class ProfiledLockGuard {
+  MutexT &M;
+  ProfiledLockGuard(const ProfiledLockGuard &) = delete;
+  ProfiledLockGuard &operator=(const ProfiledLockGuard &) = delete;
+
+public:
+  ProfiledLockGuard(MutexT &M, ContentionSite Site) : M(M) {
+    lockProfiled(M, Site);
+  }
+  ~ProfiledLockGuard() { M.unlock(); }
+};
+
+} // end namespace llvm
+
+#endif
@@ -410,7 +410,8 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
        PassNo != e; ++PassNo) {
     Pass *P = getContainedPass(PassNo);
     // HLSL Change Begin - Support hierarchial time tracing.
-    TimeTraceScope PassScope("RunCallGraphSCCPass", P->getPassName());
+    TimeTraceScope PassScope("RunCallGraphSCCPass",
+                             [&]() { return P->getPassName().str(); });
     // HLSL Change End - Support hierarchial time tracing.
     
     // If we're in -debug-pass=Executions mode, construct the SCC node list,
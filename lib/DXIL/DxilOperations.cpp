@@ -2665,6 +2665,32 @@ unsigned OP::GetTypeSlot(Type *pType) {
   return UINT_MAX;
 }
 
+// Returns the overload slot of a type if the slot can only hold that type,
+// so it can index m_OpFuncCache, or UINT_MAX otherwise. Unlike GetTypeSlot,
+// pointers are not looked through.
+unsigned OP::GetOpFuncCacheSlot(Type *pType) {
+  switch (pType->getTypeID()) {
+  case Type::VoidTyID:
+  case Type::HalfTyID:
+  case Type::FloatTyID:
+  case Type::DoubleTyID:
+    return GetTypeSlot(pType);
+  case Type::IntegerTyID:
+    switch (cast<IntegerType>(pType)->getBitWidth()) {
+    case 1:
+    case 8:
+    case 16:
+    case 32:
+    case 64:
+      return GetTypeSlot(pType);
+    }
+    break;
+  default:
+    break;
+  }
+  return UINT_MAX;
+}
+
 const char *OP::GetOverloadTypeName(unsigned TypeSlot) {
   DXASSERT(TypeSlot < kUserDefineTypeSlot, "otherwise caller passed OOB index");
   return m_OverloadTypeName[TypeSlot];
@@ -3448,6 +3474,7 @@ OP::OP(LLVMContext &Ctx, Module *pModule)
   memset(m_pResRetType, 0, sizeof(m_pResRetType));
   memset(m_pCBufferRetType, 0, sizeof(m_pCBufferRetType));
   memset(m_OpCodeClassCache, 0, sizeof(m_OpCodeClassCache));
+  memset(m_OpFuncCache, 0, sizeof(m_OpFuncCache));
   static_assert(_countof(OP::m_OpCodeProps) == (size_t)OP::OpCode::NumOpCodes,
                 "forgot to update OP::m_OpCodeProps");
 
@@ -3573,11 +3600,22 @@ Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
   // Illegal overloads of DXIL intrinsics may survive through to final DXIL,
   // but these will be caught by the validator, and this is not a regression.
 
+  // Lowering asks for the same few overloads over and over, so look in the
+  // dense cache before hashing the type into the per-class map.
+  unsigned CacheSlot = GetOpFuncCacheSlot(pOverloadType);
+  Function **ppCachedF = CacheSlot < kUserDefineTypeSlot
+                             ? &m_OpFuncCache[(unsigned)opCode][CacheSlot]
+                             : nullptr;
+  if (ppCachedF && *ppCachedF)
+    return *ppCachedF;
+
   OpCodeClass opClass = m_OpCodeProps[(unsigned)opCode].opCodeClass;
   Function *&F =
       m_OpCodeClassCache[(unsigned)opClass].pOverloads[pOverloadType];
   if (F != nullptr) {
     UpdateCache(opClass, pOverloadType, F);
+    if (ppCachedF)
+      *ppCachedF = F;
     return F;
   }
 
@@ -5519,12 +5557,16 @@ Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
       return nullptr;
     F = existF;
     UpdateCache(opClass, pOverloadType, F);
+    if (ppCachedF)
+      *ppCachedF = F;
     return F;
   }
 
   F = cast<Function>(m_pModule->getOrInsertFunction(funcName, pFT));
 
   UpdateCache(opClass, pOverloadType, F);
+  if (ppCachedF)
+    *ppCachedF = F;
   F->setCallingConv(CallingConv::C);
   F->addFnAttr(Attribute::NoUnwind);
   if (m_OpCodeProps[(unsigned)opCode].FuncAttr != Attribute::None)
@@ -5564,6 +5606,14 @@ void OP::RemoveFunction(Function *F) {
         break;
       }
     }
+    // Every opcode of the class may have cached F.
+    for (unsigned i = 0; i < (unsigned)OpCode::NumOpCodes; i++) {
+      if (m_OpCodeProps[i].opCodeClass != opClass)
+        continue;
+      for (Function *&CachedF : m_OpFuncCache[i])
+        if (CachedF == F)
+          CachedF = nullptr;
+    }
   }
 }
 
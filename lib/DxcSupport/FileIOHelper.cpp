@@ -22,6 +22,8 @@
 
 #ifdef _WIN32
 #include <intsafe.h>
+#else
+#include <sys/mman.h>
 #endif
 
 // CP_UTF8 is defined in WinNls.h, but others we use are not defined there.
@@ -203,6 +205,16 @@ static bool IsUnsupportedUtfCodePage(UINT32 codePage) {
   return false;
 }
 
+// Is text in the ANSI code page the same as its conversion to UTF-8?
+static bool IsAcpBufferUtf8(const char *pBuffer, SIZE_T size) {
+#ifdef _WIN32
+  return Unicode::IsASCII(pBuffer, size);
+#else
+  // Outside Windows the ANSI code page is UTF-8.
+  return Unicode::IsValidUTF8(pBuffer, size);
+#endif
+}
+
 unsigned GetBomLengthFromBytes(const char *bytes, size_t byteLen) throw() {
   return GetBomLengthFromCodePage(DxcCodePageFromBytes(bytes, byteLen));
 }
@@ -421,10 +433,18 @@ static HRESULT CodePageBufferToWide(UINT32 codePage, LPCVOID bufferPointer,
   if (IsUnsupportedUtfCodePage(codePage))
     return DXC_E_STRING_ENCODING_FAILED;
 
+  // ASCII is the same in UTF-8 and in every ANSI code page, and is widened
+  // without MultiByteToWideChar.
+  bool isASCII = (codePage == CP_ACP || codePage == CP_UTF8) &&
+                 bufferSize <= INT_MAX &&
+                 Unicode::IsASCII((const char *)bufferPointer, bufferSize);
+
   // Calculate the length of the buffer in wchar_t elements.
   int numToConvertWide =
-      MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, (LPCSTR)bufferPointer,
-                          bufferSize, nullptr, 0);
+      isASCII ? (int)bufferSize
+              : MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS,
+                                    (LPCSTR)bufferPointer, bufferSize, nullptr,
+                                    0);
   if (numToConvertWide == 0)
     return HRESULT_FROM_WIN32(GetLastError());
 
@@ -436,9 +456,13 @@ static HRESULT CodePageBufferToWide(UINT32 codePage, LPCVOID bufferPointer,
   wideNewCopy.AllocateBytes(buffSizeWide);
   IFROOM(wideNewCopy.m_pData);
 
-  int numActuallyConvertedWide =
-      MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, (LPCSTR)bufferPointer,
-                          bufferSize, wideNewCopy, buffSizeWide);
+  int numActuallyConvertedWide = numToConvertWide;
+  if (isASCII)
+    Unicode::ASCIIToWide((const char *)bufferPointer, bufferSize, wideNewCopy);
+  else
+    numActuallyConvertedWide = MultiByteToWideChar(
+        codePage, MB_ERR_INVALID_CHARS, (LPCSTR)bufferPointer, bufferSize,
+        wideNewCopy, buffSizeWide / sizeof(WCHAR));
 
   if (numActuallyConvertedWide == 0)
     return HRESULT_FROM_WIN32(GetLastError());
@@ -817,6 +841,113 @@ DxcCreateBlobOnHeapCopy(LPCVOID pData, UINT32 size,
   return S_OK;
 }
 
+// Blob over a copy-on-write view of a file, with no encoding.
+class MappedFileBlob : public IDxcBlobEncoding {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  void *m_pView = nullptr;
+  SIZE_T m_Size = 0;
+
+public:
+  DXC_MICROCOM_ADDREF_IMPL(m_dwRef)
+  ULONG STDMETHODCALLTYPE Release() override {
+    // Like InternalDxcBlobEncoding_Impl, avoid TLS.
+    ULONG result = (ULONG)--m_dwRef;
+    if (result == 0) {
+      CComPtr<IMalloc> pTmp(m_pMalloc);
+      this->MappedFileBlob::~MappedFileBlob();
+      pTmp->Free(this);
+    }
+    return result;
+  }
+  DXC_MICROCOM_TM_CTOR(MappedFileBlob)
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcBlob, IDxcBlobEncoding>(this, iid,
+                                                             ppvObject);
+  }
+
+  ~MappedFileBlob() {
+    if (m_pView == nullptr)
+      return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_pView);
+#else
+    munmap(m_pView, m_Size);
+#endif
+  }
+
+  HRESULT Map(HANDLE hFile, SIZE_T size) {
+    DXASSERT_NOMSG(size != 0);
+#ifdef _WIN32
+    HANDLE hMapping =
+        CreateFileMappingW(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (hMapping == nullptr)
+      return HRESULT_FROM_WIN32(GetLastError());
+    CHandle mapping(hMapping);
+    m_pView = MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, size);
+    if (m_pView == nullptr)
+      return HRESULT_FROM_WIN32(GetLastError());
+#else
+    void *pView = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       (int)(size_t)hFile, 0);
+    if (pView == MAP_FAILED)
+      return HRESULT_FROM_WIN32(GetLastError());
+    m_pView = pView;
+#endif
+    m_Size = size;
+    return S_OK;
+  }
+
+  LPVOID STDMETHODCALLTYPE GetBufferPointer(void) override { return m_pView; }
+  SIZE_T STDMETHODCALLTYPE GetBufferSize(void) override { return m_Size; }
+  HRESULT STDMETHODCALLTYPE GetEncoding(BOOL *pKnown,
+                                        UINT32 *pCodePage) override {
+    *pKnown = FALSE;
+    *pCodePage = CP_ACP;
+    return S_OK;
+  }
+};
+
+static HRESULT MapBinaryFile(IMalloc *pMalloc, LPCWSTR pFileName,
+                             IDxcBlobEncoding **ppBlobEncoding) {
+  HANDLE hFile = CreateFileW(pFileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+
+  CHandle h(hFile);
+
+  LARGE_INTEGER FileSize;
+  if (!GetFileSizeEx(hFile, &FileSize)) {
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+  if (FileSize.u.HighPart != 0) {
+    return DXC_E_INPUT_FILE_TOO_LARGE;
+  }
+  if (FileSize.u.LowPart == 0)
+    return DxcCreateBlob(nullptr, 0, false, false, false, 0, pMalloc,
+                         ppBlobEncoding);
+
+  CComPtr<MappedFileBlob> pBlob = MappedFileBlob::Alloc(pMalloc);
+  IFROOM(pBlob.p);
+  IFR(pBlob->Map(hFile, FileSize.u.LowPart));
+  *ppBlobEncoding = pBlob.Detach();
+  return S_OK;
+}
+
+HRESULT DxcCreateBlobFromMappedFile(IMalloc *pMalloc, LPCWSTR pFileName,
+                                    IDxcBlobEncoding **ppBlobEncoding) throw() {
+  if (pFileName == nullptr || ppBlobEncoding == nullptr) {
+    return E_POINTER;
+  }
+  *ppBlobEncoding = nullptr;
+  if (!pMalloc)
+    pMalloc = DxcGetThreadMallocNoRef();
+  return MapBinaryFile(pMalloc, pFileName, ppBlobEncoding);
+}
+
 HRESULT
 DxcCreateBlobFromFile(IMalloc *pMalloc, LPCWSTR pFileName, UINT32 *pCodePage,
                       IDxcBlobEncoding **ppBlobEncoding) throw() {
@@ -966,6 +1097,11 @@ DxcGetBlobAsUtf8(IDxcBlob *pBlob, IMalloc *pMalloc,
     }
   }
 
+  // Reference or copy text in the ANSI code page that needs no conversion,
+  // rather than convert it to wide and back.
+  if (codePage == CP_ACP && IsAcpBufferUtf8(bufferPointer, blobLen))
+    codePage = CP_UTF8;
+
   if (!pMalloc)
     pMalloc = DxcGetThreadMallocNoRef();
 
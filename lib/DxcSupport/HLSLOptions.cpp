@@ -22,6 +22,7 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Option/Option.h"
+#include "llvm/Support/ContentionProfiler.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -208,6 +209,233 @@ StringRefWide::StringRefWide(llvm::StringRef value) {
     m_value = Unicode::UTF8ToWideStringOrThrow(value.data());
 }
 
+// 64-bit FNV-1a, used for argument list keys that must not change between
+// runs.
+static const uint64_t kArgsHashOffset = 14695981039346656037ULL;
+static const uint64_t kArgsHashPrime = 1099511628211ULL;
+
+template <typename CharT>
+static void HashArgChars(uint64_t &hash, const CharT *chars, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    hash ^= (uint64_t)(typename std::make_unsigned<CharT>::type)chars[i];
+    hash *= kArgsHashPrime;
+  }
+  // Terminate each argument so that "-a" "b" and "-ab" differ.
+  hash ^= 0xFF;
+  hash *= kArgsHashPrime;
+}
+
+std::shared_ptr<const DxcParsedArgs>
+DxcParsedArgs::Parse(const OptTable *optionTable, unsigned flagsToInclude,
+                     const MainArgs &argStrings) {
+  DXASSERT_NOMSG(optionTable != nullptr);
+  std::shared_ptr<DxcParsedArgs> parsed(new DxcParsedArgs());
+  parsed->m_strings = argStrings;
+  parsed->m_argv.append(parsed->m_strings.Utf8CharPtrVector.begin(),
+                        parsed->m_strings.Utf8CharPtrVector.end());
+  parsed->m_flagsToInclude = flagsToInclude;
+  parsed->m_args = llvm::make_unique<InputArgList>(optionTable->ParseArgs(
+      parsed->m_argv, parsed->m_missingArgIndex, parsed->m_missingArgCount,
+      flagsToInclude));
+
+  // Remember where the -D values are so that clones can replace them.
+  for (const Arg *A : parsed->m_args->filtered(OPT_D)) {
+    const char *value = A->getValue();
+    unsigned index = A->getIndex();
+    if (A->getSpelling().size() == strlen(parsed->m_argv[index]))
+      ++index; // Separate value.
+    DXASSERT(value >= parsed->m_argv[index] &&
+                 value <= parsed->m_argv[index] + strlen(parsed->m_argv[index]),
+             "else -D value is not part of its argument string");
+    parsed->m_defineValues.emplace_back(
+        index, (unsigned)(value - parsed->m_argv[index]));
+  }
+
+  parsed->ComputeHash();
+  return parsed;
+}
+
+void DxcParsedArgs::ComputeHash() {
+  uint64_t hash = kArgsHashOffset;
+  unsigned nextDefine = 0;
+  for (unsigned i = 0, e = m_argv.size(); i != e; ++i) {
+    size_t length = strlen(m_argv[i]);
+    if (nextDefine < m_defineValues.size() &&
+        m_defineValues[nextDefine].first == i)
+      length = m_defineValues[nextDefine++].second;
+    HashArgChars(hash, m_argv[i], length);
+  }
+  m_hash = hash;
+}
+
+std::shared_ptr<const DxcParsedArgs> DxcParsedArgs::CloneWithDefines(
+    llvm::ArrayRef<llvm::StringRef> defineValues) const {
+  if (defineValues.size() != m_defineValues.size())
+    return nullptr;
+
+  std::shared_ptr<DxcParsedArgs> clone(new DxcParsedArgs());
+  clone->m_base = m_base ? m_base : shared_from_this();
+  clone->m_argv = m_argv;
+  clone->m_defineValues = m_defineValues;
+  clone->m_flagsToInclude = m_flagsToInclude;
+  clone->m_missingArgIndex = m_missingArgIndex;
+  clone->m_missingArgCount = m_missingArgCount;
+  clone->m_hash = m_hash;
+
+  // Build all the replacement tokens before taking pointers to them.
+  std::vector<llvm::StringRef> tokens;
+  tokens.reserve(defineValues.size());
+  for (size_t i = 0; i < defineValues.size(); ++i) {
+    const DefineValueLoc &loc = m_defineValues[i];
+    std::string token(m_argv[loc.first], loc.second);
+    token += defineValues[i];
+    clone->m_strings.Utf8StringVector.emplace_back(std::move(token));
+  }
+  for (size_t i = 0; i < defineValues.size(); ++i) {
+    const char *token = clone->m_strings.Utf8StringVector[i].c_str();
+    clone->m_strings.Utf8CharPtrVector.push_back(token);
+    clone->m_argv[m_defineValues[i].first] = token;
+  }
+  return clone;
+}
+
+InputArgList DxcParsedArgs::CloneArgList(unsigned &missingArgIndex,
+                                         unsigned &missingArgCount) const {
+  const DxcParsedArgs &root = m_base ? *m_base : *this;
+  missingArgIndex = m_missingArgIndex;
+  missingArgCount = m_missingArgCount;
+
+  InputArgList Args(m_argv.begin(), m_argv.end());
+
+  // Point strings that live in the parsed argument strings at the same offset
+  // of ours; anything else (like alias spellings) is copied into the new list.
+  auto Rebase = [&](llvm::StringRef S, unsigned index) -> llvm::StringRef {
+    for (unsigned i = index, e = root.m_argv.size(); i < e; ++i) {
+      const char *token = root.m_argv[i];
+      if (S.data() >= token &&
+          S.data() <= token + root.m_strings.Utf8StringVector[i].size())
+        return llvm::StringRef(m_argv[i] + (S.data() - token), S.size());
+    }
+    return Args.MakeArgString(S);
+  };
+
+  for (const Arg *A : root.m_args->getArgs()) {
+    DXASSERT(&A->getBaseArg() == A, "else parsed list has derived arguments");
+    Arg *clone = new Arg(A->getOption(),
+                         Rebase(A->getSpelling(), A->getIndex()), A->getIndex());
+    for (const char *value : A->getValues()) {
+      if (A->getOwnsValues()) {
+        size_t size = strlen(value) + 1;
+        char *copy = new char[size];
+        memcpy(copy, value, size);
+        clone->getValues().push_back(copy);
+      } else {
+        clone->getValues().push_back(Rebase(value, A->getIndex()).data());
+      }
+    }
+    clone->setOwnsValues(A->getOwnsValues());
+    Args.append(clone);
+  }
+  return Args;
+}
+
+std::shared_ptr<const DxcParsedArgs>
+DxcParsedArgsCache::GetOrParse(const OptTable *optionTable,
+                               llvm::ArrayRef<LPCWSTR> args) {
+  // Find the -D values without converting or parsing. The parser has the
+  // final word: a list is only cached if it found the values in the same
+  // places, so a lexical hit is always safe to clone.
+  llvm::SmallVector<DxcParsedArgs::DefineValueLoc, 4> defineValues;
+  uint64_t key = kArgsHashOffset;
+  bool separateValue = false;
+  for (unsigned i = 0, e = args.size(); i != e; ++i) {
+    LPCWSTR arg = args[i];
+    size_t length = wcslen(arg);
+    if (separateValue) {
+      defineValues.emplace_back(i, 0);
+      length = 0;
+      separateValue = false;
+    } else if ((arg[0] == L'-' || arg[0] == L'/') && arg[1] == L'D') {
+      if (length > 2) {
+        defineValues.emplace_back(i, 2);
+        length = 2;
+      } else {
+        separateValue = true;
+      }
+    }
+    HashArgChars(key, arg, length);
+  }
+
+  auto MatchesIgnoringDefines = [&](const Entry &entry) {
+    if (entry.Key != key || entry.WideArgs.size() != args.size() ||
+        entry.Parsed->GetDefineValueLocs() != llvm::makeArrayRef(defineValues))
+      return false;
+    unsigned nextDefine = 0;
+    for (unsigned i = 0, e = args.size(); i != e; ++i) {
+      const std::wstring &cached = entry.WideArgs[i];
+      if (nextDefine < defineValues.size() &&
+          defineValues[nextDefine].first == i) {
+        size_t offset = defineValues[nextDefine++].second;
+        if (cached.compare(0, offset, args[i], offset) != 0)
+          return false;
+      } else if (cached.compare(args[i]) != 0) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // The lock is held only to find and promote the entry. Compiles sharing
+  // this compiler object serialize on it, so the cached arguments are
+  // compared in place rather than copied out.
+  std::shared_ptr<const DxcParsedArgs> cached;
+  bool sameDefines = true;
+  {
+    llvm::ProfiledLockGuard<std::mutex> lock(m_lock,
+                                             llvm::ContentionSite::ArgsCache);
+    for (auto it = m_entries.begin(), end = m_entries.end(); it != end; ++it) {
+      if (MatchesIgnoringDefines(*it)) {
+        m_entries.splice(m_entries.begin(), m_entries, it);
+        cached = it->Parsed;
+        for (const DxcParsedArgs::DefineValueLoc &loc : defineValues)
+          sameDefines &= it->WideArgs[loc.first].compare(args[loc.first]) == 0;
+        break;
+      }
+    }
+  }
+
+  if (cached) {
+    if (sameDefines)
+      return cached;
+
+    std::vector<std::string> utf8Values;
+    utf8Values.reserve(defineValues.size());
+    for (const DxcParsedArgs::DefineValueLoc &loc : defineValues)
+      utf8Values.emplace_back(
+          Unicode::WideToUTF8StringOrThrow(args[loc.first] + loc.second));
+    std::vector<llvm::StringRef> valueRefs(utf8Values.begin(),
+                                           utf8Values.end());
+    return cached->CloneWithDefines(valueRefs);
+  }
+
+  MainArgs mainArgs(args.size(), const_cast<const wchar_t **>(args.data()), 0);
+  std::shared_ptr<const DxcParsedArgs> parsed =
+      DxcParsedArgs::Parse(optionTable, m_flagsToInclude, mainArgs);
+  if (parsed->GetDefineValueLocs() != llvm::makeArrayRef(defineValues))
+    return parsed;
+
+  Entry entry;
+  entry.Key = key;
+  entry.WideArgs.assign(args.begin(), args.end());
+  entry.Parsed = parsed;
+  llvm::ProfiledLockGuard<std::mutex> lock(m_lock,
+                                           llvm::ContentionSite::ArgsCache);
+  m_entries.push_front(std::move(entry));
+  if (m_entries.size() > m_maxEntries)
+    m_entries.pop_back();
+  return parsed;
+}
+
 static bool GetTargetVersionFromString(llvm::StringRef ref, unsigned *major,
                                        unsigned *minor) {
   *major = *minor = -1;
@@ -364,18 +592,40 @@ LangStd parseHLSLVersion(llvm::StringRef Ver) {
 }
 namespace options {
 
+static int ReadDxcOptsFromArgs(InputArgList Args, unsigned flagsToInclude,
+                               unsigned missingArgIndex,
+                               unsigned missingArgCount, DxcOpts &opts,
+                               llvm::raw_ostream &errors);
+
 /// Reads all options from the given argument strings, populates opts, and
 /// validates reporting errors and warnings.
 int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
                 const MainArgs &argStrings, DxcOpts &opts,
                 llvm::raw_ostream &errors) {
   DXASSERT_NOMSG(optionTable != nullptr);
-  opts.DefaultTextCodePage = DXC_CP_UTF8;
-
   unsigned missingArgIndex = 0, missingArgCount = 0;
   InputArgList Args =
       optionTable->ParseArgs(argStrings.getArrayRef(), missingArgIndex,
                              missingArgCount, flagsToInclude);
+  return ReadDxcOptsFromArgs(std::move(Args), flagsToInclude, missingArgIndex,
+                             missingArgCount, opts, errors);
+}
+
+/// Reads all options from an already parsed argument list, populates opts,
+/// and validates reporting errors and warnings.
+int ReadDxcOpts(const DxcParsedArgs &parsedArgs, DxcOpts &opts,
+                llvm::raw_ostream &errors) {
+  unsigned missingArgIndex = 0, missingArgCount = 0;
+  InputArgList Args = parsedArgs.CloneArgList(missingArgIndex, missingArgCount);
+  return ReadDxcOptsFromArgs(std::move(Args), parsedArgs.GetFlagsToInclude(),
+                             missingArgIndex, missingArgCount, opts, errors);
+}
+
+static int ReadDxcOptsFromArgs(InputArgList Args, unsigned flagsToInclude,
+                               unsigned missingArgIndex,
+                               unsigned missingArgCount, DxcOpts &opts,
+                               llvm::raw_ostream &errors) {
+  opts.DefaultTextCodePage = DXC_CP_UTF8;
 
   // Set DefaultTextCodePage early so it may influence error buffer
   // Default to UTF8 for compatibility
@@ -613,6 +863,38 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   if (!limit.empty())
     opts.ScanLimit = std::stoul(std::string(limit));
 
+  opts.BatchFile = Args.getLastArgValue(OPT_batch);
+  opts.BatchDependencyFile = Args.getLastArgValue(OPT_batch_deps);
+  llvm::StringRef batchJobs = Args.getLastArgValue(OPT_batch_jobs);
+  if (!batchJobs.empty() && batchJobs.getAsInteger(10, opts.BatchJobs)) {
+    errors << "Invalid job count '" << batchJobs << "' for -j.";
+    return 1;
+  }
+  if (opts.BatchFile.empty() &&
+      (!opts.BatchDependencyFile.empty() || !batchJobs.empty())) {
+    errors << "-batch-deps and -j require -batch.";
+    return 1;
+  }
+  if (!opts.BatchFile.empty() && !opts.InputFile.empty()) {
+    errors << "Cannot specify an input file with -batch; each job names its "
+              "own input.";
+    return 1;
+  }
+
+  opts.ServerAddress = Args.getLastArgValue(OPT_server);
+  opts.ConnectAddress = Args.getLastArgValue(OPT_connect);
+  if (!opts.ServerAddress.empty() &&
+      (!opts.InputFile.empty() || !opts.BatchFile.empty() ||
+       !opts.ConnectAddress.empty())) {
+    errors << "Cannot specify an input file, -batch or -connect with -server; "
+              "clients send their own command lines.";
+    return 1;
+  }
+  if (!opts.ConnectAddress.empty() && !opts.BatchFile.empty()) {
+    errors << "Cannot specify -connect together with -batch.";
+    return 1;
+  }
+
   for (std::string opt : Args.getAllArgValues(OPT_opt_disable))
     opts.OptToggles.Toggles[llvm::StringRef(opt).lower()] = false;
 
@@ -786,6 +1068,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.EmbedDebug = Args.hasFlag(OPT_Qembed_debug, OPT_INVALID, false);
   opts.SourceInDebugModule =
       Args.hasFlag(OPT_Qsource_in_debug_module, OPT_INVALID, false);
+  opts.CompressSourcesPerFile =
+      Args.hasFlag(OPT_Qsource_compress_per_file, OPT_INVALID, false);
   opts.SourceOnlyDebug = Args.hasFlag(OPT_Zs, OPT_INVALID, false);
   opts.PdbInPrivate = Args.hasFlag(OPT_Qpdb_in_private, OPT_INVALID, false);
   opts.StripRootSignature =
@@ -821,6 +1105,9 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
                    DXIL::CompareVersions(Major, Minor, 6, 6) >= 0);
   opts.ForceDisableLocTracking =
       Args.hasFlag(OPT_fdisable_loc_tracking, OPT_INVALID, false);
+  opts.DiscardTeardown =
+      Args.hasFlag(OPT_fdiscard_teardown, OPT_INVALID, false) ||
+      Args.hasFlag(OPT_fdiscard_teardown_at_exit, OPT_INVALID, false);
   opts.NewInlining =
       Args.hasFlag(OPT_fnew_inlining_behavior, OPT_INVALID, false);
   opts.TimeReport = Args.hasFlag(OPT_ftime_report, OPT_INVALID, false);
@@ -828,6 +1115,14 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.VerifyDiagnostics = Args.hasFlag(OPT_verify, OPT_INVALID, false);
   if (Args.hasArg(OPT_ftime_trace_EQ))
     opts.TimeTrace = Args.getLastArgValue(OPT_ftime_trace_EQ);
+  opts.MemoryReport =
+      Args.hasFlag(OPT_fmemory_report, OPT_INVALID, false) ? "-" : "";
+  if (Args.hasArg(OPT_fmemory_report_EQ))
+    opts.MemoryReport = Args.getLastArgValue(OPT_fmemory_report_EQ);
+  opts.ContentionReport =
+      Args.hasFlag(OPT_fcontention_report, OPT_INVALID, false) ? "-" : "";
+  if (Args.hasArg(OPT_fcontention_report_EQ))
+    opts.ContentionReport = Args.getLastArgValue(OPT_fcontention_report_EQ);
   if (Arg *A = Args.getLastArg(OPT_ftime_trace_granularity_EQ)) {
     if (llvm::StringRef(A->getValue())
             .getAsInteger(10, opts.TimeTraceGranularity)) {
@@ -903,9 +1198,10 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   }
 
   if ((flagsToInclude & hlsl::options::DriverOption) &&
-      opts.InputFile.empty()) {
+      opts.InputFile.empty() && opts.BatchFile.empty() &&
+      opts.ServerAddress.empty()) {
     // Input file is required in arguments only for drivers; APIs take this
-    // through an argument.
+    // through an argument. Batch jobs and server clients name their own inputs.
     errors << "Required input file argument is missing. use -help to get more "
               "information.";
     return 1;
@@ -953,7 +1249,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   if ((flagsToInclude & hlsl::options::DriverOption) &&
       !(flagsToInclude & hlsl::options::RewriteOption) &&
       opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() &&
-      !opts.RecompileFromBinary) {
+      !opts.RecompileFromBinary && opts.BatchFile.empty() &&
+      opts.ServerAddress.empty()) {
     // Target profile is required in arguments only for drivers when compiling;
     // APIs take this through an argument.
     errors << "Target profile argument is missing";
@@ -1207,6 +1504,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
 
   opts.SpirvOptions.entrypointName =
       Args.getLastArgValue(OPT_fspv_entrypoint_name_EQ);
+  opts.SpirvOptions.legalizationCacheDir =
+      Args.getLastArgValue(OPT_fspv_legalization_cache_EQ);
 
   // Check for use of options not implemented in the SPIR-V backend.
   if (Args.hasFlag(OPT_spirv, OPT_INVALID, false) &&
@@ -1239,6 +1538,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       !Args.getLastArgValue(OPT_fspv_debug_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_extension_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_target_env_EQ).empty() ||
+      !Args.getLastArgValue(OPT_fspv_legalization_cache_EQ).empty() ||
       !Args.getLastArgValue(OPT_Oconfig).empty() ||
       !Args.getLastArgValue(OPT_fvk_bind_register).empty() ||
       !Args.getLastArgValue(OPT_fvk_bind_globals).empty() ||
@@ -11,8 +11,6 @@
 
 #ifdef _WIN32
 #include <specstrings.h>
-#else
-#include <clocale>
 #endif
 #include "dxc/Support/Global.h"
 #include "dxc/Support/Unicode.h"
@@ -20,112 +18,311 @@
 #include <assert.h>
 #include <string>
 
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DXC_UNICODE_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DXC_UNICODE_NEON
+#endif
+
+// Returns the length of the run of ASCII bytes that text starts with.
+static size_t CountLeadingASCII(const char *text, size_t cb) {
+  size_t i = 0;
+#if defined(DXC_UNICODE_SSE2)
+  for (; i + 16 <= cb; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+    if (_mm_movemask_epi8(v) != 0)
+      break;
+  }
+#elif defined(DXC_UNICODE_NEON)
+  for (; i + 16 <= cb; i += 16) {
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(text + i));
+    if (vmaxvq_u8(v) >= 0x80)
+      break;
+  }
+#endif
+  // Without vectors, and to find the first non-ASCII byte, go a word at a time.
+  for (; i + sizeof(uint64_t) <= cb; i += sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, text + i, sizeof(w));
+    if (w & 0x8080808080808080ULL)
+      break;
+  }
+  while (i < cb && (unsigned char)text[i] < 0x80)
+    ++i;
+  return i;
+}
+
+// Decodes the multi-byte UTF-8 sequence text starts with. Returns its length,
+// or zero if it is truncated or overlong, or encodes a surrogate or a value
+// above U+10FFFF.
+static size_t DecodeUTF8Sequence(const char *text, const char *end,
+                                 uint32_t *pValue) {
+  static const uint32_t MinValue[] = {0, 0, 0x80, 0x800, 0x10000};
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(text);
+  unsigned char lead = p[0];
+  size_t len;
+  uint32_t value;
+  if (lead < 0xC2) // Continuation byte, or overlong two-byte sequence.
+    return 0;
+  if (lead < 0xE0) {
+    len = 2;
+    value = lead & 0x1F;
+  } else if (lead < 0xF0) {
+    len = 3;
+    value = lead & 0x0F;
+  } else if (lead < 0xF5) {
+    len = 4;
+    value = lead & 0x07;
+  } else {
+    return 0;
+  }
+  if ((size_t)(end - text) < len)
+    return 0;
+  for (size_t i = 1; i < len; ++i) {
+    if ((p[i] & 0xC0) != 0x80)
+      return 0;
+    value = (value << 6) | (p[i] & 0x3F);
+  }
+  if (value < MinValue[len] || value > 0x10FFFF ||
+      (value >= 0xD800 && value <= 0xDFFF))
+    return 0;
+  *pValue = value;
+  return len;
+}
+
+namespace Unicode {
+
+bool IsASCII(const char *text, size_t cb) {
+  return CountLeadingASCII(text, cb) == cb;
+}
+
+bool IsValidUTF8(const char *text, size_t cb) {
+  const char *p = text;
+  const char *end = text + cb;
+  for (;;) {
+    p += CountLeadingASCII(p, end - p);
+    if (p == end)
+      return true;
+    uint32_t value;
+    size_t len = DecodeUTF8Sequence(p, end, &value);
+    if (len == 0)
+      return false;
+    p += len;
+  }
+}
+
+void ASCIIToWide(const char *text, size_t cb, wchar_t *pWide) {
+  size_t i = 0;
+#if defined(DXC_UNICODE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= cb; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    __m128i *out = reinterpret_cast<__m128i *>(pWide + i);
+#ifdef _WIN32
+    // wchar_t holds UTF-16.
+    _mm_storeu_si128(out, lo);
+    _mm_storeu_si128(out + 1, hi);
+#else
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+#endif
+  }
+#endif
+  for (; i < cb; ++i)
+    pWide[i] = (unsigned char)text[i];
+}
+
+} // namespace Unicode
+
 #ifndef _WIN32
+static_assert(sizeof(wchar_t) == 4, "wchar_t is expected to hold UTF-32");
+
+// Returns the length of the run of ASCII characters that text starts with.
+static size_t CountLeadingASCII(const wchar_t *text, size_t cch) {
+  size_t i = 0;
+#if defined(DXC_UNICODE_SSE2)
+  const __m128i nonASCII = _mm_set1_epi32(~0x7F);
+  for (; i + 8 <= cch; i += 8) {
+    const __m128i *in = reinterpret_cast<const __m128i *>(text + i);
+    __m128i v = _mm_or_si128(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+    v = _mm_and_si128(v, nonASCII);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, _mm_setzero_si128())) != 0xFFFF)
+      break;
+  }
+#endif
+  while (i < cch && (uint32_t)text[i] < 0x80)
+    ++i;
+  return i;
+}
+
+// Narrows cch ASCII characters of text into pOut.
+static void WideToASCII(const wchar_t *text, size_t cch, char *pOut) {
+  size_t i = 0;
+#if defined(DXC_UNICODE_SSE2)
+  for (; i + 16 <= cch; i += 16) {
+    const __m128i *in = reinterpret_cast<const __m128i *>(text + i);
+    // The values are below 0x80, so the saturating packs only truncate.
+    __m128i lo = _mm_packs_epi32(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+    __m128i hi =
+        _mm_packs_epi32(_mm_loadu_si128(in + 2), _mm_loadu_si128(in + 3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut + i),
+                     _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < cch; ++i)
+    pOut[i] = (char)text[i];
+}
+
 // MultiByteToWideChar which is a Windows-specific method.
-// This is a very simplistic implementation for non-Windows platforms. This
-// implementation completely ignores CodePage and dwFlags.
+// This implementation for non-Windows platforms converts from UTF-8 to UTF-32
+// and ignores CodePage and dwFlags; malformed input always fails with
+// ERROR_NO_UNICODE_TRANSLATION.
 int MultiByteToWideChar(uint32_t /*CodePage*/, uint32_t /*dwFlags*/,
                         const char *lpMultiByteStr, int cbMultiByte,
                         wchar_t *lpWideCharStr, int cchWideChar) {
 
-  if (cbMultiByte == 0) {
+  if (lpMultiByteStr == nullptr || cbMultiByte == 0 || cbMultiByte < -1 ||
+      cchWideChar < 0) {
     SetLastError(ERROR_INVALID_PARAMETER);
     return 0;
   }
 
   // if cbMultiByte is -1, it indicates that lpMultiByteStr is null-terminated
-  // and the entire string should be processed.
-  if (cbMultiByte == -1) {
-    for (cbMultiByte = 0; lpMultiByteStr[cbMultiByte] != '\0'; ++cbMultiByte)
-      ;
-    // Add 1 for the null-terminating character.
-    ++cbMultiByte;
-  }
+  // and the entire string should be processed, including the terminator.
+  size_t cb = cbMultiByte == -1 ? strlen(lpMultiByteStr) + 1 : cbMultiByte;
+
   // If zero is given as the destination size, this function should
-  // return the required size (including the null-terminating character).
-  // This is the behavior of mbstowcs when the target is null.
-  if (cchWideChar == 0) {
-    lpWideCharStr = nullptr;
-  } else if (cchWideChar < cbMultiByte) {
-    SetLastError(ERROR_INSUFFICIENT_BUFFER);
-    return 0;
+  // return the required size, which includes the null-terminating character
+  // only if the input does.
+  const char *p = lpMultiByteStr;
+  const char *end = p + cb;
+  size_t cch = 0;
+  for (;;) {
+    size_t ascii = CountLeadingASCII(p, end - p);
+    if (cchWideChar != 0) {
+      if ((size_t)cchWideChar - cch < ascii) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      Unicode::ASCIIToWide(p, ascii, lpWideCharStr + cch);
+    }
+    p += ascii;
+    cch += ascii;
+    if (p == end)
+      break;
+
+    uint32_t value;
+    size_t len = DecodeUTF8Sequence(p, end, &value);
+    if (len == 0) {
+      SetLastError(ERROR_NO_UNICODE_TRANSLATION);
+      return 0;
+    }
+    if (cchWideChar != 0) {
+      if ((size_t)cchWideChar == cch) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      lpWideCharStr[cch] = (wchar_t)value;
+    }
+    p += len;
+    ++cch;
   }
-
-  size_t rv;
-  const char *prevLocale = setlocale(LC_ALL, nullptr);
-  setlocale(LC_ALL, "en_US.UTF-8");
-  if (lpMultiByteStr[cbMultiByte - 1] != '\0') {
-    char *srcStr = (char *)malloc((cbMultiByte + 1) * sizeof(char));
-    strncpy(srcStr, lpMultiByteStr, cbMultiByte);
-    srcStr[cbMultiByte] = '\0';
-    rv = mbstowcs(lpWideCharStr, srcStr, cchWideChar);
-    free(srcStr);
-  } else {
-    rv = mbstowcs(lpWideCharStr, lpMultiByteStr, cchWideChar);
+  if (cch > INT_MAX) {
+    SetLastError(ERROR_ARITHMETIC_OVERFLOW);
+    return 0;
   }
-
-  if (prevLocale)
-    setlocale(LC_ALL, prevLocale);
-
-  if (rv == (size_t)cbMultiByte)
-    return rv;
-  return rv + 1; // mbstowcs excludes the terminating character
+  return (int)cch;
 }
 
 // WideCharToMultiByte is a Windows-specific method.
-// This is a very simplistic implementation for non-Windows platforms. This
-// implementation completely ignores CodePage and dwFlags.
+// This implementation for non-Windows platforms converts from UTF-32 to UTF-8
+// and ignores CodePage and dwFlags; surrogates and values above U+10FFFF
+// always fail with ERROR_NO_UNICODE_TRANSLATION.
 int WideCharToMultiByte(uint32_t /*CodePage*/, uint32_t /*dwFlags*/,
                         const wchar_t *lpWideCharStr, int cchWideChar,
                         char *lpMultiByteStr, int cbMultiByte,
                         const char * /*lpDefaultChar*/,
                         // Mach change start
                         // bool * /*lpUsedDefaultChar*/) {
-                        LPBOOL /*lpUsedDefaultChar*/) {
+                        LPBOOL lpUsedDefaultChar) {
                         // Mach change end
 
-  if (cchWideChar == 0) {
+  if (lpWideCharStr == nullptr || cchWideChar == 0 || cchWideChar < -1 ||
+      cbMultiByte < 0) {
     SetLastError(ERROR_INVALID_PARAMETER);
     return 0;
   }
+  // Nothing is ever replaced with the default character.
+  if (lpUsedDefaultChar != nullptr)
+    *lpUsedDefaultChar = FALSE;
 
   // if cchWideChar is -1, it indicates that lpWideCharStr is null-terminated
-  // and the entire string should be processed.
-  if (cchWideChar == -1) {
-    for (cchWideChar = 0; lpWideCharStr[cchWideChar] != '\0'; ++cchWideChar)
-      ;
-    // Add 1 for the null-terminating character.
-    ++cchWideChar;
-  }
+  // and the entire string should be processed, including the terminator.
+  size_t cch = cchWideChar == -1 ? wcslen(lpWideCharStr) + 1 : cchWideChar;
+
   // If zero is given as the destination size, this function should
-  // return the required size (including the null-terminating character).
-  // This is the behavior of wcstombs when the target is null.
-  if (cbMultiByte == 0) {
-    lpMultiByteStr = nullptr;
-  } else if (cbMultiByte < cchWideChar) {
-    SetLastError(ERROR_INSUFFICIENT_BUFFER);
-    return 0;
+  // return the required size, which includes the null-terminating character
+  // only if the input does.
+  const wchar_t *p = lpWideCharStr;
+  const wchar_t *end = p + cch;
+  size_t cb = 0;
+  for (;;) {
+    size_t ascii = CountLeadingASCII(p, end - p);
+    if (cbMultiByte != 0) {
+      if ((size_t)cbMultiByte - cb < ascii) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      WideToASCII(p, ascii, lpMultiByteStr + cb);
+    }
+    p += ascii;
+    cb += ascii;
+    if (p == end)
+      break;
+
+    uint32_t value = (uint32_t)*p++;
+    char encoded[4];
+    size_t len;
+    if (value < 0x800) {
+      len = 2;
+      encoded[0] = (char)(0xC0 | (value >> 6));
+    } else if (value < 0x10000) {
+      if (value >= 0xD800 && value <= 0xDFFF) {
+        SetLastError(ERROR_NO_UNICODE_TRANSLATION);
+        return 0;
+      }
+      len = 3;
+      encoded[0] = (char)(0xE0 | (value >> 12));
+    } else if (value <= 0x10FFFF) {
+      len = 4;
+      encoded[0] = (char)(0xF0 | (value >> 18));
+    } else {
+      SetLastError(ERROR_NO_UNICODE_TRANSLATION);
+      return 0;
+    }
+    for (size_t i = 1; i < len; ++i)
+      encoded[i] = (char)(0x80 | ((value >> (6 * (len - 1 - i))) & 0x3F));
+    if (cbMultiByte != 0) {
+      if ((size_t)cbMultiByte - cb < len) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      memcpy(lpMultiByteStr + cb, encoded, len);
+    }
+    cb += len;
   }
-
-  size_t rv;
-  const char *prevLocale = setlocale(LC_ALL, nullptr);
-  setlocale(LC_ALL, "en_US.UTF-8");
-  if (lpWideCharStr[cchWideChar - 1] != L'\0') {
-    wchar_t *srcStr = (wchar_t *)malloc((cchWideChar + 1) * sizeof(wchar_t));
-    wcsncpy(srcStr, lpWideCharStr, cchWideChar);
-    srcStr[cchWideChar] = L'\0';
-    rv = wcstombs(lpMultiByteStr, srcStr, cbMultiByte);
-    free(srcStr);
-  } else {
-    rv = wcstombs(lpMultiByteStr, lpWideCharStr, cbMultiByte);
+  if (cb > INT_MAX) {
+    SetLastError(ERROR_ARITHMETIC_OVERFLOW);
+    return 0;
   }
-
-  if (prevLocale)
-    setlocale(LC_ALL, prevLocale);
-
-  if (rv == (size_t)cchWideChar)
-    return rv;
-  return rv + 1; // mbstowcs excludes the terminating character
+  return (int)cb;
 }
 #endif // _WIN32
 
@@ -11,15 +11,17 @@
 #include "dxc/Support/WinIncludes.h"
 
 #include "assert.h"
-#include "dxc/Support/microcom.h"
 
 #if defined(_WIN32) && !defined(DXC_DISABLE_ALLOCATOR_OVERRIDES)
 // CoGetMalloc from combaseapi.h is used
 #else
+// Like the COM task allocator, there is a single process-wide instance that
+// is never freed. Every object that holds the default IMalloc references it,
+// so it keeps no reference count: otherwise every AddRef and Release on any
+// thread would write the same cache line.
 struct DxcCoMalloc : public IMalloc {
-  DxcCoMalloc() : m_dwRef(0){};
-
-  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+  ULONG STDMETHODCALLTYPE Release() override { return 1; }
   STDMETHODIMP QueryInterface(REFIID riid, void **ppvObject) override {
     assert(false && "QueryInterface not implemented for DxcCoMalloc.");
     return E_NOINTERFACE;
@@ -33,14 +35,11 @@ struct DxcCoMalloc : public IMalloc {
   SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override { return -1; }
   int STDMETHODCALLTYPE DidAlloc(void *pv) override { return -1; }
   void STDMETHODCALLTYPE HeapMinimize(void) override {}
-
-private:
-  DXC_MICROCOM_REF_FIELD(m_dwRef)
 };
 
 HRESULT DxcCoGetMalloc(DWORD dwMemContext, IMalloc **ppMalloc) {
-  *ppMalloc = new DxcCoMalloc;
-  (*ppMalloc)->AddRef();
+  static DxcCoMalloc s_Malloc;
+  *ppMalloc = &s_Malloc;
   return S_OK;
 }
-#endif
\ No newline at end of file
+#endif
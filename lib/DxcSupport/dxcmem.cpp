@@ -10,13 +10,17 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/Support/Global.h"
+#include "dxc/Support/DxcMallocAccountant.h"
 #ifdef _WIN32
 #include <specstrings.h>
 #endif
 
 #include "dxc/Support/WinFunctions.h"
 #include "dxc/Support/WinIncludes.h"
+#include "llvm/Support/ContentionProfiler.h"
 #include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <memory>
 
 static llvm::sys::ThreadLocal<IMalloc> *g_ThreadMallocTls;
@@ -134,4 +138,151 @@ void DxcDelete(void *ptr) throw() {
     // CoGetMalloc, Free & Release for better perf.
     CoTaskMemFree(ptr);
   }
-}
\ No newline at end of file
+}
+
+static thread_local DxcMallocPhase g_ThreadMallocPhase = DxcMallocPhase::Other;
+
+DxcMallocPhase DxcGetThreadMallocPhase() throw() {
+  return g_ThreadMallocPhase;
+}
+
+static_assert((unsigned)DxcMallocPhase::LastPhase <
+                  llvm::ContentionProfile::kMaxPhases,
+              "contention profiles must have room for every phase");
+
+void DxcSetThreadMallocPhase(DxcMallocPhase phase) throw() {
+  g_ThreadMallocPhase = phase;
+  llvm::contentionProfilerSetPhase((unsigned)phase);
+}
+
+namespace hlsl {
+
+void DxcMallocAccountant::Track(void *pv, SIZE_T cb) {
+  std::lock_guard<std::mutex> lock(m_Lock);
+  {
+    // The map must not allocate through this accountant.
+    DxcThreadMalloc TM(m_pMalloc);
+    m_Sizes[pv] = cb;
+  }
+  m_LiveBytes += cb;
+
+  Stats &phase = m_Phases[(unsigned)DxcGetThreadMallocPhase()];
+  ++phase.AllocCount;
+  phase.AllocBytes += cb;
+  phase.PeakBytes = std::max(phase.PeakBytes, m_LiveBytes);
+  ++m_Totals.AllocCount;
+  m_Totals.AllocBytes += cb;
+  m_Totals.PeakBytes = std::max(m_Totals.PeakBytes, m_LiveBytes);
+}
+
+bool DxcMallocAccountant::Untrack(void *pv) {
+  std::lock_guard<std::mutex> lock(m_Lock);
+  auto it = m_Sizes.find(pv);
+  if (it == m_Sizes.end())
+    return false;
+  m_LiveBytes -= it->second;
+  m_Sizes.erase(it);
+  return true;
+}
+
+void *STDMETHODCALLTYPE DxcMallocAccountant::Alloc(SIZE_T cb) {
+  void *pv = m_pMalloc->Alloc(cb);
+  if (pv)
+    Track(pv, cb);
+  return pv;
+}
+
+void *STDMETHODCALLTYPE DxcMallocAccountant::Realloc(void *pv, SIZE_T cb) {
+  if (pv == nullptr)
+    return Alloc(cb);
+  void *pNew = m_pMalloc->Realloc(pv, cb);
+  // Blocks the accountant did not allocate stay uncounted once resized.
+  if ((pNew || cb == 0) && Untrack(pv) && pNew)
+    Track(pNew, cb);
+  return pNew;
+}
+
+void STDMETHODCALLTYPE DxcMallocAccountant::Free(void *pv) {
+  if (pv)
+    Untrack(pv);
+  m_pMalloc->Free(pv);
+}
+
+SIZE_T STDMETHODCALLTYPE DxcMallocAccountant::GetSize(void *pv) {
+  return m_pMalloc->GetSize(pv);
+}
+
+int STDMETHODCALLTYPE DxcMallocAccountant::DidAlloc(void *pv) {
+  return m_pMalloc->DidAlloc(pv);
+}
+
+void STDMETHODCALLTYPE DxcMallocAccountant::HeapMinimize(void) {
+  m_pMalloc->HeapMinimize();
+}
+
+DxcMallocAccountant::Stats DxcMallocAccountant::GetTotals() const {
+  std::lock_guard<std::mutex> lock(m_Lock);
+  return m_Totals;
+}
+
+DxcMallocAccountant::Stats
+DxcMallocAccountant::GetPhaseStats(DxcMallocPhase phase) const {
+  std::lock_guard<std::mutex> lock(m_Lock);
+  return m_Phases[(unsigned)phase];
+}
+
+const char *DxcMallocAccountant::GetPhaseName(DxcMallocPhase phase) {
+  switch (phase) {
+  case DxcMallocPhase::Other:
+    return "other";
+  case DxcMallocPhase::Parse:
+    return "parse";
+  case DxcMallocPhase::Sema:
+    return "sema";
+  case DxcMallocPhase::CodeGen:
+    return "codegen";
+  case DxcMallocPhase::HLPasses:
+    return "hl-passes";
+  case DxcMallocPhase::DxilPasses:
+    return "dxil-passes";
+  case DxcMallocPhase::Validation:
+    return "validation";
+  case DxcMallocPhase::Container:
+    return "container";
+  }
+  return "unknown";
+}
+
+static void WriteStatsJson(llvm::raw_ostream &OS,
+                           const DxcMallocAccountant::Stats &stats) {
+  OS << "\"allocations\": " << stats.AllocCount
+     << ", \"allocatedBytes\": " << stats.AllocBytes
+     << ", \"peakBytes\": " << stats.PeakBytes;
+}
+
+void DxcMallocAccountant::WriteJson(llvm::raw_ostream &OS,
+                                    bool includesOperatorNew) const {
+  // Writing to OS may allocate through this accountant, which takes the
+  // lock, so only the snapshot is taken under it.
+  Stats totals;
+  Stats phases[kNumPhases];
+  {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    totals = m_Totals;
+    std::copy(std::begin(m_Phases), std::end(m_Phases), phases);
+  }
+
+  OS << "{ \"includesOperatorNew\": "
+     << (includesOperatorNew ? "true" : "false") << ",\n  ";
+  WriteStatsJson(OS, totals);
+  OS << ",\n  \"phases\": [";
+  for (unsigned i = 0; i < kNumPhases; ++i) {
+    OS << (i ? ",\n" : "\n") << "    { \"name\": \""
+       << GetPhaseName((DxcMallocPhase)i) << "\", ";
+    WriteStatsJson(OS, phases[i]);
+    OS << " }";
+  }
+  OS << "\n  ]\n}\n";
+}
+
+} // namespace hlsl
@@ -16,11 +16,10 @@ uint32_t RDATTable::InsertImpl(const void *ptr, size_t size) {
   IFTBOOL(m_RecordStride <= size, DXC_E_GENERAL_INTERNAL_ERROR);
   size_t count = m_rows.size();
   if (count < (UINT32_MAX - 1)) {
-    const char *pData = (const char *)ptr;
     auto result = m_map.insert(
-        std::make_pair(std::string(pData, pData + m_RecordStride), count));
+        std::make_pair(StringRef((const char *)ptr, m_RecordStride), count));
     if (!m_bDeduplicationEnabled || result.second) {
-      m_rows.emplace_back(result.first->first);
+      m_rows.emplace_back(result.first->getKey());
       return count;
     } else {
       return result.first->second;
@@ -50,13 +49,12 @@ uint32_t RDATTable::GetPartSize() const {
 }
 
 uint32_t RawBytesPart::Insert(const void *pData, size_t dataSize) {
-  auto result = m_Map.insert(std::make_pair(
-      std::string((const char *)pData, (const char *)pData + dataSize),
-      m_Size));
+  auto result = m_Map.insert(
+      std::make_pair(StringRef((const char *)pData, dataSize), m_Size));
   auto iterator = result.first;
   if (result.second) {
-    const std::string &key = iterator->first;
-    m_List.push_back(llvm::StringRef(key.data(), key.size()));
+    StringRef key = iterator->getKey();
+    m_List.push_back(key);
     m_Size += key.size();
   }
   return iterator->second;
@@ -176,13 +174,12 @@ public:
 
 // returns the offset of the name inserted
 uint32_t StringBufferPart::Insert(llvm::StringRef str) {
-  auto result = m_Map.insert(
-      std::make_pair(std::string(str.data(), str.data() + str.size()), m_Size));
+  auto result = m_Map.insert(std::make_pair(str, m_Size));
 
   auto iterator = result.first;
   if (result.second) {
-    const std::string &key = iterator->first;
-    m_List.push_back(llvm::StringRef(key.data(), key.size()));
+    StringRef key = iterator->getKey();
+    m_List.push_back(key);
     m_Size += key.size() + 1 /*null terminator*/;
   }
   return iterator->second;
@@ -11,8 +11,12 @@
 
 #include "DxilDiaSession.h"
 
+#include <algorithm>
+#include <tuple>
+
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
@@ -62,6 +66,16 @@ void dxil_dia::Session::Init(std::shared_ptr<llvm::LLVMContext> context,
   if (!m_arguments)
     m_arguments = m_module->getNamedMetadata("llvm.dbg.args");
 
+  // Map source file names to their index in the contents.
+  if (m_contents != nullptr) {
+    for (unsigned i = 0; i < m_contents->getNumOperands(); ++i) {
+      llvm::StringRef fn = llvm::dyn_cast<llvm::MDString>(
+                               m_contents->getOperand(i)->getOperand(0))
+                               ->getString();
+      m_sourceFileIds.insert({fn, i});
+    }
+  }
+
   // Build up a linear list of instructions. The index will be used as the
   // RVA.
   std::vector<llvm::Function *> allInstrumentableFunctions =
@@ -96,6 +110,24 @@ void dxil_dia::Session::Init(std::shared_ptr<llvm::LLVMContext> context,
     DXASSERT(m_rvaMap[It->second] == It->first,
              "instruction mapped to wrong rva");
   }
+
+  // Build the lookup indices used by the findLines* queries, so that they
+  // don't need to walk the line number table.
+  m_rvaIndex.assign(m_instructions.begin(), m_instructions.end());
+
+  m_lineIndex.reserve(m_instructionLines.size());
+  for (const llvm::Instruction *I : m_instructionLines) {
+    const llvm::DebugLoc &DL = I->getDebugLoc();
+    DWORD fileId;
+    if (getSourceFileIdByScope(DL.getScope(), &fileId) != S_OK)
+      fileId = kNoSourceFileId;
+    m_lineIndex.push_back({fileId, DL.getLine(), DL.getCol(), I});
+  }
+  std::stable_sort(m_lineIndex.begin(), m_lineIndex.end(),
+                   [](const LineIndexEntry &L, const LineIndexEntry &R) {
+                     return std::tie(L.FileId, L.Line) <
+                            std::tie(R.FileId, R.Line);
+                   });
 }
 
 const dxil_dia::SymbolManager &dxil_dia::Session::SymMgr() {
@@ -112,16 +144,25 @@ const dxil_dia::SymbolManager &dxil_dia::Session::SymMgr() {
 
 HRESULT dxil_dia::Session::getSourceFileIdByName(llvm::StringRef fileName,
                                                  DWORD *pRetVal) {
-  if (Contents() != nullptr) {
-    for (unsigned i = 0; i < Contents()->getNumOperands(); ++i) {
-      llvm::StringRef fn = llvm::dyn_cast<llvm::MDString>(
-                               Contents()->getOperand(i)->getOperand(0))
-                               ->getString();
-      if (fn.equals(fileName)) {
-        *pRetVal = i;
-        return S_OK;
-      }
-    }
+  auto It = m_sourceFileIds.find(fileName);
+  if (It != m_sourceFileIds.end()) {
+    *pRetVal = It->second;
+    return S_OK;
+  }
+  *pRetVal = 0;
+  return S_FALSE;
+}
+
+HRESULT dxil_dia::Session::getSourceFileIdByScope(llvm::MDNode *pScope,
+                                                  DWORD *pRetVal) {
+  auto *pBlock = llvm::dyn_cast_or_null<llvm::DILexicalBlock>(pScope);
+  if (pBlock != nullptr) {
+    return getSourceFileIdByName(pBlock->getFile()->getFilename(), pRetVal);
+  }
+  auto *pSubProgram = llvm::dyn_cast_or_null<llvm::DISubprogram>(pScope);
+  if (pSubProgram != nullptr) {
+    return getSourceFileIdByName(pSubProgram->getFile()->getFilename(),
+                                 pRetVal);
   }
   *pRetVal = 0;
   return S_FALSE;
@@ -232,14 +273,23 @@ static HRESULT DxcDiaFindLineNumbersByRVA(Session *pSession, DWORD rva,
     return E_POINTER;
 
   std::vector<const llvm::Instruction *> instructions;
-  auto &allInstructions = pSession->InstructionsRef();
-
-  // Gather the list of insructions that map to the given rva range.
-  for (DWORD i = rva; i < rva + length; ++i) {
-    auto It = allInstructions.find(i);
-    if (It == allInstructions.end())
+  auto &rvaIndex = pSession->RVAIndexRef();
+
+  // Gather the list of insructions that map to the given rva range. RVAs in
+  // the index are unique and sorted, so the range is fully mapped exactly when
+  // its last rva is found length - 1 entries after the first one.
+  auto First = std::lower_bound(
+      rvaIndex.begin(), rvaIndex.end(), rva,
+      [](const std::pair<Session::RVA, const llvm::Instruction *> &Entry,
+         DWORD Rva) { return Entry.first < Rva; });
+  if (length != 0) {
+    if (First == rvaIndex.end() ||
+        (size_t)(rvaIndex.end() - First) < (size_t)length ||
+        First->first != rva || First[length - 1].first != rva + length - 1)
       return E_INVALIDARG;
+  }
 
+  for (auto It = First, End = First + length; It != End; ++It) {
     // Only include the instruction if it has debug info for line mappings.
     const llvm::Instruction *inst = It->second;
     if (inst->getDebugLoc())
@@ -296,44 +346,25 @@ STDMETHODIMP dxil_dia::Session::findLinesByLinenum(
   *ppResult = nullptr;
 
   DxcThreadMalloc TM(m_pMalloc);
-  CComPtr<IDiaTable> pTable;
-  VARIANT vtIndex;
-  vtIndex.vt = VT_UI4;
-  vtIndex.uintVal = (int)Table::Kind::LineNumbers;
-  IFR(m_pEnumTables->Item(vtIndex, &pTable));
-
-  CComPtr<IDiaEnumLineNumbers> pLineTable;
-  IFR(pTable->QueryInterface(&pLineTable));
-  HRESULT hr;
-  CComPtr<IDiaLineNumber> line;
-  ULONG cnt;
-  std::vector<const llvm::Instruction *> lines;
-
-  std::function<bool(DWORD, DWORD)> column_matches =
-      [](DWORD colStart, DWORD colEnd) -> bool { return true; };
-
-  if (column != 0) {
-    column_matches = [column](DWORD colStart, DWORD colEnd) -> bool {
-      return colStart < column && column < colEnd;
-    };
+  DWORD fileId = kNoSourceFileId;
+  if (file != nullptr) {
+    IFR(file->get_uniqueId(&fileId));
   }
 
-  pLineTable->Reset();
-  while (SUCCEEDED(hr = pLineTable->Next(1, &line, &cnt)) && hr == S_OK &&
-         cnt == 1) {
-    CComPtr<IDiaSourceFile> f;
-    DWORD ln, lnEnd, cn, cnEnd;
-    IFR(line->get_lineNumber(&ln));
-    IFR(line->get_lineNumberEnd(&lnEnd));
-    IFR(line->get_columnNumber(&cn));
-    IFR(line->get_columnNumberEnd(&cnEnd));
-    IFR(line->get_sourceFile(&f));
-
-    if (file == f && (ln <= linenum && linenum <= lnEnd) &&
-        column_matches(cn, cnEnd)) {
-      lines.emplace_back(reinterpret_cast<LineNumber *>(line.p)->Inst());
-    }
-    line.Release();
+  // Look up the instructions for the line in the (file, line) index. Each
+  // entry spans a single line and column, as reported by LineNumber.
+  std::vector<const llvm::Instruction *> lines;
+  auto Range = std::equal_range(
+      m_lineIndex.begin(), m_lineIndex.end(),
+      LineIndexEntry{fileId, linenum, 0, nullptr},
+      [](const LineIndexEntry &L, const LineIndexEntry &R) {
+        return std::tie(L.FileId, L.Line) < std::tie(R.FileId, R.Line);
+      });
+  for (auto It = Range.first; It != Range.second; ++It) {
+    DWORD colStart = It->Column, colEnd = It->Column;
+    if (column != 0 && !(colStart < column && column < colEnd))
+      continue;
+    lines.emplace_back(It->Inst);
   }
 
   HRESULT result = lines.empty() ? S_FALSE : S_OK;
@@ -20,6 +20,8 @@
 
 #include "dia2.h"
 
+#include "llvm/ADT/StringMap.h"
+
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/dxcpix.h"
 
@@ -45,6 +47,22 @@ public:
   };
   using LineToInfoMap = std::unordered_map<std::uint32_t, LineInfo>;
 
+  // Entry in the (file, line) index over instructions with line info. Entries
+  // are sorted by file and line, and otherwise keep the order of
+  // InstructionLinesRef().
+  struct LineIndexEntry {
+    std::uint32_t FileId;
+    std::uint32_t Line;
+    std::uint32_t Column;
+    const llvm::Instruction *Inst;
+  };
+  using LineIndex = std::vector<LineIndexEntry>;
+  using RVAIndex = std::vector<std::pair<RVA, const llvm::Instruction *>>;
+
+  // File id used in the line index for instructions whose scope does not
+  // resolve to a source file.
+  static constexpr std::uint32_t kNoSourceFileId = UINT32_MAX;
+
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(Session)
 
@@ -72,8 +90,11 @@ public:
   const LineToInfoMap &LineToColumnStartMapRef() const {
     return m_lineToInfoMap;
   }
+  const LineIndex &LineIndexRef() const { return m_lineIndex; }
+  const RVAIndex &RVAIndexRef() const { return m_rvaIndex; }
 
   HRESULT getSourceFileIdByName(llvm::StringRef fileName, DWORD *pRetVal);
+  HRESULT getSourceFileIdByScope(llvm::MDNode *pScope, DWORD *pRetVal);
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
                                            void **ppvObject) override {
@@ -499,6 +520,9 @@ private:
   std::unordered_map<const llvm::Instruction *, RVA>
       m_rvaMap; // Map instruction to its RVA.
   LineToInfoMap m_lineToInfoMap;
+  LineIndex m_lineIndex; // Sorted by (file, line).
+  RVAIndex m_rvaIndex;   // Sorted by RVA.
+  llvm::StringMap<DWORD> m_sourceFileIds; // Map file name to its id.
   std::unique_ptr<SymbolManager> m_symsMgr;
 
 private:
@@ -122,19 +122,7 @@ STDMETHODIMP dxil_dia::LineNumber::get_statement(
 
 STDMETHODIMP dxil_dia::LineNumber::get_sourceFileId(
     /* [retval][out] */ DWORD *pRetVal) {
-  llvm::MDNode *pScope = DL().getScope();
-  auto *pBlock = llvm::dyn_cast_or_null<llvm::DILexicalBlock>(pScope);
-  if (pBlock != nullptr) {
-    return m_pSession->getSourceFileIdByName(pBlock->getFile()->getFilename(),
-                                             pRetVal);
-  }
-  auto *pSubProgram = llvm::dyn_cast_or_null<llvm::DISubprogram>(pScope);
-  if (pSubProgram != nullptr) {
-    return m_pSession->getSourceFileIdByName(
-        pSubProgram->getFile()->getFilename(), pRetVal);
-  }
-  *pRetVal = 0;
-  return S_FALSE;
+  return m_pSession->getSourceFileIdByScope(DL().getScope(), pRetVal);
 }
 
 STDMETHODIMP dxil_dia::LineNumber::get_compilandId(
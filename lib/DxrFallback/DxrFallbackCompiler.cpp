@@ -14,13 +14,17 @@
 #include "dxc/dxcapi.h"
 #include "dxc/dxcdxrfallbackcompiler.h"
 
+#include "llvm/ADT/SetVector.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -30,7 +34,9 @@
 #include "StateFunctionTransform.h"
 #include "runtime.h"
 
+#include <atomic>
 #include <queue>
+#include <thread>
 
 using namespace hlsl;
 using namespace llvm;
@@ -194,6 +200,8 @@ void DxrFallbackCompiler::setDebugOutputLevel(int val) {
   m_debugOutputLevel = val;
 }
 
+void DxrFallbackCompiler::setThreadCount(unsigned val) { m_threadCount = val; }
+
 static bool isShader(Function *F) {
   if (F->hasFnAttribute("exp-shader"))
     return true;
@@ -492,6 +500,299 @@ static void collectResources(DxilModule &DM, std::set<Value *> &resources) {
     resources.insert(r->GetGlobalSymbol());
 }
 
+namespace {
+// Settings for the state function transform of one shader. They are computed
+// from the DxilModule up front so that the transform itself does not need it.
+struct ShaderTransformInfo {
+  std::vector<StateFunctionTransform::ParameterSemanticType> paramTypes;
+  bool hasParameterInfo = false;
+  bool useCommittedAttr = false;
+  int attributeSize = -1;
+
+  void configure(StateFunctionTransform &sft) const {
+    if (attributeSize >= 0)
+      sft.setAttributeSize(attributeSize);
+    if (hasParameterInfo)
+      sft.setParameterInfo(paramTypes, useCommittedAttr);
+  }
+};
+
+// A shader extracted into a module of its own, so that it can be transformed
+// on another thread in a separate LLVMContext.
+struct ShaderTransformJob {
+  std::string functionName;
+  ShaderTransformInfo info;
+  std::string inputBitcode;
+  std::vector<std::string> resourceNames;
+  // Main module globals with local linkage, declared as
+  // localPlaceholderName(i) in the extracted module.
+  std::vector<GlobalValue *> locals;
+
+  std::string outputBitcode;
+  std::vector<std::string> stateFunctionNames;
+  unsigned stackSize = 0;
+  std::exception_ptr error;
+};
+} // namespace
+
+static std::string localPlaceholderName(size_t index) {
+  return "dxr.fallback.local." + std::to_string(index);
+}
+
+static std::string writeBitcode(const Module &M) {
+  std::string bitcode;
+  raw_string_ostream OS(bitcode);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+  return bitcode;
+}
+
+// Collects the globals referenced by F, directly or through constants.
+static bool collectReferencedGlobals(Function *F,
+                                     SetVector<GlobalValue *> &globals) {
+  SmallPtrSet<Constant *, 32> visited;
+  SmallVector<Constant *, 32> worklist;
+  for (auto &I : inst_range(F)) {
+    for (Value *op : I.operands()) {
+      Constant *C = dyn_cast<Constant>(op);
+      if (C && visited.insert(C).second)
+        worklist.push_back(C);
+    }
+  }
+
+  while (!worklist.empty()) {
+    Constant *C = worklist.pop_back_val();
+    if (isa<GlobalAlias>(C))
+      return false;
+    if (GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+      if (GV != F)
+        globals.insert(GV);
+      continue;
+    }
+    for (Value *op : C->operands()) {
+      Constant *opC = dyn_cast<Constant>(op);
+      if (opC && visited.insert(opC).second)
+        worklist.push_back(opC);
+    }
+  }
+  return true;
+}
+
+static GlobalValue *declareGlobal(Module &M, GlobalValue *GV,
+                                  ShaderTransformJob &job) {
+  std::string name = GV->getName();
+  if (GV->hasLocalLinkage() || !GV->hasName()) {
+    name = localPlaceholderName(job.locals.size());
+    job.locals.push_back(GV);
+  }
+
+  if (Function *F = dyn_cast<Function>(GV)) {
+    Function *decl = Function::Create(F->getFunctionType(),
+                                      GlobalValue::ExternalLinkage, name, &M);
+    decl->setAttributes(F->getAttributes());
+    decl->setCallingConv(F->getCallingConv());
+    return decl;
+  }
+
+  GlobalVariable *var = cast<GlobalVariable>(GV);
+  return new GlobalVariable(M, var->getType()->getElementType(),
+                            var->isConstant(), GlobalValue::ExternalLinkage,
+                            nullptr, name, nullptr, var->getThreadLocalMode(),
+                            var->getType()->getAddressSpace());
+}
+
+// Copies F into a new module that only declares the globals F uses and writes
+// that module into job.inputBitcode. Globals with local linkage cannot be
+// resolved by name when linking back, so they are declared under placeholder
+// names instead.
+static bool extractShader(Function *F, const std::set<Value *> &resources,
+                          ShaderTransformJob &job) {
+  SetVector<GlobalValue *> globals;
+  if (!collectReferencedGlobals(F, globals))
+    return false;
+  // The transform takes the runtime data type from this declaration.
+  Module *mainModule = F->getParent();
+  globals.insert(mainModule->getFunction("stackIntPtr"));
+
+  Module M(F->getName(), F->getContext());
+  M.setDataLayout(mainModule->getDataLayout());
+  M.setTargetTriple(mainModule->getTargetTriple());
+
+  ValueToValueMapTy VMap;
+  for (GlobalValue *GV : globals) {
+    GlobalValue *decl = declareGlobal(M, GV, job);
+    VMap[GV] = decl;
+    if (resources.count(GV))
+      job.resourceNames.push_back(decl->getName());
+  }
+
+  Function *clone = Function::Create(
+      F->getFunctionType(), GlobalValue::ExternalLinkage, F->getName(), &M);
+  VMap[F] = clone;
+  for (auto SI = F->arg_begin(), SE = F->arg_end(), DI = clone->arg_begin();
+       SI != SE; ++SI, ++DI) {
+    DI->setName(SI->getName());
+    VMap[SI] = DI;
+  }
+  SmallVector<ReturnInst *, 4> returns;
+  CloneFunctionInto(clone, F, VMap, false, returns);
+
+  job.functionName = F->getName();
+  job.inputBitcode = writeBitcode(M);
+
+  // Constants created while remapping still refer to the declarations.
+  M.dropAllReferences();
+  for (GlobalValue &GV : M.globals())
+    GV.removeDeadConstantUsers();
+  for (GlobalValue &GV : M.functions())
+    GV.removeDeadConstantUsers();
+  return true;
+}
+
+static void removeUnusedDeclarations(Module &M) {
+  for (auto F = M.begin(), E = M.end(); F != E;) {
+    Function *cur = F++;
+    if (cur->isDeclaration() && cur->use_empty())
+      cur->eraseFromParent();
+  }
+  for (auto GV = M.global_begin(), E = M.global_end(); GV != E;) {
+    GlobalVariable *cur = GV++;
+    if (cur->isDeclaration() && cur->use_empty())
+      cur->eraseFromParent();
+  }
+}
+
+static void runShaderTransformJob(ShaderTransformJob &job,
+                                  const std::vector<std::string> &shaderNames) {
+  LLVMContext context;
+  ErrorOr<std::unique_ptr<Module>> M = parseBitcodeFile(
+      MemoryBufferRef(job.inputBitcode, job.functionName), context);
+  IFTLLVM(M.getError());
+  Module *mod = M.get().get();
+
+  std::set<Value *> resources;
+  for (const std::string &name : job.resourceNames)
+    resources.insert(mod->getNamedValue(name));
+  Type *runtimeDataArgTy =
+      mod->getFunction("stackIntPtr")->arg_begin()->getType();
+
+  StateFunctionTransform sft(mod->getFunction(job.functionName), shaderNames,
+                             runtimeDataArgTy);
+  job.info.configure(sft);
+  sft.setResourceGlobals(resources);
+  std::vector<Function *> stateFunctions;
+  sft.run(stateFunctions, job.stackSize);
+  for (Function *stateF : stateFunctions)
+    job.stateFunctionNames.push_back(stateF->getName());
+
+  removeUnusedDeclarations(*mod);
+  job.outputBitcode = writeBitcode(*mod);
+}
+
+static ShaderTransformInfo getShaderTransformInfo(Function *F,
+                                                  const std::string &shader,
+                                                  unsigned maxAttributeSize) {
+  ShaderTransformInfo info;
+  if (shader == "Fallback_TraceRay")
+    info.attributeSize = maxAttributeSize;
+  DXIL::ShaderKind shaderKind = getRayShaderKind(F);
+  if (shaderKind != DXIL::ShaderKind::Invalid) {
+    info.paramTypes = getParameterTypes(F, shaderKind);
+    info.hasParameterInfo = true;
+    info.useCommittedAttr = shaderKind == DXIL::ShaderKind::ClosestHit;
+  }
+  return info;
+}
+
+bool DxrFallbackCompiler::transformShadersInParallel(
+    const std::vector<std::string> &shaderNames,
+    const std::set<Value *> &resources,
+    std::vector<std::vector<Function *>> &stateFunctions,
+    std::vector<unsigned int> &stackSizes) {
+  unsigned threadCount =
+      m_threadCount ? m_threadCount : std::thread::hardware_concurrency();
+  if (m_debugOutputLevel >= 2 || shaderNames.size() < 2 || threadCount < 2)
+    return false;
+  // Debug info metadata refers to functions outside the extracted shader.
+  if (m_module->getNamedMetadata("llvm.dbg.cu"))
+    return false;
+
+  std::vector<ShaderTransformJob> jobs(shaderNames.size());
+  for (size_t i = 0; i < shaderNames.size(); ++i) {
+    Function *F = m_shaderMap[shaderNames[i]];
+    if (!F || !extractShader(F, resources, jobs[i]))
+      return false;
+    jobs[i].info =
+        getShaderTransformInfo(F, shaderNames[i], m_maxAttributeSize);
+  }
+
+  // LLVMContext is not thread safe, so each job owns its context and only
+  // exchanges bitcode with this thread.
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  sys::fs::MSFileSystem *fileSystem = sys::fs::GetCurrentThreadFileSystem();
+  std::atomic<size_t> nextJob(0);
+  auto worker = [&]() {
+    DxcThreadMalloc TM(pMalloc);
+    sys::fs::AutoPerThreadSystem pts(fileSystem);
+    for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+      try {
+        runShaderTransformJob(jobs[i], shaderNames);
+      } catch (...) {
+        jobs[i].error = std::current_exception();
+      }
+    }
+  };
+  threadCount = std::min<size_t>(threadCount, jobs.size());
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+  for (unsigned i = 0; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  for (std::thread &t : threads)
+    t.join();
+
+  for (ShaderTransformJob &job : jobs) {
+    if (job.error)
+      std::rethrow_exception(job.error);
+  }
+
+  // Leave the original shaders as declarations, as the transform does when it
+  // runs in place.
+  for (const std::string &shader : shaderNames) {
+    Function *F = m_shaderMap[shader];
+    F->deleteBody();
+    F->setName(cleanName(F->getName()));
+  }
+
+  // Link the results back in shader order so the output does not depend on
+  // which thread finished first.
+  LLVMContext &context = m_module->getContext();
+  Linker linker(m_module);
+  stateFunctions.assign(jobs.size(), std::vector<Function *>());
+  stackSizes.assign(jobs.size(), 0);
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    ShaderTransformJob &job = jobs[i];
+    ErrorOr<std::unique_ptr<Module>> M = parseBitcodeFile(
+        MemoryBufferRef(job.outputBitcode, job.functionName), context);
+    IFTLLVM(M.getError());
+    IFTBOOL(!linker.linkInModule(M.get().get()), E_FAIL);
+
+    for (size_t l = 0; l < job.locals.size(); ++l) {
+      GlobalValue *placeholder =
+          m_module->getNamedValue(localPlaceholderName(l));
+      if (!placeholder)
+        continue;
+      placeholder->replaceAllUsesWith(
+          ConstantExpr::getBitCast(job.locals[l], placeholder->getType()));
+      placeholder->eraseFromParent();
+    }
+
+    for (const std::string &name : job.stateFunctionNames)
+      stateFunctions[i].push_back(m_module->getFunction(name));
+    stackSizes[i] = job.stackSize;
+  }
+  return true;
+}
+
 void DxrFallbackCompiler::createStateFunctions(
     IntToFuncMap &stateFunctionMap, std::vector<int> &shaderEntryStateIds,
     std::vector<unsigned int> &shaderStackSizes, int baseStateId,
@@ -505,30 +806,37 @@ void DxrFallbackCompiler::createStateFunctions(
   std::set<Value *> resources;
   collectResources(DM, resources);
 
+  // The shaders are transformed independently of each other, so they only
+  // need to be run one at a time when that is cheaper or required for the
+  // debug output.
+  std::vector<std::vector<Function *>> stateFunctions;
+  std::vector<unsigned int> stackSizes;
+  if (!transformShadersInParallel(shaderNames, resources, stateFunctions,
+                                  stackSizes)) {
+    stateFunctions.assign(shaderNames.size(), std::vector<Function *>());
+    stackSizes.assign(shaderNames.size(), 0);
+    for (size_t i = 0; i < shaderNames.size(); ++i) {
+      Function *F = m_shaderMap[shaderNames[i]];
+      StateFunctionTransform sft(F, shaderNames, runtimeDataArgTy);
+      if (m_debugOutputLevel >= 2)
+        sft.setVerbose(true);
+      if (m_debugOutputLevel >= 3)
+        sft.setDumpFilename("dump.ll");
+      getShaderTransformInfo(F, shaderNames[i], m_maxAttributeSize)
+          .configure(sft);
+      sft.setResourceGlobals(resources);
+      sft.run(stateFunctions[i], stackSizes[i]);
+    }
+  }
+
   shaderEntryStateIds.clear();
   shaderStackSizes.clear();
   int stateId = baseStateId;
-  for (auto &shader : shaderNames) {
-    std::vector<Function *> stateFunctions;
-    Function *F = m_shaderMap[shader];
-    StateFunctionTransform sft(F, shaderNames, runtimeDataArgTy);
-    if (m_debugOutputLevel >= 2)
-      sft.setVerbose(true);
-    if (m_debugOutputLevel >= 3)
-      sft.setDumpFilename("dump.ll");
-    if (shader == "Fallback_TraceRay")
-      sft.setAttributeSize(m_maxAttributeSize);
-    DXIL::ShaderKind shaderKind = getRayShaderKind(F);
-    if (shaderKind != DXIL::ShaderKind::Invalid)
-      sft.setParameterInfo(getParameterTypes(F, shaderKind),
-                           shaderKind == DXIL::ShaderKind::ClosestHit);
-    sft.setResourceGlobals(resources);
-    UINT shaderStackSize = 0;
-    sft.run(stateFunctions, shaderStackSize);
-
+  for (size_t i = 0; i < shaderNames.size(); ++i) {
+    Function *F = m_shaderMap[shaderNames[i]];
     shaderEntryStateIds.push_back(stateId);
-    shaderStackSizes.push_back(shaderStackSize);
-    for (Function *stateF : stateFunctions) {
+    shaderStackSizes.push_back(stackSizes[i]);
+    for (Function *stateF : stateFunctions[i]) {
       stateFunctionMap[stateId++] = stateF;
       if (DM.HasDxilFunctionProps(F)) {
         DM.CloneDxilEntryProps(F, stateF);
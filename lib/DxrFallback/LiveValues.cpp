@@ -1,5 +1,7 @@
 #include "LiveValues.h"
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
@@ -19,19 +21,22 @@ applyMapping(InstructionSetVector &iset,
   }
 }
 
-// Compute liveness of a value at basic blocks. Roughly based on
-// Algorithm 6 & 7 from the paper "Computing Liveness Sets for SSA-
-// Form Programs" by Brander et al., 2011.
+// Liveness is computed with a standard backward dataflow over the blocks of
+// the function. Every instruction that has uses gets a dense number, in
+// function order, so that block live-in and live-out sets are bit vectors.
+// Phi operands are treated as used on the edge from their incoming block, so
+// they are live out of that block but not live into the phi's block.
+//
+// A value is live at a call site if it is live across it: it is needed after
+// the call site and it is not the call site itself.
 
 LiveValues::LiveValues(ArrayRef<Instruction *> computeLiveAt) {
   m_liveSets.resize(computeLiveAt.size());
 
-  // Build index and set of active blocks
+  // Build index
   for (unsigned int i = 0; i < computeLiveAt.size(); i++) {
     Instruction *v = computeLiveAt[i];
     m_computeLiveAtIndex.insert(std::make_pair(v, i));
-
-    m_activeBlocks.insert(v->getParent());
   }
 
   if (computeLiveAt.size() > 0) {
@@ -39,191 +44,139 @@ LiveValues::LiveValues(ArrayRef<Instruction *> computeLiveAt) {
   }
 }
 
-// Go over all the instructions between begin (included) and end (excluded) and
-// mark the given value live for code locations contained in the given range.
-void LiveValues::markLiveRange(Instruction *value, BasicBlock::iterator begin,
-                               BasicBlock::iterator end) {
-  BasicBlock *B = begin->getParent();
+namespace {
+struct BlockLiveness {
+  BitVector LiveIn;
+  BitVector LiveOut;
+  SmallVector<unsigned, 8> UpwardExposedUses; // Uses not defined in the block.
+  SmallVector<unsigned, 4> PhiUses; // Uses by phis in the block's successors.
+};
+} // namespace
 
-  if (m_activeBlocks.count(B) == 0)
-    return; // Nothing to mark in this block
+void LiveValues::run() {
+  if (m_computeLiveAtIndex.empty())
+    return;
 
-  for (BasicBlock::iterator I = begin; I != end; ++I) {
-    if (m_computeLiveAtIndex.count(I)) {
-      // Mark this value
-      unsigned int index = m_computeLiveAtIndex[I];
-      m_liveSets[index].insert(value);
-      m_allLiveSet.insert(value);
-      // Also store for each value where it is live.
-      m_liveAtIndices[value].insert(index);
-    }
+  // Number the values in function order.
+  std::vector<Instruction *> values;
+  DenseMap<const Value *, unsigned> valueIds;
+  for (inst_iterator I = inst_begin(m_function), E = inst_end(m_function);
+       I != E; ++I) {
+    if (I->use_empty())
+      continue;
+    valueIds[&*I] = values.size();
+    values.push_back(&*I);
   }
-}
-
-void LiveValues::upAndMark(Instruction *def, Use &use, BlockSet &scanned) {
-  // Determine the starting point for the backwards search.
-  // (Remember that Use represents an edge between the definition of a value and
-  // its use) In the case in which the user of the use is a phi node we start
-  // the search from the terminator of the preceding block. This allows to avoid
-  // going through loop back-edges in cases like these:
-  //                 |
-  //                 | (y)
-  //                 v
-  //          -----------------
-  //     (x)  | z = phi(x, y) |
-  //    ----> | ...           |
-  //    |     | x = z + 1     |
-  //    |     -----------------
-  //    |             |
-  //    |             |
-  //    |             |
-  //    |             v
-  //    |     -----------------
-  //    |     |               |
-  //    ------| INDIRECT CALL |
-  //          |               |
-  //          -----------------
-  //                  | (Start the search for the definition of x (backwards)
-  //                  from here!)
-  //                  v
-  //
-  // Notice that here x is live across the call. This case is tricky because the
-  // def comes 'after' the use. The def still dominates the use because phi
-  // nodes logically use their input values on the edges, i.e. on the terminator
-  // of the preceding blocks.
-  //
-  // This has the advantage of being able to traverse edges strictly backwards.
-
-  Instruction *startingPoint = dyn_cast<Instruction>(use.getUser());
-  if (PHINode *usePHI = dyn_cast<PHINode>(startingPoint)) {
-    BasicBlock *predecessor = usePHI->getIncomingBlock(use);
-    startingPoint = predecessor->getTerminator();
+  const unsigned numValues = values.size();
+
+  DenseMap<const BasicBlock *, unsigned> blockIds;
+  std::vector<BlockLiveness> blocks(m_function->size());
+  for (BasicBlock &B : *m_function) {
+    unsigned blockId = blockIds.size();
+    blockIds[&B] = blockId;
+    blocks[blockId].LiveIn.resize(numValues);
+    blocks[blockId].LiveOut.resize(numValues);
   }
 
-  BasicBlock *startingPointBB = startingPoint->getParent();
-  BasicBlock *defBB = def->getParent();
-
-  // Start a bottom-up recursive search from startingPoint to the definition of
-  // the current value. Mark all the code ranges that we encounter on the way a
-  // having the current value 'live'. 'scanned' contains the blocks that we have
-  // scanned to the bottom of the block and the we know already having the
-  // current value 'live'.
-
-  SmallVector<BasicBlock *, 16> worklist;
-  worklist.push_back(startingPointBB);
-
-  BlockSet visited;
+  // Gather the uses of each block.
+  for (BasicBlock &B : *m_function) {
+    BlockLiveness &info = blocks[blockIds[&B]];
+    for (Instruction &I : B) {
+      if (PHINode *phi = dyn_cast<PHINode>(&I)) {
+        for (unsigned i = 0, e = phi->getNumIncomingValues(); i != e; ++i) {
+          auto it = valueIds.find(phi->getIncomingValue(i));
+          if (it != valueIds.end())
+            blocks[blockIds[phi->getIncomingBlock(i)]].PhiUses.push_back(
+                it->second);
+        }
+        continue;
+      }
+      for (Use &U : I.operands()) {
+        Instruction *op = dyn_cast<Instruction>(U.get());
+        if (op && op->getParent() != &B)
+          info.UpwardExposedUses.push_back(valueIds[op]);
+      }
+    }
+  }
 
+  // Iterate to a fixed point, visiting blocks bottom-up first.
+  SmallVector<BasicBlock *, 32> worklist;
+  SmallPtrSet<BasicBlock *, 32> inWorklist;
+  for (BasicBlock &B : *m_function) {
+    worklist.push_back(&B);
+    inWorklist.insert(&B);
+  }
+  BitVector liveIn(numValues);
   while (!worklist.empty()) {
     BasicBlock *B = worklist.pop_back_val();
+    inWorklist.erase(B);
+    BlockLiveness &info = blocks[blockIds[B]];
+
+    for (succ_iterator S = succ_begin(B), SE = succ_end(B); S != SE; ++S)
+      info.LiveOut |= blocks[blockIds[*S]].LiveIn;
+    for (unsigned id : info.PhiUses)
+      info.LiveOut.set(id);
+
+    liveIn = info.LiveOut;
+    for (Instruction &I : *B) {
+      auto it = valueIds.find(&I);
+      if (it != valueIds.end())
+        liveIn.reset(it->second);
+    }
+    for (unsigned id : info.UpwardExposedUses)
+      liveIn.set(id);
 
-    if (scanned.count(B) != 0)
+    if (liveIn == info.LiveIn)
       continue;
-
-    // We have reached the block that contains the definition of the value. We
-    // are done for this branch of the search.
-    if (B == defBB) {
-      if (defBB == startingPointBB) {
-        // If the first block that we visit is also the last mark only the range
-        // of instructions between the def and the starting point.
-        //    -----------------
-        //    |               |
-        //    | x = // def    |  <--
-        //    |               |    !
-        //    |               |    ! This is the range in which x is live.
-        //    |               |    !
-        //    | = x // use    |  <--
-        //    |               |
-        //    -----------------
-
-        markLiveRange(def, ++BasicBlock::iterator(def),
-                      BasicBlock::iterator(startingPoint));
-      } else {
-        markLiveRange(def, ++BasicBlock::iterator(def), defBB->end());
-        scanned.insert(B);
-      }
-    } else {
-      if (B == startingPointBB) {
-        // We are in the starting-point block.
-        // This can mean two things:
-        // 1. We are in the first iteration, mark the range between begin and
-        // starting point as live.
-        if (visited.count(B) == 0) {
-          markLiveRange(def, B->begin(), BasicBlock::iterator(startingPoint));
-        }
-        // 2. We came back here because the starting point is in a loop.
-        // In this case mark the whole block as live range and don't come back
-        // anymore.
-        else {
-          markLiveRange(def, B->begin(), B->end());
-          scanned.insert(B);
-        }
-
-        // The if statement above allows to manage situations like this:
-        //         BB0
-        //        -----------------
-        //        | x = ...       |
-        //        -----------------
-        //                |
-        //                |
-        //                |
-        //         BB1    v
-        //        -----------------<--                     <--
-        //        |               |  !                       !
-        //  ----->|               |  ! First range marked    !
-        //  |     |               |  !                       !
-        //  |     | ... = x       |<--                       ! Second and final
-        //  range marked |     |               |                          ! | |
-        //  INDIRECT CALL |                          ! |     |               | !
-        //  |     -----------------                        <--
-        //  |              |
-        //  ---------------
-        // x is defined outside a loop and used inside a loop. This means that
-        // it is live inside the whole loop. So, we first mark the range from
-        // the use of x to the top of BB1 and, when we visit BB1 again (because
-        // BB1 is a predecessor of BB1) we mark the whole block as live range.
-        // <rant>
-        // This case could have been managed much more easily and efficiently if
-        // we had access to LLVM LoopInfo analysis pass. We could have done the
-        // following: x is uses in a loop and defined outside of it => mark the
-        // whole loop body as live range.
-        // </rant>
-      } else {
-        // We are in an intermediate block on the way to the definition mark it,
-        // all as live range.
-        markLiveRange(def, B->begin(), B->end());
-        scanned.insert(B);
-      }
-
-      visited.insert(B);
-
-      for (pred_iterator P = pred_begin(B), PE = pred_end(B); P != PE; ++P) {
+    info.LiveIn = liveIn;
+    for (pred_iterator P = pred_begin(B), PE = pred_end(B); P != PE; ++P) {
+      if (inWorklist.insert(*P).second)
         worklist.push_back(*P);
-      }
     }
   }
-}
 
-void LiveValues::run() {
-  if (m_computeLiveAtIndex.empty())
-    return;
-
-  // for each variable v do
-  for (inst_iterator I = inst_begin(m_function), E = inst_end(m_function);
-       I != E; ++I) {
-    Instruction *v = &*I;
-    assert(v->getParent()->getParent() == m_function);
-
-    // for each block B where v is used do
-    BlockSet scanned;
-    for (Value::use_iterator U = v->use_begin(), UE = v->use_end(); U != UE;
-         ++U) {
-      Instruction *user = cast<Instruction>(U->getUser());
-      assert(user->getParent()->getParent() == m_function);
-      (void)user;
+  // Walk each block with call sites backwards from its live-out set.
+  std::vector<BitVector> liveAt(m_liveSets.size());
+  SetVector<BasicBlock *> activeBlocks;
+  for (auto &kv : m_computeLiveAtIndex)
+    activeBlocks.insert(kv.first->getParent());
+  BitVector live;
+  for (BasicBlock *B : activeBlocks) {
+    live = blocks[blockIds[B]].LiveOut;
+    for (BasicBlock::reverse_iterator I = B->rbegin(), E = B->rend(); I != E;
+         ++I) {
+      if (isa<PHINode>(*I))
+        break;
+      auto def = valueIds.find(&*I);
+      if (def != valueIds.end())
+        live.reset(def->second);
+
+      auto index = m_computeLiveAtIndex.find(&*I);
+      if (index != m_computeLiveAtIndex.end())
+        liveAt[index->second] = live;
+
+      for (Use &U : I->operands()) {
+        auto op = valueIds.find(U.get());
+        if (op != valueIds.end())
+          live.set(op->second);
+      }
+    }
+  }
 
-      upAndMark(v, *U, scanned);
+  // Fill the sets value by value, so that every set is in function order.
+  BitVector allLive(numValues);
+  for (const BitVector &bits : liveAt)
+    allLive |= bits;
+  for (int id = allLive.find_first(); id != -1; id = allLive.find_next(id)) {
+    Instruction *value = values[id];
+    Indices &indices = m_liveAtIndices[value];
+    for (unsigned index = 0; index < liveAt.size(); ++index) {
+      if (liveAt[index].size() > (unsigned)id && liveAt[index].test(id)) {
+        m_liveSets[index].insert(value);
+        indices.insert(index);
+      }
     }
+    m_allLiveSet.insert(value);
   }
 }
 
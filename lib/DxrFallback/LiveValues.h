@@ -2,6 +2,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/IR/BasicBlock.h"
 
@@ -41,7 +42,9 @@ public:
   void remapLiveValues(
       llvm::DenseMap<llvm::Instruction *, llvm::Instruction *> &imap);
 
-  typedef llvm::SetVector<unsigned int> Indices;
+  typedef llvm::SetVector<unsigned int, std::vector<unsigned int>,
+                          llvm::DenseSet<unsigned int>>
+      Indices;
 
   // Return all indices at which the given value is live.
   const Indices *getIndicesWhereLive(const llvm::Value *value) const;
@@ -70,13 +73,6 @@ private:
   llvm::Function *m_function = nullptr;
   std::vector<InstructionSetVector> m_liveSets;
   InstructionSetVector m_allLiveSet;
-  llvm::SmallSet<llvm::BasicBlock *, 8> m_activeBlocks;
   llvm::DenseMap<llvm::Instruction *, unsigned int> m_computeLiveAtIndex;
   llvm::DenseMap<const llvm::Value *, Indices> m_liveAtIndices;
-
-  typedef llvm::SmallSet<llvm::BasicBlock *, 8> BlockSet;
-
-  void markLiveRange(llvm::Instruction *value, llvm::BasicBlock::iterator begin,
-                     llvm::BasicBlock::iterator end);
-  void upAndMark(llvm::Instruction *v, llvm::Use &use, BlockSet &scanned);
 };
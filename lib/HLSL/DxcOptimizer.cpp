@@ -40,9 +40,11 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include <algorithm>
 #include <list> // should change this for string_table
+#include <memory>
 #include <vector>
 
 #include "llvm/PassPrinters/PassPrinters.h"
@@ -154,7 +156,7 @@ public:
   }
 };
 
-class DxcOptimizer : public IDxcOptimizer {
+class DxcOptimizer : public IDxcOptimizer2 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   PassRegistry *m_registry;
@@ -166,12 +168,15 @@ public:
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
                                            void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcOptimizer>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcOptimizer, IDxcOptimizer2>(this, iid,
+                                                                ppvObject);
   }
 
   HRESULT Initialize();
   const PassInfo *getPassByID(llvm::AnalysisID PassID);
   const PassInfo *getPassByName(const char *pName);
+  HRESULT RunPasses(Module &M, LPCWSTR *ppOptions, UINT32 optionCount,
+                    raw_ostream &outStream);
   HRESULT STDMETHODCALLTYPE GetAvailablePassCount(UINT32 *pCount) override {
     return AssignToOut<UINT32>(m_passes.size(), pCount);
   }
@@ -180,6 +185,8 @@ public:
   HRESULT STDMETHODCALLTYPE RunOptimizer(
       IDxcBlob *pBlob, LPCWSTR *ppOptions, UINT32 optionCount,
       IDxcBlob **ppOutputModule, IDxcBlobEncoding **ppOutputText) override;
+  HRESULT STDMETHODCALLTYPE
+  CreateSession(IDxcBlob *pBlob, IDxcOptimizerSession **ppSession) override;
 };
 
 class CapturePassManager : public llvm::legacy::PassManagerBase {
@@ -242,349 +249,502 @@ DxcOptimizer::GetAvailablePass(UINT32 index, IDxcOptimizerPass **ppResult) {
       GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
 }
 
-HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
-    IDxcBlob *pBlob, LPCWSTR *ppOptions, UINT32 optionCount,
-    IDxcBlob **ppOutputModule, IDxcBlobEncoding **ppOutputText) {
-  AssignToOutOpt(nullptr, ppOutputModule);
-  AssignToOutOpt(nullptr, ppOutputText);
-  if (pBlob == nullptr)
-    return E_POINTER;
-  if (optionCount > 0 && ppOptions == nullptr)
-    return E_POINTER;
-
-  DxcThreadMalloc TM(m_pMalloc);
-
-  try {
-
-    // Setup input buffer.
-    //
-    // The ir parsing requires the buffer to be null terminated. We deal with
-    // both source and bitcode input, so the input buffer may not be null
-    // terminated; we create a new membuf that copies and appends for this.
-    //
-    // If we have the beginning of a DXIL program header, skip to the bitcode.
-    //
-
-    LLVMContext Context;
-    SMDiagnostic Err;
-    std::unique_ptr<MemoryBuffer> memBuf;
-    std::unique_ptr<Module> M;
-    const char *pBlobContent =
-        reinterpret_cast<const char *>(pBlob->GetBufferPointer());
-    unsigned blobSize = pBlob->GetBufferSize();
-    const DxilProgramHeader *pProgramHeader =
-        reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
-    const DxilContainerHeader *pContainerHeader =
-        IsDxilContainerLike(pBlobContent, blobSize);
-    bool bIsFullContainer = IsValidDxilContainer(pContainerHeader, blobSize);
-
-    if (bIsFullContainer) {
-      // Prefer debug module, if present.
-      pProgramHeader =
-          GetDxilProgramHeader(pContainerHeader, DFCC_ShaderDebugInfoDXIL);
-      if (!pProgramHeader)
-        pProgramHeader = GetDxilProgramHeader(pContainerHeader, DFCC_DXIL);
+static HRESULT RestoreContainerData(const DxilContainerHeader *pContainerHeader,
+                                    Module &M) {
+  // Restore extra data from certain parts back into the module so that data
+  // isn't lost. Note: Only GetOrCreateDxilModule if one of these is
+  // present.
+  // - Subobjects from RDAT
+  // - RootSignature from RTS0
+  // - ViewID and I/O dependency data from PSV0
+  // - Resource names and types/annotations from STAT
+
+  // RDAT
+  if (const DxilPartHeader *pPartHeader =
+          GetDxilPartByType(pContainerHeader, DFCC_RuntimeData)) {
+    DxilModule &DM = M.GetOrCreateDxilModule();
+    RDAT::DxilRuntimeData rdat(GetDxilPartData(pPartHeader),
+                               pPartHeader->PartSize);
+    auto table = rdat.GetSubobjectTable();
+    if (table && table.Count() > 0) {
+      DM.ResetSubobjects(new DxilSubobjects());
+      if (!LoadSubobjectsFromRDAT(*DM.GetSubobjects(), rdat)) {
+        return DXC_E_CONTAINER_INVALID;
+      }
     }
+  }
 
-    if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
-      std::string DiagStr;
-      GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
-      M = hlsl::dxilutil::LoadModuleFromBitcode(
-          llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
-    } else if (!bIsFullContainer) {
-      StringRef bufStrRef(pBlobContent, blobSize);
-      memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
-      M = parseIR(memBuf->getMemBufferRef(), Err, Context);
-    } else {
-      return DXC_E_CONTAINER_MISSING_DXIL;
-    }
+  // RST0
+  if (const DxilPartHeader *pPartHeader =
+          GetDxilPartByType(pContainerHeader, DFCC_RootSignature)) {
+    DxilModule &DM = M.GetOrCreateDxilModule();
+    const uint8_t *pPartData = (const uint8_t *)GetDxilPartData(pPartHeader);
+    std::vector<uint8_t> partData(pPartData, pPartData + pPartHeader->PartSize);
+    DM.ResetSerializedRootSignature(partData);
+  }
 
-    if (M == nullptr) {
-      return DXC_E_IR_VERIFICATION_FAILED;
+  // PSV0
+  if (const DxilPartHeader *pPartHeader = GetDxilPartByType(
+          pContainerHeader, DFCC_PipelineStateValidation)) {
+    DxilModule &DM = M.GetOrCreateDxilModule();
+    std::vector<unsigned int> &viewState = DM.GetSerializedViewIdState();
+    if (viewState.empty()) {
+      DxilPipelineStateValidation PSV;
+      PSV.InitFromPSV0(GetDxilPartData(pPartHeader), pPartHeader->PartSize);
+      unsigned OutputSizeInUInts =
+          hlsl::LoadViewIDStateFromPSV(nullptr, 0, PSV);
+      if (OutputSizeInUInts) {
+        viewState.assign(OutputSizeInUInts, 0);
+        hlsl::LoadViewIDStateFromPSV(viewState.data(),
+                                     (unsigned)viewState.size(), PSV);
+      }
     }
+  }
 
-    if (bIsFullContainer) {
-      // Restore extra data from certain parts back into the module so that data
-      // isn't lost. Note: Only GetOrCreateDxilModule if one of these is
-      // present.
-      // - Subobjects from RDAT
-      // - RootSignature from RTS0
-      // - ViewID and I/O dependency data from PSV0
-      // - Resource names and types/annotations from STAT
-
-      // RDAT
-      if (const DxilPartHeader *pPartHeader =
-              GetDxilPartByType(pContainerHeader, DFCC_RuntimeData)) {
-        DxilModule &DM = M->GetOrCreateDxilModule();
-        RDAT::DxilRuntimeData rdat(GetDxilPartData(pPartHeader),
-                                   pPartHeader->PartSize);
-        auto table = rdat.GetSubobjectTable();
-        if (table && table.Count() > 0) {
-          DM.ResetSubobjects(new DxilSubobjects());
-          if (!LoadSubobjectsFromRDAT(*DM.GetSubobjects(), rdat)) {
-            return DXC_E_CONTAINER_INVALID;
-          }
-        }
+  // STAT
+  if (const DxilPartHeader *pPartHeader =
+          GetDxilPartByType(pContainerHeader, DFCC_ShaderStatistics)) {
+    const DxilProgramHeader *pReflProgramHeader =
+        reinterpret_cast<const DxilProgramHeader *>(
+            GetDxilPartData(pPartHeader));
+    if (IsValidDxilProgramHeader(pReflProgramHeader, pPartHeader->PartSize)) {
+      const char *pReflBitcode;
+      uint32_t reflBitcodeLength;
+      GetDxilProgramBitcode((const DxilProgramHeader *)pReflProgramHeader,
+                            &pReflBitcode, &reflBitcodeLength);
+      std::string DiagStr;
+      std::unique_ptr<Module> ReflM = hlsl::dxilutil::LoadModuleFromBitcode(
+          llvm::StringRef(pReflBitcode, reflBitcodeLength), M.getContext(),
+          DiagStr);
+      if (ReflM) {
+        // Restore resource names from reflection
+        M.GetOrCreateDxilModule().RestoreResourceReflection(
+            ReflM->GetOrCreateDxilModule());
       }
+    }
+  }
 
-      // RST0
-      if (const DxilPartHeader *pPartHeader =
-              GetDxilPartByType(pContainerHeader, DFCC_RootSignature)) {
-        DxilModule &DM = M->GetOrCreateDxilModule();
-        const uint8_t *pPartData =
-            (const uint8_t *)GetDxilPartData(pPartHeader);
-        std::vector<uint8_t> partData(pPartData,
-                                      pPartData + pPartHeader->PartSize);
-        DM.ResetSerializedRootSignature(partData);
-      }
+  return S_OK;
+}
 
-      // PSV0
-      if (const DxilPartHeader *pPartHeader = GetDxilPartByType(
-              pContainerHeader, DFCC_PipelineStateValidation)) {
-        DxilModule &DM = M->GetOrCreateDxilModule();
-        std::vector<unsigned int> &viewState = DM.GetSerializedViewIdState();
-        if (viewState.empty()) {
-          DxilPipelineStateValidation PSV;
-          PSV.InitFromPSV0(GetDxilPartData(pPartHeader), pPartHeader->PartSize);
-          unsigned OutputSizeInUInts =
-              hlsl::LoadViewIDStateFromPSV(nullptr, 0, PSV);
-          if (OutputSizeInUInts) {
-            viewState.assign(OutputSizeInUInts, 0);
-            hlsl::LoadViewIDStateFromPSV(viewState.data(),
-                                         (unsigned)viewState.size(), PSV);
-          }
-        }
-      }
+// Loads the module to optimize from a container, program or IR in pBlob.
+static HRESULT LoadModuleForOptimizer(IDxcBlob *pBlob, LLVMContext &Context,
+                                      std::unique_ptr<Module> &M) {
+  // Setup input buffer.
+  //
+  // The ir parsing requires the buffer to be null terminated. We deal with
+  // both source and bitcode input, so the input buffer may not be null
+  // terminated; we create a new membuf that copies and appends for this.
+  //
+  // If we have the beginning of a DXIL program header, skip to the bitcode.
+  //
+
+  SMDiagnostic Err;
+  std::unique_ptr<MemoryBuffer> memBuf;
+  const char *pBlobContent =
+      reinterpret_cast<const char *>(pBlob->GetBufferPointer());
+  unsigned blobSize = pBlob->GetBufferSize();
+  const DxilProgramHeader *pProgramHeader =
+      reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
+  const DxilContainerHeader *pContainerHeader =
+      IsDxilContainerLike(pBlobContent, blobSize);
+  bool bIsFullContainer = IsValidDxilContainer(pContainerHeader, blobSize);
+
+  if (bIsFullContainer) {
+    // Prefer debug module, if present.
+    pProgramHeader =
+        GetDxilProgramHeader(pContainerHeader, DFCC_ShaderDebugInfoDXIL);
+    if (!pProgramHeader)
+      pProgramHeader = GetDxilProgramHeader(pContainerHeader, DFCC_DXIL);
+  }
 
-      // STAT
-      if (const DxilPartHeader *pPartHeader =
-              GetDxilPartByType(pContainerHeader, DFCC_ShaderStatistics)) {
-        const DxilProgramHeader *pReflProgramHeader =
-            reinterpret_cast<const DxilProgramHeader *>(
-                GetDxilPartData(pPartHeader));
-        if (IsValidDxilProgramHeader(pReflProgramHeader,
-                                     pPartHeader->PartSize)) {
-          const char *pReflBitcode;
-          uint32_t reflBitcodeLength;
-          GetDxilProgramBitcode((const DxilProgramHeader *)pReflProgramHeader,
-                                &pReflBitcode, &reflBitcodeLength);
-          std::string DiagStr;
-          std::unique_ptr<Module> ReflM = hlsl::dxilutil::LoadModuleFromBitcode(
-              llvm::StringRef(pReflBitcode, reflBitcodeLength), Context,
-              DiagStr);
-          if (ReflM) {
-            // Restore resource names from reflection
-            M->GetOrCreateDxilModule().RestoreResourceReflection(
-                ReflM->GetOrCreateDxilModule());
-          }
-        }
-      }
-    }
+  if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
+    std::string DiagStr;
+    GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
+    M = hlsl::dxilutil::LoadModuleFromBitcode(
+        llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
+  } else if (!bIsFullContainer) {
+    StringRef bufStrRef(pBlobContent, blobSize);
+    memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
+    M = parseIR(memBuf->getMemBufferRef(), Err, Context);
+  } else {
+    return DXC_E_CONTAINER_MISSING_DXIL;
+  }
 
-    legacy::PassManager ModulePasses;
-    legacy::FunctionPassManager FunctionPasses(M.get());
-    legacy::PassManagerBase *pPassManager = &ModulePasses;
+  if (M == nullptr) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
 
-    CComPtr<AbstractMemoryStream> pOutputStream;
-    CComPtr<IDxcBlob> pOutputBlob;
+  if (bIsFullContainer)
+    return RestoreContainerData(pContainerHeader, *M);
+  return S_OK;
+}
 
-    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
-    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+// Returns pBlob as a DXIL container, or nullptr if it is something else.
+static const DxilContainerHeader *GetFullContainer(IDxcBlob *pBlob) {
+  const DxilContainerHeader *pContainerHeader =
+      IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  return IsValidDxilContainer(pContainerHeader, pBlob->GetBufferSize())
+             ? pContainerHeader
+             : nullptr;
+}
 
-    raw_stream_ostream outStream(pOutputStream.p);
+static void WriteModuleToBlob(IMalloc *pMalloc, Module &M,
+                              IDxcBlob **ppOutputModule) {
+  CComPtr<AbstractMemoryStream> pProgramStream;
+  IFT(CreateMemoryStream(pMalloc, &pProgramStream));
+  {
+    raw_stream_ostream outStream(pProgramStream.p);
+    WriteBitcodeToFile(&M, outStream, true);
+  }
+  IFT(pProgramStream.QueryInterface(ppOutputModule));
+}
 
-    //
-    // Consider some differences from opt.exe:
-    //
-    // Create a new optimization pass for each one specified on the command line
-    // as in StandardLinkOpts, OptLevelO1, etc.
-    // No target machine, and so no passes get their target machine ctor called.
-    // No print-after-each-pass option.
-    // No printing of the pass options.
-    // No StripDebug support.
-    // No verifyModule before starting.
-    // Use of PassPipeline for new manager.
-    // No TargetInfo.
-    // No DataLayout.
-    //
-    bool OutputAssembly = false;
-    bool AnalyzeOnly = false;
-
-    // First gather flags, wherever they may be.
-    SmallVector<UINT32, 2> handled;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (wcseq(L"-S", ppOptions[i])) {
-        OutputAssembly = true;
-        handled.push_back(i);
-        continue;
-      }
-      if (wcseq(L"-analyze", ppOptions[i])) {
-        AnalyzeOnly = true;
-        handled.push_back(i);
-        continue;
-      }
+// Runs the passes listed in ppOptions on M, writing any text they print to
+// outStream.
+HRESULT DxcOptimizer::RunPasses(Module &M, LPCWSTR *ppOptions,
+                                UINT32 optionCount, raw_ostream &outStream) {
+  legacy::PassManager ModulePasses;
+  legacy::FunctionPassManager FunctionPasses(&M);
+  legacy::PassManagerBase *pPassManager = &ModulePasses;
+
+  //
+  // Consider some differences from opt.exe:
+  //
+  // Create a new optimization pass for each one specified on the command line
+  // as in StandardLinkOpts, OptLevelO1, etc.
+  // No target machine, and so no passes get their target machine ctor called.
+  // No print-after-each-pass option.
+  // No printing of the pass options.
+  // No StripDebug support.
+  // No verifyModule before starting.
+  // Use of PassPipeline for new manager.
+  // No TargetInfo.
+  // No DataLayout.
+  //
+  bool OutputAssembly = false;
+  bool AnalyzeOnly = false;
+
+  // First gather flags, wherever they may be.
+  SmallVector<UINT32, 2> handled;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (wcseq(L"-S", ppOptions[i])) {
+      OutputAssembly = true;
+      handled.push_back(i);
+      continue;
+    }
+    if (wcseq(L"-analyze", ppOptions[i])) {
+      AnalyzeOnly = true;
+      handled.push_back(i);
+      continue;
     }
+  }
 
-    // TODO: should really use string_table for this once that's available
-    std::list<std::string> optionsAnsi;
-    SmallVector<PassOption, 2> options;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
-        continue;
-      }
+  // TODO: should really use string_table for this once that's available
+  std::list<std::string> optionsAnsi;
+  SmallVector<PassOption, 2> options;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
+      continue;
+    }
 
-      // Handle some special cases where we can inject a redirected output
-      // stream.
-      if (wcsstartswith(ppOptions[i], L"-print-module")) {
-        LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
-        std::string Banner;
-        if (*pName) {
-          IFTARG(*pName != L':' || *pName != L'=');
-          ++pName;
-          CW2A name8(pName);
-          Banner = "MODULE-PRINT ";
-          Banner += name8.m_psz;
-          Banner += "\n";
-        }
-        if (pPassManager == &ModulePasses)
-          pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
-        continue;
+    // Handle some special cases where we can inject a redirected output
+    // stream.
+    if (wcsstartswith(ppOptions[i], L"-print-module")) {
+      LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
+      std::string Banner;
+      if (*pName) {
+        IFTARG(*pName != L':' || *pName != L'=');
+        ++pName;
+        CW2A name8(pName);
+        Banner = "MODULE-PRINT ";
+        Banner += name8.m_psz;
+        Banner += "\n";
       }
+      if (pPassManager == &ModulePasses)
+        pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
+      continue;
+    }
 
-      // Handle special switches to toggle per-function prepasses vs. module
-      // passes.
-      if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
-        pPassManager = &FunctionPasses;
-        continue;
-      }
-      if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
-        pPassManager = &ModulePasses;
-        continue;
-      }
+    // Handle special switches to toggle per-function prepasses vs. module
+    // passes.
+    if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
+      pPassManager = &FunctionPasses;
+      continue;
+    }
+    if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
+      pPassManager = &ModulePasses;
+      continue;
+    }
 
-      CW2A optName(ppOptions[i]);
-      // The option syntax is
-      const char ArgDelim = ',';
-      // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
-      char *pCursor = optName.m_psz;
-      const char *pEnd = optName.m_psz + strlen(optName.m_psz);
-      if (*pCursor != '-' && *pCursor != '/') {
+    CW2A optName(ppOptions[i]);
+    // The option syntax is
+    const char ArgDelim = ',';
+    // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
+    char *pCursor = optName.m_psz;
+    const char *pEnd = optName.m_psz + strlen(optName.m_psz);
+    if (*pCursor != '-' && *pCursor != '/') {
+      return E_INVALIDARG;
+    }
+    ++pCursor;
+    const char *pOptionNameStart = pCursor;
+    while (*pCursor && *pCursor != ArgDelim) {
+      ++pCursor;
+    }
+    *pCursor = '\0';
+    const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
+    if (!PassInf) {
+      return E_INVALIDARG;
+    }
+    while (pCursor < pEnd) {
+      // *pCursor is '\0' when we overwrite ',' to get a null-terminated
+      // string
+      if (*pCursor && *pCursor != ArgDelim) {
         return E_INVALIDARG;
       }
       ++pCursor;
-      const char *pOptionNameStart = pCursor;
+      const char *pArgStart = pCursor;
       while (*pCursor && *pCursor != ArgDelim) {
         ++pCursor;
       }
-      *pCursor = '\0';
-      const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
-      if (!PassInf) {
+      StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
+      std::pair<StringRef, StringRef> nameValue = argString.split('=');
+      if (!IsPassOptionName(nameValue.first)) {
         return E_INVALIDARG;
       }
-      while (pCursor < pEnd) {
-        // *pCursor is '\0' when we overwrite ',' to get a null-terminated
-        // string
-        if (*pCursor && *pCursor != ArgDelim) {
-          return E_INVALIDARG;
-        }
-        ++pCursor;
-        const char *pArgStart = pCursor;
-        while (*pCursor && *pCursor != ArgDelim) {
-          ++pCursor;
-        }
-        StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
-        std::pair<StringRef, StringRef> nameValue = argString.split('=');
-        if (!IsPassOptionName(nameValue.first)) {
-          return E_INVALIDARG;
-        }
 
-        PassOption *OptionPos = std::lower_bound(
-            options.begin(), options.end(), nameValue, PassOptionsCompare());
-        // If empty, remove if available; otherwise upsert.
-        if (nameValue.second.empty()) {
-          if (OptionPos != options.end() &&
-              OptionPos->first == nameValue.first) {
-            options.erase(OptionPos);
-          }
+      PassOption *OptionPos = std::lower_bound(
+          options.begin(), options.end(), nameValue, PassOptionsCompare());
+      // If empty, remove if available; otherwise upsert.
+      if (nameValue.second.empty()) {
+        if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
+          options.erase(OptionPos);
+        }
+      } else {
+        if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
+          OptionPos->second = nameValue.second;
         } else {
-          if (OptionPos != options.end() &&
-              OptionPos->first == nameValue.first) {
-            OptionPos->second = nameValue.second;
-          } else {
-            options.insert(OptionPos, nameValue);
-          }
+          options.insert(OptionPos, nameValue);
         }
       }
+    }
 
-      DXASSERT(PassInf->getNormalCtor(),
-               "else pass with no default .ctor was added");
-      Pass *pass = PassInf->getNormalCtor()();
-      pass->setOSOverride(&outStream);
-      pass->applyOptions(options);
-      options.clear();
-      pPassManager->add(pass);
-      if (AnalyzeOnly) {
-        const bool Quiet = false;
-        PassKind Kind = pass->getPassKind();
-        switch (Kind) {
-        case PT_BasicBlock:
-          pPassManager->add(
-              createBasicBlockPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Region:
-          pPassManager->add(createRegionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Loop:
-          pPassManager->add(createLoopPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Function:
-          pPassManager->add(
-              createFunctionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_CallGraphSCC:
-          pPassManager->add(
-              createCallGraphPassPrinter(PassInf, outStream, Quiet));
-          break;
-        default:
-          pPassManager->add(createModulePassPrinter(PassInf, outStream, Quiet));
-          break;
-        }
+    DXASSERT(PassInf->getNormalCtor(),
+             "else pass with no default .ctor was added");
+    Pass *pass = PassInf->getNormalCtor()();
+    pass->setOSOverride(&outStream);
+    pass->applyOptions(options);
+    options.clear();
+    pPassManager->add(pass);
+    if (AnalyzeOnly) {
+      const bool Quiet = false;
+      PassKind Kind = pass->getPassKind();
+      switch (Kind) {
+      case PT_BasicBlock:
+        pPassManager->add(
+            createBasicBlockPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Region:
+        pPassManager->add(createRegionPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Loop:
+        pPassManager->add(createLoopPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Function:
+        pPassManager->add(createFunctionPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_CallGraphSCC:
+        pPassManager->add(
+            createCallGraphPassPrinter(PassInf, outStream, Quiet));
+        break;
+      default:
+        pPassManager->add(createModulePassPrinter(PassInf, outStream, Quiet));
+        break;
       }
     }
+  }
 
-    ModulePasses.add(createVerifierPass());
+  ModulePasses.add(createVerifierPass());
 
-    if (OutputAssembly) {
-      ModulePasses.add(llvm::createPrintModulePass(outStream));
-    }
+  if (OutputAssembly) {
+    ModulePasses.add(llvm::createPrintModulePass(outStream));
+  }
 
-    // Now that we have all of the passes ready, run them.
-    {
-      raw_ostream *err_ostream = &outStream;
-      ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite,
-                                         err_ostream);
-
-      FunctionPasses.doInitialization();
-      for (Function &F : *M.get())
-        if (!F.isDeclaration())
-          FunctionPasses.run(F);
-      FunctionPasses.doFinalization();
-      ModulePasses.run(*M.get());
-    }
+  // Now that we have all of the passes ready, run them.
+  {
+    raw_ostream *err_ostream = &outStream;
+    ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite,
+                                       err_ostream);
+
+    FunctionPasses.doInitialization();
+    for (Function &F : M)
+      if (!F.isDeclaration())
+        FunctionPasses.run(F);
+    FunctionPasses.doFinalization();
+    ModulePasses.run(M);
+  }
+
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
+    IDxcBlob *pBlob, LPCWSTR *ppOptions, UINT32 optionCount,
+    IDxcBlob **ppOutputModule, IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try {
+    LLVMContext Context;
+    std::unique_ptr<Module> M;
+    IFR(LoadModuleForOptimizer(pBlob, Context, M));
+
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    CComPtr<IDxcBlob> pOutputBlob;
+
+    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+    raw_stream_ostream outStream(pOutputStream.p);
+    IFR(RunPasses(*M, ppOptions, optionCount, outStream));
 
     outStream.flush();
     if (ppOutputText != nullptr) {
       IFT(DxcCreateBlobWithEncodingSet(pOutputBlob, CP_UTF8, ppOutputText));
     }
     if (ppOutputModule != nullptr) {
-      CComPtr<AbstractMemoryStream> pProgramStream;
-      IFT(CreateMemoryStream(m_pMalloc, &pProgramStream));
-      {
-        raw_stream_ostream outStream(pProgramStream.p);
-        WriteBitcodeToFile(M.get(), outStream, true);
+      WriteModuleToBlob(m_pMalloc, *M, ppOutputModule);
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  return S_OK;
+}
+
+// Keeps a module loaded so that successive pass lists run on it without
+// parsing and serializing it in between.
+class DxcOptimizerSession : public IDxcOptimizerSession {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<DxcOptimizer> m_pOptimizer;
+  CComPtr<IDxcBlob> m_pSource;
+  // Shared with forked sessions, whose modules live in the same context.
+  std::shared_ptr<LLVMContext> m_pContext;
+  std::unique_ptr<Module> m_pModule;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcOptimizerSession)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcOptimizerSession>(this, iid, ppvObject);
+  }
+
+  void Initialize(DxcOptimizer *pOptimizer, IDxcBlob *pSource,
+                  std::shared_ptr<LLVMContext> pContext,
+                  std::unique_ptr<Module> pModule) {
+    m_pOptimizer = pOptimizer;
+    m_pSource = pSource;
+    m_pContext = std::move(pContext);
+    m_pModule = std::move(pModule);
+  }
+
+  HRESULT STDMETHODCALLTYPE
+  RunPasses(LPCWSTR *ppOptions, UINT32 optionCount,
+            IDxcBlobEncoding **ppOutputText) override {
+    AssignToOutOpt(nullptr, ppOutputText);
+    if (optionCount > 0 && ppOptions == nullptr)
+      return E_POINTER;
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    try {
+      CComPtr<AbstractMemoryStream> pOutputStream;
+      CComPtr<IDxcBlob> pOutputBlob;
+      IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+      IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+      raw_stream_ostream outStream(pOutputStream.p);
+      IFR(m_pOptimizer->RunPasses(*m_pModule, ppOptions, optionCount,
+                                  outStream));
+
+      outStream.flush();
+      if (ppOutputText != nullptr) {
+        IFT(DxcCreateBlobWithEncodingSet(pOutputBlob, CP_UTF8, ppOutputText));
       }
-      IFT(pProgramStream.QueryInterface(ppOutputModule));
     }
+    CATCH_CPP_RETURN_HRESULT();
+
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetModule(IDxcBlob **ppOutputModule) override {
+    if (ppOutputModule == nullptr)
+      return E_POINTER;
+    *ppOutputModule = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    try {
+      WriteModuleToBlob(m_pMalloc, *m_pModule, ppOutputModule);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE Fork(IDxcOptimizerSession **ppSession) override {
+    if (ppSession == nullptr)
+      return E_POINTER;
+    *ppSession = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    try {
+      // The DxilModule isn't cloned along with the IR, so the clone reloads it
+      // from metadata and gets the container data restored again.
+      std::unique_ptr<Module> pClone(CloneModule(m_pModule.get()));
+      if (const DxilContainerHeader *pContainerHeader =
+              GetFullContainer(m_pSource))
+        IFR(RestoreContainerData(pContainerHeader, *pClone));
+
+      CComPtr<DxcOptimizerSession> pSession =
+          DxcOptimizerSession::Alloc(m_pMalloc);
+      IFROOM(pSession.p);
+      pSession->Initialize(m_pOptimizer, m_pSource, m_pContext,
+                           std::move(pClone));
+      *ppSession = pSession.Detach();
+    }
+    CATCH_CPP_RETURN_HRESULT();
+
+    return S_OK;
+  }
+};
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::CreateSession(
+    IDxcBlob *pBlob, IDxcOptimizerSession **ppSession) {
+  if (pBlob == nullptr || ppSession == nullptr)
+    return E_POINTER;
+  *ppSession = nullptr;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try {
+    std::shared_ptr<LLVMContext> pContext = std::make_shared<LLVMContext>();
+    std::unique_ptr<Module> M;
+    IFR(LoadModuleForOptimizer(pBlob, *pContext, M));
+
+    CComPtr<DxcOptimizerSession> pSession =
+        DxcOptimizerSession::Alloc(m_pMalloc);
+    IFROOM(pSession.p);
+    pSession->Initialize(this, pBlob, std::move(pContext), std::move(M));
+    *ppSession = pSession.Detach();
   }
   CATCH_CPP_RETURN_HRESULT();
 
@@ -32,6 +32,7 @@
 #include "llvm/IR/Operator.h"
 
 #include "llvm/ADT/SetVector.h"
+#include <mutex>
 #include <unordered_set>
 
 #include "dxc/dxcapi.h"
@@ -275,14 +276,23 @@ private:
 
   // Storage, and function by name:
   typedef DenseMap<StringRef, std::unique_ptr<CFunctionReflection>> FunctionMap;
-  typedef DenseMap<const Function *, CFunctionReflection *> FunctionsByPtr;
   FunctionMap m_FunctionMap;
-  FunctionsByPtr m_FunctionsByPtr;
   // Enable indexing into functions in deterministic order:
   std::vector<CFunctionReflection *> m_FunctionVector;
 
+  // Functions and their resource usage come from RDAT alone. The module is
+  // only parsed on the first query that needs bindings, constant buffer
+  // layouts or function properties, from this private copy of the program.
+  std::vector<uint32_t> m_ProgramCopy;
+  uint32_t m_ProgramVersion = 0;
+  size_t m_RDATResourceCount = 0;
+  HRESULT m_ModuleLoadResult = S_OK;
+  bool m_bModuleLoaded = false;
+  std::mutex m_ModuleLoadMutex;
+
   void AddResourceDependencies();
   void SetCBufferUsage();
+  HRESULT LoadModule(const DxilProgramHeader *pProgramHeader);
 
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
@@ -295,6 +305,12 @@ public:
   HRESULT Load(const DxilProgramHeader *pProgramHeader,
                const DxilPartHeader *pRDATPart);
 
+  // Parses the module if that has not happened yet. Returns the result of
+  // the one and only parse attempt.
+  HRESULT EnsureModuleLoaded();
+  bool RequiresEarlyDepthStencil(StringRef FunctionName);
+  uint32_t GetProgramVersion() const { return m_ProgramVersion; }
+
   // ID3D12LibraryReflection
   STDMETHOD(GetDesc)(D3D12_LIBRARY_DESC *pDesc) override;
 
@@ -401,17 +417,22 @@ HRESULT DxilContainerReflection::Load(IDxcBlob *pContainer) {
     return S_OK;
   }
 
+  // Only a PDB needs its container copied out of the stream; a container is
+  // referenced in place.
   CComPtr<IDxcBlob> pPDBContainer;
-  try {
-    DxcThreadMalloc DxcMalloc(m_pMalloc);
-    CComPtr<IStream> pStream;
-    IFR(hlsl::CreateReadOnlyBlobStream(pContainer, &pStream));
-    if (SUCCEEDED(hlsl::pdb::LoadDataFromStream(m_pMalloc, pStream,
-                                                &pPDBContainer))) {
-      pContainer = pPDBContainer;
+  if (!IsDxilContainerLike(pContainer->GetBufferPointer(),
+                           pContainer->GetBufferSize())) {
+    try {
+      DxcThreadMalloc DxcMalloc(m_pMalloc);
+      CComPtr<IStream> pStream;
+      IFR(hlsl::CreateReadOnlyBlobStream(pContainer, &pStream));
+      if (SUCCEEDED(hlsl::pdb::LoadDataFromStream(m_pMalloc, pStream,
+                                                  &pPDBContainer))) {
+        pContainer = pPDBContainer;
+      }
     }
+    CATCH_CPP_RETURN_HRESULT();
   }
-  CATCH_CPP_RETURN_HRESULT();
 
   uint32_t bufLen = pContainer->GetBufferSize();
   const DxilContainerHeader *pHeader =
@@ -2787,9 +2808,8 @@ UINT64 DxilShaderReflection::GetRequiresFlags() noexcept {
 class CFunctionReflection final : public ID3D12FunctionReflection {
 protected:
   DxilLibraryReflection *m_pLibraryReflection = nullptr;
-  const Function *m_pFunction;
-  const DxilFunctionProps *m_pProps; // nullptr if non-shader library function
-                                     // or patch constant function
+  // Library if non-shader library function or patch constant function
+  DXIL::ShaderKind m_ShaderKind = DXIL::ShaderKind::Library;
   std::string m_Name;
   typedef SmallSetVector<UINT32, 8> ResourceUseSet;
   ResourceUseSet m_UsedResources;
@@ -2797,19 +2817,12 @@ protected:
   UINT64 m_FeatureFlags;
 
 public:
-  void Initialize(DxilLibraryReflection *pLibraryReflection,
-                  Function *pFunction) {
+  void Initialize(DxilLibraryReflection *pLibraryReflection, StringRef Name,
+                  DXIL::ShaderKind ShaderKind) {
     DXASSERT_NOMSG(pLibraryReflection);
-    DXASSERT_NOMSG(pFunction);
     m_pLibraryReflection = pLibraryReflection;
-    m_pFunction = pFunction;
-
-    const DxilModule &M = *m_pLibraryReflection->m_pDxilModule;
-    m_Name = m_pFunction->getName().str();
-    m_pProps = nullptr;
-    if (M.HasDxilFunctionProps(m_pFunction)) {
-      m_pProps = &M.GetDxilFunctionProps(m_pFunction);
-    }
+    m_Name = Name.str();
+    m_ShaderKind = ShaderKind;
   }
   void AddResourceReference(UINT resIndex) { m_UsedResources.insert(resIndex); }
   void AddCBReference(UINT cbIndex) { m_UsedCBs.insert(cbIndex); }
@@ -2841,13 +2854,10 @@ HRESULT CFunctionReflection::GetDesc(D3D12_FUNCTION_DESC *pDesc) {
   DXASSERT_NOMSG(m_pLibraryReflection);
   IFR(ZeroMemoryToOut(pDesc));
 
-  const ShaderModel *pSM =
-      m_pLibraryReflection->m_pDxilModule->GetShaderModel();
-  DXIL::ShaderKind kind = DXIL::ShaderKind::Library;
-  if (m_pProps) {
-    kind = m_pProps->shaderKind;
-  }
-  pDesc->Version = EncodeVersion(kind, pSM->GetMajor(), pSM->GetMinor());
+  uint32_t programVersion = m_pLibraryReflection->GetProgramVersion();
+  pDesc->Version =
+      EncodeVersion(m_ShaderKind, GetVersionMajor(programVersion),
+                    GetVersionMinor(programVersion));
 
   // Unset: LPCSTR Creator;  // Creator string
   // Unset: UINT   Flags;    // Shader compilation/parse flags
@@ -2896,8 +2906,8 @@ HRESULT CFunctionReflection::GetDesc(D3D12_FUNCTION_DESC *pDesc) {
       m_FeatureFlags & ~(UINT64)D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL;
   // Also Mask off function-level derivatives flag.
   pDesc->RequiredFeatureFlags &= ~DXIL::OptFeatureInfo_UsesDerivatives;
-  if (kind == DXIL::ShaderKind::Pixel && m_pProps &&
-      m_pProps->ShaderProps.PS.EarlyDepthStencil) {
+  if (m_ShaderKind == DXIL::ShaderKind::Pixel &&
+      m_pLibraryReflection->RequiresEarlyDepthStencil(m_Name)) {
     pDesc->RequiredFeatureFlags |= D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL;
   }
 
@@ -2916,7 +2926,8 @@ HRESULT CFunctionReflection::GetDesc(D3D12_FUNCTION_DESC *pDesc) {
 ID3D12ShaderReflectionConstantBuffer *
 CFunctionReflection::GetConstantBufferByIndex(UINT BufferIndex) {
   DXASSERT_NOMSG(m_pLibraryReflection);
-  if (BufferIndex >= m_UsedCBs.size())
+  if (BufferIndex >= m_UsedCBs.size() ||
+      FAILED(m_pLibraryReflection->EnsureModuleLoaded()))
     return &g_InvalidSRConstantBuffer;
   return m_pLibraryReflection->_GetConstantBufferByIndex(
       m_UsedCBs[BufferIndex]);
@@ -2925,6 +2936,8 @@ CFunctionReflection::GetConstantBufferByIndex(UINT BufferIndex) {
 ID3D12ShaderReflectionConstantBuffer *
 CFunctionReflection::GetConstantBufferByName(LPCSTR Name) {
   DXASSERT_NOMSG(m_pLibraryReflection);
+  if (FAILED(m_pLibraryReflection->EnsureModuleLoaded()))
+    return &g_InvalidSRConstantBuffer;
   return m_pLibraryReflection->_GetConstantBufferByName(Name);
 }
 
@@ -2933,6 +2946,7 @@ HRESULT CFunctionReflection::GetResourceBindingDesc(
   DXASSERT_NOMSG(m_pLibraryReflection);
   if (ResourceIndex >= m_UsedResources.size())
     return E_INVALIDARG;
+  IFR(m_pLibraryReflection->EnsureModuleLoaded());
   return m_pLibraryReflection->_GetResourceBindingDesc(
       m_UsedResources[ResourceIndex], pDesc);
 }
@@ -2940,12 +2954,15 @@ HRESULT CFunctionReflection::GetResourceBindingDesc(
 ID3D12ShaderReflectionVariable *
 CFunctionReflection::GetVariableByName(LPCSTR Name) {
   DXASSERT_NOMSG(m_pLibraryReflection);
+  if (FAILED(m_pLibraryReflection->EnsureModuleLoaded()))
+    return &g_InvalidSRVariable;
   return m_pLibraryReflection->_GetVariableByName(Name);
 }
 
 HRESULT CFunctionReflection::GetResourceBindingDescByName(
     LPCSTR Name, D3D12_SHADER_INPUT_BIND_DESC *pDesc) {
   DXASSERT_NOMSG(m_pLibraryReflection);
+  IFR(m_pLibraryReflection->EnsureModuleLoaded());
   return m_pLibraryReflection->_GetResourceBindingDescByName(Name, pDesc);
 }
 
@@ -2980,17 +2997,40 @@ void DxilLibraryReflection::AddResourceDependencies() {
     }
   }
 
-  IFTBOOL(resourceTable.Count() == m_Resources.size(),
-          DXC_E_INCORRECT_DXIL_METADATA);
+  m_RDATResourceCount = resourceTable.Count();
+
+  // Index the constant buffers the same way CreateReflectionObjects fills
+  // m_CBs: cbuffers, then structured UAVs, then structured and tbuffer SRVs.
+  std::map<StringRef, UINT> CBsByName;
+  std::map<StringRef, UINT> StructuredBufferCBsByName;
+  UINT CBCount = 0;
+  for (unsigned i = 0; i < resourceTable.Count(); i++) {
+    auto resource = resourceTable[i];
+    if (resource.getClass() == DXIL::ResourceClass::CBuffer)
+      CBsByName[resource.getName()] = CBCount++;
+  }
+  for (unsigned i = 0; i < resourceTable.Count(); i++) {
+    auto resource = resourceTable[i];
+    if (resource.getClass() == DXIL::ResourceClass::UAV &&
+        DXIL::IsStructuredBuffer(resource.getKind()))
+      StructuredBufferCBsByName[resource.getName()] = CBCount++;
+  }
+  for (unsigned i = 0; i < resourceTable.Count(); i++) {
+    auto resource = resourceTable[i];
+    if (resource.getClass() != DXIL::ResourceClass::SRV)
+      continue;
+    if (resource.getKind() == DXIL::ResourceKind::StructuredBuffer)
+      StructuredBufferCBsByName[resource.getName()] = CBCount++;
+    else if (resource.getKind() == DXIL::ResourceKind::TBuffer)
+      CBsByName[resource.getName()] = CBCount++;
+  }
 
   for (unsigned iFunc = 0; iFunc < functionTable.Count(); ++iFunc) {
     auto FR = functionTable[iFunc];
     auto &func = m_FunctionMap[FR.getName()];
     DXASSERT(!func.get(), "otherwise duplicate named functions");
-    Function *F = m_pModule->getFunction(FR.getName());
     func.reset(new CFunctionReflection());
-    func->Initialize(this, F);
-    m_FunctionsByPtr[F] = func.get();
+    func->Initialize(this, FR.getName(), FR.getShaderKind());
     orderedMap[FR.getName()] = func.get();
 
     func->SetFeatureFlags(FR.GetFeatureFlags());
@@ -3009,20 +3049,20 @@ void DxilLibraryReflection::AddResourceDependencies() {
       case DXIL::ResourceClass::SRV:
         func->AddResourceReference(SRVsStart + id);
         if (DXIL::IsStructuredBuffer(RR.getKind())) {
-          auto it = m_StructuredBufferCBsByName.find(RR.getName());
-          if (it != m_StructuredBufferCBsByName.end())
+          auto it = StructuredBufferCBsByName.find(RR.getName());
+          if (it != StructuredBufferCBsByName.end())
             func->AddCBReference(it->second);
         } else if (RR.getKind() == DXIL::ResourceKind::TBuffer) {
-          auto it = m_CBsByName.find(RR.getName());
-          if (it != m_CBsByName.end())
+          auto it = CBsByName.find(RR.getName());
+          if (it != CBsByName.end())
             func->AddCBReference(it->second);
         }
         break;
       case DXIL::ResourceClass::UAV:
         func->AddResourceReference(UAVsStart + id);
         if (DXIL::IsStructuredBuffer(RR.getKind())) {
-          auto it = m_StructuredBufferCBsByName.find(RR.getName());
-          if (it != m_StructuredBufferCBsByName.end())
+          auto it = StructuredBufferCBsByName.find(RR.getName());
+          if (it != StructuredBufferCBsByName.end())
             func->AddCBReference(it->second);
         }
         break;
@@ -3068,10 +3108,31 @@ void DxilLibraryReflection::SetCBufferUsage() {
 HRESULT DxilLibraryReflection::Load(const DxilProgramHeader *pProgramHeader,
                                     const DxilPartHeader *pRDATPart) {
   IFR(LoadRDAT(pRDATPart));
-  IFR(LoadProgramHeader(pProgramHeader));
+  m_ProgramVersion = pProgramHeader->ProgramVersion;
 
   try {
     AddResourceDependencies();
+    // Without RDAT there is no cheaper source of truth, so parse now and
+    // report bitcode errors from creation, as before.
+    if (!pRDATPart)
+      return LoadModule(pProgramHeader);
+    m_ProgramCopy.assign(
+        reinterpret_cast<const uint32_t *>(pProgramHeader),
+        reinterpret_cast<const uint32_t *>(pProgramHeader) +
+            pProgramHeader->SizeInUint32);
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT DxilLibraryReflection::LoadModule(
+    const DxilProgramHeader *pProgramHeader) {
+  m_bModuleLoaded = true;
+  IFR(LoadProgramHeader(pProgramHeader));
+
+  try {
+    IFTBOOL(m_RDATResourceCount == m_Resources.size(),
+            DXC_E_INCORRECT_DXIL_METADATA);
     if (!m_bUsageInMetadata)
       SetCBufferUsage();
     return S_OK;
@@ -3079,6 +3140,28 @@ HRESULT DxilLibraryReflection::Load(const DxilProgramHeader *pProgramHeader,
   CATCH_CPP_RETURN_HRESULT();
 }
 
+HRESULT DxilLibraryReflection::EnsureModuleLoaded() {
+  std::lock_guard<std::mutex> lock(m_ModuleLoadMutex);
+  if (!m_bModuleLoaded) {
+    DxcThreadMalloc TM(m_pMalloc);
+    m_ModuleLoadResult = LoadModule(
+        reinterpret_cast<const DxilProgramHeader *>(m_ProgramCopy.data()));
+    // LoadProgramHeader keeps its own copy of the bitcode.
+    std::vector<uint32_t>().swap(m_ProgramCopy);
+  }
+  return m_ModuleLoadResult;
+}
+
+bool DxilLibraryReflection::RequiresEarlyDepthStencil(StringRef FunctionName) {
+  if (FAILED(EnsureModuleLoaded()))
+    return false;
+  const Function *F = m_pModule->getFunction(FunctionName);
+  if (!F || !m_pDxilModule->HasDxilFunctionProps(F))
+    return false;
+  return m_pDxilModule->GetDxilFunctionProps(F)
+      .ShaderProps.PS.EarlyDepthStencil;
+}
+
 HRESULT DxilLibraryReflection::GetDesc(D3D12_LIBRARY_DESC *pDesc) {
   IFR(ZeroMemoryToOut(pDesc));
   // Unset:  LPCSTR    Creator;           // The name of the originator of the
@@ -198,6 +198,12 @@ public:
   }
 
   bool runOnModule(Module &M) override {
+    // Everything from here on works on DXIL. The pipeline's owner scopes
+    // the HL passes phase and restores the phase before it when the
+    // pipeline is done; other pipelines keep their phase.
+    if (DxcGetThreadMallocPhase() == DxcMallocPhase::HLPasses)
+      DxcSetThreadMallocPhase(DxcMallocPhase::DxilPasses);
+
     m_pHLModule = &M.GetOrCreateHLModule();
     const ShaderModel *SM = m_pHLModule->GetShaderModel();
 
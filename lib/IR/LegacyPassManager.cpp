@@ -1572,7 +1572,10 @@ bool FPPassManager::runOnFunction(Function &F) {
     bool LocalChanged = false;
 
     // HLSL Change Begin - Support hierarchial time tracing.
-    llvm::TimeTraceScope PassScope("RunFunctionPass", FP->getPassName());
+    // The name is only looked up when tracing: it may take the PassRegistry
+    // lock, which every concurrent compile shares.
+    llvm::TimeTraceScope PassScope("RunFunctionPass",
+                                   [&]() { return FP->getPassName().str(); });
     // HLSL Change End - Support hierarchial time tracing.
 
     dumpPassInfo(FP, EXECUTION_MSG, ON_FUNCTION_MSG, F.getName());
@@ -1655,7 +1658,9 @@ MPPassManager::runOnModule(Module &M) {
     ModulePass *MP = getContainedPass(Index);
     bool LocalChanged = false;
 
-    llvm::TimeTraceScope PassScope("RunModulePass", MP->getPassName());
+    llvm::TimeTraceScope PassScope("RunModulePass", [&]() {
+      return MP->getPassName().str();
+    }); // HLSL Change - only look up the name when tracing
 
     dumpPassInfo(MP, EXECUTION_MSG, ON_MODULE_MSG, M.getModuleIdentifier());
     dumpRequiredSet(MP);
@@ -16,6 +16,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/PassSupport.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/ContentionProfiler.h" // HLSL Change
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/RWMutex.h"
 #include <vector>
@@ -67,9 +68,27 @@ PassRegistry *PassRegistry::getPassRegistry() {
 
 PassRegistry::~PassRegistry() {}
 
+#ifndef LLVM_ON_WIN32
+// HLSL Change Begin - Lookups run from every compiling thread; report their
+// reader lock acquisitions to the contention profiler.
+namespace {
+class ScopedProfiledReader {
+  sys::SmartRWMutex<true> &Lock;
+
+public:
+  explicit ScopedProfiledReader(sys::SmartRWMutex<true> &L) : Lock(L) {
+    acquireProfiled(ContentionSite::PassRegistry,
+                    [this]() { Lock.lock_shared(); });
+  }
+  ~ScopedProfiledReader() { Lock.unlock_shared(); }
+};
+} // namespace
+// HLSL Change End
+#endif
+
 const PassInfo *PassRegistry::getPassInfo(const void *TI) const {
   #ifndef LLVM_ON_WIN32  // HLSL Change
-  sys::SmartScopedReader<true> Guard(Lock);
+  ScopedProfiledReader Guard(Lock);
   #endif
   MapType::const_iterator I = PassInfoMap.find(TI);
   return I != PassInfoMap.end() ? I->second : nullptr;
@@ -77,7 +96,7 @@ const PassInfo *PassRegistry::getPassInfo(const void *TI) const {
 
 const PassInfo *PassRegistry::getPassInfo(StringRef Arg) const {
   #ifndef LLVM_ON_WIN32  // HLSL Change
-  sys::SmartScopedReader<true> Guard(Lock);
+  ScopedProfiledReader Guard(Lock);
   #endif
   StringMapType::const_iterator I = PassInfoStringMap.find(Arg);
   return I != PassInfoStringMap.end() ? I->second : nullptr;
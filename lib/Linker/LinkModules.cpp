@@ -260,6 +260,13 @@ Type *TypeMapTy::get(Type *Ty, SmallPtrSet<StructType *, 8> &Visited) {
   // These are types that LLVM itself will unique.
   bool IsUniqued = !isa<StructType>(Ty) || cast<StructType>(Ty)->isLiteral();
 
+  // HLSL Change Begin - The bitcode reader reuses identical named types that
+  // already exist in the context, so the source module may use destination
+  // types directly. Those map to themselves.
+  if (!IsUniqued && DstStructTypesSet.hasType(cast<StructType>(Ty)))
+    return *Entry = Ty;
+  // HLSL Change End
+
 #ifndef NDEBUG
   if (!IsUniqued) {
     for (auto &Pair : MappedTypes) {
@@ -0,0 +1,104 @@
+//===-- ContentionProfiler.cpp - Lock Contention Profiler -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - Per-thread lock contention profiling.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ContentionProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cassert>
+
+using namespace std::chrono;
+
+namespace llvm {
+
+LLVM_THREAD_LOCAL ContentionProfile *ContentionProfilerInstance = nullptr;
+static LLVM_THREAD_LOCAL unsigned ContentionProfilerPhase = 0;
+
+void contentionProfilerBegin(ContentionProfile &Profile) {
+  assert(ContentionProfilerInstance == nullptr &&
+         "Profiler should not be active");
+  ContentionProfilerInstance = &Profile;
+}
+
+void contentionProfilerEnd() { ContentionProfilerInstance = nullptr; }
+
+void contentionProfilerSetPhase(unsigned Phase) {
+  assert(Phase < ContentionProfile::kMaxPhases && "Phase out of range");
+  ContentionProfilerPhase = Phase;
+}
+
+void contentionProfilerRecord(ContentionSite Site, bool Contended,
+                              steady_clock::duration Wait) {
+  ContentionProfile *Profile = ContentionProfilerInstance;
+  if (Profile == nullptr)
+    return;
+  ContentionCounters &C =
+      Profile->Counters[ContentionProfilerPhase][(unsigned)Site];
+  ++C.Acquisitions;
+  if (Contended)
+    ++C.Contended;
+  C.WaitNanoseconds += duration_cast<nanoseconds>(Wait).count();
+}
+
+const char *getContentionSiteName(ContentionSite Site) {
+  switch (Site) {
+  case ContentionSite::ManagedStatic:
+    return "managed-static";
+  case ContentionSite::PassRegistry:
+    return "pass-registry";
+  case ContentionSite::DxilLibrary:
+    return "dxil-library";
+  case ContentionSite::ArgsCache:
+    return "args-cache";
+  }
+  return "unknown";
+}
+
+static void writeCounters(raw_ostream &OS, const ContentionCounters &C) {
+  OS << "\"acquisitions\": " << C.Acquisitions
+     << ", \"contended\": " << C.Contended
+     << ", \"waitNanoseconds\": " << C.WaitNanoseconds;
+}
+
+void writeContentionProfile(raw_ostream &OS, const ContentionProfile &Profile,
+                            unsigned NumPhases,
+                            function_ref<const char *(unsigned)> PhaseName) {
+  assert(NumPhases <= ContentionProfile::kMaxPhases && "Too many phases");
+  OS << "{ \"sites\": [";
+  for (unsigned S = 0; S < ContentionProfile::kNumSites; ++S) {
+    ContentionCounters Total;
+    for (unsigned P = 0; P < NumPhases; ++P) {
+      const ContentionCounters &C = Profile.Counters[P][S];
+      Total.Acquisitions += C.Acquisitions;
+      Total.Contended += C.Contended;
+      Total.WaitNanoseconds += C.WaitNanoseconds;
+    }
+    OS << (S ? ",\n" : "\n") << "    { \"name\": \""
+       << getContentionSiteName((ContentionSite)S) << "\", ";
+    writeCounters(OS, Total);
+    OS << ", \"phases\": [";
+    bool First = true;
+    for (unsigned P = 0; P < NumPhases; ++P) {
+      const ContentionCounters &C = Profile.Counters[P][S];
+      if (C.Acquisitions == 0)
+        continue;
+      OS << (First ? "\n" : ",\n") << "      { \"name\": \"" << PhaseName(P)
+         << "\", ";
+      writeCounters(OS, C);
+      OS << " }";
+      First = false;
+    }
+    OS << (First ? "] }" : " ] }");
+  }
+  OS << "\n  ]\n}\n";
+}
+
+} // namespace llvm
@@ -26,6 +26,7 @@
 
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Config/config.h"
+#include "llvm/Support/ContentionProfiler.h" // HLSL Change
 #include "llvm/Support/Threading.h"
 #include <cassert>
 #include <mutex>
@@ -42,7 +43,9 @@ void ManagedStaticBase::RegisterManagedStatic(void *(*Creator)(),
                                               void (*Deleter)(void*)) const {
   assert(Creator);
   if (llvm_is_multithreaded()) {
-    std::lock_guard<std::recursive_mutex> Lock(*getManagedStaticMutex());
+    // HLSL Change - profiled, as compiles on other threads can be here too.
+    ProfiledLockGuard<std::recursive_mutex> Lock(*getManagedStaticMutex(),
+                                                 ContentionSite::ManagedStatic);
 
     if (!Ptr.load(std::memory_order_relaxed)) {
       void *Tmp = Creator();
@@ -24,7 +24,8 @@ using namespace std::chrono;
 
 namespace llvm {
 
-TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
+LLVM_THREAD_LOCAL TimeTraceProfiler *TimeTraceProfilerInstance =
+    nullptr; // HLSL Change - per thread
 
 static std::string escapeString(StringRef Src) {
   std::string OS;
@@ -52,6 +52,11 @@ namespace hlsl {
 /// compilation.</summary>
 void InitializeASTContextForHLSL(clang::ASTContext &context);
 
+/// <summary>Releases the COM references that HLSL support holds in the
+/// specified context, for a context that is abandoned rather than
+/// destroyed.</summary>
+void ReleaseExternalReferencesForHLSL(clang::ASTContext &context);
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Type system enumerations.
 
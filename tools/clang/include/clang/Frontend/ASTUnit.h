@@ -192,6 +192,17 @@ private:
   /// some number of calls.
   unsigned PreambleRebuildCounter;
 
+  // HLSL Change Starts
+  /// \brief Whether function bodies outside of the main file are skipped.
+  ///
+  /// HLSL has no support for precompiled headers, so a precompiled preamble
+  /// is approximated by parsing only the declarations of included files, which
+  /// keeps the cost of a reparse tied to the main file rather than to the
+  /// volume of included headers. Diagnostics within the skipped bodies are not
+  /// reported.
+  bool HlslSkipPreambleFunctionBodies;
+  // HLSL Change Ends
+
 public:
   hlsl::DxcLangExtensionsHelperApply *HlslLangExtensions; // HLSL Change
 
@@ -552,6 +563,12 @@ public:
 
   bool getOnlyLocalDecls() const { return OnlyLocalDecls; }
 
+  // HLSL Change Starts
+  bool getHlslSkipPreambleFunctionBodies() const {
+    return HlslSkipPreambleFunctionBodies;
+  }
+  // HLSL Change Ends
+
   bool getOwnsRemappedFileBuffers() const { return OwnsRemappedFileBuffers; }
   void setOwnsRemappedFileBuffers(bool val) { OwnsRemappedFileBuffers = val; }
 
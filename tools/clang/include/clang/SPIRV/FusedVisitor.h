@@ -0,0 +1,55 @@
+//===-- FusedVisitor.h - Fused SPIR-V Visitor -------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_CLANG_SPIRV_FUSEDVISITOR_H
+#define LLVM_CLANG_SPIRV_FUSEDVISITOR_H
+
+#include "clang/SPIRV/SpirvVisitor.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace clang {
+namespace spirv {
+
+/// \brief Runs several visitors in a single traversal of a SPIR-V module.
+///
+/// Every construct is handed to each member visitor in the order the members
+/// were given, before the traversal moves on to the next construct. This is
+/// only equivalent to running the members one after another when no member
+/// reads state that a later member changes on constructs visited earlier, so
+/// visitors that need to see the whole module before the next one starts
+/// must not be fused.
+///
+/// A member that returns false stops receiving visits, as if its own
+/// traversal had ended there. The fused traversal itself stops once every
+/// member has stopped.
+class FusedVisitor : public Visitor {
+public:
+  FusedVisitor(SpirvContext &spvCtx, const SpirvCodeGenOptions &opts,
+               llvm::ArrayRef<Visitor *> visitors);
+
+  bool visit(SpirvModule *, Phase) override;
+  bool visit(SpirvFunction *, Phase) override;
+  bool visit(SpirvBasicBlock *, Phase) override;
+
+  using Visitor::visit;
+
+  /// Dispatches the instruction to each active member through its own
+  /// overloads.
+  bool visitInstruction(SpirvInstruction *) override;
+
+private:
+  template <typename Fn> bool forEachActive(Fn fn);
+
+  llvm::SmallVector<Visitor *, 4> members;
+  llvm::SmallVector<bool, 4> active;
+};
+
+} // end namespace spirv
+} // end namespace clang
+
+#endif // LLVM_CLANG_SPIRV_FUSEDVISITOR_H
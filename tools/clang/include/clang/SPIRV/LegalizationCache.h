@@ -0,0 +1,60 @@
+//===-- LegalizationCache.h - SPIR-V Legalization Cache ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_CLANG_SPIRV_LEGALIZATIONCACHE_H
+#define LLVM_CLANG_SPIRV_LEGALIZATIONCACHE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace spirv {
+
+/// \brief A directory of SPIR-V modules that already went through
+/// legalization and optimization, keyed on the module before those passes.
+///
+/// Each entry is a single file named after its key. Entries are written to a
+/// temporary file first and renamed into place, so several processes may
+/// share the directory: readers either see a complete entry or none at all.
+///
+/// The cache talks to the operating system directly rather than through
+/// llvm::sys::fs, because compilations run with a file system that only
+/// exposes the compile inputs.
+class LegalizationCache {
+public:
+  /// Creates a cache over the given directory, which must already exist.
+  explicit LegalizationCache(llvm::StringRef directory);
+
+  /// Returns the key of a module before legalization. The configuration must
+  /// describe everything other than the module itself that affects the
+  /// legalized result, such as the pass pipeline and the target environment.
+  static std::string computeKey(llvm::ArrayRef<uint32_t> module,
+                                llvm::StringRef configuration);
+
+  /// Reads the entry for the given key into *module. Returns false and
+  /// leaves *module untouched if there is no complete entry.
+  bool lookup(llvm::StringRef key, std::vector<uint32_t> *module) const;
+
+  /// Writes an entry for the given key. Failures are ignored: the cache is
+  /// only an accelerator and the caller already has the result.
+  void store(llvm::StringRef key, llvm::ArrayRef<uint32_t> module) const;
+
+private:
+  std::string getEntryPath(llvm::StringRef key) const;
+
+  std::string directory;
+};
+
+} // end namespace spirv
+} // end namespace clang
+
+#endif // LLVM_CLANG_SPIRV_LEGALIZATIONCACHE_H
@@ -776,6 +776,9 @@ void clang::EmitBackendOutput(DiagnosticsEngine &Diags,
 
   // HLSL Change - Support hierarchial time tracing.
   TimeTraceScope TimeScope("Backend", StringRef(""));
+  // HLSL Change - Scope the HL passes phase. DxilGenerationPass moves on to
+  // DxilPasses within it.
+  DxcThreadMallocPhase HLPassesPhase(DxcMallocPhase::HLPasses);
 
   try { // HLSL Change Starts
     // Catch any fatal errors during optimization passes here
@@ -211,6 +211,7 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     OwnsRemappedFileBuffers(true),
     NumStoredDiagnosticsFromDriver(0),
     PreambleRebuildCounter(0),
+    HlslSkipPreambleFunctionBodies(false), // HLSL Change
     HlslLangExtensions(nullptr),    // HLSL Change
     NumWarningsInPreamble(0),
     ShouldCacheCodeCompletionResults(false),
@@ -888,6 +889,22 @@ public:
   ASTDeserializationListener *GetASTDeserializationListener() override {
     return nullptr; // return Unit.getDeserializationListener(); // HLSL Change - no support for serialization
   }
+
+  // HLSL Change Starts - skip bodies of included files in place of a
+  // precompiled preamble.
+  bool shouldSkipFunctionBody(Decl *D) override {
+    if (!Unit.getHlslSkipPreambleFunctionBodies())
+      return ASTConsumer::shouldSkipFunctionBody(D);
+
+    // Templates may need their bodies to instantiate in the main file.
+    if (const FunctionDecl *FD = D->getAsFunction())
+      if (FD->getDescribedFunctionTemplate() || FD->isDependentContext())
+        return false;
+
+    const SourceManager &SM = Unit.getSourceManager();
+    return !SM.isInMainFile(SM.getExpansionLoc(D->getLocation()));
+  }
+  // HLSL Change Ends
 };
 
 class TopLevelDeclTrackerAction : public ASTFrontendAction {
@@ -1915,6 +1932,17 @@ bool ASTUnit::LoadFromCompilerInvocation(
     OverrideMainBuffer =
         getMainBufferWithPrecompiledPreamble(PCHContainerOps, *Invocation);
   }
+
+  // HLSL Change Starts - there are no precompiled preambles for HLSL; parse
+  // only the declarations of included files instead, on this and every
+  // subsequent reparse. If all bodies are skipped already, leave it at that.
+  FrontendOptions &FrontendOpts = Invocation->getFrontendOpts();
+  if (PrecompilePreamble && Invocation->getLangOpts()->HLSL &&
+      !FrontendOpts.SkipFunctionBodies) {
+    HlslSkipPreambleFunctionBodies = true;
+    FrontendOpts.SkipFunctionBodies = true;
+  }
+  // HLSL Change Ends
   
   SimpleTimer ParsingTimer(WantTiming);
   ParsingTimer.setOutput("Parsing " + getMainFileName());
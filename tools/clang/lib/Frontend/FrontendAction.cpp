@@ -11,6 +11,7 @@
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/DeclGroup.h"
+#include "clang/AST/HlslTypes.h" // HLSL Change
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
@@ -486,6 +487,10 @@ void FrontendAction::EndSourceFile() {
   // FIXME: There is more per-file stuff we could just drop here?
   bool DisableFree = CI.getFrontendOpts().DisableFree;
   if (DisableFree) {
+    // HLSL Change Begin - the leaked context must not keep host objects alive.
+    if (CI.hasASTContext() && CI.getLangOpts().HLSL)
+      hlsl::ReleaseExternalReferencesForHLSL(CI.getASTContext());
+    // HLSL Change End
     CI.resetAndLeakSema();
     CI.resetAndLeakASTContext();
     BuryPointer(CI.takeASTConsumer().get());
@@ -23,6 +23,7 @@
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/SemaConsumer.h"
 #include "clang/Sema/SemaHLSL.h" // HLSL Change
+#include "dxc/Support/Global.h"  // HLSL Change
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/TimeProfiler.h"
 #include <cstdio>
@@ -102,6 +103,8 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
 
   // HLSL Change - Support hierarchial time tracing.
   llvm::TimeTraceScope TimeScope("Frontend", StringRef(""));
+  // HLSL Change - Attribute allocations to compile phases.
+  DxcThreadMallocPhase ParsePhase(DxcMallocPhase::Parse);
   // Collect global stats on Decls/Stmts (until we have a module streamer).
   if (PrintStats) {
     Decl::EnableStatistics();
@@ -145,8 +148,13 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
         // If we got a null return and something *was* parsed, ignore it.  This
         // is due to a top-level semicolon, an action override, or a parse error
         // skipping something.
-        if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
-          return;
+        // HLSL Change Begin - Attribute allocations to codegen.
+        if (ADecl) {
+          DxcThreadMallocPhase CodeGenPhase(DxcMallocPhase::CodeGen);
+          if (!Consumer->HandleTopLevelDecl(ADecl.get()))
+            return;
+        }
+        // HLSL Change End
       } while (!P.ParseTopLevelDecl(ADecl));
     }
   } // HLSL Change: Skip if fatal error already occurred
@@ -160,8 +168,11 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   // errors in the front-end, without relying on code generation being
   // available.
   hlsl::DiagnoseTranslationUnit(&S);
+  {
+    DxcThreadMallocPhase CodeGenPhase(DxcMallocPhase::CodeGen);
+    Consumer->HandleTranslationUnit(S.getASTContext());
+  }
   // HLSL Change Ends
-  Consumer->HandleTranslationUnit(S.getASTContext());
 
   std::swap(OldCollectStats, S.CollectStats);
   if (PrintStats) {
@@ -23,6 +23,7 @@
 #include "clang/SPIRV/String.h"
 // clang-format on
 
+#include <algorithm>
 #include <functional>
 
 namespace clang {
@@ -468,21 +469,40 @@ void EmitVisitor::finalizeInstruction(std::vector<uint32_t> *section) {
 }
 
 std::vector<uint32_t> EmitVisitor::takeBinary() {
-  std::vector<uint32_t> result;
   Header header(takeNextId(), getHeaderVersion(featureManager.getTargetEnv()));
   auto headerBinary = header.takeBinary();
-  result.insert(result.end(), headerBinary.begin(), headerBinary.end());
-  result.insert(result.end(), preambleBinary.begin(), preambleBinary.end());
-  result.insert(result.end(), debugFileBinary.begin(), debugFileBinary.end());
-  result.insert(result.end(), debugVariableBinary.begin(),
-                debugVariableBinary.end());
-  result.insert(result.end(), annotationsBinary.begin(),
-                annotationsBinary.end());
-  result.insert(result.end(), typeConstantBinary.begin(),
-                typeConstantBinary.end());
-  result.insert(result.end(), globalVarsBinary.begin(), globalVarsBinary.end());
-  result.insert(result.end(), richDebugInfo.begin(), richDebugInfo.end());
-  result.insert(result.end(), mainBinary.begin(), mainBinary.end());
+
+  // The sections that precede mainBinary, in module layout order.
+  const std::vector<uint32_t> *leadingSections[] = {
+      &headerBinary,      &preambleBinary,      &debugFileBinary,
+      &debugVariableBinary, &annotationsBinary, &typeConstantBinary,
+      &globalVarsBinary,  &richDebugInfo};
+  size_t leadingSize = 0;
+  for (auto *section : leadingSections)
+    leadingSize += section->size();
+
+  // The function bodies usually make up most of the module. When mainBinary
+  // has spare capacity for the whole module, the module is assembled in its
+  // buffer: its words are shifted to the end and the other sections are
+  // copied in front of them. Otherwise the module is assembled into a buffer
+  // allocated once at its final size.
+  const size_t mainSize = mainBinary.size();
+  const size_t totalSize = leadingSize + mainSize;
+  std::vector<uint32_t> result;
+  if (mainBinary.capacity() >= totalSize) {
+    result = std::move(mainBinary);
+    result.resize(totalSize);
+    std::move_backward(result.begin(), result.begin() + mainSize,
+                       result.end());
+    auto out = result.begin();
+    for (auto *section : leadingSections)
+      out = std::copy(section->begin(), section->end(), out);
+  } else {
+    result.reserve(totalSize);
+    for (auto *section : leadingSections)
+      result.insert(result.end(), section->begin(), section->end());
+    result.insert(result.end(), mainBinary.begin(), mainBinary.end());
+  }
   return result;
 }
 
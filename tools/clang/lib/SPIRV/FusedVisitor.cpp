@@ -0,0 +1,60 @@
+//===--- FusedVisitor.cpp - Fused SPIR-V Visitor -----------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/SPIRV/FusedVisitor.h"
+
+namespace clang {
+namespace spirv {
+
+FusedVisitor::FusedVisitor(SpirvContext &spvCtx,
+                           const SpirvCodeGenOptions &opts,
+                           llvm::ArrayRef<Visitor *> visitors)
+    : Visitor(opts, spvCtx), members(visitors.begin(), visitors.end()),
+      active(visitors.size(), true) {
+  // The traversal consults the options of the visitor it is given, so every
+  // member must agree with them.
+  for (auto *member : members) {
+    (void)member;
+    assert(member->getCodeGenOptions().debugInfoVulkan ==
+               opts.debugInfoVulkan &&
+           "fused visitors must share the debug info flavor");
+  }
+}
+
+template <typename Fn> bool FusedVisitor::forEachActive(Fn fn) {
+  bool anyActive = false;
+  for (size_t i = 0; i < members.size(); ++i) {
+    if (!active[i])
+      continue;
+    if (fn(members[i]))
+      anyActive = true;
+    else
+      active[i] = false;
+  }
+  return anyActive;
+}
+
+bool FusedVisitor::visit(SpirvModule *mod, Phase phase) {
+  return forEachActive([=](Visitor *v) { return v->visit(mod, phase); });
+}
+
+bool FusedVisitor::visit(SpirvFunction *fn, Phase phase) {
+  return forEachActive([=](Visitor *v) { return v->visit(fn, phase); });
+}
+
+bool FusedVisitor::visit(SpirvBasicBlock *bb, Phase phase) {
+  return forEachActive([=](Visitor *v) { return v->visit(bb, phase); });
+}
+
+bool FusedVisitor::visitInstruction(SpirvInstruction *instr) {
+  return forEachActive([=](Visitor *v) { return instr->invokeVisitor(v); });
+}
+
+} // end namespace spirv
+} // end namespace clang
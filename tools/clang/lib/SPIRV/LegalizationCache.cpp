@@ -0,0 +1,121 @@
+//===--- LegalizationCache.cpp - SPIR-V Legalization Cache -------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/SPIRV/LegalizationCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Process.h"
+
+#include <atomic>
+#include <cstdio>
+
+namespace clang {
+namespace spirv {
+
+namespace {
+// Every entry starts with this header, followed by the module words.
+const uint32_t kEntryMagic = 0x434C5044; // "DPLC"
+const uint32_t kEntryVersion = 1;
+const uint32_t kSpirvMagic = 0x07230203;
+
+struct EntryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t wordCount;
+};
+
+llvm::ArrayRef<uint8_t> asBytes(const void *data, size_t size) {
+  return llvm::ArrayRef<uint8_t>(static_cast<const uint8_t *>(data), size);
+}
+} // namespace
+
+LegalizationCache::LegalizationCache(llvm::StringRef dir) : directory(dir) {
+  while (!directory.empty() &&
+         (directory.back() == '/' || directory.back() == '\\'))
+    directory.pop_back();
+}
+
+std::string LegalizationCache::computeKey(llvm::ArrayRef<uint32_t> module,
+                                          llvm::StringRef configuration) {
+  // Lengths go in first so that the module/configuration boundary is
+  // unambiguous.
+  const uint64_t lengths[2] = {module.size(), configuration.size()};
+  llvm::MD5 hash;
+  hash.update(asBytes(lengths, sizeof(lengths)));
+  hash.update(asBytes(module.data(), module.size() * sizeof(uint32_t)));
+  hash.update(configuration);
+
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<32> key;
+  llvm::MD5::stringifyResult(result, key);
+  return key.str();
+}
+
+std::string LegalizationCache::getEntryPath(llvm::StringRef key) const {
+  return directory + "/" + key.str() + ".spv";
+}
+
+bool LegalizationCache::lookup(llvm::StringRef key,
+                               std::vector<uint32_t> *module) const {
+  FILE *f = std::fopen(getEntryPath(key).c_str(), "rb");
+  if (!f)
+    return false;
+
+  bool ok = false;
+  EntryHeader header;
+  std::vector<uint32_t> words;
+  if (std::fread(&header, sizeof(header), 1, f) == 1 &&
+      header.magic == kEntryMagic && header.version == kEntryVersion &&
+      header.wordCount > 0) {
+    words.resize(header.wordCount);
+    // The entry must hold exactly the advertised number of words.
+    ok = std::fread(words.data(), sizeof(uint32_t), words.size(), f) ==
+             words.size() &&
+         std::fgetc(f) == EOF && words[0] == kSpirvMagic;
+  }
+  std::fclose(f);
+
+  if (ok)
+    module->swap(words);
+  return ok;
+}
+
+void LegalizationCache::store(llvm::StringRef key,
+                              llvm::ArrayRef<uint32_t> module) const {
+  if (module.empty())
+    return;
+
+  // Concurrent writers of the same key produce identical contents, so each
+  // only needs a temporary name that no other writer can pick.
+  static std::atomic<unsigned> counter(0);
+  const std::string path = getEntryPath(key);
+  const std::string tempPath =
+      path + "." + std::to_string(llvm::sys::Process::GetRandomNumber()) +
+      "." + std::to_string(counter++) + ".tmp";
+
+  FILE *f = std::fopen(tempPath.c_str(), "wb");
+  if (!f)
+    return;
+
+  EntryHeader header = {kEntryMagic, kEntryVersion,
+                        static_cast<uint32_t>(module.size())};
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+            std::fwrite(module.data(), sizeof(uint32_t), module.size(), f) ==
+                module.size();
+  ok = std::fclose(f) == 0 && ok;
+
+  // On Windows, rename fails if another writer got there first. The entry
+  // that is already in place is just as good.
+  if (!ok || std::rename(tempPath.c_str(), path.c_str()) != 0)
+    std::remove(tempPath.c_str());
+}
+
+} // end namespace spirv
+} // end namespace clang
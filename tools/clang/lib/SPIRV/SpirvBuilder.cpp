@@ -20,6 +20,7 @@
 #include "RemoveBufferBlockVisitor.h"
 #include "SortDebugInfoVisitor.h"
 #include "clang/SPIRV/AstTypeProbe.h"
+#include "clang/SPIRV/FusedVisitor.h"
 #include "clang/SPIRV/String.h"
 
 namespace clang {
@@ -1939,11 +1940,12 @@ std::vector<uint32_t> SpirvBuilder::takeModule() {
 
   mod->invokeVisitor(&literalTypeVisitor, true);
 
-  // Propagate NonUniform decorations
-  mod->invokeVisitor(&nonUniformVisitor);
-
-  // Lower types
-  mod->invokeVisitor(&lowerTypeVisitor);
+  // Propagate NonUniform decorations and lower types. NonUniform propagation
+  // only reads and writes the NonUniform flags, which type lowering does not
+  // touch, so both share a single walk.
+  FusedVisitor nonUniformAndLowerTypeVisitor(
+      context, spirvOptions, {&nonUniformVisitor, &lowerTypeVisitor});
+  mod->invokeVisitor(&nonUniformAndLowerTypeVisitor);
 
   // Generate debug types (if needed)
   if (spirvOptions.debugInfoRich) {
@@ -1954,11 +1956,12 @@ std::vector<uint32_t> SpirvBuilder::takeModule() {
     mod->invokeVisitor(&sortDebugInfoVisitor);
   }
 
-  // Add necessary capabilities and extensions
-  mod->invokeVisitor(&capabilityVisitor);
-
-  // Propagate RelaxedPrecision decorations
-  mod->invokeVisitor(&relaxedPrecisionVisitor);
+  // Add necessary capabilities and extensions, and propagate RelaxedPrecision
+  // decorations. The RelaxedPrecision flags are not read when selecting
+  // capabilities, so both share a single walk.
+  FusedVisitor capabilityAndRelaxedPrecisionVisitor(
+      context, spirvOptions, {&capabilityVisitor, &relaxedPrecisionVisitor});
+  mod->invokeVisitor(&capabilityAndRelaxedPrecisionVisitor);
 
   // Propagate NoContraction decorations
   mod->invokeVisitor(&preciseVisitor, true);
@@ -25,6 +25,7 @@
 #include "clang/AST/RecordLayout.h"
 #include "clang/AST/Type.h"
 #include "clang/SPIRV/AstTypeProbe.h"
+#include "clang/SPIRV/LegalizationCache.h"
 #include "clang/SPIRV/String.h"
 #include "clang/Sema/Sema.h"
 #include "llvm/ADT/APInt.h"
@@ -906,7 +907,26 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
   if (spirvOptions.codeGenHighLevel) {
     beforeHlslLegalization = needsLegalization;
   } else {
-    if (needsLegalization) {
+    const bool needsOptimization =
+        theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0;
+
+    // The result of legalization and optimization only depends on the module
+    // and on the pass configuration, so it can be reused from an earlier
+    // compilation that emitted the same module.
+    LegalizationCache legalizationCache(spirvOptions.legalizationCacheDir);
+    std::string legalizationCacheKey;
+    bool useLegalizationCache = !spirvOptions.legalizationCacheDir.empty() &&
+                                !spirvOptions.printAll &&
+                                (needsLegalization || needsOptimization);
+    bool legalizationCacheHit = false;
+    if (useLegalizationCache) {
+      legalizationCacheKey = LegalizationCache::computeKey(
+          m, getLegalizationCacheConfig(needsLegalization, needsOptimization,
+                                        dsetbindingsToCombineImageSampler));
+      legalizationCacheHit = legalizationCache.lookup(legalizationCacheKey, &m);
+    }
+
+    if (needsLegalization && !legalizationCacheHit) {
       std::string messages;
       if (!spirvToolsLegalize(&m, &messages,
                               &dsetbindingsToCombineImageSampler)) {
@@ -918,10 +938,12 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
         return;
       } else if (!messages.empty()) {
         emitWarning("SPIR-V legalization: %0", {}) << messages;
+        // Keep the warning visible to later compilations.
+        useLegalizationCache = false;
       }
     }
 
-    if (theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0) {
+    if (needsOptimization && !legalizationCacheHit) {
       // Run optimization passes
       std::string messages;
       if (!spirvToolsOptimize(&m, &messages)) {
@@ -934,6 +956,9 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
       }
     }
 
+    if (useLegalizationCache && !legalizationCacheHit)
+      legalizationCache.store(legalizationCacheKey, m);
+
     // Fixup debug instruction opcodes: change the opcode to
     // OpExtInstWithForwardRefsKHR is the instruction at least one forward
     // reference.
@@ -14759,6 +14784,35 @@ bool SpirvEmitter::spirvToolsOptimize(std::vector<uint32_t> *mod,
   return optimizer.Run(mod->data(), mod->size(), mod, options);
 }
 
+std::string SpirvEmitter::getLegalizationCacheConfig(
+    bool legalize, bool optimize,
+    const std::vector<DescriptorSetAndBinding>
+        &dsetbindingsToCombineImageSampler) {
+  // Everything spirvToolsLegalize and spirvToolsOptimize consult besides the
+  // module itself, plus the versions of the compiler and of SPIRV-Tools.
+  std::string config;
+  llvm::raw_string_ostream os(config);
+  os << clang::getClangFullVersion() << '\n'
+     << spvSoftwareVersionDetailsString() << '\n'
+     << "env=" << static_cast<int>(featureManager.getTargetEnv())
+     << " legalize=" << legalize << " optimize=" << optimize
+     << " preserve-bindings=" << spirvOptions.preserveBindings
+     << " preserve-interface=" << spirvOptions.preserveInterface
+     << " max-id=" << spirvOptions.maxId
+     << " signature-packing=" << spirvOptions.signaturePacking
+     << " flatten=" << (spirvOptions.flattenResourceArrays ||
+                        declIdMapper.requiresFlatteningCompositeResources())
+     << " reduce-load-size=" << spirvOptions.reduceLoadSize
+     << " fix-func-call-arguments=" << spirvOptions.fixFuncCallArguments;
+  os << " combine-image-sampler=";
+  for (const auto &dsetbinding : dsetbindingsToCombineImageSampler)
+    os << dsetbinding.descriptor_set << ':' << dsetbinding.binding << ';';
+  os << " oconfig=";
+  for (const auto &flag : spirvOptions.optConfig)
+    os << flag << ';';
+  return os.str();
+}
+
 bool SpirvEmitter::spirvToolsLegalize(std::vector<uint32_t> *mod,
                                       std::string *messages,
                                       const std::vector<DescriptorSetAndBinding>
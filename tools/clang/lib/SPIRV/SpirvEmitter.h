@@ -1222,6 +1222,15 @@ private:
                      const std::vector<spvtools::opt::DescriptorSetAndBinding>
                          *dsetbindingsToCombineImageSampler);
 
+  /// \brief Returns a description of everything other than the module that
+  /// determines the result of running spirvToolsLegalize (if |legalize|) and
+  /// then spirvToolsOptimize (if |optimize|). Used to key the legalization
+  /// cache.
+  std::string getLegalizationCacheConfig(
+      bool legalize, bool optimize,
+      const std::vector<spvtools::opt::DescriptorSetAndBinding>
+          &dsetbindingsToCombineImageSampler);
+
   /// \brief Helper function to run the SPIRV-Tools validator.
   /// Runs the SPIRV-Tools validator on the given SPIR-V module |mod|, and
   /// gets the info/warning/error messages via |messages|.
@@ -42,6 +42,7 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/TimeProfiler.h"
+#include "dxc/Support/Global.h" // HLSL Change
 using namespace clang;
 using namespace sema;
 
@@ -650,6 +651,7 @@ void Sema::emitAndClearUnusedLocalTypedefWarnings() {
 /// translation unit when EOF is reached and all but the top-level scope is
 /// popped.
 void Sema::ActOnEndOfTranslationUnit() {
+  DxcThreadMallocPhase SemaPhase(DxcMallocPhase::Sema); // HLSL Change
   assert(DelayedDiagnostics.getCurrentPool() == nullptr
          && "reached end of translation unit with a pool attached?");
 
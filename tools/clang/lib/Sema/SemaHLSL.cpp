@@ -4540,6 +4540,8 @@ public:
     }
   }
 
+  void ReleaseIntrinsicTables() { m_intrinsicTables.clear(); }
+
   void RegisterIntrinsicTable(IDxcIntrinsicTable *table) {
     DXASSERT_NOMSG(table != nullptr);
     m_intrinsicTables.push_back(table);
@@ -12180,6 +12182,15 @@ void hlsl::InitializeASTContextForHLSL(ASTContext &context) {
   }
 }
 
+/// <summary>Releases the intrinsic tables registered with the specified
+/// context.</summary>
+void hlsl::ReleaseExternalReferencesForHLSL(ASTContext &context) {
+  ExternalSemaSource *externalSource =
+      dyn_cast_or_null<ExternalSemaSource>(context.getExternalSource());
+  if (externalSource != nullptr)
+    static_cast<HLSLExternalSource *>(externalSource)->ReleaseIntrinsicTables();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // FlattenedTypeIterator implementation                                       //
 
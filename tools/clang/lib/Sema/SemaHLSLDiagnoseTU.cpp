@@ -292,9 +292,10 @@ std::vector<FunctionDecl *> GetAllExportedFDecls(clang::Sema *self) {
 clang::FunctionDecl *ValidateNoRecursion(CallGraphWithRecurseGuard &callGraph,
                                          clang::FunctionDecl *FD) {
   // Validate that there is no recursion reachable by this function declaration
-  // NOTE: the information gathered here could be used to bypass code generation
-  // on functions that are unreachable (as an early form of dead code
-  // elimination).
+  // NOTE: for non-library targets, code generation already skips unreachable
+  // functions without this information: ASTContext::DeclMustBeEmitted only
+  // requires the entry and patch constant functions, and every other function
+  // is deferred until emitted code references it.
   if (FD) {
     callGraph.BuildForEntry(FD);
     return callGraph.CheckRecursion(FD);
@@ -370,6 +371,7 @@ getFunctionOutputControlPointsCount(const FunctionDecl *function) {
 
 void hlsl::DiagnoseTranslationUnit(clang::Sema *self) {
   DXASSERT_NOMSG(self != nullptr);
+  DxcThreadMallocPhase SemaPhase(DxcMallocPhase::Sema);
 
   // Don't bother with global validation if compilation has already failed.
   if (self->getDiagnostics().hasErrorOccurred()) {
@@ -0,0 +1,43 @@
+// REQUIRES: shell
+
+// A miss stores the legalized module and a hit reuses it; either way the
+// output must match a compile that does not use the cache.
+// RUN: rm -rf %t.cache && mkdir %t.cache
+// RUN: %dxc -T cs_6_0 -E main %s -spirv -Fo %t.nocache.spv
+// RUN: %dxc -T cs_6_0 -E main %s -spirv -fspv-legalization-cache=%t.cache -Fo %t.miss.spv
+// RUN: ls %t.cache | FileCheck %s --check-prefix=ENTRY
+// RUN: %dxc -T cs_6_0 -E main %s -spirv -fspv-legalization-cache=%t.cache -Fo %t.hit.spv
+// RUN: cmp %t.nocache.spv %t.miss.spv
+// RUN: cmp %t.miss.spv %t.hit.spv
+
+// A truncated entry is a miss, and is replaced by a good one.
+// RUN: for f in %t.cache/*.spv; do head -c 20 $f > $f.cut && mv $f.cut $f; done
+// RUN: %dxc -T cs_6_0 -E main %s -spirv -fspv-legalization-cache=%t.cache -Fo %t.truncated.spv
+// RUN: cmp %t.miss.spv %t.truncated.spv
+// RUN: test $(cat %t.cache/*.spv | wc -c) -gt 20
+
+// So is an entry that is not a cache entry at all.
+// RUN: for f in %t.cache/*.spv; do echo corrupt > $f; done
+// RUN: %dxc -T cs_6_0 -E main %s -spirv -fspv-legalization-cache=%t.cache -Fo %t.corrupt.spv
+// RUN: cmp %t.miss.spv %t.corrupt.spv
+// RUN: ls %t.cache | FileCheck %s --check-prefix=ENTRY
+
+// ENTRY-NOT: .tmp
+// ENTRY: {{^[0-9a-f]+\.spv$}}
+// ENTRY-NOT: {{.}}
+
+struct S {
+  float4 f;
+  RWStructuredBuffer<float4> buffer;
+};
+
+RWStructuredBuffer<float4> gBuffer;
+
+[numthreads(1, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID) {
+  S s;
+  s.f = float4(id, 1);
+  s.buffer = gBuffer;
+  S copy = s;
+  copy.buffer[id.x] = copy.f;
+}
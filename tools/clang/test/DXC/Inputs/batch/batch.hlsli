@@ -0,0 +1 @@
+float4 Scale(float4 v) { return v * 2; }
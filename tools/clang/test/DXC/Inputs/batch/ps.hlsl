@@ -0,0 +1,3 @@
+#include "batch.hlsli"
+
+float4 main(float4 c : COLOR) : SV_Target { return Scale(c); }
@@ -0,0 +1,10 @@
+// server.hlsli only exists in the client's working directory.
+#include "server.hlsli"
+
+float4 main(float4 c : COLOR) : SV_Target {
+#ifdef ERROR
+  return undeclared;
+#else
+  return Scale(c);
+#endif
+}
@@ -0,0 +1,13 @@
+// RUN: %dxc -E main -T vs_6_0 %s -fcontention-report | FileCheck %s
+// RUN: %dxc -E main -T vs_6_0 %s -fcontention-report=%t.json
+// RUN: cat %t.json | FileCheck %s
+
+// CHECK: { "sites": [
+// CHECK-NEXT: { "name": "managed-static", "acquisitions": {{[0-9]+}}, "contended": {{[0-9]+}}, "waitNanoseconds": {{[0-9]+}}, "phases": [
+// CHECK: { "name": "pass-registry", "acquisitions": {{[0-9]+}},
+// CHECK: { "name": "dxil-library", "acquisitions": {{[0-9]+}},
+// CHECK: { "name": "args-cache", "acquisitions": {{[1-9][0-9]*}},
+// CHECK: ]
+// CHECK-NEXT: }
+
+void main() {}
@@ -0,0 +1,26 @@
+// Discarding the AST and IR at the end of a compile must not change what the
+// compile produces, including on paths that keep extra modules alive.
+// RUN: %dxc -E main -T ps_6_0 %s -fdiscard-teardown | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s -fdiscard-teardown -Zi -Qembed_debug | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s -fdiscard-teardown -fcgl | FileCheck %s --check-prefix=CGL
+// RUN: not %dxc -E main -T ps_6_0 %s -fdiscard-teardown -DERROR 2>&1 | FileCheck %s --check-prefix=ERR
+// RUN: %dxc -help | FileCheck %s --check-prefix=HELP
+
+// HELP: -fdiscard-teardown
+// HELP-SAME: only reclaimed when the process exits
+// HELP-NOT: -fdiscard-teardown-at-exit
+
+// CHECK: define void @main()
+// CHECK: call void @dx.op.storeOutput.f32
+
+// CGL: define <4 x float> @main(
+
+// ERR: error: use of undeclared identifier 'undeclared'
+
+float4 main(float4 a : A) : SV_Target {
+#ifdef ERROR
+  return undeclared;
+#else
+  return a * 2;
+#endif
+}
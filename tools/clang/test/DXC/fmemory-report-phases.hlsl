@@ -0,0 +1,11 @@
+// REQUIRES: system-windows
+// Operator new only allocates through the compile's IMalloc on Windows, so
+// only there do the front end phases have allocations to report.
+
+// RUN: %dxc -E main -T ps_6_0 %s -fmemory-report | FileCheck %s
+
+// CHECK: { "includesOperatorNew": true,
+// CHECK: { "name": "parse", "allocations": {{[1-9][0-9]*}}, "allocatedBytes": {{[1-9][0-9]*}},
+// CHECK: { "name": "codegen", "allocations": {{[1-9][0-9]*}}, "allocatedBytes": {{[1-9][0-9]*}},
+
+float4 main(float4 c : COLOR) : SV_Target { return c * 2.0; }
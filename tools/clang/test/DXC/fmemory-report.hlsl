@@ -0,0 +1,18 @@
+// RUN: %dxc -E main -T vs_6_0 %s -fmemory-report | FileCheck %s
+// RUN: %dxc -E main -T vs_6_0 %s -fmemory-report=%t.json
+// RUN: cat %t.json | FileCheck %s
+
+// CHECK: { "includesOperatorNew": {{true|false}},
+// CHECK-NEXT: "allocations": {{[0-9]+}}, "allocatedBytes": {{[0-9]+}}, "peakBytes": {{[0-9]+}},
+// CHECK-NEXT: "phases": [
+// CHECK-NEXT: { "name": "other", "allocations":
+// CHECK-NEXT: { "name": "parse", "allocations":
+// CHECK-NEXT: { "name": "sema", "allocations":
+// CHECK-NEXT: { "name": "codegen", "allocations":
+// CHECK-NEXT: { "name": "hl-passes", "allocations":
+// CHECK-NEXT: { "name": "dxil-passes", "allocations":
+// CHECK-NEXT: { "name": "validation", "allocations":
+// CHECK-NEXT: { "name": "container", "allocations":
+// CHECK-NEXT: ]
+
+void main() {}
@@ -1,9 +1,31 @@
 // RUN: %dxc -T vs_6_1 -fcgl %s | FileCheck %s
 
-// Make sure unused functions are not generated.
+// Make sure unused functions are not generated, including functions only
+// called from other unused functions, namespace functions and out-of-line
+// methods.
 
 // CHECK-NOT: unused_function_name
+// CHECK-NOT: unused_callee_name
+// CHECK-NOT: unused_namespace_function_name
+// CHECK-NOT: unused_method_name
+// CHECK: define void @main(
+// CHECK-NOT: unused_function_name
+// CHECK-NOT: unused_callee_name
+// CHECK-NOT: unused_namespace_function_name
+// CHECK-NOT: unused_method_name
 
-void unused_function_name() {}
-void main() {}
+float unused_callee_name(float f) { return f * 2; }
+void unused_function_name() { unused_callee_name(1); }
+
+namespace helpers {
+float unused_namespace_function_name(float f) { return unused_callee_name(f); }
+}
 
+struct S {
+  float f;
+  float unused_method_name();
+};
+
+float S::unused_method_name() { return unused_callee_name(f); }
+
+void main() {}
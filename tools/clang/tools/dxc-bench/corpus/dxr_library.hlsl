@@ -0,0 +1,153 @@
+// DXR library with a ray generation shader, two miss shaders and a closest
+// hit and any hit shader for each of 32 materials. Every closest hit
+// shader traces a shadow ray and a reflection ray, so the library is
+// large and call-heavy.
+
+struct Payload {
+  float4 Color;
+  uint Depth;
+};
+
+struct ShadowPayload {
+  float Visibility;
+};
+
+struct Vertex {
+  float3 Position;
+  float3 Normal;
+  float2 UV;
+};
+
+cbuffer Camera : register(b0) {
+  float4x4 InvViewProj;
+  float3 CameraPos;
+  uint MaxDepth;
+  float3 SunDirection;
+  float Time;
+};
+
+RaytracingAccelerationStructure Scene : register(t0);
+StructuredBuffer<Vertex> Vertices : register(t1);
+ByteAddressBuffer Indices : register(t2);
+Texture2D<float4> MaterialTextures[] : register(t0, space1);
+RWTexture2D<float4> Output : register(u0);
+SamplerState LinearSampler : register(s0);
+
+RayDesc MakeRay(float3 origin, float3 direction) {
+  RayDesc ray;
+  ray.Origin = origin;
+  ray.Direction = direction;
+  ray.TMin = 0.001f;
+  ray.TMax = 10000.0f;
+  return ray;
+}
+
+[shader("raygeneration")]
+void RayGen() {
+  uint2 pixel = DispatchRaysIndex().xy;
+  float2 dims = (float2)DispatchRaysDimensions().xy;
+  float2 ndc = ((float2)pixel + 0.5f) / dims * float2(2.0f, -2.0f) +
+               float2(-1.0f, 1.0f);
+  float4 world = mul(InvViewProj, float4(ndc, 0.0f, 1.0f));
+  float3 direction = normalize(world.xyz / world.w - CameraPos);
+  Payload payload = {float4(0.0f, 0.0f, 0.0f, 0.0f), 0};
+  TraceRay(Scene, RAY_FLAG_NONE, 0xFF, 0, 2, 0, MakeRay(CameraPos, direction),
+           payload);
+  Output[pixel] = payload.Color;
+}
+
+[shader("miss")]
+void Miss(inout Payload payload) {
+  float t = saturate(WorldRayDirection().y * 0.5f + 0.5f);
+  float3 sky = lerp(float3(1.0f, 1.0f, 1.0f), float3(0.3f, 0.5f, 1.0f), t);
+  float sun = pow(saturate(dot(WorldRayDirection(), SunDirection)), 256.0f);
+  payload.Color = float4(sky + sun, 1.0f);
+}
+
+[shader("miss")]
+void ShadowMiss(inout ShadowPayload payload) { payload.Visibility = 1.0f; }
+
+float3 InterpolateNormal(BuiltInTriangleIntersectionAttributes attr,
+                         out float2 uv) {
+  uint3 index = Indices.Load3(PrimitiveIndex() * 12);
+  Vertex v0 = Vertices[index.x];
+  Vertex v1 = Vertices[index.y];
+  Vertex v2 = Vertices[index.z];
+  float3 bary = float3(1.0f - attr.barycentrics.x - attr.barycentrics.y,
+                       attr.barycentrics.x, attr.barycentrics.y);
+  uv = v0.UV * bary.x + v1.UV * bary.y + v2.UV * bary.z;
+  float3 normal = v0.Normal * bary.x + v1.Normal * bary.y + v2.Normal * bary.z;
+  return normalize(mul((float3x3)ObjectToWorld3x4(), normal));
+}
+
+float TraceShadow(float3 origin, float3 direction) {
+  ShadowPayload payload = {0.0f};
+  TraceRay(Scene,
+           RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH |
+               RAY_FLAG_SKIP_CLOSEST_HIT_SHADER,
+           0xFF, 1, 2, 1, MakeRay(origin, direction), payload);
+  return payload.Visibility;
+}
+
+#define DEFINE_MATERIAL(N)                                                     \
+  [shader("closesthit")]                                                       \
+  void ClosestHit##N(inout Payload payload,                                    \
+                     BuiltInTriangleIntersectionAttributes attr) {             \
+    float2 uv;                                                                 \
+    float3 normal = InterpolateNormal(attr, uv);                               \
+    float4 albedo = MaterialTextures[N].SampleLevel(LinearSampler, uv, 0.0f);  \
+    float3 hitPos = WorldRayOrigin() + WorldRayDirection() * RayTCurrent();    \
+    float visibility = TraceShadow(hitPos, SunDirection);                      \
+    float3 color = albedo.rgb * saturate(dot(normal, SunDirection)) *          \
+                   visibility * (1.0f + 0.03125f * N);                         \
+    if (payload.Depth < MaxDepth) {                                            \
+      Payload reflected = {float4(0.0f, 0.0f, 0.0f, 0.0f), payload.Depth + 1}; \
+      TraceRay(Scene, RAY_FLAG_NONE, 0xFF, 0, 2, 0,                            \
+               MakeRay(hitPos, reflect(WorldRayDirection(), normal)),          \
+               reflected);                                                     \
+      color = lerp(color, reflected.Color.rgb, 0.25f);                         \
+    }                                                                          \
+    payload.Color = float4(color, 1.0f);                                       \
+  }                                                                            \
+                                                                               \
+  [shader("anyhit")]                                                           \
+  void AnyHit##N(inout Payload payload,                                        \
+                 BuiltInTriangleIntersectionAttributes attr) {                 \
+    float2 uv;                                                                 \
+    InterpolateNormal(attr, uv);                                               \
+    if (MaterialTextures[N].SampleLevel(LinearSampler, uv, 0.0f).a < 0.5f)     \
+      IgnoreHit();                                                             \
+  }
+
+DEFINE_MATERIAL(0)
+DEFINE_MATERIAL(1)
+DEFINE_MATERIAL(2)
+DEFINE_MATERIAL(3)
+DEFINE_MATERIAL(4)
+DEFINE_MATERIAL(5)
+DEFINE_MATERIAL(6)
+DEFINE_MATERIAL(7)
+DEFINE_MATERIAL(8)
+DEFINE_MATERIAL(9)
+DEFINE_MATERIAL(10)
+DEFINE_MATERIAL(11)
+DEFINE_MATERIAL(12)
+DEFINE_MATERIAL(13)
+DEFINE_MATERIAL(14)
+DEFINE_MATERIAL(15)
+DEFINE_MATERIAL(16)
+DEFINE_MATERIAL(17)
+DEFINE_MATERIAL(18)
+DEFINE_MATERIAL(19)
+DEFINE_MATERIAL(20)
+DEFINE_MATERIAL(21)
+DEFINE_MATERIAL(22)
+DEFINE_MATERIAL(23)
+DEFINE_MATERIAL(24)
+DEFINE_MATERIAL(25)
+DEFINE_MATERIAL(26)
+DEFINE_MATERIAL(27)
+DEFINE_MATERIAL(28)
+DEFINE_MATERIAL(29)
+DEFINE_MATERIAL(30)
+DEFINE_MATERIAL(31)
@@ -0,0 +1,131 @@
+// Physically based material pixel shader, written as an uber-shader that is
+// compiled once per combination of the feature macros below.
+//
+//   NORMAL_MAP  - perturb the vertex normal with a tangent space normal map.
+//   ALPHA_TEST  - discard pixels below AlphaCutoff.
+//   SHADOWS     - 3x3 PCF shadow lookup.
+//   EMISSIVE    - add an emissive texture.
+//   NUM_LIGHTS  - number of point lights, unrolled.
+
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 4
+#endif
+
+struct Light {
+  float3 Position;
+  float Range;
+  float3 Color;
+  float Intensity;
+};
+
+cbuffer Frame : register(b0) {
+  float4x4 ShadowMatrix;
+  float3 CameraPosition;
+  float AlphaCutoff;
+  float3 EmissiveColor;
+  float ExposureScale;
+  Light Lights[NUM_LIGHTS];
+};
+
+Texture2D<float4> BaseColorMap : register(t0);
+Texture2D<float4> NormalMap : register(t1);
+Texture2D<float4> MetalRoughMap : register(t2);
+Texture2D<float4> EmissiveMap : register(t3);
+Texture2D<float> ShadowMap : register(t4);
+SamplerState LinearSampler : register(s0);
+SamplerComparisonState ShadowSampler : register(s1);
+
+struct PSInput {
+  float4 Position : SV_Position;
+  float3 WorldPos : POSITION;
+  float3 Normal : NORMAL;
+  float4 Tangent : TANGENT;
+  float2 UV : TEXCOORD0;
+};
+
+static const float PI = 3.14159265f;
+
+float DistributionGGX(float NdotH, float roughness) {
+  float a = roughness * roughness;
+  float a2 = a * a;
+  float d = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+  return a2 / (PI * d * d);
+}
+
+float GeometrySmith(float NdotV, float NdotL, float roughness) {
+  float k = (roughness + 1.0f) * (roughness + 1.0f) / 8.0f;
+  float gv = NdotV / (NdotV * (1.0f - k) + k);
+  float gl = NdotL / (NdotL * (1.0f - k) + k);
+  return gv * gl;
+}
+
+float3 FresnelSchlick(float cosTheta, float3 F0) {
+  return F0 + (1.0f - F0) * pow(saturate(1.0f - cosTheta), 5.0f);
+}
+
+#if SHADOWS
+float SampleShadow(float3 worldPos) {
+  float4 shadowPos = mul(ShadowMatrix, float4(worldPos, 1.0f));
+  shadowPos.xyz /= shadowPos.w;
+  float2 uv = shadowPos.xy * float2(0.5f, -0.5f) + 0.5f;
+  float sum = 0.0f;
+  [unroll]
+  for (int y = -1; y <= 1; ++y) {
+    [unroll]
+    for (int x = -1; x <= 1; ++x)
+      sum += ShadowMap.SampleCmpLevelZero(ShadowSampler, uv, shadowPos.z,
+                                          int2(x, y));
+  }
+  return sum / 9.0f;
+}
+#endif
+
+float4 main(PSInput input) : SV_Target {
+  float4 baseColor = BaseColorMap.Sample(LinearSampler, input.UV);
+#if ALPHA_TEST
+  clip(baseColor.a - AlphaCutoff);
+#endif
+
+  float3 N = normalize(input.Normal);
+#if NORMAL_MAP
+  float3 T = normalize(input.Tangent.xyz);
+  float3 B = cross(N, T) * input.Tangent.w;
+  float3 tangentNormal =
+      NormalMap.Sample(LinearSampler, input.UV).xyz * 2.0f - 1.0f;
+  N = normalize(mul(tangentNormal, float3x3(T, B, N)));
+#endif
+
+  float2 metalRough = MetalRoughMap.Sample(LinearSampler, input.UV).bg;
+  float metallic = metalRough.x;
+  float roughness = max(metalRough.y, 0.04f);
+  float3 V = normalize(CameraPosition - input.WorldPos);
+  float NdotV = max(dot(N, V), 1e-4f);
+  float3 F0 = lerp(float3(0.04f, 0.04f, 0.04f), baseColor.rgb, metallic);
+
+  float3 color = float3(0.0f, 0.0f, 0.0f);
+  [unroll]
+  for (int i = 0; i < NUM_LIGHTS; ++i) {
+    float3 toLight = Lights[i].Position - input.WorldPos;
+    float dist = length(toLight);
+    float3 L = toLight / dist;
+    float3 H = normalize(V + L);
+    float NdotL = saturate(dot(N, L));
+    float NdotH = saturate(dot(N, H));
+    float attenuation = saturate(1.0f - dist / Lights[i].Range);
+    float3 F = FresnelSchlick(saturate(dot(H, V)), F0);
+    float3 specular = DistributionGGX(NdotH, roughness) *
+                      GeometrySmith(NdotV, NdotL, roughness) * F /
+                      (4.0f * NdotV * NdotL + 1e-4f);
+    float3 diffuse = (1.0f - F) * (1.0f - metallic) * baseColor.rgb / PI;
+    color += (diffuse + specular) * Lights[i].Color * Lights[i].Intensity *
+             NdotL * attenuation;
+  }
+
+#if SHADOWS
+  color *= SampleShadow(input.WorldPos);
+#endif
+#if EMISSIVE
+  color += EmissiveColor * EmissiveMap.Sample(LinearSampler, input.UV).rgb;
+#endif
+  return float4(color * ExposureScale, baseColor.a);
+}
@@ -0,0 +1,91 @@
+// Compute shader dominated by [unroll] loops: a register-tiled matrix
+// multiply where each thread accumulates a TILE x TILE block, followed by a
+// fully unrolled bitonic sort of SORT_SIZE keys in group shared memory.
+
+#define TILE 8
+#define THREADS 16
+#define SORT_SIZE (THREADS * THREADS)
+
+cbuffer Params : register(b0) {
+  uint N;
+  uint K;
+};
+
+StructuredBuffer<float> A : register(t0);
+StructuredBuffer<float> B : register(t1);
+RWStructuredBuffer<float> C : register(u0);
+RWStructuredBuffer<uint> Keys : register(u1);
+
+groupshared float TileA[THREADS * TILE][TILE];
+groupshared float TileB[TILE][THREADS * TILE];
+groupshared uint SortKeys[SORT_SIZE];
+
+[numthreads(THREADS, THREADS, 1)]
+void main(uint3 gid : SV_GroupID, uint3 tid : SV_GroupThreadID,
+          uint gi : SV_GroupIndex) {
+  float acc[TILE][TILE];
+  [unroll]
+  for (uint i = 0; i < TILE; ++i) {
+    [unroll]
+    for (uint j = 0; j < TILE; ++j)
+      acc[i][j] = 0.0f;
+  }
+
+  uint rowBase = gid.y * THREADS * TILE;
+  uint colBase = gid.x * THREADS * TILE;
+  for (uint k0 = 0; k0 < K; k0 += TILE) {
+    // Each tile holds THREADS * TILE * TILE elements, four per thread.
+    [unroll]
+    for (uint l = 0; l < 4; ++l) {
+      uint e = gi * 4 + l;
+      uint r = e / TILE;
+      uint c = e % TILE;
+      TileA[r][c] = A[(rowBase + r) * K + k0 + c];
+      TileB[c][r] = B[(k0 + c) * N + colBase + r];
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint kk = 0; kk < TILE; ++kk) {
+      float a[TILE];
+      float b[TILE];
+      [unroll]
+      for (uint i = 0; i < TILE; ++i) {
+        a[i] = TileA[tid.y * TILE + i][kk];
+        b[i] = TileB[kk][tid.x * TILE + i];
+      }
+      [unroll]
+      for (uint i = 0; i < TILE; ++i) {
+        [unroll]
+        for (uint j = 0; j < TILE; ++j)
+          acc[i][j] = mad(a[i], b[j], acc[i][j]);
+      }
+    }
+    GroupMemoryBarrierWithGroupSync();
+  }
+
+  [unroll]
+  for (uint i = 0; i < TILE; ++i) {
+    [unroll]
+    for (uint j = 0; j < TILE; ++j)
+      C[(rowBase + tid.y * TILE + i) * N + colBase + tid.x * TILE + j] =
+          acc[i][j];
+  }
+
+  SortKeys[gi] = Keys[gid.x * SORT_SIZE + gi];
+  GroupMemoryBarrierWithGroupSync();
+  [unroll]
+  for (uint size = 2; size <= SORT_SIZE; size <<= 1) {
+    [unroll]
+    for (uint stride = size >> 1; stride > 0; stride >>= 1) {
+      uint partner = gi ^ stride;
+      uint mine = SortKeys[gi];
+      uint other = SortKeys[partner];
+      bool keepMin = (gi < partner) == ((gi & size) == 0);
+      GroupMemoryBarrierWithGroupSync();
+      SortKeys[gi] = keepMin ? min(mine, other) : max(mine, other);
+      GroupMemoryBarrierWithGroupSync();
+    }
+  }
+  Keys[gid.x * SORT_SIZE + gi] = SortKeys[gi];
+}
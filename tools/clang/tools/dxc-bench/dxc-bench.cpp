@@ -0,0 +1,1045 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxc-bench.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxc-bench console program, which times   //
+// a corpus of compiles and writes the results as JSON.                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+
+#include "dxc/Support/D3DReflection.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/dxcapi.use.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+static cl::opt<bool> Help("help", cl::desc("Print help"));
+static cl::alias Help_h("h", cl::aliasopt(Help));
+static cl::alias Help_q("?", cl::aliasopt(Help));
+
+static cl::opt<std::string> CorpusFilename(cl::Positional,
+                                           cl::desc("<corpus manifest>"));
+
+static cl::opt<std::string> OutputFilename("o",
+                                           cl::desc("Override output filename"),
+                                           cl::value_desc("filename"));
+
+static cl::opt<unsigned>
+    Iterations("n", cl::desc("Timed runs of every case variant (default: 5)"),
+               cl::value_desc("count"), cl::init(5));
+
+static cl::opt<unsigned>
+    Warmup("warmup",
+           cl::desc("Untimed runs of every case variant, at least one for "
+                    "compiles (default: 1)"),
+           cl::value_desc("count"), cl::init(1));
+
+static cl::list<unsigned>
+    ThreadCounts("threads", cl::CommaSeparated,
+                 cl::desc("Thread counts to measure throughput at "
+                          "(default: 1,2,4 and all cores)"),
+                 cl::value_desc("n,..."));
+
+static cl::opt<bool>
+    NoThroughput("no-throughput",
+                 cl::desc("Skip the multi-threaded throughput runs"),
+                 cl::init(false));
+
+static cl::opt<bool>
+    ShareCompiler("share-compiler",
+                  cl::desc("Use one compiler object for every thread in the "
+                           "throughput runs, instead of one per thread"),
+                  cl::init(false));
+
+static cl::opt<std::string>
+    Filter("filter", cl::desc("Only run cases whose name contains <text>"),
+           cl::value_desc("text"));
+
+static cl::opt<std::string>
+    BaselineFilename("baseline",
+                     cl::desc("Compare the results against an earlier run"),
+                     cl::value_desc("filename"));
+
+static cl::opt<std::string>
+    ResultsFilename("results",
+                    cl::desc("Compare an earlier run with -baseline instead "
+                             "of running the corpus"),
+                    cl::value_desc("filename"));
+
+static cl::opt<double>
+    Threshold("threshold",
+              cl::desc("Percentage change reported as a regression "
+                       "(default: 5)"),
+              cl::value_desc("percent"), cl::init(5.0));
+
+static dxc::DxcDllSupport g_DxcSupport;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double MillisecondsSince(Clock::time_point Start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - Start)
+      .count();
+}
+
+// Phases timed by the compiler's -ftime-trace, keyed by trace event name.
+// Validation includes assembling the container it validates.
+const struct {
+  const char *TraceName;
+  const char *Name;
+} TracePhases[] = {{"Total Frontend", "frontend"},
+                   {"Total Backend", "backend"},
+                   {"Total Validation", "validation"},
+                   {"Total AssembleContainer", "container"}};
+
+// Phases reported by the compiler's -fmemory-report, in report order.
+const char *MemoryPhases[] = {"other",      "parse",       "sema",
+                              "codegen",    "hl-passes",   "dxil-passes",
+                              "validation", "container"};
+
+struct AllocStats {
+  uint64_t Allocations = 0;
+  uint64_t AllocatedBytes = 0;
+  uint64_t PeakBytes = 0;
+};
+
+struct BenchCase {
+  std::string Name;
+  std::string Action;
+  std::string File;
+  std::string Source;
+  // Compiler arguments of each variant, starting with the file name.
+  std::vector<std::vector<std::wstring>> Variants;
+
+  std::string Status = "ok";
+  // Wall time of every timed run, across all variants.
+  std::vector<double> WallMs;
+  // For compile cases, per-compile means over the variants, except for peak
+  // bytes, which are the highest of any variant.
+  double PhaseMs[_countof(TracePhases)] = {};
+  bool HasMemory = false;
+  bool IncludesOperatorNew = false;
+  AllocStats Memory;
+  AllocStats MemoryPhase[_countof(MemoryPhases)];
+};
+
+struct ContentionStats {
+  uint64_t Acquisitions = 0;
+  uint64_t Contended = 0;
+  uint64_t WaitNanoseconds = 0;
+};
+
+struct ThroughputResult {
+  unsigned Threads = 0;
+  uint64_t Compiles = 0;
+  uint64_t Failures = 0;
+  double Seconds = 0;
+  // Totals of the compiler's -fcontention-report over the untimed repeat of
+  // the compiles, by lock site, and by site and phase.
+  std::map<std::string, ContentionStats> Contention;
+  std::map<std::string, std::map<std::string, ContentionStats>>
+      ContentionPhases;
+};
+
+//------------------------------------------------------------------------------
+// JSON reading
+//
+// Compiler reports and earlier results are read with the YAML parser, which
+// accepts JSON, into a small tree.
+
+struct JsonNode {
+  std::string Value; // Scalars only.
+  std::vector<std::pair<std::string, JsonNode>> Members;
+  std::vector<JsonNode> Elements;
+
+  const JsonNode *Get(StringRef Key) const {
+    for (const auto &Member : Members)
+      if (Member.first == Key)
+        return &Member.second;
+    return nullptr;
+  }
+  double GetNumber(StringRef Key) const {
+    const JsonNode *pNode = Get(Key);
+    return pNode ? strtod(pNode->Value.c_str(), nullptr) : 0;
+  }
+  uint64_t GetInteger(StringRef Key) const {
+    const JsonNode *pNode = Get(Key);
+    return pNode ? strtoull(pNode->Value.c_str(), nullptr, 10) : 0;
+  }
+  std::string GetString(StringRef Key) const {
+    const JsonNode *pNode = Get(Key);
+    return pNode ? pNode->Value : std::string();
+  }
+};
+
+bool ConvertYamlNode(yaml::Node *pNode, JsonNode &Out) {
+  SmallString<64> Storage;
+  if (auto *pScalar = dyn_cast_or_null<yaml::ScalarNode>(pNode)) {
+    Out.Value = pScalar->getValue(Storage);
+    return true;
+  }
+  if (auto *pMapping = dyn_cast_or_null<yaml::MappingNode>(pNode)) {
+    for (yaml::KeyValueNode &KV : *pMapping) {
+      auto *pKey = dyn_cast_or_null<yaml::ScalarNode>(KV.getKey());
+      if (!pKey)
+        return false;
+      Out.Members.emplace_back(pKey->getValue(Storage), JsonNode());
+      if (!ConvertYamlNode(KV.getValue(), Out.Members.back().second))
+        return false;
+    }
+    return true;
+  }
+  if (auto *pSequence = dyn_cast_or_null<yaml::SequenceNode>(pNode)) {
+    for (yaml::Node &Element : *pSequence) {
+      Out.Elements.emplace_back();
+      if (!ConvertYamlNode(&Element, Out.Elements.back()))
+        return false;
+    }
+    return true;
+  }
+  return pNode && isa<yaml::NullNode>(pNode);
+}
+
+bool ParseJson(StringRef Text, JsonNode &Root) {
+  SourceMgr SM;
+  // Keep parse errors off the console; they are reported by the caller.
+  SM.setDiagHandler([](const SMDiagnostic &, void *) {});
+  yaml::Stream Stream(Text, SM);
+  yaml::document_iterator Document = Stream.begin();
+  if (Document == Stream.end())
+    return false;
+  return ConvertYamlNode(Document->getRoot(), Root) && !Stream.failed();
+}
+
+std::string ReadFile(const std::string &Filename) {
+  CComPtr<IDxcBlobEncoding> pBlob;
+  std::wstring WideFilename =
+      Unicode::UTF8ToWideStringOrThrow(Filename.c_str());
+  if (FAILED(DxcCreateBlobFromFile(WideFilename.c_str(), nullptr, &pBlob)))
+    throw hlsl::Exception(E_FAIL, "unable to read '" + Filename + "'");
+  return std::string((const char *)pBlob->GetBufferPointer(),
+                     pBlob->GetBufferSize());
+}
+
+void ReadJsonFile(const std::string &Filename, JsonNode &Root) {
+  if (!ParseJson(ReadFile(Filename), Root))
+    throw hlsl::Exception(E_FAIL,
+                          "unable to parse '" + Filename + "' as JSON");
+}
+
+//------------------------------------------------------------------------------
+// Corpus
+
+// Expands every argument containing {a,b,...} into its alternatives, giving
+// one variant per combination.
+void ExpandVariants(const std::vector<std::string> &Args,
+                    std::vector<std::vector<std::string>> &Variants) {
+  Variants.assign(1, std::vector<std::string>());
+  for (const std::string &Arg : Args) {
+    size_t Open = Arg.find('{');
+    size_t Close = Open == std::string::npos ? Open : Arg.find('}', Open);
+    if (Close == std::string::npos) {
+      for (std::vector<std::string> &Variant : Variants)
+        Variant.push_back(Arg);
+      continue;
+    }
+    SmallVector<StringRef, 4> Alternatives;
+    StringRef(Arg).slice(Open + 1, Close).split(Alternatives, ",");
+    std::vector<std::vector<std::string>> Expanded;
+    for (const std::vector<std::string> &Variant : Variants) {
+      for (StringRef Alternative : Alternatives) {
+        Expanded.push_back(Variant);
+        Expanded.back().push_back(Arg.substr(0, Open) + Alternative.str() +
+                                  Arg.substr(Close + 1));
+      }
+    }
+    Variants.swap(Expanded);
+  }
+}
+
+void ReadCorpus(std::vector<BenchCase> &Cases) {
+  std::string Manifest = ReadFile(CorpusFilename);
+  StringRef Text(Manifest);
+  StringRef Directory = sys::path::parent_path(CorpusFilename);
+
+  std::string Line;
+  while (!Text.empty()) {
+    std::pair<StringRef, StringRef> Split = Text.split('\n');
+    Text = Split.second;
+    StringRef Part = Split.first.rtrim();
+    if (Part.endswith("\\")) {
+      Line += Part.drop_back().str() + " ";
+      if (!Text.empty())
+        continue;
+    } else {
+      Line += Part.str();
+    }
+
+    SmallVector<StringRef, 16> Tokens;
+    StringRef(Line).split(Tokens, " ", -1, false);
+    // Tabs are accepted as separators too.
+    SmallVector<StringRef, 16> Fields;
+    for (StringRef Token : Tokens) {
+      SmallVector<StringRef, 2> Pieces;
+      Token.split(Pieces, "\t", -1, false);
+      Fields.append(Pieces.begin(), Pieces.end());
+    }
+    if (Fields.empty() || Fields[0].startswith("#")) {
+      Line.clear();
+      continue;
+    }
+    if (Fields.size() < 3)
+      throw hlsl::Exception(E_INVALIDARG,
+                            "corpus line needs a name, action and file: " +
+                                Line);
+
+    BenchCase Case;
+    Case.Name = Fields[0];
+    Case.Action = Fields[1];
+    if (Case.Action != "compile" && Case.Action != "disassemble" &&
+        Case.Action != "reflect")
+      throw hlsl::Exception(E_INVALIDARG, "unknown corpus action '" +
+                                              Case.Action + "' for case " +
+                                              Case.Name);
+    Line.clear();
+    if (!Filter.empty() && Case.Name.find(Filter) == std::string::npos)
+      continue;
+
+    SmallString<128> Path(Directory);
+    sys::path::append(Path, Fields[2]);
+    Case.File = Path.str();
+
+    std::vector<std::string> Args(Fields.begin() + 3, Fields.end());
+    std::vector<std::vector<std::string>> Variants;
+    ExpandVariants(Args, Variants);
+    if (Case.Action != "compile" && Variants.size() != 1)
+      throw hlsl::Exception(E_INVALIDARG, "case " + Case.Name +
+                                              " may only have one variant");
+    for (const std::vector<std::string> &Variant : Variants) {
+      Case.Variants.emplace_back();
+      Case.Variants.back().push_back(
+          Unicode::UTF8ToWideStringOrThrow(Case.File.c_str()));
+      for (const std::string &Arg : Variant)
+        Case.Variants.back().push_back(
+            Unicode::UTF8ToWideStringOrThrow(Arg.c_str()));
+    }
+    Cases.push_back(std::move(Case));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Running
+
+// The compiler objects one thread uses.
+class BenchCompiler {
+public:
+  BenchCompiler() {
+    IFT(g_DxcSupport.CreateInstance(CLSID_DxcCompiler, &m_pCompiler));
+    IFT(g_DxcSupport.CreateInstance(CLSID_DxcUtils, &m_pUtils));
+    IFT(m_pUtils->CreateDefaultIncludeHandler(&m_pIncludeHandler));
+  }
+
+  // Compiles one variant, returning the error text in Errors on failure.
+  CComPtr<IDxcResult> Compile(const BenchCase &Case,
+                              const std::vector<std::wstring> &Args,
+                              std::string &Errors,
+                              ArrayRef<LPCWSTR> ExtraArgs = None) {
+    std::vector<LPCWSTR> ArgPointers;
+    for (const std::wstring &Arg : Args)
+      ArgPointers.push_back(Arg.c_str());
+    ArgPointers.insert(ArgPointers.end(), ExtraArgs.begin(), ExtraArgs.end());
+
+    DxcBuffer Source = {Case.Source.data(), Case.Source.size(), DXC_CP_UTF8};
+    CComPtr<IDxcResult> pResult;
+    IFT(m_pCompiler->Compile(&Source, ArgPointers.data(),
+                             (UINT32)ArgPointers.size(), m_pIncludeHandler,
+                             IID_PPV_ARGS(&pResult)));
+    HRESULT Status;
+    IFT(pResult->GetStatus(&Status));
+    if (FAILED(Status)) {
+      CComPtr<IDxcBlobUtf8> pErrors;
+      if (SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors),
+                                       nullptr)) &&
+          pErrors && pErrors->GetStringLength())
+        Errors.assign(pErrors->GetStringPointer(), pErrors->GetStringLength());
+      else
+        Errors = "compilation failed";
+      return nullptr;
+    }
+    return pResult;
+  }
+
+  void Disassemble(IDxcBlob *pContainer) {
+    DxcBuffer Buffer = {pContainer->GetBufferPointer(),
+                        pContainer->GetBufferSize(), DXC_CP_ACP};
+    CComPtr<IDxcResult> pResult;
+    IFT(m_pCompiler->Disassemble(&Buffer, IID_PPV_ARGS(&pResult)));
+    HRESULT Status;
+    IFT(pResult->GetStatus(&Status));
+    IFT(Status);
+  }
+
+  // Creates reflection for the container and reads every function and
+  // resource description, so lazily built reflection is fully built.
+  void Reflect(IDxcBlob *pContainer) {
+    DxcBuffer Buffer = {pContainer->GetBufferPointer(),
+                        pContainer->GetBufferSize(), DXC_CP_ACP};
+    CComPtr<ID3D12LibraryReflection> pLibrary;
+    if (SUCCEEDED(m_pUtils->CreateReflection(&Buffer,
+                                             IID_PPV_ARGS(&pLibrary)))) {
+      D3D12_LIBRARY_DESC LibraryDesc;
+      IFT(pLibrary->GetDesc(&LibraryDesc));
+      for (UINT i = 0; i < LibraryDesc.FunctionCount; ++i) {
+        ID3D12FunctionReflection *pFunction = pLibrary->GetFunctionByIndex(i);
+        D3D12_FUNCTION_DESC FunctionDesc;
+        IFT(pFunction->GetDesc(&FunctionDesc));
+        for (UINT r = 0; r < FunctionDesc.BoundResources; ++r) {
+          D3D12_SHADER_INPUT_BIND_DESC BindDesc;
+          IFT(pFunction->GetResourceBindingDesc(r, &BindDesc));
+        }
+      }
+      return;
+    }
+    CComPtr<ID3D12ShaderReflection> pShader;
+    IFT(m_pUtils->CreateReflection(&Buffer, IID_PPV_ARGS(&pShader)));
+    D3D12_SHADER_DESC ShaderDesc;
+    IFT(pShader->GetDesc(&ShaderDesc));
+    for (UINT r = 0; r < ShaderDesc.BoundResources; ++r) {
+      D3D12_SHADER_INPUT_BIND_DESC BindDesc;
+      IFT(pShader->GetResourceBindingDesc(r, &BindDesc));
+    }
+    for (UINT c = 0; c < ShaderDesc.ConstantBuffers; ++c) {
+      D3D12_SHADER_BUFFER_DESC BufferDesc;
+      IFT(pShader->GetConstantBufferByIndex(c)->GetDesc(&BufferDesc));
+    }
+  }
+
+private:
+  CComPtr<IDxcCompiler3> m_pCompiler;
+  CComPtr<IDxcUtils> m_pUtils;
+  CComPtr<IDxcIncludeHandler> m_pIncludeHandler;
+};
+
+std::string FirstLine(StringRef Text) {
+  return Text.split('\n').first.rtrim().str();
+}
+
+// Adds the phase times and allocation statistics from the compiler's
+// reports to the case totals.
+void AccumulateReports(IDxcResult *pResult, BenchCase &Case) {
+  CComPtr<IDxcBlobUtf8> pTrace;
+  JsonNode Trace;
+  if (SUCCEEDED(pResult->GetOutput(DXC_OUT_TIME_TRACE, IID_PPV_ARGS(&pTrace),
+                                   nullptr)) &&
+      pTrace &&
+      ParseJson(StringRef(pTrace->GetStringPointer(),
+                          pTrace->GetStringLength()),
+                Trace)) {
+    if (const JsonNode *pEvents = Trace.Get("traceEvents")) {
+      for (const JsonNode &Event : pEvents->Elements) {
+        std::string Name = Event.GetString("name");
+        for (unsigned i = 0; i < _countof(TracePhases); ++i)
+          if (Name == TracePhases[i].TraceName)
+            Case.PhaseMs[i] += Event.GetNumber("dur") / 1000.0;
+      }
+    }
+  }
+
+  CComPtr<IDxcBlobUtf8> pReport;
+  JsonNode Report;
+  if (SUCCEEDED(pResult->GetOutput(DXC_OUT_MEMORY_REPORT,
+                                   IID_PPV_ARGS(&pReport), nullptr)) &&
+      pReport &&
+      ParseJson(StringRef(pReport->GetStringPointer(),
+                          pReport->GetStringLength()),
+                Report)) {
+    auto Accumulate = [](const JsonNode &Node, AllocStats &Stats) {
+      Stats.Allocations += Node.GetInteger("allocations");
+      Stats.AllocatedBytes += Node.GetInteger("allocatedBytes");
+      Stats.PeakBytes = std::max(Stats.PeakBytes, Node.GetInteger("peakBytes"));
+    };
+    Case.HasMemory = true;
+    Case.IncludesOperatorNew =
+        Report.GetString("includesOperatorNew") == "true";
+    Accumulate(Report, Case.Memory);
+    if (const JsonNode *pPhases = Report.Get("phases")) {
+      for (const JsonNode &Phase : pPhases->Elements) {
+        std::string Name = Phase.GetString("name");
+        for (unsigned i = 0; i < _countof(MemoryPhases); ++i)
+          if (Name == MemoryPhases[i])
+            Accumulate(Phase, Case.MemoryPhase[i]);
+      }
+    }
+  }
+}
+
+void RunCompileCase(BenchCompiler &Compiler, BenchCase &Case) {
+  std::string Errors;
+  for (unsigned w = 0; w < std::max(1u, (unsigned)Warmup); ++w) {
+    for (const std::vector<std::wstring> &Args : Case.Variants) {
+      if (!Compiler.Compile(Case, Args, Errors)) {
+        Case.Status = Errors.find("SPIR-V CodeGen not available") !=
+                              std::string::npos
+                          ? "skipped: SPIR-V CodeGen not available"
+                          : "error: " + FirstLine(Errors);
+        return;
+      }
+    }
+  }
+
+  for (unsigned n = 0; n < Iterations; ++n) {
+    for (const std::vector<std::wstring> &Args : Case.Variants) {
+      Clock::time_point Start = Clock::now();
+      Compiler.Compile(Case, Args, Errors);
+      Case.WallMs.push_back(MillisecondsSince(Start));
+    }
+  }
+
+  // The reports slow the compile down, so they come from separate runs.
+  static const LPCWSTR ReportArgs[] = {L"-ftime-trace", L"-fmemory-report"};
+  for (const std::vector<std::wstring> &Args : Case.Variants) {
+    CComPtr<IDxcResult> pResult =
+        Compiler.Compile(Case, Args, Errors, ReportArgs);
+    if (pResult)
+      AccumulateReports(pResult, Case);
+  }
+  double Variants = (double)Case.Variants.size();
+  for (double &Ms : Case.PhaseMs)
+    Ms /= Variants;
+  Case.Memory.Allocations /= Case.Variants.size();
+  Case.Memory.AllocatedBytes /= Case.Variants.size();
+  for (AllocStats &Stats : Case.MemoryPhase) {
+    Stats.Allocations /= Case.Variants.size();
+    Stats.AllocatedBytes /= Case.Variants.size();
+  }
+}
+
+void RunContainerCase(BenchCompiler &Compiler, BenchCase &Case) {
+  std::string Errors;
+  CComPtr<IDxcResult> pResult =
+      Compiler.Compile(Case, Case.Variants.front(), Errors);
+  if (!pResult) {
+    Case.Status = "error: " + FirstLine(Errors);
+    return;
+  }
+  CComPtr<IDxcBlob> pContainer;
+  IFT(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pContainer), nullptr));
+
+  auto RunOnce = [&]() {
+    if (Case.Action == "disassemble")
+      Compiler.Disassemble(pContainer);
+    else
+      Compiler.Reflect(pContainer);
+  };
+  for (unsigned w = 0; w < Warmup; ++w)
+    RunOnce();
+  for (unsigned n = 0; n < Iterations; ++n) {
+    Clock::time_point Start = Clock::now();
+    RunOnce();
+    Case.WallMs.push_back(MillisecondsSince(Start));
+  }
+}
+
+void RunCases(std::vector<BenchCase> &Cases) {
+  BenchCompiler Compiler;
+  for (BenchCase &Case : Cases) {
+    fprintf(stderr, "%s...\n", Case.Name.c_str());
+    try {
+      Case.Source = ReadFile(Case.File);
+      if (Case.Action == "compile")
+        RunCompileCase(Compiler, Case);
+      else
+        RunContainerCase(Compiler, Case);
+    } catch (const hlsl::Exception &E) {
+      std::string Message = E.what();
+      if (Message.empty()) {
+        char Buffer[32];
+        sprintf_s(Buffer, _countof(Buffer), "error code 0x%08x",
+                  (unsigned)E.hr);
+        Message = Buffer;
+      }
+      Case.Status = "error: " + Message;
+      Case.WallMs.clear();
+    }
+  }
+}
+
+// Adds the lock contention from a compiler report to the totals.
+void AccumulateContention(StringRef Report, ThroughputResult &Result) {
+  JsonNode Root;
+  const JsonNode *pSites;
+  if (!ParseJson(Report, Root) || !(pSites = Root.Get("sites")))
+    return;
+  auto Accumulate = [](const JsonNode &Node, ContentionStats &Stats) {
+    Stats.Acquisitions += Node.GetInteger("acquisitions");
+    Stats.Contended += Node.GetInteger("contended");
+    Stats.WaitNanoseconds += Node.GetInteger("waitNanoseconds");
+  };
+  for (const JsonNode &Site : pSites->Elements) {
+    std::string Name = Site.GetString("name");
+    Accumulate(Site, Result.Contention[Name]);
+    if (const JsonNode *pPhases = Site.Get("phases"))
+      for (const JsonNode &Phase : pPhases->Elements)
+        Accumulate(Phase,
+                   Result.ContentionPhases[Name][Phase.GetString("name")]);
+  }
+}
+
+// Compiles every variant of every successful compile case, Iterations
+// times over, spread across Threads threads. The same compiles then run
+// again with lock contention reports, outside the timed run.
+ThroughputResult RunThroughput(const std::vector<BenchCase> &Cases,
+                               unsigned Threads) {
+  std::vector<std::pair<const BenchCase *, size_t>> Jobs;
+  for (const BenchCase &Case : Cases)
+    if (Case.Action == "compile" && Case.Status == "ok")
+      for (size_t i = 0; i < Case.Variants.size(); ++i)
+        Jobs.emplace_back(&Case, i);
+
+  ThroughputResult Result;
+  Result.Threads = Threads;
+  Result.Compiles = Jobs.size() * Iterations;
+  if (Jobs.empty())
+    return Result;
+
+  // Compiler objects are created up front so only compiles are timed.
+  std::vector<std::unique_ptr<BenchCompiler>> Compilers;
+  for (unsigned i = 0; i < (ShareCompiler ? 1 : Threads); ++i)
+    Compilers.emplace_back(new BenchCompiler());
+
+  static const LPCWSTR ReportArgs[] = {L"-fcontention-report"};
+  std::vector<std::vector<CComPtr<IDxcBlobUtf8>>> Reports(Threads);
+  std::atomic<uint64_t> Next(0);
+  std::atomic<uint64_t> Failures(0);
+  bool Reporting = false;
+  auto Worker = [&](unsigned Thread) {
+    BenchCompiler *pCompiler = Compilers[ShareCompiler ? 0 : Thread].get();
+    std::string Errors;
+    for (uint64_t i = Next++; i < Result.Compiles; i = Next++) {
+      const auto &Job = Jobs[i % Jobs.size()];
+      try {
+        CComPtr<IDxcResult> pResult = pCompiler->Compile(
+            *Job.first, Job.first->Variants[Job.second], Errors,
+            Reporting ? makeArrayRef(ReportArgs) : None);
+        CComPtr<IDxcBlobUtf8> pReport;
+        if (!pResult) {
+          if (!Reporting)
+            ++Failures;
+        } else if (Reporting &&
+                   SUCCEEDED(pResult->GetOutput(DXC_OUT_CONTENTION_REPORT,
+                                                IID_PPV_ARGS(&pReport),
+                                                nullptr)) &&
+                   pReport) {
+          Reports[Thread].push_back(pReport);
+        }
+      } catch (const hlsl::Exception &) {
+        if (!Reporting)
+          ++Failures;
+      }
+    }
+  };
+  auto RunWorkers = [&]() {
+    Next = 0;
+    std::vector<std::thread> Workers;
+    for (unsigned i = 1; i < Threads; ++i)
+      Workers.emplace_back(Worker, i);
+    Worker(0);
+    for (std::thread &T : Workers)
+      T.join();
+  };
+
+  Clock::time_point Start = Clock::now();
+  RunWorkers();
+  Result.Seconds = MillisecondsSince(Start) / 1000.0;
+  Result.Failures = Failures;
+
+  // The reports slow the compile down, so they come from a separate run.
+  Reporting = true;
+  RunWorkers();
+  for (const auto &ThreadReports : Reports)
+    for (IDxcBlobUtf8 *pReport : ThreadReports)
+      AccumulateContention(StringRef(pReport->GetStringPointer(),
+                                     pReport->GetStringLength()),
+                           Result);
+  return Result;
+}
+
+//------------------------------------------------------------------------------
+// Writing
+
+void WriteJsonString(raw_ostream &OS, StringRef Value) {
+  OS << '"';
+  for (unsigned char C : Value) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+double Median(std::vector<double> Values) {
+  std::sort(Values.begin(), Values.end());
+  size_t Mid = Values.size() / 2;
+  return Values.size() % 2 ? Values[Mid]
+                           : (Values[Mid - 1] + Values[Mid]) / 2.0;
+}
+
+void WriteAllocStats(raw_ostream &OS, const AllocStats &Stats) {
+  OS << "\"allocations\": " << Stats.Allocations
+     << ", \"allocatedBytes\": " << Stats.AllocatedBytes
+     << ", \"peakBytes\": " << Stats.PeakBytes;
+}
+
+void WriteContentionStats(raw_ostream &OS, const ContentionStats &Stats) {
+  OS << "\"acquisitions\": " << Stats.Acquisitions
+     << ", \"contended\": " << Stats.Contended << ", \"waitMs\": "
+     << format("%.3f", Stats.WaitNanoseconds / 1.0e6);
+}
+
+void WriteThroughput(raw_ostream &OS, const ThroughputResult &T,
+                     const ThroughputResult *pSingleThread) {
+  double Rate = T.Seconds > 0 ? T.Compiles / T.Seconds : 0.0;
+  OS << "    { \"threads\": " << T.Threads << ", \"sharedCompiler\": "
+     << (ShareCompiler ? "true" : "false") << ", \"compiles\": " << T.Compiles
+     << ", \"failures\": " << T.Failures
+     << ", \"seconds\": " << format("%.3f", T.Seconds)
+     << ", \"compilesPerSecond\": " << format("%.2f", Rate);
+  // Scaling relative to one thread: near-linear scaling keeps efficiency
+  // near 1.
+  if (pSingleThread && pSingleThread->Seconds > 0) {
+    double Speedup =
+        Rate / (pSingleThread->Compiles / pSingleThread->Seconds);
+    OS << ", \"speedup\": " << format("%.2f", Speedup)
+       << ", \"efficiency\": " << format("%.3f", Speedup / T.Threads);
+  }
+  OS << ",\n      \"contention\": {";
+  bool FirstSite = true;
+  for (const auto &Site : T.Contention) {
+    OS << (FirstSite ? "\n        \"" : ",\n        \"") << Site.first
+       << "\": { ";
+    WriteContentionStats(OS, Site.second);
+    OS << ", \"phases\": {";
+    bool FirstPhase = true;
+    auto Phases = T.ContentionPhases.find(Site.first);
+    if (Phases != T.ContentionPhases.end()) {
+      for (const auto &Phase : Phases->second) {
+        OS << (FirstPhase ? " \"" : ", \"") << Phase.first << "\": { ";
+        WriteContentionStats(OS, Phase.second);
+        OS << " }";
+        FirstPhase = false;
+      }
+    }
+    OS << (FirstPhase ? "} }" : " } }");
+    FirstSite = false;
+  }
+  OS << (FirstSite ? "} }" : " } }");
+}
+
+void WriteCase(raw_ostream &OS, const BenchCase &Case) {
+  OS << "    { \"name\": ";
+  WriteJsonString(OS, Case.Name);
+  OS << ", \"action\": \"" << Case.Action << "\", \"status\": ";
+  WriteJsonString(OS, Case.Status);
+  OS << ", \"variants\": " << Case.Variants.size();
+  if (Case.WallMs.empty()) {
+    OS << " }";
+    return;
+  }
+
+  double Sum = 0;
+  for (double Ms : Case.WallMs)
+    Sum += Ms;
+  OS << ",\n      \"wallMs\": { \"min\": "
+     << format("%.3f", *std::min_element(Case.WallMs.begin(),
+                                         Case.WallMs.end()))
+     << ", \"median\": " << format("%.3f", Median(Case.WallMs))
+     << ", \"mean\": " << format("%.3f", Sum / Case.WallMs.size()) << " }";
+
+  if (Case.Action == "compile") {
+    OS << ",\n      \"phaseMs\": {";
+    for (unsigned i = 0; i < _countof(TracePhases); ++i)
+      OS << (i ? ", \"" : " \"") << TracePhases[i].Name
+         << "\": " << format("%.3f", Case.PhaseMs[i]);
+    OS << " }";
+  }
+
+  if (Case.HasMemory) {
+    OS << ",\n      \"memory\": { \"includesOperatorNew\": "
+       << (Case.IncludesOperatorNew ? "true" : "false") << ", ";
+    WriteAllocStats(OS, Case.Memory);
+    OS << ",\n        \"phases\": {";
+    for (unsigned i = 0; i < _countof(MemoryPhases); ++i) {
+      OS << (i ? ",\n          \"" : "\n          \"") << MemoryPhases[i]
+         << "\": { ";
+      WriteAllocStats(OS, Case.MemoryPhase[i]);
+      OS << " }";
+    }
+    OS << " } }";
+  }
+  OS << " }";
+}
+
+void WriteResults(raw_ostream &OS, const std::vector<BenchCase> &Cases,
+                  const std::vector<ThroughputResult> &Throughput) {
+  UINT32 Major = 0, Minor = 0, CommitCount = 0;
+  CComHeapPtr<char> CommitHash;
+  CComPtr<IDxcVersionInfo> pVersionInfo;
+  CComPtr<IDxcVersionInfo2> pVersionInfo2;
+  IFT(g_DxcSupport.CreateInstance(CLSID_DxcCompiler, &pVersionInfo));
+  IFT(pVersionInfo->GetVersion(&Major, &Minor));
+  if (SUCCEEDED(pVersionInfo.QueryInterface(&pVersionInfo2)))
+    IFT(pVersionInfo2->GetCommitInfo(&CommitCount, &CommitHash));
+
+  // Fields are written in a fixed order, one case per line group, so runs
+  // can also be compared with a plain text diff.
+  OS << "{ \"tool\": \"dxc-bench\", \"formatVersion\": 1,\n"
+     << "  \"compiler\": { \"version\": \"" << Major << "." << Minor
+     << "\", \"commitCount\": " << CommitCount << ", \"commitHash\": ";
+  WriteJsonString(OS, CommitHash.m_pData ? CommitHash.m_pData : "");
+  OS << " },\n  \"iterations\": " << Iterations
+     << ", \"hardwareThreads\": " << std::thread::hardware_concurrency()
+     << ",\n  \"cases\": [";
+  for (size_t i = 0; i < Cases.size(); ++i) {
+    OS << (i ? ",\n" : "\n");
+    WriteCase(OS, Cases[i]);
+  }
+  OS << "\n  ],\n  \"throughput\": [";
+  const ThroughputResult *pSingleThread = nullptr;
+  for (const ThroughputResult &T : Throughput)
+    if (T.Threads == 1)
+      pSingleThread = &T;
+  for (size_t i = 0; i < Throughput.size(); ++i) {
+    OS << (i ? ",\n" : "\n");
+    WriteThroughput(OS, Throughput[i], pSingleThread);
+  }
+  OS << "\n  ]\n}\n";
+}
+
+//------------------------------------------------------------------------------
+// Comparing
+
+// Prints one compared metric and returns whether it regressed. Metrics
+// where a larger value is better are passed with HigherIsBetter.
+bool CompareMetric(raw_ostream &OS, StringRef Label, double Base,
+                   double Current, bool HigherIsBetter = false) {
+  if (Base <= 0)
+    return false;
+  double Change = (Current - Base) / Base * 100.0;
+  bool Regressed = HigherIsBetter ? -Change > Threshold : Change > Threshold;
+  OS << format("%-48s %12.3f %12.3f %+8.1f%%", Label.str().c_str(), Base,
+               Current, Change)
+     << (Regressed ? "  REGRESSION" : "") << "\n";
+  return Regressed;
+}
+
+// Compares two result files and returns the number of regressions.
+unsigned CompareResults(raw_ostream &OS, const JsonNode &Base,
+                        const JsonNode &Current) {
+  unsigned Regressions = 0;
+  const char *Metric = "metric", *Baseline = "baseline", *Now = "current",
+             *Change = "change";
+  OS << format("%-48s %12s %12s %9s\n", Metric, Baseline, Now, Change);
+  const JsonNode *pBaseCases = Base.Get("cases");
+  const JsonNode *pCurrentCases = Current.Get("cases");
+  if (pBaseCases && pCurrentCases) {
+    for (const JsonNode &CurrentCase : pCurrentCases->Elements) {
+      std::string Name = CurrentCase.GetString("name");
+      const JsonNode *pBaseCase = nullptr;
+      for (const JsonNode &BaseCase : pBaseCases->Elements)
+        if (BaseCase.GetString("name") == Name)
+          pBaseCase = &BaseCase;
+      if (!pBaseCase)
+        continue;
+      const JsonNode *pBaseWall = pBaseCase->Get("wallMs");
+      const JsonNode *pCurrentWall = CurrentCase.Get("wallMs");
+      if (pBaseWall && pCurrentWall)
+        Regressions += CompareMetric(OS, Name + " median ms",
+                                     pBaseWall->GetNumber("median"),
+                                     pCurrentWall->GetNumber("median"));
+      // Allocation counts are deterministic, so small changes are real.
+      const JsonNode *pBaseMemory = pBaseCase->Get("memory");
+      const JsonNode *pCurrentMemory = CurrentCase.Get("memory");
+      if (pBaseMemory && pCurrentMemory &&
+          pBaseMemory->GetString("includesOperatorNew") ==
+              pCurrentMemory->GetString("includesOperatorNew"))
+        Regressions += CompareMetric(
+            OS, Name + " allocated bytes",
+            pBaseMemory->GetNumber("allocatedBytes"),
+            pCurrentMemory->GetNumber("allocatedBytes"));
+    }
+  }
+
+  const JsonNode *pBaseThroughput = Base.Get("throughput");
+  const JsonNode *pCurrentThroughput = Current.Get("throughput");
+  if (pBaseThroughput && pCurrentThroughput) {
+    for (const JsonNode &CurrentRun : pCurrentThroughput->Elements) {
+      std::string Threads = CurrentRun.GetString("threads");
+      for (const JsonNode &BaseRun : pBaseThroughput->Elements)
+        if (BaseRun.GetString("threads") == Threads) {
+          Regressions += CompareMetric(
+              OS, "compiles/s at " + Threads + " threads",
+              BaseRun.GetNumber("compilesPerSecond"),
+              CurrentRun.GetNumber("compilesPerSecond"),
+              /*HigherIsBetter*/ true);
+          // A drop in efficiency means scaling got worse, even when
+          // single-threaded speed hides it in compiles/s.
+          if (Threads != "1")
+            Regressions += CompareMetric(
+                OS, "efficiency at " + Threads + " threads",
+                BaseRun.GetNumber("efficiency"),
+                CurrentRun.GetNumber("efficiency"),
+                /*HigherIsBetter*/ true);
+        }
+    }
+  }
+  return Regressions;
+}
+
+} // namespace
+
+#ifdef _WIN32
+int __cdecl main(int argc, char **argv) {
+#else
+int main(int argc, const char **argv) {
+#endif
+  if (llvm::sys::fs::SetupPerThreadFileSystem())
+    return 1;
+  llvm::sys::fs::AutoCleanupPerThreadFileSystem auto_cleanup_fs;
+  if (FAILED(DxcInitThreadMalloc()))
+    return 1;
+  DxcSetThreadMallocToDefault();
+
+  const char *pStage = "Operation";
+  int RetVal = 0;
+  try {
+    llvm::sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    pStage = "Argument processing";
+    cl::ParseCommandLineOptions(argc, argv, "dxc compiler benchmark\n");
+    if (Help) {
+      cl::PrintHelpMessage();
+      return 2;
+    }
+    if (CorpusFilename.empty() == ResultsFilename.empty())
+      throw hlsl::Exception(E_INVALIDARG,
+                            "specify either a corpus manifest or -results");
+    if (!ResultsFilename.empty() && BaselineFilename.empty())
+      throw hlsl::Exception(E_INVALIDARG, "-results requires -baseline");
+
+    JsonNode Current;
+    if (!ResultsFilename.empty()) {
+      pStage = "Reading results";
+      ReadJsonFile(ResultsFilename, Current);
+    } else {
+      pStage = "Reading corpus";
+      std::vector<BenchCase> Cases;
+      ReadCorpus(Cases);
+
+      pStage = "Loading dxcompiler";
+      IFT(g_DxcSupport.Initialize());
+
+      pStage = "Running cases";
+      RunCases(Cases);
+
+      std::vector<ThroughputResult> Throughput;
+      if (!NoThroughput) {
+        pStage = "Measuring throughput";
+        std::vector<unsigned> Counts(ThreadCounts.begin(), ThreadCounts.end());
+        if (Counts.empty())
+          Counts = {1, 2, 4, std::thread::hardware_concurrency()};
+        std::sort(Counts.begin(), Counts.end());
+        Counts.erase(std::unique(Counts.begin(), Counts.end()), Counts.end());
+        for (unsigned Threads : Counts) {
+          if (Threads == 0)
+            continue;
+          fprintf(stderr, "throughput at %u threads...\n", Threads);
+          Throughput.push_back(RunThroughput(Cases, Threads));
+        }
+      }
+
+      pStage = "Writing output";
+      std::string Output;
+      raw_string_ostream OS(Output);
+      WriteResults(OS, Cases, Throughput);
+      OS.flush();
+      if (OutputFilename.empty()) {
+        fwrite(Output.data(), 1, Output.size(), stdout);
+      } else {
+        std::wstring WideOutput =
+            Unicode::UTF8ToWideStringOrThrow(OutputFilename.c_str());
+        IFT(WriteBinaryFile(WideOutput.c_str(), Output.data(),
+                            (DWORD)Output.size()));
+      }
+      if (!BaselineFilename.empty() && !ParseJson(Output, Current))
+        throw hlsl::Exception(E_FAIL, "unable to parse the results");
+    }
+
+    if (!BaselineFilename.empty()) {
+      pStage = "Comparing with baseline";
+      JsonNode Baseline;
+      ReadJsonFile(BaselineFilename, Baseline);
+      std::string Report;
+      raw_string_ostream OS(Report);
+      unsigned Regressions = CompareResults(OS, Baseline, Current);
+      OS << Regressions << " regression(s) beyond "
+         << format("%.1f", (double)Threshold) << "%\n";
+      OS.flush();
+      fwrite(Report.data(), 1, Report.size(), stderr);
+      RetVal = Regressions ? 1 : 0;
+    }
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg == nullptr || *msg == '\0')
+      printf("%s failed - error code 0x%08x.\n", pStage, hlslException.hr);
+    else
+      printf("%s\n", msg);
+    return 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    return 1;
+  } catch (...) {
+    printf("%s failed - unknown error.\n", pStage);
+    return 1;
+  }
+
+  return RetVal;
+}
@@ -37,6 +37,7 @@
 //
 
 #include "dxc.h"
+#include "dxcserver.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/WinFunctions.h"
@@ -58,8 +59,10 @@
 #include "dxc/dxctools.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/OptTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/StringSaver.h"
 #include "llvm/Support/raw_ostream.h"
 #ifdef _WIN32
 // Mach change start
@@ -71,6 +74,8 @@
 #include <dia2.h>
 #endif
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include <unordered_map>
 
 #ifdef _WIN32
@@ -131,6 +136,7 @@ class DxcContext {
 private:
   DxcOpts &m_Opts;
   DxcDllSupport &m_dxcSupport;
+  std::vector<std::string> *m_pDependencies = nullptr;
 
   int ActOnBlob(IDxcBlob *pBlob);
   int ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugBlobName);
@@ -163,6 +169,11 @@ public:
   DxcContext(DxcOpts &Opts, DxcDllSupport &dxcSupport)
       : m_Opts(Opts), m_dxcSupport(dxcSupport) {}
 
+  // Collects the files included while compiling into pDependencies.
+  void RecordDependencies(std::vector<std::string> *pDependencies) {
+    m_pDependencies = pDependencies;
+  }
+
   int Compile();
   void Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary,
                  IDxcCompiler *pCompiler, std::vector<LPCWSTR> &args,
@@ -552,19 +563,20 @@ HRESULT DxcContext::ReadFileIntoPartContent(hlsl::DxilFourCC fourCC,
   // rootsignature part, then construct a blob of root signature part
   if (fourCC == hlsl::DxilFourCC::DFCC_RootSignature) {
     CComPtr<IDxcBlob> pResult;
-    CComHeapPtr<BYTE> pData;
-    DWORD dataSize;
-    IFT(hlsl::ReadBinaryFile(fileName, (void **)&pData, &dataSize));
-    DXASSERT(pData != nullptr,
-             "otherwise ReadBinaryFile should throw an exception");
-    hlsl::DxilContainerHeader *pHeader =
-        hlsl::IsDxilContainerLike(pData.m_pData, dataSize);
+    CComPtr<IDxcBlobEncoding> pFile;
+    ReadFileIntoBlob(m_dxcSupport, fileName, &pFile);
+    const char *pData = (const char *)pFile->GetBufferPointer();
+    uint32_t dataSize = (uint32_t)pFile->GetBufferSize();
+    const hlsl::DxilContainerHeader *pHeader =
+        hlsl::IsDxilContainerLike(pData, dataSize);
     IFRBOOL(hlsl::IsValidDxilContainer(pHeader, dataSize), E_INVALIDARG);
-    hlsl::DxilPartHeader *pPartHeader =
+    const hlsl::DxilPartHeader *pPartHeader =
         hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_RootSignature);
     IFRBOOL(pPartHeader != nullptr, E_INVALIDARG);
-    hlsl::DxcCreateBlobOnHeapCopy(hlsl::GetDxilPartData(pPartHeader),
-                                  pPartHeader->PartSize, &pResult);
+    // Refer to the part in place rather than copying it out of the file.
+    IFR(hlsl::DxcCreateBlobFromBlob(
+        pFile, (uint32_t)(hlsl::GetDxilPartData(pPartHeader) - pData),
+        pPartHeader->PartSize, &pResult));
     *ppResult = pResult.Detach();
   }
   return S_OK;
@@ -721,6 +733,40 @@ public:
   }
 };
 
+// Forwards to another include handler and records every file it loads.
+class DxcIncludeHandlerWithDependencies : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IDxcIncludeHandler> m_pInner;
+  std::vector<std::string> &m_dependencies;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  DxcIncludeHandlerWithDependencies(IDxcIncludeHandler *pInner,
+                                    std::vector<std::string> &dependencies)
+      : m_dwRef(0), m_pInner(pInner), m_dependencies(dependencies) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename,
+                                       IDxcBlob **ppIncludeSource) override {
+    HRESULT hr = m_pInner->LoadSource(pFilename, ppIncludeSource);
+    if (SUCCEEDED(hr)) {
+      try {
+        std::string name = Unicode::WideToUTF8StringOrThrow(pFilename);
+        if (std::find(m_dependencies.begin(), m_dependencies.end(), name) ==
+            m_dependencies.end())
+          m_dependencies.push_back(std::move(name));
+      }
+      CATCH_CPP_RETURN_HRESULT()
+    }
+    return hr;
+  }
+};
+
 void DxcContext::Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary,
                            IDxcCompiler *pCompiler, std::vector<LPCWSTR> &args,
                            std::wstring &outputPDBPath,
@@ -835,6 +881,10 @@ int DxcContext::Compile() {
 
     if (m_Opts.AstDump)
       args.push_back(L"-ast-dump");
+    // The driver exits after compiling, so it may leave the compile's memory
+    // to the process teardown.
+    if (m_Opts.DiscardTeardown)
+      args.push_back(L"-fdiscard-teardown-at-exit");
 
     CComPtr<IDxcLibrary> pLibrary;
     IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
@@ -848,6 +898,12 @@ int DxcContext::Compile() {
     } else {
       CComPtr<IDxcIncludeHandler> pIncludeHandler;
       IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+      if (m_pDependencies) {
+        CComPtr<IDxcIncludeHandler> pRecorder =
+            new DxcIncludeHandlerWithDependencies(pIncludeHandler,
+                                                  *m_pDependencies);
+        pIncludeHandler = pRecorder;
+      }
 
       // Upgrade profile to 6.0 version from minimum recognized shader model
       llvm::StringRef TargetProfile = m_Opts.TargetProfile;
@@ -930,6 +986,28 @@ int DxcContext::Compile() {
           WriteBlobToFile(pData, m_Opts.TimeTrace, m_Opts.DefaultTextCodePage);
         }
 
+        if (m_Opts.MemoryReport == "-")
+          WriteDxcOutputToConsole(pResult, DXC_OUT_MEMORY_REPORT);
+        else if (!m_Opts.MemoryReport.empty()) {
+          CComPtr<IDxcBlob> pData;
+          CComPtr<IDxcBlobWide> pName;
+          IFT(pResult->GetOutput(DXC_OUT_MEMORY_REPORT, IID_PPV_ARGS(&pData),
+                                 &pName));
+          WriteBlobToFile(pData, m_Opts.MemoryReport,
+                          m_Opts.DefaultTextCodePage);
+        }
+
+        if (m_Opts.ContentionReport == "-")
+          WriteDxcOutputToConsole(pResult, DXC_OUT_CONTENTION_REPORT);
+        else if (!m_Opts.ContentionReport.empty()) {
+          CComPtr<IDxcBlob> pData;
+          CComPtr<IDxcBlobWide> pName;
+          IFT(pResult->GetOutput(DXC_OUT_CONTENTION_REPORT,
+                                 IID_PPV_ARGS(&pData), &pName));
+          WriteBlobToFile(pData, m_Opts.ContentionReport,
+                          m_Opts.DefaultTextCodePage);
+        }
+
         WriteDxcOutputToFile(DXC_OUT_ROOT_SIGNATURE, pResult,
                              m_Opts.DefaultTextCodePage);
         WriteDxcOutputToFile(DXC_OUT_SHADER_HASH, pResult,
@@ -1414,6 +1492,242 @@ static LONG CALLBACK ExceptionFilter(PEXCEPTION_POINTERS pExceptionInfo) {
 }
 #endif
 
+// Returns the message to report for an exception; exceptions without one get
+// a description of their HRESULT written to printBuffer.
+static const char *GetHlslExceptionMessage(
+    const ::hlsl::Exception &hlslException, Unicode::acp_char *printBuffer,
+    size_t printBufferSize) {
+  const char *msg = hlslException.what();
+  if (msg == nullptr || *msg == '\0') {
+    switch (hlslException.hr) {
+    case DXC_E_DUPLICATE_PART:
+      sprintf_s(
+          printBuffer, printBufferSize,
+          "dxc failed : DXIL container already contains the given part.");
+      break;
+    case DXC_E_MISSING_PART:
+      sprintf_s(
+          printBuffer, printBufferSize,
+          "dxc failed : DXIL container does not contain the given part.");
+      break;
+    case DXC_E_CONTAINER_INVALID:
+      sprintf_s(printBuffer, printBufferSize,
+                "dxc failed : Invalid DXIL container.");
+      break;
+    case DXC_E_CONTAINER_MISSING_DXIL:
+      sprintf_s(printBuffer, printBufferSize,
+                "dxc failed : DXIL container is missing DXIL part.");
+      break;
+    case DXC_E_CONTAINER_MISSING_DEBUG:
+      sprintf_s(printBuffer, printBufferSize,
+                "dxc failed : DXIL container is missing Debug Info part.");
+      break;
+    case DXC_E_LLVM_FATAL_ERROR:
+      sprintf_s(printBuffer, printBufferSize,
+                "dxc failed : Internal Compiler Error - LLVM Fatal Error!");
+      break;
+    case DXC_E_LLVM_UNREACHABLE:
+      sprintf_s(
+          printBuffer, printBufferSize,
+          "dxc failed : Internal Compiler Error - UNREACHABLE executed!");
+      break;
+    case DXC_E_LLVM_CAST_ERROR:
+      sprintf_s(printBuffer, printBufferSize,
+                "dxc failed : Internal Compiler Error - Cast of "
+                "incompatible type!");
+      break;
+    case E_OUTOFMEMORY:
+      sprintf_s(printBuffer, printBufferSize, "dxc failed : Out of Memory.");
+      break;
+    case E_INVALIDARG:
+      sprintf_s(printBuffer, printBufferSize, "dxc failed : Invalid argument.");
+      break;
+    default:
+      sprintf_s(printBuffer, printBufferSize,
+                "dxc failed : error code 0x%08x.\n", hlslException.hr);
+    }
+    msg = printBuffer;
+  }
+  return msg;
+}
+
+namespace {
+// One command line of a -batch manifest and what compiling it produced.
+struct DxcBatchJob {
+  unsigned Line = 0;
+  std::vector<llvm::StringRef> Args;
+  std::string Target;
+  std::string Input;
+  std::vector<std::string> Dependencies;
+  int Result = 0;
+};
+} // namespace
+
+static void ReportBatchJobError(llvm::StringRef batchFile,
+                                const DxcBatchJob &job, const char *msg) {
+  fprintf(stderr, "%s(%u): %s\n", batchFile.str().c_str(), job.Line, msg);
+}
+
+// Parses and runs a single -batch job; errors are reported, not thrown.
+static void RunBatchJob(llvm::StringRef batchFile, DxcBatchJob &job,
+                        DxcDllSupport &dxcSupport) {
+  const char *pStage = "Argument processing";
+  try {
+    MainArgs argStrings(job.Args);
+    DxcOpts jobOpts;
+    std::string errorString;
+    llvm::raw_string_ostream errorStream(errorString);
+    job.Result = ReadDxcOpts(getHlslOptTable(), DxcFlags, argStrings, jobOpts,
+                             errorStream);
+    if (job.Result == 0 && !jobOpts.BatchFile.empty()) {
+      errorStream << "-batch cannot be used inside a batch file.";
+      job.Result = 1;
+    }
+    errorStream.flush();
+    if (!errorString.empty())
+      ReportBatchJobError(batchFile, job, errorString.c_str());
+    if (job.Result != 0 || jobOpts.ShowHelp || jobOpts.ShowVersion)
+      return;
+
+    if (jobOpts.EntryPoint.empty() && !jobOpts.RecompileFromBinary)
+      jobOpts.EntryPoint = "main";
+    job.Input = jobOpts.InputFile;
+    job.Target = jobOpts.OutputObject.empty() ? job.Input
+                                              : jobOpts.OutputObject.str();
+
+    DxcContext context(jobOpts, dxcSupport);
+    context.RecordDependencies(&job.Dependencies);
+    if (!jobOpts.Preprocess.empty()) {
+      pStage = "Preprocessing";
+      context.Preprocess();
+    } else if (jobOpts.DumpBin) {
+      pStage = "Dumping existing binary";
+      job.Result = context.DumpBinary();
+    } else if (jobOpts.Link) {
+      pStage = "Linking";
+      job.Result = context.Link();
+    } else {
+      pStage = "Compilation";
+      job.Result = context.Compile();
+    }
+  } catch (const ::hlsl::Exception &hlslException) {
+    Unicode::acp_char printBuffer[128];
+    ReportBatchJobError(batchFile, job,
+                        GetHlslExceptionMessage(hlslException, printBuffer,
+                                                _countof(printBuffer)));
+    job.Result = 1;
+  } catch (std::bad_alloc &) {
+    fprintf(stderr, "%s(%u): %s failed - out of memory.\n",
+            batchFile.str().c_str(), job.Line, pStage);
+    job.Result = 1;
+  } catch (...) {
+    fprintf(stderr, "%s(%u): %s failed - unknown error.\n",
+            batchFile.str().c_str(), job.Line, pStage);
+    job.Result = 1;
+  }
+}
+
+// Escapes a path for use in a make-style dependency file.
+static void WriteDependencyPath(llvm::raw_ostream &OS, llvm::StringRef path) {
+  for (char c : path) {
+    if (c == ' ' || c == '#')
+      OS << '\\';
+    else if (c == '$')
+      OS << '$';
+    OS << c;
+  }
+}
+
+// Compiles every command line of opts.BatchFile in this process, spreading the
+// jobs over opts.BatchJobs worker threads. Lines are tokenized like a response
+// file; empty lines and lines starting with '//' are skipped.
+static int CompileBatch(const DxcOpts &opts, DxcDllSupport &dxcSupport) {
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pManifest;
+  CComPtr<IDxcBlobEncoding> pManifestUtf8;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  ReadFileIntoBlob(dxcSupport, StringRefWide(opts.BatchFile), &pManifest);
+  IFT(pLibrary->GetBlobAsUtf8(pManifest, &pManifestUtf8));
+  llvm::StringRef manifest(
+      (const char *)pManifestUtf8->GetBufferPointer(),
+      strnlen((const char *)pManifestUtf8->GetBufferPointer(),
+              pManifestUtf8->GetBufferSize()));
+
+  llvm::BumpPtrAllocator argAlloc;
+  llvm::BumpPtrStringSaver argSaver(argAlloc);
+  std::vector<DxcBatchJob> jobs;
+  llvm::SmallVector<llvm::StringRef, 64> lines;
+  manifest.split(lines, "\n");
+  for (unsigned i = 0; i < lines.size(); ++i) {
+    llvm::StringRef line = lines[i].trim();
+    if (line.empty() || line.startswith("//"))
+      continue;
+    llvm::SmallVector<const char *, 32> argv;
+#ifdef _WIN32
+    llvm::cl::TokenizeWindowsCommandLine(line, argSaver, argv);
+#else
+    llvm::cl::TokenizeGNUCommandLine(line, argSaver, argv);
+#endif
+    jobs.emplace_back();
+    jobs.back().Line = i + 1;
+    jobs.back().Args.assign(argv.begin(), argv.end());
+  }
+
+  unsigned threadCount = opts.BatchJobs;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min<size_t>(threadCount, jobs.size());
+
+  std::atomic<size_t> nextJob(0);
+  auto worker = [&]() {
+    DxcThreadMalloc TM(nullptr);
+    for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+      RunBatchJob(opts.BatchFile, jobs[i], dxcSupport);
+  };
+  if (threadCount <= 1) {
+    worker();
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+      threads.emplace_back(worker);
+    for (std::thread &t : threads)
+      t.join();
+  }
+
+  int retVal = 0;
+  for (const DxcBatchJob &job : jobs)
+    if (job.Result != 0)
+      retVal = 1;
+
+  if (!opts.BatchDependencyFile.empty()) {
+    std::string deps;
+    llvm::raw_string_ostream OS(deps);
+    for (const DxcBatchJob &job : jobs) {
+      if (job.Result != 0 || job.Target.empty())
+        continue;
+      WriteDependencyPath(OS, job.Target);
+      OS << ':';
+      if (!job.Input.empty()) {
+        OS << ' ';
+        WriteDependencyPath(OS, job.Input);
+      }
+      for (const std::string &dep : job.Dependencies) {
+        OS << " \\\n  ";
+        WriteDependencyPath(OS, dep);
+      }
+      OS << '\n';
+    }
+    OS.flush();
+    CComPtr<IDxcBlobEncoding> pDeps;
+    IFT(pLibrary->CreateBlobWithEncodingOnHeapCopy(deps.data(), deps.size(),
+                                                   CP_UTF8, &pDeps));
+    WriteBlobToFile(pDeps, opts.BatchDependencyFile, CP_UTF8);
+  }
+
+  return retVal;
+}
+
 // Mach change start
 // #ifdef _WIN32
 #if defined(_WIN32) && !defined(__clang__)
@@ -1467,6 +1781,13 @@ int dxc::main(int argc, const char **argv_) {
       SetUnhandledExceptionFilter(ExceptionFilter);
 #endif
 
+    // Compiling through a server does not need the compiler in this process.
+    if (!dxcOpts.ConnectAddress.empty() && !dxcOpts.ShowHelp &&
+        !dxcOpts.ShowVersion) {
+      pStage = "Compilation";
+      return CompileWithServer(dxcOpts);
+    }
+
     // Setup a helper DLL.
     {
       std::string dllErrorString;
@@ -1507,7 +1828,13 @@ int dxc::main(int argc, const char **argv_) {
     }
 
     // TODO: implement all other actions.
-    if (!dxcOpts.Preprocess.empty()) {
+    if (!dxcOpts.ServerAddress.empty()) {
+      pStage = "Serving";
+      retVal = RunCompilerServer(dxcOpts.ServerAddress, dxcSupport);
+    } else if (!dxcOpts.BatchFile.empty()) {
+      pStage = "Batch compilation";
+      retVal = CompileBatch(dxcOpts, dxcSupport);
+    } else if (!dxcOpts.Preprocess.empty()) {
       pStage = "Preprocessing";
       context.Preprocess();
     } else if (dxcOpts.DumpBin) {
@@ -1522,63 +1849,11 @@ int dxc::main(int argc, const char **argv_) {
     }
   } catch (const ::hlsl::Exception &hlslException) {
     try {
-      const char *msg = hlslException.what();
       Unicode::acp_char
           printBuffer[128]; // printBuffer is safe to treat as
                             // UTF-8 because we use ASCII only errors
-      if (msg == nullptr || *msg == '\0') {
-        switch (hlslException.hr) {
-        case DXC_E_DUPLICATE_PART:
-          sprintf_s(
-              printBuffer, _countof(printBuffer),
-              "dxc failed : DXIL container already contains the given part.");
-          break;
-        case DXC_E_MISSING_PART:
-          sprintf_s(
-              printBuffer, _countof(printBuffer),
-              "dxc failed : DXIL container does not contain the given part.");
-          break;
-        case DXC_E_CONTAINER_INVALID:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Invalid DXIL container.");
-          break;
-        case DXC_E_CONTAINER_MISSING_DXIL:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : DXIL container is missing DXIL part.");
-          break;
-        case DXC_E_CONTAINER_MISSING_DEBUG:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : DXIL container is missing Debug Info part.");
-          break;
-        case DXC_E_LLVM_FATAL_ERROR:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Internal Compiler Error - LLVM Fatal Error!");
-          break;
-        case DXC_E_LLVM_UNREACHABLE:
-          sprintf_s(
-              printBuffer, _countof(printBuffer),
-              "dxc failed : Internal Compiler Error - UNREACHABLE executed!");
-          break;
-        case DXC_E_LLVM_CAST_ERROR:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Internal Compiler Error - Cast of "
-                    "incompatible type!");
-          break;
-        case E_OUTOFMEMORY:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Out of Memory.");
-          break;
-        case E_INVALIDARG:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Invalid argument.");
-          break;
-        default:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : error code 0x%08x.\n", hlslException.hr);
-        }
-        msg = printBuffer;
-      }
-
+      const char *msg = GetHlslExceptionMessage(hlslException, printBuffer,
+                                                _countof(printBuffer));
       WriteUtf8ToConsoleSizeT(msg, strlen(msg), STD_ERROR_HANDLE);
       printf("\n");
     } catch (...) {
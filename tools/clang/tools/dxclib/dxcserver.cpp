@@ -0,0 +1,627 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcserver.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the dxc compiler server and its client.                        //
+//                                                                           //
+// The server listens on a Unix domain socket (a named pipe on Windows) and  //
+// keeps its compilers alive between requests, so process startup and       //
+// compiler warm-up are paid once rather than once per shader. Includes are  //
+// requested from the client, which reads them from its own file system.     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxcserver.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/HLSLOptions.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/dxcapi.use.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include "llvm/Option/ArgList.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace dxc;
+using namespace hlsl::options;
+
+namespace {
+
+// Messages larger than this are treated as a protocol error.
+static const uint32_t kMaxMessageSize = 1u << 30;
+
+// A connected, bidirectional byte stream between the server and a client.
+class DxcServerChannel {
+public:
+#ifdef _WIN32
+  typedef HANDLE NativeHandle;
+#else
+  typedef int NativeHandle;
+#endif
+
+  explicit DxcServerChannel(NativeHandle handle) : m_handle(handle) {}
+  ~DxcServerChannel() {
+#ifdef _WIN32
+    CloseHandle(m_handle);
+#else
+    ::close(m_handle);
+#endif
+  }
+  DxcServerChannel(const DxcServerChannel &) = delete;
+  DxcServerChannel &operator=(const DxcServerChannel &) = delete;
+
+  bool ReadMessage(DxcServerMessage &kind, std::vector<char> &payload) {
+    uint32_t header[2];
+    if (!Read(header, sizeof(header)) || header[1] > kMaxMessageSize)
+      return false;
+    kind = (DxcServerMessage)header[0];
+    payload.resize(header[1]);
+    return payload.empty() || Read(payload.data(), payload.size());
+  }
+
+  bool WriteMessage(DxcServerMessage kind, const std::vector<char> &payload) {
+    if (payload.size() > kMaxMessageSize)
+      return false;
+    uint32_t header[2] = {(uint32_t)kind, (uint32_t)payload.size()};
+    return Write(header, sizeof(header)) &&
+           (payload.empty() || Write(payload.data(), payload.size()));
+  }
+
+private:
+  NativeHandle m_handle;
+
+  bool Read(void *pData, size_t size) {
+    char *pCur = (char *)pData;
+    while (size != 0) {
+#ifdef _WIN32
+      DWORD bytesRead = 0;
+      if (!ReadFile(m_handle, pCur, (DWORD)std::min<size_t>(size, 1u << 20),
+                    &bytesRead, nullptr) ||
+          bytesRead == 0)
+        return false;
+#else
+      ssize_t bytesRead = ::read(m_handle, pCur, size);
+      if (bytesRead < 0 && errno == EINTR)
+        continue;
+      if (bytesRead <= 0)
+        return false;
+#endif
+      pCur += bytesRead;
+      size -= bytesRead;
+    }
+    return true;
+  }
+
+  bool Write(const void *pData, size_t size) {
+    const char *pCur = (const char *)pData;
+    while (size != 0) {
+#ifdef _WIN32
+      DWORD bytesWritten = 0;
+      if (!WriteFile(m_handle, pCur, (DWORD)std::min<size_t>(size, 1u << 20),
+                     &bytesWritten, nullptr))
+        return false;
+#else
+      ssize_t bytesWritten = ::write(m_handle, pCur, size);
+      if (bytesWritten < 0 && errno == EINTR)
+        continue;
+      if (bytesWritten < 0)
+        return false;
+#endif
+      pCur += bytesWritten;
+      size -= bytesWritten;
+    }
+    return true;
+  }
+};
+
+// Builds a message payload out of u32 values and length-prefixed byte strings.
+class DxcServerPayloadWriter {
+public:
+  void AddUInt32(uint32_t value) {
+    const char *pValue = (const char *)&value;
+    m_data.insert(m_data.end(), pValue, pValue + sizeof(value));
+  }
+  void AddBytes(llvm::StringRef bytes) {
+    AddUInt32((uint32_t)bytes.size());
+    m_data.insert(m_data.end(), bytes.begin(), bytes.end());
+  }
+  const std::vector<char> &GetData() const { return m_data; }
+
+private:
+  std::vector<char> m_data;
+};
+
+// Reads back what DxcServerPayloadWriter produced; returns false on
+// truncated payloads.
+class DxcServerPayloadReader {
+public:
+  explicit DxcServerPayloadReader(const std::vector<char> &data)
+      : m_data(data), m_offset(0) {}
+  bool ReadUInt32(uint32_t &value) {
+    if (m_data.size() - m_offset < sizeof(value))
+      return false;
+    memcpy(&value, m_data.data() + m_offset, sizeof(value));
+    m_offset += sizeof(value);
+    return true;
+  }
+  bool ReadBytes(llvm::StringRef &bytes) {
+    uint32_t size;
+    if (!ReadUInt32(size) || m_data.size() - m_offset < size)
+      return false;
+    bytes = llvm::StringRef(m_data.data() + m_offset, size);
+    m_offset += size;
+    return true;
+  }
+
+private:
+  const std::vector<char> &m_data;
+  size_t m_offset;
+};
+
+#ifdef _WIN32
+static std::wstring GetPipeName(llvm::StringRef address) {
+  std::wstring name = Unicode::UTF8ToWideStringOrThrow(address.str().c_str());
+  if (name.compare(0, 9, L"\\\\.\\pipe\\") != 0)
+    name.insert(0, L"\\\\.\\pipe\\");
+  return name;
+}
+#else
+static sockaddr_un GetSocketAddress(llvm::StringRef address) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (address.empty() || address.size() >= sizeof(addr.sun_path))
+    throw hlsl::Exception(E_INVALIDARG,
+                          "Invalid dxc server address '" + address.str() + "'");
+  memcpy(addr.sun_path, address.data(), address.size());
+  return addr;
+}
+
+static hlsl::Exception SocketError(const char *pAction,
+                                   llvm::StringRef address) {
+  return hlsl::Exception(E_FAIL, std::string(pAction) + " '" + address.str() +
+                                     "' failed: " + strerror(errno));
+}
+#endif
+
+// Idle compilers, shared by all connections so that state a compiler keeps
+// between calls stays warm across clients.
+class DxcServerCompilerPool {
+public:
+  explicit DxcServerCompilerPool(DxcDllSupport &dxcSupport)
+      : m_dxcSupport(dxcSupport) {}
+
+  CComPtr<IDxcCompiler3> Acquire() {
+    CComPtr<IDxcCompiler3> pCompiler;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_idle.empty()) {
+        pCompiler = m_idle.back();
+        m_idle.pop_back();
+        return pCompiler;
+      }
+    }
+    IFT(m_dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    return pCompiler;
+  }
+
+  void Release(IDxcCompiler3 *pCompiler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idle.emplace_back(pCompiler);
+  }
+
+private:
+  DxcDllSupport &m_dxcSupport;
+  std::mutex m_mutex;
+  std::vector<CComPtr<IDxcCompiler3>> m_idle;
+};
+
+// Resolves includes by asking the client for the file contents.
+class DxcServerIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  DxcServerChannel &m_channel;
+  bool m_channelFailed;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  explicit DxcServerIncludeHandler(DxcServerChannel &channel)
+      : m_dwRef(0), m_channel(channel), m_channelFailed(false) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename,
+                                       IDxcBlob **ppIncludeSource) override {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_POINTER;
+    *ppIncludeSource = nullptr;
+    if (m_channelFailed)
+      return E_ABORT;
+    try {
+      DxcServerPayloadWriter request;
+      request.AddBytes(Unicode::WideToUTF8StringOrThrow(pFilename));
+      DxcServerMessage kind;
+      std::vector<char> payload;
+      uint32_t found = 0;
+      llvm::StringRef contents;
+      if (!m_channel.WriteMessage(DxcServerMessage::IncludeRequest,
+                                  request.GetData()) ||
+          !m_channel.ReadMessage(kind, payload) ||
+          kind != DxcServerMessage::IncludeResponse) {
+        m_channelFailed = true;
+        return E_ABORT;
+      }
+      DxcServerPayloadReader reader(payload);
+      if (!reader.ReadUInt32(found) || !reader.ReadBytes(contents)) {
+        m_channelFailed = true;
+        return E_ABORT;
+      }
+      if (!found)
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+      CComPtr<IDxcBlobEncoding> pSource;
+      IFR(hlsl::DxcCreateBlobWithEncodingOnHeapCopy(
+          contents.data(), contents.size(), CP_ACP, &pSource));
+      *ppIncludeSource = pSource.Detach();
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  bool ChannelFailed() const { return m_channelFailed; }
+};
+
+static bool IsTextOutput(DXC_OUT_KIND kind) {
+  switch (kind) {
+  case DXC_OUT_ERRORS:
+  case DXC_OUT_DISASSEMBLY:
+  case DXC_OUT_HLSL:
+  case DXC_OUT_TEXT:
+  case DXC_OUT_REMARKS:
+  case DXC_OUT_TIME_REPORT:
+  case DXC_OUT_TIME_TRACE:
+  case DXC_OUT_MEMORY_REPORT:
+  case DXC_OUT_CONTENTION_REPORT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Appends the status and every blob output of pResult to payload.
+static void WriteResultPayload(DxcServerPayloadWriter &payload,
+                               IDxcResult *pResult) {
+  struct Output {
+    DXC_OUT_KIND Kind;
+    std::string Name;
+    CComPtr<IDxcBlob> Blob;
+    llvm::StringRef Data;
+  };
+  std::vector<Output> outputs;
+  for (UINT32 i = 0, e = pResult->GetNumOutputs(); i < e; ++i) {
+    Output output;
+    output.Kind = pResult->GetOutputByIndex(i);
+    CComPtr<IDxcBlobWide> pName;
+    if (output.Kind == DXC_OUT_EXTRA_OUTPUTS ||
+        FAILED(pResult->GetOutput(output.Kind, IID_PPV_ARGS(&output.Blob),
+                                  &pName)) ||
+        output.Blob == nullptr)
+      continue;
+
+    output.Data = llvm::StringRef((const char *)output.Blob->GetBufferPointer(),
+                                  output.Blob->GetBufferSize());
+    CComPtr<IDxcBlobUtf8> pText;
+    if (IsTextOutput(output.Kind) &&
+        SUCCEEDED(output.Blob.QueryInterface(&pText)))
+      output.Data = llvm::StringRef(pText->GetStringPointer(),
+                                    pText->GetStringLength());
+    if (pName && pName->GetStringLength() != 0)
+      output.Name = Unicode::WideToUTF8StringOrThrow(pName->GetStringPointer());
+    outputs.emplace_back(std::move(output));
+  }
+
+  HRESULT status;
+  IFT(pResult->GetStatus(&status));
+  payload.AddUInt32((uint32_t)status);
+  payload.AddUInt32((uint32_t)outputs.size());
+  for (const Output &output : outputs) {
+    payload.AddUInt32((uint32_t)output.Kind);
+    payload.AddBytes(output.Name);
+    payload.AddBytes(output.Data);
+  }
+}
+
+// Reports a request that could not be compiled as a failed result whose only
+// output is the error text.
+static void WriteFailurePayload(DxcServerPayloadWriter &payload, HRESULT hr,
+                                llvm::StringRef message) {
+  payload.AddUInt32((uint32_t)hr);
+  payload.AddUInt32(1);
+  payload.AddUInt32(DXC_OUT_ERRORS);
+  payload.AddBytes("");
+  payload.AddBytes(message);
+}
+
+// Compiles one Compile request and returns false if the connection broke.
+static bool ServeCompileRequest(DxcServerChannel &channel,
+                                const std::vector<char> &request,
+                                DxcServerCompilerPool &pool) {
+  DxcServerPayloadWriter response;
+  try {
+    DxcServerPayloadReader reader(request);
+    uint32_t argCount;
+    if (!reader.ReadUInt32(argCount))
+      return false;
+    std::vector<std::wstring> argStrings;
+    for (uint32_t i = 0; i < argCount; ++i) {
+      llvm::StringRef arg;
+      if (!reader.ReadBytes(arg))
+        return false;
+      // The server outlives its compiles, so none may leave its memory to
+      // the process teardown.
+      if (arg == "-fdiscard-teardown-at-exit")
+        continue;
+      argStrings.emplace_back(
+          Unicode::UTF8ToWideStringOrThrow(arg.str().c_str()));
+    }
+    llvm::StringRef sourceName, source;
+    if (!reader.ReadBytes(sourceName) || !reader.ReadBytes(source))
+      return false;
+    if (!sourceName.empty())
+      argStrings.emplace_back(
+          Unicode::UTF8ToWideStringOrThrow(sourceName.str().c_str()));
+
+    std::vector<LPCWSTR> args;
+    args.reserve(argStrings.size());
+    for (const std::wstring &arg : argStrings)
+      args.push_back(arg.c_str());
+
+    DxcBuffer sourceBuffer;
+    sourceBuffer.Ptr = source.data();
+    sourceBuffer.Size = source.size();
+    sourceBuffer.Encoding = CP_ACP;
+
+    CComPtr<DxcServerIncludeHandler> pIncludeHandler =
+        new DxcServerIncludeHandler(channel);
+    CComPtr<IDxcCompiler3> pCompiler = pool.Acquire();
+    CComPtr<IDxcResult> pResult;
+    HRESULT hr = pCompiler->Compile(&sourceBuffer, args.data(), args.size(),
+                                    pIncludeHandler, IID_PPV_ARGS(&pResult));
+    pool.Release(pCompiler);
+    if (pIncludeHandler->ChannelFailed())
+      return false;
+    if (FAILED(hr))
+      WriteFailurePayload(response, hr, "dxc server: compilation failed.");
+    else
+      WriteResultPayload(response, pResult);
+  } catch (const hlsl::Exception &e) {
+    response = DxcServerPayloadWriter();
+    WriteFailurePayload(response, e.hr, e.msg);
+  } catch (std::bad_alloc &) {
+    response = DxcServerPayloadWriter();
+    WriteFailurePayload(response, E_OUTOFMEMORY, "dxc server: out of memory.");
+  }
+  return channel.WriteMessage(DxcServerMessage::Result, response.GetData());
+}
+
+static void ServeConnection(DxcServerChannel::NativeHandle handle,
+                            DxcServerCompilerPool &pool) {
+  DxcThreadMalloc TM(nullptr);
+  DxcServerChannel channel(handle);
+  DxcServerPayloadWriter hello;
+  hello.AddUInt32(DxcServerProtocolVersion);
+  if (!channel.WriteMessage(DxcServerMessage::Hello, hello.GetData()))
+    return;
+
+  DxcServerMessage kind;
+  std::vector<char> request;
+  while (channel.ReadMessage(kind, request) &&
+         kind == DxcServerMessage::Compile) {
+    if (!ServeCompileRequest(channel, request, pool))
+      return;
+  }
+}
+
+static DxcServerChannel::NativeHandle ConnectToServer(llvm::StringRef address) {
+#ifdef _WIN32
+  std::wstring pipeName = GetPipeName(address);
+  for (;;) {
+    HANDLE hPipe = CreateFileW(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE,
+                               0, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (hPipe != INVALID_HANDLE_VALUE)
+      return hPipe;
+    if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeW(pipeName.c_str(),
+                                                             10000))
+      throw hlsl::Exception(HRESULT_FROM_WIN32(GetLastError()),
+                            "Unable to connect to dxc server '" +
+                                address.str() + "'");
+  }
+#else
+  sockaddr_un addr = GetSocketAddress(address);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    throw SocketError("Creating a socket for", address);
+  if (::connect(fd, (const sockaddr *)&addr, sizeof(addr)) != 0) {
+    hlsl::Exception e = SocketError("Connecting to dxc server", address);
+    ::close(fd);
+    throw e;
+  }
+  return fd;
+#endif
+}
+
+// Answers an IncludeRequest from the local file system.
+static bool AnswerIncludeRequest(DxcServerChannel &channel,
+                                 const std::vector<char> &request) {
+  DxcServerPayloadReader reader(request);
+  llvm::StringRef fileName;
+  if (!reader.ReadBytes(fileName))
+    return false;
+
+  CComHeapPtr<BYTE> pData;
+  DWORD dataSize = 0;
+  std::wstring wFileName =
+      Unicode::UTF8ToWideStringOrThrow(fileName.str().c_str());
+  bool found =
+      SUCCEEDED(hlsl::ReadBinaryFile(wFileName.c_str(), (void **)&pData,
+                                     &dataSize));
+  DxcServerPayloadWriter response;
+  response.AddUInt32(found ? 1 : 0);
+  response.AddBytes(found ? llvm::StringRef((const char *)pData.m_pData,
+                                            dataSize)
+                          : llvm::StringRef());
+  return channel.WriteMessage(DxcServerMessage::IncludeResponse,
+                              response.GetData());
+}
+
+} // namespace
+
+int dxc::RunCompilerServer(llvm::StringRef address,
+                           DxcDllSupport &dxcSupport) {
+  DxcServerCompilerPool pool(dxcSupport);
+  // Create a compiler up front so the first client does not pay for it.
+  pool.Release(pool.Acquire());
+
+#ifdef _WIN32
+  std::wstring pipeName = GetPipeName(address);
+  for (;;) {
+    HANDLE hPipe = CreateNamedPipeW(
+        pipeName.c_str(), PIPE_ACCESS_DUPLEX,
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+        PIPE_UNLIMITED_INSTANCES, 1 << 16, 1 << 16, 0, nullptr);
+    if (hPipe == INVALID_HANDLE_VALUE)
+      throw hlsl::Exception(HRESULT_FROM_WIN32(GetLastError()),
+                            "Unable to create dxc server pipe '" +
+                                address.str() + "'");
+    if (!ConnectNamedPipe(hPipe, nullptr) &&
+        GetLastError() != ERROR_PIPE_CONNECTED) {
+      CloseHandle(hPipe);
+      continue;
+    }
+    std::thread(ServeConnection, hPipe, std::ref(pool)).detach();
+  }
+#else
+  // Clients that disconnect early must not kill the server.
+  signal(SIGPIPE, SIG_IGN);
+
+  sockaddr_un addr = GetSocketAddress(address);
+  int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0)
+    throw SocketError("Creating a socket for", address);
+  // Remove the socket left behind by a previous server.
+  ::unlink(addr.sun_path);
+  if (::bind(listenFd, (const sockaddr *)&addr, sizeof(addr)) != 0 ||
+      ::listen(listenFd, SOMAXCONN) != 0) {
+    hlsl::Exception e = SocketError("Listening on", address);
+    ::close(listenFd);
+    throw e;
+  }
+  for (;;) {
+    int clientFd = ::accept(listenFd, nullptr, nullptr);
+    if (clientFd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      hlsl::Exception e = SocketError("Accepting a client on", address);
+      ::close(listenFd);
+      throw e;
+    }
+    std::thread(ServeConnection, clientFd, std::ref(pool)).detach();
+  }
+#endif
+}
+
+int dxc::CompileWithServer(const DxcOpts &opts) {
+  if (opts.DumpBin || opts.Link || opts.RecompileFromBinary ||
+      !opts.AssemblyCode.empty() || !opts.OutputHeader.empty())
+    throw hlsl::Exception(E_INVALIDARG,
+                          "-connect only supports compilations whose outputs "
+                          "are written by the compiler; -dumpbin, -link, "
+                          "-recompile, -Fc and -Fh are not supported.");
+
+  // The server receives the options the compiler itself understands; the
+  // input file is sent separately, along with its contents.
+  llvm::opt::ArgStringList argList;
+  for (const llvm::opt::Arg *A : opts.Args) {
+    if (A->getOption().hasFlag(CoreOption))
+      A->renderAsInput(opts.Args, argList);
+  }
+
+  CComHeapPtr<BYTE> pSource;
+  DWORD sourceSize = 0;
+  IFT_Data(hlsl::ReadBinaryFile(StringRefWide(opts.InputFile),
+                                (void **)&pSource, &sourceSize),
+           StringRefWide(opts.InputFile));
+
+  DxcServerChannel channel(ConnectToServer(opts.ConnectAddress));
+  DxcServerMessage kind;
+  std::vector<char> payload;
+  uint32_t version = 0;
+  if (!channel.ReadMessage(kind, payload) || kind != DxcServerMessage::Hello ||
+      !DxcServerPayloadReader(payload).ReadUInt32(version) ||
+      version != DxcServerProtocolVersion)
+    throw hlsl::Exception(E_FAIL, "dxc server '" + opts.ConnectAddress.str() +
+                                      "' speaks an unsupported protocol.");
+
+  DxcServerPayloadWriter request;
+  request.AddUInt32((uint32_t)argList.size());
+  for (const char *arg : argList)
+    request.AddBytes(arg);
+  request.AddBytes(opts.InputFile);
+  request.AddBytes(
+      llvm::StringRef((const char *)pSource.m_pData, sourceSize));
+  if (!channel.WriteMessage(DxcServerMessage::Compile, request.GetData()))
+    throw hlsl::Exception(E_FAIL, "Lost connection to dxc server.");
+
+  for (;;) {
+    if (!channel.ReadMessage(kind, payload))
+      throw hlsl::Exception(E_FAIL, "Lost connection to dxc server.");
+    if (kind == DxcServerMessage::Result)
+      break;
+    if (kind != DxcServerMessage::IncludeRequest ||
+        !AnswerIncludeRequest(channel, payload))
+      throw hlsl::Exception(E_FAIL, "Lost connection to dxc server.");
+  }
+
+  DxcServerPayloadReader reader(payload);
+  uint32_t status, outputCount;
+  if (!reader.ReadUInt32(status) || !reader.ReadUInt32(outputCount))
+    throw hlsl::Exception(E_FAIL, "Malformed result from dxc server.");
+
+  for (uint32_t i = 0; i < outputCount; ++i) {
+    uint32_t outputKind;
+    llvm::StringRef name, data;
+    if (!reader.ReadUInt32(outputKind) || !reader.ReadBytes(name) ||
+        !reader.ReadBytes(data))
+      throw hlsl::Exception(E_FAIL, "Malformed result from dxc server.");
+    if (!name.empty()) {
+      // StringRefWide needs a null-terminated string.
+      StringRefWide wName(name.str());
+      IFT_Data(hlsl::WriteBinaryFile(wName, data.data(), (DWORD)data.size()),
+               wName);
+    } else if (outputKind == DXC_OUT_ERRORS && !data.empty() &&
+               (FAILED((HRESULT)status) || opts.OutputWarnings)) {
+      WriteUtf8ToConsoleSizeT(data.data(), data.size(), STD_ERROR_HANDLE);
+    }
+  }
+  return FAILED((HRESULT)status) ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcserver.h                                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the dxc compiler server (-server) and its client (-connect).     //
+// The wire protocol is described in docs/DxcServerProtocol.rst.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef __DXC_DXCSERVER__
+#define __DXC_DXCSERVER__
+
+#include "llvm/ADT/StringRef.h"
+
+namespace hlsl {
+namespace options {
+class DxcOpts;
+}
+} // namespace hlsl
+
+namespace dxc {
+class DxcDllSupport;
+
+// Version sent by the server when a client connects.
+static const unsigned DxcServerProtocolVersion = 1;
+
+// Kinds of the messages exchanged between the server and its clients.
+enum class DxcServerMessage : unsigned {
+  Hello = 1,           // Server -> client: u32 protocol version.
+  Compile = 2,         // Client -> server: arguments and main source.
+  IncludeRequest = 3,  // Server -> client: name of a file to load.
+  IncludeResponse = 4, // Client -> server: u32 found, file contents.
+  Result = 5,          // Server -> client: status and compiler outputs.
+};
+
+// Accepts connections on address and compiles their requests until the
+// process is terminated. Compilers are kept alive between requests.
+int RunCompilerServer(llvm::StringRef address, DxcDllSupport &dxcSupport);
+
+// Sends the compilation described by opts to the server on
+// opts.ConnectAddress, serves its include requests from disk and writes the
+// outputs it returns.
+int CompileWithServer(const hlsl::options::DxcOpts &opts);
+} // namespace dxc
+
+#endif // __DXC_DXCSERVER__
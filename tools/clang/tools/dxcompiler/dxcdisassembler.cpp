@@ -30,6 +30,7 @@
 #include "dxc/HLSL/HLMatrixType.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxcutil.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DiagnosticInfo.h"
@@ -37,6 +38,7 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 
 using namespace llvm;
@@ -54,7 +56,7 @@ bool SigElementHasStream(const DxilProgramSignatureElement &pSignature) {
 }
 
 void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
-                    bool bIsInput, raw_string_ostream &OS, StringRef comment) {
+                    bool bIsInput, raw_ostream &OS, StringRef comment) {
   OS << comment << "\n"
      << comment << " " << pName << " signature:\n"
      << comment << "\n"
@@ -267,7 +269,7 @@ void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
   OS << comment << "\n";
 }
 
-void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
+void PintCompMaskNameCompact(raw_ostream &OS, unsigned CompMask) {
   char Mask[5];
   memset(Mask, '\0', sizeof(Mask));
   unsigned idx = 0;
@@ -283,7 +285,7 @@ void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
 }
 
 void PrintDxilSignature(LPCSTR pName, const DxilSignature &Signature,
-                        raw_string_ostream &OS, StringRef comment) {
+                        raw_ostream &OS, StringRef comment) {
   const std::vector<std::unique_ptr<DxilSignatureElement>> &sigElts =
       Signature.GetElements();
   if (sigElts.size() == 0)
@@ -361,7 +363,7 @@ static_assert(_countof(g_pOptFeatureInfoNames) == OptFeatureInfoCount,
               "g_pOptFeatureInfoNames needs to be updated");
 
 void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
-                      raw_string_ostream &OS, StringRef comment) {
+                      raw_ostream &OS, StringRef comment) {
   uint64_t featureFlags = pFeatureInfo->FeatureFlags;
   if (!featureFlags)
     return;
@@ -385,7 +387,7 @@ void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
 }
 
 void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
-                         raw_string_ostream &OS) {
+                         raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -415,7 +417,7 @@ void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
 }
 
 void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
-                      raw_string_ostream &OS) {
+                      raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -457,7 +459,7 @@ void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
   }
 }
 
-void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
+void PrintResourceBinding(DxilResourceBase &res, raw_ostream &OS,
                           StringRef comment) {
   OS << comment << " " << left_justify(res.GetGlobalName(), 31);
 
@@ -483,8 +485,7 @@ void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
     OS << right_justify("unbounded", 6) << "\n";
 }
 
-void PrintResourceBindings(DxilModule &M, raw_string_ostream &OS,
-                           StringRef comment) {
+void PrintResourceBindings(DxilModule &M, raw_ostream &OS, StringRef comment) {
   OS << comment << "\n"
      << comment << " Resource Bindings:\n"
      << comment << "\n"
@@ -550,8 +551,7 @@ void PrintInputsContributingToOutputs(
   }
 }
 
-void PrintViewIdState(DxilModule &M, raw_string_ostream &OS,
-                      StringRef comment) {
+void PrintViewIdState(DxilModule &M, raw_ostream &OS, StringRef comment) {
   if (!M.GetModule()->getNamedMetadata("dx.viewIdState"))
     return;
 
@@ -685,7 +685,7 @@ static const char *HitGroupTypeToString(DXIL::HitGroupType type) {
   return "<invalid HitGroupType>";
 }
 
-template <typename _T> void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
+template <typename _T> void PrintFlags(raw_ostream &OS, uint32_t Flags) {
   if (!Flags) {
     OS << "0";
     return;
@@ -700,7 +700,7 @@ template <typename _T> void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
   }
 }
 
-void PrintSubobjects(const DxilSubobjects &subobjects, raw_string_ostream &OS,
+void PrintSubobjects(const DxilSubobjects &subobjects, raw_ostream &OS,
                      StringRef comment) {
   if (subobjects.GetSubobjects().empty())
     return;
@@ -820,7 +820,7 @@ void PrintSubobjects(const DxilSubobjects &subobjects, raw_string_ostream &OS,
 }
 
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys,
-                       const DataLayout *DL, raw_string_ostream &OS,
+                       const DataLayout *DL, raw_ostream &OS,
                        StringRef comment, StringRef varName, unsigned offset,
                        unsigned indent, unsigned arraySize,
                        unsigned sizeOfStruct = 0);
@@ -861,8 +861,8 @@ void PrintTypeAndName(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
                       DxilTypeSystem &typeSys, const DataLayout *DL,
-                      raw_string_ostream &OS, StringRef comment,
-                      unsigned offset, unsigned indent, unsigned offsetIndent,
+                      raw_ostream &OS, StringRef comment, unsigned offset,
+                      unsigned indent, unsigned offsetIndent,
                       unsigned sizeToPrint = 0) {
   if (Ty->isStructTy() && !annotation.HasMatrixAnnotation()) {
     PrintStructLayout(cast<StructType>(Ty), typeSys, DL, OS, comment,
@@ -931,7 +931,7 @@ void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 // null DataLayout => assume constant buffer layout
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys,
-                       const DataLayout *DL, raw_string_ostream &OS,
+                       const DataLayout *DL, raw_ostream &OS,
                        StringRef comment, StringRef varName, unsigned offset,
                        unsigned indent, unsigned offsetIndent,
                        unsigned sizeOfStruct) {
@@ -978,7 +978,7 @@ void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys,
 }
 
 void PrintStructBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
-                                 const DataLayout &DL, raw_string_ostream &OS,
+                                 const DataLayout &DL, raw_ostream &OS,
                                  StringRef comment) {
   const unsigned offsetIndent = 50;
 
@@ -1025,7 +1025,7 @@ void PrintStructBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
 }
 
 void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
-                            raw_string_ostream &OS, StringRef comment) {
+                            raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetHLSLType()->getPointerElementType();
   // For TextureBuffer<> buf[2], the array size is in Resource binding count
@@ -1051,7 +1051,7 @@ void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
 }
 
 void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
-                            raw_string_ostream &OS, StringRef comment) {
+                            raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetHLSLType()->getPointerElementType();
   // For ConstantBuffer<> buf[2], the array size is in Resource binding count
@@ -1077,8 +1077,7 @@ void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
   OS << comment << "\n";
 }
 
-void PrintBufferDefinitions(DxilModule &M, raw_string_ostream &OS,
-                            StringRef comment) {
+void PrintBufferDefinitions(DxilModule &M, raw_ostream &OS, StringRef comment) {
   OS << comment << "\n"
      << comment << " Buffer Definitions:\n"
      << comment << "\n";
@@ -1348,7 +1347,7 @@ public:
 void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
                                              const uint32_t uBufferSize,
                                              DXIL::ShaderKind shaderKind,
-                                             raw_string_ostream &OS,
+                                             raw_ostream &OS,
                                              StringRef comment) {
   OS << comment << "\n"
      << comment << " Pipeline Runtime Information: \n"
@@ -1627,11 +1626,53 @@ void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
 
   OS << comment << "\n";
 }
+
+// Loads the module to disassemble. A lazily loaded module has its metadata
+// but keeps function bodies in the bitcode until they are materialized.
+std::unique_ptr<Module> LoadModuleForDisassembly(StringRef IL,
+                                                 LLVMContext &Ctx, bool lazy) {
+  std::string DiagStr;
+  if (!lazy)
+    return dxilutil::LoadModuleFromBitcode(IL, Ctx, DiagStr);
+  std::unique_ptr<Module> pModule = dxilutil::LoadModuleFromBitcodeLazy(
+      MemoryBuffer::getMemBuffer(IL, "", /*RequiresNullTerminator*/ false),
+      Ctx, DiagStr);
+  if (pModule && pModule->materializeMetadata())
+    return nullptr;
+  return pModule;
+}
+
+// Parses the bodies of the functions named in the options and turns the
+// others into declarations, so that only the selected bodies are printed.
+HRESULT MaterializeSelectedFunctions(Module &M,
+                                     const DxcDisassembleOptions &options) {
+  StringSet<> names;
+  for (UINT32 i = 0; i < options.FunctionCount; ++i) {
+    if (options.pFunctionNames[i])
+      names.insert(options.pFunctionNames[i]);
+  }
+  for (Function &F : M) {
+    if (F.isMaterializable() && names.count(F.getName()) && F.materialize())
+      return DXC_E_IR_VERIFICATION_FAILED;
+  }
+  for (Function &F : M) {
+    if (F.isMaterializable())
+      F.setIsMaterializable(false);
+  }
+  return S_OK;
+}
 } // namespace
 
 namespace dxcutil {
 
-HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
+HRESULT Disassemble(IDxcBlob *pProgram, raw_ostream &Stream,
+                    const DxcDisassembleOptions *pOptions) {
+  const UINT32 sections =
+      pOptions ? pOptions->Sections : DxcDisassembleSection_All;
+  const bool filterFunctions = pOptions && pOptions->FunctionCount;
+  if (filterFunctions && !pOptions->pFunctionNames)
+    return E_INVALIDARG;
+
   CComPtr<IDxcBlob> pPdbContainerBlob;
   {
     CComPtr<IStream> pStream;
@@ -1655,7 +1696,7 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
 
     DxilPartIterator it = std::find_if(begin(pContainer), end(pContainer),
                                        DxilPartIsType(DFCC_FeatureInfo));
-    if (it != end(pContainer)) {
+    if (it != end(pContainer) && (sections & DxcDisassembleSection_Header)) {
       PrintFeatureInfo(
           reinterpret_cast<const DxilShaderFeatureInfo *>(GetDxilPartData(*it)),
           Stream, /*comment*/ ";");
@@ -1663,7 +1704,8 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
 
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_InputSignature));
-    if (it != end(pContainer)) {
+    if (it != end(pContainer) &&
+        (sections & DxcDisassembleSection_Signatures)) {
       PrintSignature(
           "Input",
           reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(*it)),
@@ -1671,7 +1713,8 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
     }
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_OutputSignature));
-    if (it != end(pContainer)) {
+    if (it != end(pContainer) &&
+        (sections & DxcDisassembleSection_Signatures)) {
       PrintSignature(
           "Output",
           reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(*it)),
@@ -1679,7 +1722,8 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
     }
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_PatchConstantSignature));
-    if (it != end(pContainer)) {
+    if (it != end(pContainer) &&
+        (sections & DxcDisassembleSection_Signatures)) {
       PrintSignature(
           "Patch Constant",
           reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(*it)),
@@ -1688,7 +1732,7 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
 
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_ShaderDebugName));
-    if (it != end(pContainer)) {
+    if (it != end(pContainer) && (sections & DxcDisassembleSection_Header)) {
       const char *pDebugName;
       if (!GetDxilShaderDebugName(*it, &pDebugName, nullptr)) {
         Stream << "; shader debug name present; corruption detected\n";
@@ -1699,7 +1743,7 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
 
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_ShaderHash));
-    if (it != end(pContainer)) {
+    if (it != end(pContainer) && (sections & DxcDisassembleSection_Header)) {
       const DxilShaderHash *pHashContent =
           reinterpret_cast<const DxilShaderHash *>(GetDxilPartData(*it));
       Stream << "; shader hash: ";
@@ -1732,7 +1776,8 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
 
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_PipelineStateValidation));
-    if (it != end(pContainer)) {
+    if (it != end(pContainer) &&
+        (sections & DxcDisassembleSection_RuntimeInfo)) {
       PrintPipelineStateValidationRuntimeInfo(
           GetDxilPartData(*it), (*it)->PartSize,
           GetVersionShaderType(pProgramHeader->ProgramVersion), Stream,
@@ -1769,13 +1814,28 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
     }
   }
 
+  const UINT32 moduleSections =
+      DxcDisassembleSection_Signatures | DxcDisassembleSection_Resources |
+      DxcDisassembleSection_ViewId | DxcDisassembleSection_Subobjects |
+      DxcDisassembleSection_Module;
+  if (!(sections & moduleSections)) {
+    Stream.flush();
+    return S_OK;
+  }
+
+  // Function bodies are only parsed if they are printed.
+  const bool lazy =
+      filterFunctions || !(sections & DxcDisassembleSection_Module);
   std::string DiagStr;
   llvm::LLVMContext llvmContext;
-  std::unique_ptr<llvm::Module> pModule(dxilutil::LoadModuleFromBitcode(
-      llvm::StringRef(pIL, pILLength), llvmContext, DiagStr));
+  std::unique_ptr<llvm::Module> pModule(LoadModuleForDisassembly(
+      llvm::StringRef(pIL, pILLength), llvmContext, lazy));
   if (pModule.get() == nullptr) {
     return DXC_E_IR_VERIFICATION_FAILED;
   }
+  if (filterFunctions) {
+    IFR(MaterializeSelectedFunctions(*pModule, *pOptions));
+  }
 
   std::unique_ptr<llvm::Module> pReflectionModule;
   if (pReflectionIL && pReflectionILLength) {
@@ -1793,7 +1853,8 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
         pReflectionModule.get() ? pReflectionModule->GetOrCreateDxilModule()
                                 : dxilModule;
 
-    if (!dxilModule.GetShaderModel()->IsLib()) {
+    if (!dxilModule.GetShaderModel()->IsLib() &&
+        (sections & DxcDisassembleSection_Signatures)) {
       PrintDxilSignature("Input", dxilModule.GetInputSignature(), Stream,
                          /*comment*/ ";");
       if (dxilModule.GetShaderModel()->IsMS()) {
@@ -1811,11 +1872,14 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
                            /*comment*/ ";");
       }
     }
-    PrintBufferDefinitions(dxilReflectionModule, Stream, /*comment*/ ";");
-    PrintResourceBindings(dxilReflectionModule, Stream, /*comment*/ ";");
-    PrintViewIdState(dxilReflectionModule, Stream, /*comment*/ ";");
+    if (sections & DxcDisassembleSection_Resources) {
+      PrintBufferDefinitions(dxilReflectionModule, Stream, /*comment*/ ";");
+      PrintResourceBindings(dxilReflectionModule, Stream, /*comment*/ ";");
+    }
+    if (sections & DxcDisassembleSection_ViewId)
+      PrintViewIdState(dxilReflectionModule, Stream, /*comment*/ ";");
 
-    if (pRDATPart) {
+    if (pRDATPart && (sections & DxcDisassembleSection_Subobjects)) {
       RDAT::DxilRuntimeData runtimeData(GetDxilPartData(pRDATPart),
                                         pRDATPart->PartSize);
       // TODO: Print the rest of the RDAT info
@@ -1826,12 +1890,15 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
         }
       }
     }
-    if (dxilModule.GetSubobjects()) {
+    if (dxilModule.GetSubobjects() &&
+        (sections & DxcDisassembleSection_Subobjects)) {
       PrintSubobjects(*dxilModule.GetSubobjects(), Stream, /*comment*/ ";");
     }
   }
-  DxcAssemblyAnnotationWriter w;
-  pModule->print(Stream, &w);
+  if (sections & DxcDisassembleSection_Module) {
+    DxcAssemblyAnnotationWriter w;
+    pModule->print(Stream, &w);
+  }
   // if (pReflectionModule) {
   //   Stream << "\n========== Reflection Module from STAT part ==========\n";
   //   pReflectionModule->print(Stream, &w);
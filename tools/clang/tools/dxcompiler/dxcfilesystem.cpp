@@ -208,8 +208,12 @@ private:
     CComPtr<IDxcBlobUtf8> Blob;
     CComPtr<IStream> BlobStream;
     std::wstring Name;
-    IncludedFile(std::wstring &&name, IDxcBlobUtf8 *pBlob, IStream *pStream)
-        : Blob(pBlob), BlobStream(pStream), Name(name) {}
+    // The blob the include handler returned, before conversion to UTF-8.
+    CComPtr<IDxcBlob> SourceBlob;
+    IncludedFile(std::wstring &&name, IDxcBlobUtf8 *pBlob, IStream *pStream,
+                 IDxcBlob *pSourceBlob = nullptr)
+        : Blob(pBlob), BlobStream(pStream), Name(name),
+          SourceBlob(pSourceBlob) {}
   };
   llvm::SmallVector<IncludedFile, 4> m_includedFiles;
 
@@ -275,8 +279,17 @@ private:
         return ERROR_UNHANDLED_EXCEPTION;
       }
       if (fileBlob.p != nullptr) {
+        // Include handlers that cache their blobs return the same one for
+        // every spelling of a file's name; convert it only once.
         CComPtr<IDxcBlobUtf8> fileBlobUtf8;
-        if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, DxcGetThreadMallocNoRef(),
+        for (const IncludedFile &file : m_includedFiles) {
+          if (file.SourceBlob == fileBlob) {
+            fileBlobUtf8 = file.Blob;
+            break;
+          }
+        }
+        if (fileBlobUtf8 == nullptr &&
+            FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, DxcGetThreadMallocNoRef(),
                                           &fileBlobUtf8, m_DefaultCodePage))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
@@ -285,7 +298,7 @@ private:
           return ERROR_UNHANDLED_EXCEPTION;
         }
         m_includedFiles.emplace_back(std::wstring(lpFileName), fileBlobUtf8,
-                                     fileStream);
+                                     fileStream, fileBlob);
         index = m_includedFiles.size() - 1;
 
         if (m_bDisplayIncludeProcess) {
@@ -20,11 +20,13 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "clang/Frontend/Utils.h"
 #include "clang/Lex/HLSLMacroExpander.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/SemaHLSL.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/ContentionProfiler.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -42,6 +44,7 @@
 #include "dxcutil.h"
 
 #include "dxc/Support/DxcLangExtensionsHelper.h"
+#include "dxc/Support/DxcMallocAccountant.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/HLSLOptions.h"
@@ -90,6 +93,14 @@ HRESULT RunInternalValidator(IDxcValidator *pValidator, llvm::Module *pModule,
                              llvm::Module *pDebugModule, IDxcBlob *pShader,
                              UINT32 Flags, IDxcOperationResult **ppResult);
 
+// Whether operator new allocates through the thread's IMalloc (see
+// DXCompiler.cpp), and so whether memory reports cover C++ allocations.
+#if defined(LLVM_ON_WIN32) && !defined(DXC_DISABLE_ALLOCATOR_OVERRIDES)
+static const bool kOperatorNewUsesThreadMalloc = true;
+#else
+static const bool kOperatorNewUsesThreadMalloc = false;
+#endif
+
 static bool ShouldBeCopiedIntoPDB(UINT32 FourCC) {
   switch (FourCC) {
   case hlsl::DFCC_ShaderDebugName:
@@ -440,16 +451,16 @@ public:
   }
 };
 
-static void CreateDefineStrings(const DxcDefine *pDefines, UINT defineCount,
+static void CreateDefineStrings(const hlsl::options::DxcDefines &Defines,
                                 std::vector<std::string> &defines) {
-  // Not very efficient but also not very important.
-  for (UINT32 i = 0; i < defineCount; i++) {
-    CW2A utf8Name(pDefines[i].Name);
-    CW2A utf8Value(pDefines[i].Value);
-    std::string val(utf8Name.m_psz);
-    val += "=";
-    val += (pDefines[i].Value) ? utf8Value.m_psz : "1";
-    defines.push_back(val);
+  // Use the UTF-8 NAME[=VALUE] strings from the command line directly rather
+  // than converting the wide DxcDefine values back.
+  defines.reserve(Defines.DefineStrings.size());
+  for (StringRef define : Defines.DefineStrings) {
+    if (define.find('=') == StringRef::npos)
+      defines.push_back((define + "=1").str());
+    else
+      defines.push_back(define.str());
   }
 }
 
@@ -464,7 +475,7 @@ static HRESULT ErrorWithString(const std::string &error, REFIID riid,
   return S_OK;
 }
 
-class DxcCompiler : public IDxcCompiler3,
+class DxcCompiler : public IDxcCompiler4,
                     public IDxcLangExtensions3,
                     public IDxcContainerEvent,
                     public IDxcVersionInfo3,
@@ -479,10 +490,12 @@ private:
   DxcLangExtensionsHelper m_langExtensionsHelper;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
   DxcCompilerAdapter m_DxcCompilerAdapter;
+  hlsl::options::DxcParsedArgsCache m_argsCache;
 
 public:
   DxcCompiler(IMalloc *pMalloc)
-      : m_dwRef(0), m_pMalloc(pMalloc), m_DxcCompilerAdapter(this, pMalloc) {}
+      : m_dwRef(0), m_pMalloc(pMalloc), m_DxcCompilerAdapter(this, pMalloc),
+        m_argsCache(hlsl::options::CompilerFlags) {}
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_ALLOC(DxcCompiler)
   DXC_LANGEXTENSIONS_HELPER_IMPL(m_langExtensionsHelper)
@@ -505,9 +518,10 @@ public:
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
                                            void **ppvObject) override {
-    HRESULT hr = DoBasicQueryInterface<IDxcCompiler3, IDxcLangExtensions,
-                                       IDxcLangExtensions2, IDxcLangExtensions3,
-                                       IDxcContainerEvent, IDxcVersionInfo
+    HRESULT hr = DoBasicQueryInterface<IDxcCompiler3, IDxcCompiler4,
+                                       IDxcLangExtensions, IDxcLangExtensions2,
+                                       IDxcLangExtensions3, IDxcContainerEvent,
+                                       IDxcVersionInfo
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
                                        ,
                                        IDxcVersionInfo2
@@ -549,16 +563,32 @@ public:
     bool bPreprocessStarted = false;
     DxilShaderHash ShaderHashContent;
     DxcThreadMalloc TM(m_pMalloc);
+    // Start from no phase, whatever an earlier call on this thread left.
+    DxcThreadMallocPhase compilePhase(DxcMallocPhase::Other);
 
     try {
       DefaultFPEnvScope fpEnvScope;
 
       IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
 
-      // Parse command-line options into DxcOpts
+      // Parse command-line options into DxcOpts. Argument lists seen before,
+      // including ones that only differ in their defines, reuse the earlier
+      // parse; parsedArgs owns the strings opts refers to.
+      // The cache lock is taken before the options say whether a contention
+      // report was requested, so it is recorded into a profile of its own
+      // that is kept if one was.
       int argCountInt;
       IFT(UIntToInt(argCount, &argCountInt));
-      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+      llvm::ContentionProfile argsContention;
+      std::shared_ptr<const hlsl::options::DxcParsedArgs> parsedArgs;
+      {
+        llvm::Optional<llvm::ContentionProfileScope> argsContentionScope;
+        if (!llvm::contentionProfilerEnabled())
+          argsContentionScope.emplace(argsContention);
+        parsedArgs =
+            m_argsCache.GetOrParse(::options::getHlslOptTable(),
+                                   llvm::makeArrayRef(pArguments, argCount));
+      }
       hlsl::options::DxcOpts opts;
       std::string warnings;
       raw_string_ostream w(warnings);
@@ -566,7 +596,7 @@ public:
         bool finished = false;
         CComPtr<AbstractMemoryStream> pOptionErrorStream;
         IFT(CreateMemoryStream(m_pMalloc, &pOptionErrorStream));
-        dxcutil::ReadOptsAndValidate(mainArgs, opts, pOptionErrorStream,
+        dxcutil::ReadOptsAndValidate(*parsedArgs, opts, pOptionErrorStream,
                                      &pDxcOperationResult, finished);
         if (finished) {
           IFT(pDxcOperationResult->QueryInterface(riid, ppResult));
@@ -579,6 +609,25 @@ public:
         }
       }
 
+      // Route the rest of the compile's allocations through an accountant if
+      // a memory report was requested.
+      CComPtr<DxcMallocAccountant> pMallocAccountant;
+      std::unique_ptr<DxcThreadMalloc> pAccountingTM;
+      if (!opts.MemoryReport.empty()) {
+        pMallocAccountant = DxcMallocAccountant::Alloc(m_pMalloc);
+        IFTBOOL(pMallocAccountant, E_OUTOFMEMORY);
+        pAccountingTM.reset(new DxcThreadMalloc(pMallocAccountant));
+      }
+
+      // Likewise record this thread's acquisitions of locks shared with
+      // other compiles if a contention report was requested.
+      std::unique_ptr<llvm::ContentionProfile> pContention;
+      std::unique_ptr<llvm::ContentionProfileScope> pContentionScope;
+      if (!opts.ContentionReport.empty()) {
+        pContention.reset(new llvm::ContentionProfile(argsContention));
+        pContentionScope.reset(new llvm::ContentionProfileScope(*pContention));
+      }
+
       bool isPreprocessing = !opts.Preprocess.empty();
       if (isPreprocessing) {
         DxcEtw_DXCompilerPreprocess_Start();
@@ -690,14 +739,15 @@ public:
       StringRef Data(utf8Source->GetStringPointer(),
                      utf8Source->GetStringLength());
 
-      // Not very efficient but also not very important.
       std::vector<std::string> defines;
-      CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+      CreateDefineStrings(opts.Defines, defines);
 
       // Setup a compiler instance.
       raw_stream_ostream outStream(pOutputStream.p);
-      llvm::LLVMContext
-          llvmContext; // LLVMContext should outlive CompilerInstance
+      // LLVMContext should outlive CompilerInstance
+      std::unique_ptr<llvm::LLVMContext> llvmContextOwner(
+          new llvm::LLVMContext());
+      llvm::LLVMContext &llvmContext = *llvmContextOwner;
       std::unique_ptr<llvm::Module> debugModule;
       CComPtr<AbstractMemoryStream> pReflectionStream;
       CompilerInstance compiler;
@@ -961,7 +1011,7 @@ public:
         // input file name.
         if (opts.DebugInfo) {
           opts.SpirvOptions.inputFile = opts.InputFile;
-          for (auto opt : mainArgs.getArrayRef()) {
+          for (auto opt : parsedArgs->getArrayRef()) {
             if (opts.InputFile.compare(opt) != 0) {
               opts.SpirvOptions.clOptions += " " + std::string(opt);
             }
@@ -1063,6 +1113,8 @@ public:
           } else {
             dxcutil::AssembleToContainer(inputs);
           }
+          if (opts.DiscardTeardown)
+            inputs.pM.release(); // Owned by the discarded context.
 
           // Callback after valid DXIL is produced
           if (SUCCEEDED(valHR)) {
@@ -1129,6 +1181,10 @@ public:
             IFT(pResult->SetOutputObject(DXC_OUT_SHADER_HASH, pHashBlob));
           } // SUCCEEDED(valHR)
         }   // compileOK && !opts.CodeGenHighLevel
+
+        // High-level and failed compiles leave the module with the action.
+        if (opts.DiscardTeardown)
+          action.takeModule().release(); // Owned by the discarded context.
       }
 
       std::string remarks;
@@ -1160,6 +1216,7 @@ public:
       // SPIRV change ends
 
       if (!hasErrorOccurred && writePDB) {
+        DxcThreadMallocPhase containerPhase(DxcMallocPhase::Container);
         CComPtr<IDxcBlob> pStrippedContainer;
         {
           // Create the shader source information for PDB
@@ -1168,9 +1225,9 @@ public:
           if (!opts.SourceInDebugModule) { // If we are using old PDB format
                                            // where sources are in debug module,
                                            // do not generate source info at all
-            debugSourceInfoWriter.Write(opts.TargetProfile, opts.EntryPoint,
-                                        compiler.getCodeGenOpts(),
-                                        compiler.getSourceManager());
+            debugSourceInfoWriter.Write(
+                opts.TargetProfile, opts.EntryPoint, compiler.getCodeGenOpts(),
+                compiler.getSourceManager(), opts.CompressSourcesPerFile);
             pSourceInfo = debugSourceInfoWriter.GetPart();
           }
 
@@ -1243,8 +1300,46 @@ public:
           compiler.getDiagnostics().getClient()->getNumErrors();
       IFT(pResult->SetStatusAndPrimaryResult(NumErrors > 0 ? E_FAIL : S_OK,
                                              primaryOutput.kind));
+
+      if (pMallocAccountant) {
+        // Stop accounting first so the report does not count (or lock
+        // against) its own allocations.
+        pAccountingTM.reset();
+        std::string MemoryReport;
+        raw_string_ostream OS(MemoryReport);
+        pMallocAccountant->WriteJson(OS, kOperatorNewUsesThreadMalloc);
+        OS.flush();
+        IFT(pResult->SetOutputString(DXC_OUT_MEMORY_REPORT,
+                                     MemoryReport.c_str(),
+                                     MemoryReport.size()));
+      }
+      if (pContention) {
+        pContentionScope.reset();
+        std::string ContentionReport;
+        raw_string_ostream OS(ContentionReport);
+        llvm::writeContentionProfile(
+            OS, *pContention, DxcMallocAccountant::kNumPhases,
+            [](unsigned phase) {
+              return DxcMallocAccountant::GetPhaseName((DxcMallocPhase)phase);
+            });
+        OS.flush();
+        IFT(pResult->SetOutputString(DXC_OUT_CONTENTION_REPORT,
+                                     ContentionReport.c_str(),
+                                     ContentionReport.size()));
+      }
       IFT(pResult->QueryInterface(riid, ppResult));
 
+      // All outputs are in pResult now. In discard mode, the IR is abandoned
+      // along with the AST (see DisableFree) instead of being destroyed one
+      // value at a time, and its memory is never freed: only callers that
+      // exit after compiling ask for this. The intrinsic tables the AST
+      // referenced were released when the AST was abandoned, so only memory
+      // outlives the compile.
+      if (opts.DiscardTeardown) {
+        debugModule.release(); // Owned by the discarded context.
+        BuryPointer(std::move(llvmContextOwner));
+      }
+
       hr = S_OK;
     } catch (std::bad_alloc &) {
       hr = E_OUTOFMEMORY;
@@ -1347,6 +1442,47 @@ public:
     return hr;
   }
 
+  HRESULT STDMETHODCALLTYPE
+  DisassembleToStream(const DxcBuffer *pObject,
+                      const DxcDisassembleOptions *pOptions,
+                      IStream *pOutput) override {
+    if (pObject == nullptr || pOutput == nullptr)
+      return E_INVALIDARG;
+
+    HRESULT hr = S_OK;
+    DxcEtw_DXCompilerDisassemble_Start();
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      DefaultFPEnvScope fpEnvScope;
+
+      ::llvm::sys::fs::MSFileSystem *msfPtr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      CComPtr<IDxcBlobEncoding> pProgram;
+      IFT(hlsl::DxcCreateBlob(pObject->Ptr, pObject->Size, true, false, false,
+                              0, nullptr, &pProgram))
+
+      raw_istream_ostream Stream(pOutput);
+      hr = dxcutil::Disassemble(pProgram, Stream, pOptions);
+      Stream.flush();
+      if (SUCCEEDED(hr))
+        hr = Stream.GetStatus();
+    } catch (std::bad_alloc &) {
+      hr = E_OUTOFMEMORY;
+    } catch (hlsl::Exception &e) {
+      assert(DXC_FAILED(e.hr));
+      hr = e.hr;
+    } catch (...) {
+      hr = E_FAIL;
+    }
+    DxcEtw_DXCompilerDisassemble_Stop(hr);
+    return hr;
+  }
+
   void SetupCompilerForCompile(CompilerInstance &compiler,
                                DxcLangExtensionsHelper *helper,
                                LPCSTR pMainFile,
@@ -1396,6 +1532,8 @@ public:
     compiler.getFrontendOpts().Inputs.push_back(
         FrontendInputFile(pMainFile, IK_HLSL));
     compiler.getFrontendOpts().ShowTimers = Opts.TimeReport ? 1 : 0;
+    compiler.getFrontendOpts().DisableFree = Opts.DiscardTeardown;
+    compiler.getCodeGenOpts().DisableFree = Opts.DiscardTeardown;
     // Setup debug information.
     if (Opts.GenerateFullDebugInfo()) {
       CodeGenOptions &CGOpts = compiler.getCodeGenOpts();
@@ -44,6 +44,7 @@
 #include <algorithm>
 #include <codecvt>
 #include <locale>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -286,15 +287,22 @@ private:
 
   DXC_MICROCOM_TM_REF_FIELDS()
 
+  // Source contents are only turned into blobs when GetSource asks for them.
+  // Until then, a source points at its null-terminated content in
+  // m_PdbInfoData, or at its entry in m_pSourceInfoReader.
   struct Source_File {
     CComPtr<IDxcBlobWide> Name;
     CComPtr<IDxcBlobEncoding> Content;
+    const char *pPendingContent = nullptr;
+    int PendingSourceInfoIndex = -1;
   };
 
   CComPtr<IDxcBlob> m_InputBlob;
   CComPtr<IDxcBlob> m_pDebugProgramBlob;
   CComPtr<IDxcBlob> m_ContainerBlob;
   std::vector<Source_File> m_SourceFiles;
+  std::vector<char> m_PdbInfoData;
+  std::unique_ptr<hlsl::SourceInfoReader> m_pSourceInfoReader;
 
   CComPtr<IDxcBlobWide> m_EntryPoint;
   CComPtr<IDxcBlobWide> m_TargetProfile;
@@ -306,11 +314,6 @@ private:
   hlsl::DxilCompilerVersion m_VersionInfo;
   std::string m_VersionCommitSha;
   std::string m_VersionString;
-  CComPtr<IDxcResult> m_pCachedRecompileResult;
-
-  // NOTE: This is not set to null by Reset() since it doesn't
-  // necessarily change across different PDBs.
-  CComPtr<IDxcCompiler3> m_pCompiler;
 
   struct ArgPair {
     CComPtr<IDxcBlobWide> Name;
@@ -347,6 +350,8 @@ private:
     m_InputBlob = nullptr;
     m_ContainerBlob = nullptr;
     m_SourceFiles.clear();
+    m_PdbInfoData.clear();
+    m_pSourceInfoReader.reset();
     m_Name = nullptr;
     m_MainFileName = nullptr;
     m_HashBlob = nullptr;
@@ -354,7 +359,6 @@ private:
     m_VersionInfo = {};
     m_VersionCommitSha.clear();
     m_VersionString.clear();
-    m_pCachedRecompileResult = nullptr;
     m_LibraryPdbs.clear();
     m_customToolchainData = nullptr;
     ResetAllArgs();
@@ -413,13 +417,21 @@ private:
     return ret;
   }
 
+  HRESULT CreateSourceContentBlob(StringRef content,
+                                  IDxcBlobEncoding **ppResult) {
+    return hlsl::DxcCreateBlob(content.data(), content.size(),
+                               /*bPinned*/ false, /*bCopy*/ true,
+                               /*encodingKnown*/ true, CP_UTF8, m_pMalloc,
+                               ppResult);
+  }
+
   HRESULT AddSource(StringRef name, StringRef content) {
     Source_File source;
-    IFR(hlsl::DxcCreateBlob(content.data(), content.size(),
-                            /*bPinned*/ false, /*bCopy*/ true,
-                            /*encodingKnown*/ true, CP_UTF8, m_pMalloc,
-                            &source.Content));
+    IFR(CreateSourceContentBlob(content, &source.Content));
+    return AddSourceFile(name, std::move(source));
+  }
 
+  HRESULT AddSourceFile(StringRef name, Source_File &&source) {
     std::string normalizedPath = hlsl::NormalizePath(name);
     IFR(Utf8ToBlobWide(normalizedPath, &source.Name));
     // First file is the main file
@@ -439,20 +451,24 @@ private:
 
     hlsl::RDAT::DxilRuntimeData reader;
 
-    SmallVector<char, 1024> UncompressedBuffer;
+    // Sources are read from the part data when they are asked for, so the
+    // decompressed data is kept until the next Reset. Uncompressed data is
+    // read in place from m_ContainerBlob.
+    if (!m_PdbInfoData.empty())
+      return E_FAIL;
     const void *ptr = nullptr;
     size_t size = 0;
     if (header->CompressionType ==
         hlsl::DxilShaderPDBInfoCompressionType::Zlib) {
-      UncompressedBuffer.resize(header->UncompressedSizeInBytes);
+      m_PdbInfoData.resize(header->UncompressedSizeInBytes);
       if (hlsl::ZlibResult::Success !=
           hlsl::ZlibDecompress(DxcGetThreadMallocNoRef(), header + 1,
-                               header->SizeInBytes, UncompressedBuffer.data(),
-                               UncompressedBuffer.size())) {
+                               header->SizeInBytes, m_PdbInfoData.data(),
+                               m_PdbInfoData.size())) {
         return E_FAIL;
       }
-      ptr = UncompressedBuffer.data();
-      size = UncompressedBuffer.size();
+      ptr = m_PdbInfoData.data();
+      size = m_PdbInfoData.size();
     } else if (header->CompressionType ==
                hlsl::DxilShaderPDBInfoCompressionType::Uncompressed) {
       assert(header->UncompressedSizeInBytes == header->SizeInBytes);
@@ -470,12 +486,13 @@ private:
     return LoadFromPdbInfoReader(pdbInfo);
   }
 
+  // The memory behind reader must stay alive until the next Reset.
   HRESULT LoadFromPdbInfoReader(hlsl::RDAT::DxilPdbInfo_Reader &reader) {
     auto sources = reader.getSources();
     for (size_t i = 0; i < sources.Count(); i++) {
-      const char *name = sources[i].getName();
-      const char *content = sources[i].getContent();
-      IFR(AddSource(name, content));
+      Source_File source;
+      source.pPendingContent = sources[i].getContent();
+      IFR(AddSourceFile(sources[i].getName(), std::move(source)));
     }
 
     if (reader.sizeWholeDxil()) {
@@ -702,7 +719,10 @@ private:
       case hlsl::DFCC_ShaderSourceInfo: {
         const hlsl::DxilSourceInfo *header =
             (const hlsl::DxilSourceInfo *)(part + 1);
-        hlsl::SourceInfoReader reader;
+        // The reader points into m_ContainerBlob, which is kept until the
+        // next Reset.
+        m_pSourceInfoReader.reset(new hlsl::SourceInfoReader());
+        hlsl::SourceInfoReader &reader = *m_pSourceInfoReader;
         if (!reader.Init(header, part->PartSize)) {
           Reset();
           return E_FAIL;
@@ -716,8 +736,9 @@ private:
 
         // Sources
         for (unsigned i = 0; i < reader.GetSourcesCount(); i++) {
-          hlsl::SourceInfoReader::Source source_data = reader.GetSource(i);
-          IFR(AddSource(source_data.Name, source_data.Content));
+          Source_File source;
+          source.PendingSourceInfoIndex = i;
+          IFR(AddSourceFile(reader.GetSourceName(i), std::move(source)));
         }
 
       } break;
@@ -934,7 +955,24 @@ public:
     if (!ppResult)
       return E_POINTER;
     *ppResult = nullptr;
-    return m_SourceFiles[uIndex].Content.QueryInterface(ppResult);
+
+    Source_File &source = m_SourceFiles[uIndex];
+    if (!source.Content) {
+      try {
+        DxcThreadMalloc TM(m_pMalloc);
+        StringRef content;
+        if (source.pPendingContent) {
+          content = source.pPendingContent;
+        } else if (source.PendingSourceInfoIndex >= 0) {
+          if (!m_pSourceInfoReader->GetSourceContent(
+                  source.PendingSourceInfoIndex, &content))
+            return E_FAIL;
+        }
+        IFR(CreateSourceContentBlob(content, &source.Content));
+      }
+      CATCH_CPP_RETURN_HRESULT();
+    }
+    return source.Content.QueryInterface(ppResult);
   }
 
   virtual HRESULT STDMETHODCALLTYPE
@@ -1143,15 +1181,17 @@ public:
       return E_INVALIDARG;
 
     LibraryEntry &Entry = m_LibraryPdbs[uIndex];
+    CComPtr<DxcPdbUtils> pNewPdbUtils = DxcPdbUtils::Alloc(m_pMalloc);
+    pNewPdbUtils->m_PdbInfoData = Entry.PdbInfo;
+
     hlsl::RDAT::DxilRuntimeData rdat;
-    if (!rdat.InitFromRDAT(Entry.PdbInfo.data(), Entry.PdbInfo.size()))
+    if (!rdat.InitFromRDAT(pNewPdbUtils->m_PdbInfoData.data(),
+                           pNewPdbUtils->m_PdbInfoData.size()))
       return E_FAIL;
     if (rdat.GetDxilPdbInfoTable().Count() != 1)
       return E_FAIL;
 
     auto reader = rdat.GetDxilPdbInfoTable()[0];
-
-    CComPtr<DxcPdbUtils> pNewPdbUtils = DxcPdbUtils::Alloc(m_pMalloc);
     IFR(pNewPdbUtils->LoadFromPdbInfoReader(reader));
     pNewPdbUtils.QueryInterface(ppOutPdbUtils);
 
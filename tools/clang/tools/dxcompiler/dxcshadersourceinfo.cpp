@@ -158,69 +158,42 @@ bool SourceInfoReader::Init(const hlsl::DxilSourceInfo *SourceInfo,
           sectionSizeInBytes)
         return false;
 
-      const hlsl::DxilSourceInfo_SourceContentsEntry *firstEntry = nullptr;
-      if (header->CompressType ==
-          hlsl::DxilSourceInfo_SourceContentsCompressType::Zlib) {
-        m_UncompressedSources.resize(header->UncompressedEntriesSizeInBytes);
-        {
-          bool bDecompressSucc =
-              hlsl::ZlibResult::Success ==
-              ZlibDecompress(DxcGetThreadMallocNoRef(), header + 1,
-                             header->EntriesSizeInBytes,
-                             m_UncompressedSources.data(),
-                             m_UncompressedSources.size());
-          assert(bDecompressSucc);
-          if (!bDecompressSucc)
-            return false;
-        }
-        if (m_UncompressedSources.size() !=
-            header->UncompressedEntriesSizeInBytes)
-          return false;
-        firstEntry = (const hlsl::DxilSourceInfo_SourceContentsEntry *)
-                         m_UncompressedSources.data();
-      } else {
+      switch (header->CompressType) {
+      case hlsl::DxilSourceInfo_SourceContentsCompressType::None:
         if (header->EntriesSizeInBytes !=
             header->UncompressedEntriesSizeInBytes)
           return false;
-        if (PointerByteOffset(header + 1, section) +
-                header->UncompressedEntriesSizeInBytes >
-            sectionSizeInBytes)
+        break;
+      case hlsl::DxilSourceInfo_SourceContentsCompressType::Zlib:
+        break;
+      case hlsl::DxilSourceInfo_SourceContentsCompressType::ZlibPerEntry: {
+        // Validate the index now so that loading an entry later only has to
+        // check what it decompressed.
+        const size_t indexSizeInBytes =
+            (size_t)header->Count *
+            sizeof(hlsl::DxilSourceInfo_SourceContentsIndexEntry);
+        if (indexSizeInBytes > header->EntriesSizeInBytes)
           return false;
-        firstEntry =
-            (const hlsl::DxilSourceInfo_SourceContentsEntry *)(header + 1);
+        const size_t dataSizeInBytes =
+            header->EntriesSizeInBytes - indexSizeInBytes;
+        const hlsl::DxilSourceInfo_SourceContentsIndexEntry *index =
+            (const hlsl::DxilSourceInfo_SourceContentsIndexEntry *)(header +
+                                                                    1);
+        for (unsigned i = 0; i < header->Count; i++) {
+          if (index[i].Offset > dataSizeInBytes ||
+              index[i].CompressedSizeInBytes >
+                  dataSizeInBytes - index[i].Offset)
+            return false;
+        }
+      } break;
+      default:
+        return false;
       }
 
       assert(m_Sources.size() == 0 || m_Sources.size() == header->Count);
       m_Sources.resize(header->Count);
-
-      const hlsl::DxilSourceInfo_SourceContentsEntry *entry = firstEntry;
-      for (unsigned i = 0; i < header->Count; i++) {
-        if (PointerByteOffset(entry + 1, firstEntry) >
-            header->UncompressedEntriesSizeInBytes)
-          return false;
-        if (PointerByteOffset(entry + 1, firstEntry) +
-                entry->ContentSizeInBytes >
-            header->UncompressedEntriesSizeInBytes)
-          return false;
-        if (PointerByteOffset(entry, firstEntry) + entry->AlignedSizeInBytes >
-            header->UncompressedEntriesSizeInBytes)
-          return false;
-
-        const void *ptr = entry + 1;
-        if (entry->ContentSizeInBytes > 0) {
-          // Fail if not null terminated
-          if (((const char *)ptr)[entry->ContentSizeInBytes - 1] != '\0')
-            return false;
-          llvm::StringRef content = {
-              (const char *)ptr,
-              entry->ContentSizeInBytes - 1,
-          };
-          m_Sources[i].Content = content;
-        }
-
-        entry = (const hlsl::DxilSourceInfo_SourceContentsEntry
-                     *)((const uint8_t *)entry + entry->AlignedSizeInBytes);
-      }
+      m_pContents = header;
+      m_bContentsLoaded = false;
     } break;
     }
     section =
@@ -231,6 +204,118 @@ bool SourceInfoReader::Init(const hlsl::DxilSourceInfo *SourceInfo,
   return true;
 }
 
+// Checks the content entry at the start of [entry, entry + sizeInBytes) and
+// returns its content in *pContent.
+static bool
+ReadContentEntry(const hlsl::DxilSourceInfo_SourceContentsEntry *entry,
+                 size_t sizeInBytes, llvm::StringRef *pContent) {
+  if (sizeof(*entry) > sizeInBytes)
+    return false;
+  if (sizeof(*entry) + entry->ContentSizeInBytes > sizeInBytes)
+    return false;
+  if (entry->AlignedSizeInBytes > sizeInBytes)
+    return false;
+
+  *pContent = llvm::StringRef();
+  const char *ptr = (const char *)(entry + 1);
+  if (entry->ContentSizeInBytes > 0) {
+    // Fail if not null terminated
+    if (ptr[entry->ContentSizeInBytes - 1] != '\0')
+      return false;
+    *pContent = {ptr, entry->ContentSizeInBytes - 1};
+  }
+  return true;
+}
+
+bool SourceInfoReader::LoadAllContents() {
+  const hlsl::DxilSourceInfo_SourceContents *header = m_pContents;
+  const hlsl::DxilSourceInfo_SourceContentsEntry *firstEntry = nullptr;
+  if (header->CompressType ==
+      hlsl::DxilSourceInfo_SourceContentsCompressType::Zlib) {
+    m_UncompressedSources.resize(header->UncompressedEntriesSizeInBytes);
+    {
+      bool bDecompressSucc =
+          hlsl::ZlibResult::Success ==
+          ZlibDecompress(DxcGetThreadMallocNoRef(), header + 1,
+                         header->EntriesSizeInBytes,
+                         m_UncompressedSources.data(),
+                         m_UncompressedSources.size());
+      assert(bDecompressSucc);
+      if (!bDecompressSucc)
+        return false;
+    }
+    firstEntry = (const hlsl::DxilSourceInfo_SourceContentsEntry *)
+                     m_UncompressedSources.data();
+  } else {
+    firstEntry = (const hlsl::DxilSourceInfo_SourceContentsEntry *)(header + 1);
+  }
+
+  const hlsl::DxilSourceInfo_SourceContentsEntry *entry = firstEntry;
+  for (unsigned i = 0; i < header->Count; i++) {
+    const size_t entryOffset = PointerByteOffset(entry, firstEntry);
+    if (entryOffset > header->UncompressedEntriesSizeInBytes)
+      return false;
+    if (!ReadContentEntry(entry,
+                          header->UncompressedEntriesSizeInBytes - entryOffset,
+                          &m_Sources[i].Content))
+      return false;
+    m_Sources[i].ContentLoaded = true;
+
+    entry = (const hlsl::DxilSourceInfo_SourceContentsEntry
+                 *)((const uint8_t *)entry + entry->AlignedSizeInBytes);
+  }
+
+  m_bContentsLoaded = true;
+  return true;
+}
+
+bool SourceInfoReader::LoadContentEntry(unsigned i) {
+  const hlsl::DxilSourceInfo_SourceContents *header = m_pContents;
+  const hlsl::DxilSourceInfo_SourceContentsIndexEntry *index =
+      (const hlsl::DxilSourceInfo_SourceContentsIndexEntry *)(header + 1);
+  const uint8_t *data = (const uint8_t *)(index + header->Count);
+
+  Source &source = m_Sources[i];
+  source.UncompressedContent.resize(index[i].UncompressedSizeInBytes);
+  bool bDecompressSucc =
+      hlsl::ZlibResult::Success ==
+      ZlibDecompress(DxcGetThreadMallocNoRef(), data + index[i].Offset,
+                     index[i].CompressedSizeInBytes,
+                     source.UncompressedContent.data(),
+                     source.UncompressedContent.size());
+  assert(bDecompressSucc);
+  if (!bDecompressSucc)
+    return false;
+
+  if (!ReadContentEntry((const hlsl::DxilSourceInfo_SourceContentsEntry *)
+                            source.UncompressedContent.data(),
+                        source.UncompressedContent.size(), &source.Content))
+    return false;
+  source.ContentLoaded = true;
+  return true;
+}
+
+bool SourceInfoReader::GetSourceContent(unsigned i,
+                                        llvm::StringRef *pContent) {
+  assert(i < m_Sources.size());
+  Source &source = m_Sources[i];
+  if (!source.ContentLoaded) {
+    // A part without a contents section has no content for any source.
+    if (!m_pContents) {
+      source.ContentLoaded = true;
+    } else if (m_pContents->CompressType ==
+               hlsl::DxilSourceInfo_SourceContentsCompressType::ZlibPerEntry) {
+      if (!LoadContentEntry(i))
+        return false;
+    } else if (!m_bContentsLoaded) {
+      if (!LoadAllContents())
+        return false;
+    }
+  }
+  *pContent = source.Content;
+  return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Writer
 ///////////////////////////////////////////////////////////////////////////////
@@ -298,6 +383,41 @@ static void FinishSection(Buffer *buf, const size_t sectionOffset,
   memcpy(buf->data() + sectionOffset, &sectionHeader, sizeof(sectionHeader));
 }
 
+// Appends the index and the separately compressed entries of the
+// ZlibPerEntry layout. On failure, buf is left unchanged.
+static bool
+AppendEntriesCompressedPerEntry(Buffer *buf, const Buffer &uncompressedBuffer,
+                                llvm::ArrayRef<size_t> entryOffsets) {
+  const size_t indexOffset = buf->size();
+  std::vector<hlsl::DxilSourceInfo_SourceContentsIndexEntry> index(
+      entryOffsets.size());
+  Append(buf, index.data(), index.size() * sizeof(index[0]));
+
+  const size_t dataOffset = buf->size();
+  for (unsigned i = 0; i < entryOffsets.size(); i++) {
+    const size_t entryEnd = i + 1 < entryOffsets.size()
+                                ? entryOffsets[i + 1]
+                                : uncompressedBuffer.size();
+    const size_t entrySize = entryEnd - entryOffsets[i];
+    const size_t compressedOffset = buf->size();
+    if (hlsl::ZlibResult::Success !=
+        ZlibCompressAppend(DxcGetThreadMallocNoRef(),
+                           uncompressedBuffer.data() + entryOffsets[i],
+                           entrySize, *buf)) {
+      buf->resize(indexOffset);
+      return false;
+    }
+    index[i].Offset = compressedOffset - dataOffset;
+    index[i].CompressedSizeInBytes = buf->size() - compressedOffset;
+    index[i].UncompressedSizeInBytes = entrySize;
+  }
+
+  // Go back and write the index now that the sizes are known.
+  memcpy(buf->data() + indexOffset, index.data(),
+         index.size() * sizeof(index[0]));
+  return true;
+}
+
 struct SourceFile {
   std::string Name;
   llvm::StringRef Content;
@@ -344,7 +464,8 @@ static std::vector<SourceFile> ComputeFileList(clang::CodeGenOptions &cgOpts,
 void SourceInfoWriter::Write(llvm::StringRef targetProfile,
                              llvm::StringRef entryPoint,
                              clang::CodeGenOptions &cgOpts,
-                             clang::SourceManager &srcMgr) {
+                             clang::SourceManager &srcMgr,
+                             bool bCompressPerFile) {
   m_Buffer.clear();
 
   // Write an empty header first.
@@ -405,8 +526,10 @@ void SourceInfoWriter::Write(llvm::StringRef targetProfile,
 
     // Put all the contents in a buffer
     Buffer uncompressedBuffer;
+    std::vector<size_t> entryOffsets;
     for (unsigned i = 0; i < sourceFileList.size(); i++) {
       SourceFile &file = sourceFileList[i];
+      entryOffsets.push_back(uncompressedBuffer.size());
       AppendFileContentEntry(&uncompressedBuffer, file.Content);
     }
 
@@ -420,17 +543,25 @@ void SourceInfoWriter::Write(llvm::StringRef targetProfile,
     Append(&m_Buffer, &header, sizeof(header));
 
     const size_t sizeBeforeCompress = m_Buffer.size();
-    bool bCompressed =
-        hlsl::ZlibResult::Success ==
-        ZlibCompressAppend(DxcGetThreadMallocNoRef(), uncompressedBuffer.data(),
-                           uncompressedBuffer.size(), m_Buffer);
+    bool bCompressed = false;
+    if (bCompressPerFile) {
+      bCompressed = AppendEntriesCompressedPerEntry(
+          &m_Buffer, uncompressedBuffer, entryOffsets);
+      header.CompressType =
+          hlsl::DxilSourceInfo_SourceContentsCompressType::ZlibPerEntry;
+    } else {
+      bCompressed = hlsl::ZlibResult::Success ==
+                    ZlibCompressAppend(DxcGetThreadMallocNoRef(),
+                                       uncompressedBuffer.data(),
+                                       uncompressedBuffer.size(), m_Buffer);
+      header.CompressType =
+          hlsl::DxilSourceInfo_SourceContentsCompressType::Zlib;
+    }
 
     // If we compressed the content, go back to rewrite the header to write the
     // correct size in bytes.
     if (bCompressed) {
       header.EntriesSizeInBytes = m_Buffer.size() - sizeBeforeCompress;
-      header.CompressType =
-          hlsl::DxilSourceInfo_SourceContentsCompressType::Zlib;
       memcpy(m_Buffer.data() + headerOffset, &header, sizeof(header));
     }
     // Otherwise, just write the whole uncompressed
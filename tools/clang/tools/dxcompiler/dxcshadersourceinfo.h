@@ -23,6 +23,10 @@ class SourceManager;
 namespace hlsl {
 
 // TODO: Move this type to its own library.
+//
+// Init only reads the names, the args and the layout of the contents. The
+// contents are decompressed the first time one of them is asked for, and
+// with the ZlibPerEntry layout only the requested file is decompressed.
 struct SourceInfoReader {
   using Buffer = std::vector<uint8_t>;
   Buffer m_UncompressedSources;
@@ -30,6 +34,8 @@ struct SourceInfoReader {
   struct Source {
     llvm::StringRef Name;
     llvm::StringRef Content;
+    bool ContentLoaded = false;
+    Buffer UncompressedContent; // Only used by the ZlibPerEntry layout.
   };
 
   struct ArgPair {
@@ -39,15 +45,25 @@ struct SourceInfoReader {
 
   std::vector<Source> m_Sources;
   std::vector<ArgPair> m_ArgPairs;
+  const hlsl::DxilSourceInfo_SourceContents *m_pContents = nullptr;
+  bool m_bContentsLoaded = false;
 
-  Source GetSource(unsigned i) const { return m_Sources[i]; }
+  llvm::StringRef GetSourceName(unsigned i) const { return m_Sources[i].Name; }
   unsigned GetSourcesCount() const { return m_Sources.size(); }
 
+  // Decompresses the contents of source i if needed. Returns false if the
+  // contents are malformed.
+  bool GetSourceContent(unsigned i, llvm::StringRef *pContent);
+
   const ArgPair &GetArgPair(unsigned i) const { return m_ArgPairs[i]; }
   unsigned GetArgPairCount() const { return m_ArgPairs.size(); }
 
   // Note: The memory for SourceInfo must outlive this structure.
   bool Init(const hlsl::DxilSourceInfo *SourceInfo, unsigned sourceInfoSize);
+
+private:
+  bool LoadAllContents();
+  bool LoadContentEntry(unsigned i);
 };
 
 // Herper for writing the shader source part.
@@ -56,8 +72,10 @@ struct SourceInfoWriter {
   Buffer m_Buffer;
 
   const hlsl::DxilSourceInfo *GetPart() const;
+  // If bCompressPerFile is set, the contents use the ZlibPerEntry layout.
   void Write(llvm::StringRef targetProfile, llvm::StringRef entryPoint,
-             clang::CodeGenOptions &cgOpts, clang::SourceManager &srcMgr);
+             clang::CodeGenOptions &cgOpts, clang::SourceManager &srcMgr,
+             bool bCompressPerFile = false);
 };
 
 } // namespace hlsl
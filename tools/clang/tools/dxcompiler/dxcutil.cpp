@@ -28,6 +28,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
@@ -109,6 +110,8 @@ void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor,
 }
 
 void AssembleToContainer(AssembleInputs &inputs) {
+  DxcThreadMallocPhase containerPhase(DxcMallocPhase::Container);
+  llvm::TimeTraceScope TimeScope("AssembleContainer", StringRef(""));
   CComPtr<AbstractMemoryStream> pContainerStream;
   IFT(CreateMemoryStream(inputs.pMalloc, &pContainerStream));
   if (!(inputs.SerializeFlags & SerializeDxilFlags::StripRootSignature) &&
@@ -134,14 +137,11 @@ void AssembleToContainer(AssembleInputs &inputs) {
   IFT(pContainerStream.QueryInterface(&inputs.pOutputContainerBlob));
 }
 
-void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
-                         hlsl::options::DxcOpts &opts,
-                         AbstractMemoryStream *pOutputStream,
-                         IDxcOperationResult **ppResult, bool &finished) {
-  const llvm::opt::OptTable *table = ::options::getHlslOptTable();
-  raw_stream_ostream outStream(pOutputStream);
-  if (0 != hlsl::options::ReadDxcOpts(table, hlsl::options::CompilerFlags,
-                                      mainArgs, opts, outStream)) {
+static void ValidateReadOpts(int readResult, hlsl::options::DxcOpts &opts,
+                             raw_stream_ostream &outStream,
+                             AbstractMemoryStream *pOutputStream,
+                             IDxcOperationResult **ppResult, bool &finished) {
+  if (0 != readResult) {
     CComPtr<IDxcBlob> pErrorBlob;
     IFT(pOutputStream->QueryInterface(&pErrorBlob));
     outStream.flush();
@@ -159,7 +159,33 @@ void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
   finished = false;
 }
 
+void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
+                         hlsl::options::DxcOpts &opts,
+                         AbstractMemoryStream *pOutputStream,
+                         IDxcOperationResult **ppResult, bool &finished) {
+  const llvm::opt::OptTable *table = ::options::getHlslOptTable();
+  raw_stream_ostream outStream(pOutputStream);
+  int readResult = hlsl::options::ReadDxcOpts(
+      table, hlsl::options::CompilerFlags, mainArgs, opts, outStream);
+  ValidateReadOpts(readResult, opts, outStream, pOutputStream, ppResult,
+                   finished);
+}
+
+void ReadOptsAndValidate(const hlsl::options::DxcParsedArgs &parsedArgs,
+                         hlsl::options::DxcOpts &opts,
+                         AbstractMemoryStream *pOutputStream,
+                         IDxcOperationResult **ppResult, bool &finished) {
+  DXASSERT(parsedArgs.GetFlagsToInclude() == hlsl::options::CompilerFlags,
+           "else arguments were parsed for a different tool");
+  raw_stream_ostream outStream(pOutputStream);
+  int readResult = hlsl::options::ReadDxcOpts(parsedArgs, opts, outStream);
+  ValidateReadOpts(readResult, opts, outStream, pOutputStream, ppResult,
+                   finished);
+}
+
 HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
+  DxcThreadMallocPhase validationPhase(DxcMallocPhase::Validation);
+  llvm::TimeTraceScope TimeScope("Validation", StringRef(""));
   HRESULT valHR = S_OK;
 
   // If we have debug info, this will be a clone of the module before debug info
@@ -28,7 +28,7 @@ namespace llvm {
 class LLVMContext;
 class MemoryBuffer;
 class Module;
-class raw_string_ostream;
+class raw_ostream;
 class Twine;
 } // namespace llvm
 
@@ -82,11 +82,16 @@ void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor,
                          hlsl::options::ValidatorSelection SelectValidator =
                              hlsl::options::ValidatorSelection::Auto);
 void AssembleToContainer(AssembleInputs &inputs);
-HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
+HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_ostream &Stream,
+                    const DxcDisassembleOptions *pOptions = nullptr);
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
                          hlsl::options::DxcOpts &opts,
                          hlsl::AbstractMemoryStream *pOutputStream,
                          IDxcOperationResult **ppResult, bool &finished);
+void ReadOptsAndValidate(const hlsl::options::DxcParsedArgs &parsedArgs,
+                         hlsl::options::DxcOpts &opts,
+                         hlsl::AbstractMemoryStream *pOutputStream,
+                         IDxcOperationResult **ppResult, bool &finished);
 void CreateOperationResultFromOutputs(
     DXC_OUT_KIND resultKind, UINT32 textEncoding, IDxcBlob *pResultBlob,
     CComPtr<IStream> &pErrorStream, const std::string &warnings,
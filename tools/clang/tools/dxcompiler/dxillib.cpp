@@ -12,7 +12,9 @@
 #include "dxillib.h"
 #include "dxc/Support/Global.h" // For DXASSERT
 #include "dxc/Support/dxcapi.use.h"
+#include "llvm/Support/ContentionProfiler.h"
 #include "llvm/Support/Mutex.h"
+#include <atomic>
 
 using namespace dxc;
 
@@ -21,12 +23,18 @@ static HRESULT g_DllLibResult = S_OK;
 
 static llvm::sys::Mutex *cs = nullptr;
 
+// Set once loading dxil.dll has succeeded or failed. Neither changes until
+// cleanup, so DxilLibIsEnabled can then answer without taking cs, which every
+// compile that validates would otherwise serialize on.
+static std::atomic<bool> g_DllLibSettled(false);
+
 // Check if we can successfully get IDxcValidator from dxil.dll
 // This function is to prevent multiple attempts to load dxil.dll
 HRESULT DxilLibInitialize() {
   cs = new llvm::sys::Mutex;
   cs->lock();
   g_DllLibResult = g_DllSupport.InitializeForDll(kDxilLib, "DxcCreateInstance");
+  g_DllLibSettled.store(true, std::memory_order_release);
   cs->unlock();
   return S_OK;
 }
@@ -40,6 +48,7 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
   } else {
     hr = E_INVALIDARG;
   }
+  g_DllLibSettled.store(false, std::memory_order_relaxed);
   delete cs;
   cs = nullptr;
   return hr;
@@ -49,13 +58,16 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
 // If we fail to load dxil.dll, set g_DllLibResult to E_FAIL so that we don't
 // have multiple attempts to load dxil.dll
 bool DxilLibIsEnabled() {
-  cs->lock();
+  if (g_DllLibSettled.load(std::memory_order_acquire))
+    return SUCCEEDED(g_DllLibResult);
+  llvm::lockProfiled(*cs, llvm::ContentionSite::DxilLibrary);
   if (SUCCEEDED(g_DllLibResult)) {
     if (!g_DllSupport.IsEnabled()) {
       g_DllLibResult =
           g_DllSupport.InitializeForDll(kDxilLib, "DxcCreateInstance");
     }
   }
+  g_DllLibSettled.store(true, std::memory_order_release);
   cs->unlock();
   return SUCCEEDED(g_DllLibResult);
 }
@@ -64,10 +76,9 @@ HRESULT DxilLibCreateInstance(REFCLSID rclsid, REFIID riid,
                               IUnknown **ppInterface) {
   DXASSERT_NOMSG(ppInterface != nullptr);
   HRESULT hr = E_FAIL;
-  if (DxilLibIsEnabled()) {
-    cs->lock();
+  // Once DxilLibIsEnabled has returned, the loaded module does not change
+  // until cleanup and its DxcCreateInstance is free-threaded.
+  if (DxilLibIsEnabled())
     hr = g_DllSupport.CreateInstance(rclsid, riid, ppInterface);
-    cs->unlock();
-  }
   return hr;
 }
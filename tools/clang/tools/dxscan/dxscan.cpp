@@ -0,0 +1,513 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxscan.cpp                                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxscan console program, which summarizes //
+// every DXIL container under a set of files and directories.                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilContainerReader.h"
+#include "dxc/DxilContainer/DxilPipelineStateValidation.h"
+#include "dxc/DxilContainer/DxilRuntimeReflection.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+static cl::opt<bool> Help("help", cl::desc("Print help"));
+static cl::alias Help_h("h", cl::aliasopt(Help));
+static cl::alias Help_q("?", cl::aliasopt(Help));
+
+static cl::list<std::string> Inputs(cl::Positional, cl::OneOrMore,
+                                    cl::desc("<input files or directories>"));
+
+static cl::opt<std::string> OutputFilename("o",
+                                           cl::desc("Override output filename"),
+                                           cl::value_desc("filename"));
+
+static cl::opt<bool>
+    JsonLines("jsonl", cl::desc("Write JSON Lines instead of CSV"),
+              cl::init(false));
+
+static cl::list<std::string>
+    Extensions("ext", cl::CommaSeparated,
+               cl::desc("File extensions to scan in directories "
+                        "(default: cso,dxil)"),
+               cl::value_desc("ext,..."));
+
+static cl::opt<unsigned>
+    Threads("j", cl::desc("Number of worker threads (default: all cores)"),
+            cl::value_desc("n"), cl::init(0));
+
+namespace {
+
+// One row of output. Fields are filled in as far as the container allows;
+// a file that is not a container only gets Path, Size and Status.
+struct ScanResult {
+  std::string Path;
+  uint64_t Size = 0;
+  std::string Status;
+  std::string ContainerHash;
+  std::string ShaderHash;
+  std::string ShaderKind;
+  std::string ShaderModel;
+  std::string DxilVersion;
+  std::string EntryName;
+  uint64_t FeatureFlags = 0;
+  uint32_t PartCount = 0;
+  uint32_t PSVVersion = 0;
+  bool HasPSV = false;
+  uint32_t Resources = 0;
+  uint32_t CBVs = 0;
+  uint32_t Samplers = 0;
+  uint32_t SRVs = 0;
+  uint32_t UAVs = 0;
+  bool HasRDAT = false;
+  uint32_t RDATFunctions = 0;
+  uint32_t RDATResources = 0;
+  uint32_t RDATSubobjects = 0;
+};
+
+const char *ShaderKindName(unsigned Kind) {
+  static const char *Names[] = {
+      "pixel",         "vertex",   "geometry",     "hull",
+      "domain",        "compute",  "library",      "raygeneration",
+      "intersection",  "anyhit",   "closesthit",   "miss",
+      "callable",      "mesh",     "amplification", "node"};
+  static_assert(_countof(Names) == (unsigned)DXIL::ShaderKind::Invalid,
+                "otherwise shader kind names need updating");
+  return Kind < _countof(Names) ? Names[Kind] : "invalid";
+}
+
+std::string HexDigest(const uint8_t *pDigest, size_t Size) {
+  static const char Digits[] = "0123456789abcdef";
+  std::string Result;
+  Result.reserve(Size * 2);
+  for (size_t i = 0; i < Size; ++i) {
+    Result.push_back(Digits[pDigest[i] >> 4]);
+    Result.push_back(Digits[pDigest[i] & 0xf]);
+  }
+  return Result;
+}
+
+void ScanPSV(const void *pData, uint32_t Size, ScanResult &R) {
+  DxilPipelineStateValidation PSV;
+  if (!PSV.InitFromPSV0(pData, Size)) {
+    R.Status = "invalid PSV0 part";
+    return;
+  }
+  R.HasPSV = true;
+  R.PSVVersion = PSV.GetPSVRuntimeInfo3()   ? 3
+                 : PSV.GetPSVRuntimeInfo2() ? 2
+                 : PSV.GetPSVRuntimeInfo1() ? 1
+                                            : 0;
+  if (R.ShaderKind.empty() && PSV.GetPSVRuntimeInfo1())
+    R.ShaderKind = ShaderKindName(PSV.GetPSVRuntimeInfo1()->ShaderStage);
+  if (PSVRuntimeInfo3 *pInfo3 = PSV.GetPSVRuntimeInfo3()) {
+    const PSVStringTable &Strings = PSV.GetStringTable();
+    if (pInfo3->EntryFunctionName < Strings.Size &&
+        Strings.Table[Strings.Size - 1] == '\0')
+      R.EntryName = Strings.Get(pInfo3->EntryFunctionName);
+  }
+
+  R.Resources = PSV.GetBindCount();
+  for (uint32_t i = 0; i < R.Resources; ++i) {
+    switch ((PSVResourceType)PSV.GetPSVResourceBindInfo0(i)->ResType) {
+    case PSVResourceType::CBV:
+      ++R.CBVs;
+      break;
+    case PSVResourceType::Sampler:
+      ++R.Samplers;
+      break;
+    case PSVResourceType::SRVTyped:
+    case PSVResourceType::SRVRaw:
+    case PSVResourceType::SRVStructured:
+      ++R.SRVs;
+      break;
+    case PSVResourceType::UAVTyped:
+    case PSVResourceType::UAVRaw:
+    case PSVResourceType::UAVStructured:
+    case PSVResourceType::UAVStructuredWithCounter:
+      ++R.UAVs;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void ScanRDAT(const void *pData, uint32_t Size, ScanResult &R) {
+  RDAT::DxilRuntimeData RDAT;
+  if (!RDAT.InitFromRDAT(pData, Size) || !RDAT.Validate()) {
+    R.Status = "invalid RDAT part";
+    return;
+  }
+  R.HasRDAT = true;
+  R.RDATFunctions = RDAT.GetFunctionTable().Count();
+  R.RDATResources = RDAT.GetResourceTable().Count();
+  R.RDATSubobjects = RDAT.GetSubobjectTable().Count();
+}
+
+// Summarizes one container from its parts. The DXIL part contributes only
+// its program header; the bitcode that follows it is never read.
+void ScanContainer(const void *pData, uint32_t Size, ScanResult &R) {
+  DxilContainerReader Reader;
+  if (FAILED(Reader.Load(pData, Size))) {
+    R.Status = "not a DXIL container";
+    return;
+  }
+  R.ContainerHash = HexDigest(((const DxilContainerHeader *)pData)->Hash.Digest,
+                              DxilContainerHashSize);
+  IFT(Reader.GetPartCount(&R.PartCount));
+
+  for (uint32_t i = 0; i < R.PartCount; ++i) {
+    uint32_t FourCC;
+    const void *pPart;
+    uint32_t PartSize;
+    IFT(Reader.GetPartFourCC(i, &FourCC));
+    IFT(Reader.GetPartContent(i, &pPart, &PartSize));
+    switch (FourCC) {
+    case DFCC_ShaderHash:
+      if (PartSize >= sizeof(DxilShaderHash))
+        R.ShaderHash = HexDigest(((const DxilShaderHash *)pPart)->Digest,
+                                 DxilContainerHashSize);
+      break;
+    case DFCC_FeatureInfo:
+      if (PartSize >= sizeof(DxilShaderFeatureInfo))
+        R.FeatureFlags = ((const DxilShaderFeatureInfo *)pPart)->FeatureFlags;
+      break;
+    case DFCC_DXIL: {
+      const DxilProgramHeader *pHeader = (const DxilProgramHeader *)pPart;
+      if (!IsValidDxilProgramHeader(pHeader, PartSize))
+        break;
+      uint32_t ProgramVersion = pHeader->ProgramVersion;
+      R.ShaderKind =
+          ShaderKindName((unsigned)GetVersionShaderType(ProgramVersion));
+      R.ShaderModel = std::to_string(GetVersionMajor(ProgramVersion)) + "." +
+                      std::to_string(GetVersionMinor(ProgramVersion));
+      uint32_t DxilVersion = pHeader->BitcodeHeader.DxilVersion;
+      R.DxilVersion = std::to_string(DXIL::GetDxilVersionMajor(DxilVersion)) +
+                      "." +
+                      std::to_string(DXIL::GetDxilVersionMinor(DxilVersion));
+      break;
+    }
+    case DFCC_PipelineStateValidation:
+      ScanPSV(pPart, PartSize, R);
+      break;
+    case DFCC_RuntimeData:
+      ScanRDAT(pPart, PartSize, R);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void ScanFile(ScanResult &R) {
+  try {
+    CComPtr<IDxcBlobEncoding> pBlob;
+    std::wstring WidePath = Unicode::UTF8ToWideStringOrThrow(R.Path.c_str());
+    HRESULT hr = DxcCreateBlobFromMappedFile(DxcGetThreadMallocNoRef(),
+                                             WidePath.c_str(), &pBlob);
+    if (FAILED(hr)) {
+      char Buffer[64];
+      sprintf_s(Buffer, _countof(Buffer), "unable to map file (0x%08x)",
+                (unsigned)hr);
+      R.Status = Buffer;
+      return;
+    }
+    R.Size = pBlob->GetBufferSize();
+    if (R.Size > UINT32_MAX) {
+      R.Status = "file too large";
+      return;
+    }
+    ScanContainer(pBlob->GetBufferPointer(), (uint32_t)R.Size, R);
+  } catch (const hlsl::Exception &E) {
+    R.Status = E.what();
+    if (R.Status.empty()) {
+      char Buffer[32];
+      sprintf_s(Buffer, _countof(Buffer), "error: 0x%08x", (unsigned)E.hr);
+      R.Status = Buffer;
+    }
+  } catch (const std::bad_alloc &) {
+    R.Status = "out of memory";
+  }
+  if (R.Status.empty())
+    R.Status = "ok";
+}
+
+bool HasScannedExtension(StringRef Path) {
+  StringRef Ext = sys::path::extension(Path);
+  if (Ext.empty())
+    return false;
+  Ext = Ext.drop_front();
+  if (Extensions.empty())
+    return Ext.equals_lower("cso") || Ext.equals_lower("dxil");
+  for (const std::string &Allowed : Extensions)
+    if (Ext.equals_lower(Allowed))
+      return true;
+  return false;
+}
+
+// Expands the command-line inputs into a list of files. Files named
+// explicitly are always scanned; directories are walked recursively and
+// filtered by extension.
+void CollectFiles(std::vector<ScanResult> &Results) {
+  for (const std::string &Input : Inputs) {
+    bool IsDirectory = false;
+    if (!sys::fs::is_directory(Input, IsDirectory) && IsDirectory) {
+      size_t First = Results.size();
+      std::error_code EC;
+      for (sys::fs::recursive_directory_iterator I(Input, EC), E;
+           I != E && !EC; I.increment(EC)) {
+        const std::string &Path = I->path();
+        bool IsFile = false;
+        if (!sys::fs::is_regular_file(Path, IsFile) && IsFile &&
+            HasScannedExtension(Path)) {
+          Results.emplace_back();
+          Results.back().Path = Path;
+        }
+      }
+      if (EC)
+        fprintf(stderr, "warning: unable to walk '%s': %s\n", Input.c_str(),
+                EC.message().c_str());
+      // Sort for output that does not depend on directory enumeration order.
+      std::sort(Results.begin() + First, Results.end(),
+                [](const ScanResult &A, const ScanResult &B) {
+                  return A.Path < B.Path;
+                });
+    } else {
+      Results.emplace_back();
+      Results.back().Path = Input;
+    }
+  }
+}
+
+void ScanFiles(std::vector<ScanResult> &Results) {
+  unsigned NumThreads = Threads;
+  if (NumThreads == 0)
+    NumThreads = std::max(1u, std::thread::hardware_concurrency());
+  NumThreads = std::min<size_t>(NumThreads, Results.size());
+
+  std::atomic<size_t> Next(0);
+  auto Worker = [&]() {
+    DxcThreadMalloc TM(nullptr);
+    for (size_t i = Next++; i < Results.size(); i = Next++)
+      ScanFile(Results[i]);
+  };
+
+  std::vector<std::thread> Workers;
+  for (unsigned i = 1; i < NumThreads; ++i)
+    Workers.emplace_back(Worker);
+  Worker();
+  for (std::thread &T : Workers)
+    T.join();
+}
+
+void WriteCsvString(raw_ostream &OS, StringRef Value) {
+  if (Value.find_first_of(",\"\r\n") == StringRef::npos) {
+    OS << Value;
+    return;
+  }
+  OS << '"';
+  for (char C : Value) {
+    if (C == '"')
+      OS << '"';
+    OS << C;
+  }
+  OS << '"';
+}
+
+void WriteJsonString(raw_ostream &OS, StringRef Value) {
+  OS << '"';
+  for (unsigned char C : Value) {
+    switch (C) {
+    case '"':
+      OS << "\\\"";
+      break;
+    case '\\':
+      OS << "\\\\";
+      break;
+    case '\n':
+      OS << "\\n";
+      break;
+    case '\r':
+      OS << "\\r";
+      break;
+    case '\t':
+      OS << "\\t";
+      break;
+    default:
+      if (C < 0x20)
+        OS << format("\\u%04x", C);
+      else
+        OS << C;
+      break;
+    }
+  }
+  OS << '"';
+}
+
+const char *Columns[] = {
+    "path",           "size",        "status",        "container_hash",
+    "shader_hash",    "shader_kind", "shader_model",  "dxil_version",
+    "entry",          "feature_flags", "parts",       "psv_version",
+    "resources",      "cbv",         "sampler",       "srv",
+    "uav",            "rdat_functions", "rdat_resources", "rdat_subobjects"};
+
+void WriteResult(raw_ostream &OS, const ScanResult &R) {
+  std::string Flags;
+  raw_string_ostream(Flags) << format_hex(R.FeatureFlags, 18);
+
+  // Counts that come from a missing part are written as empty fields (CSV)
+  // or null (JSON) rather than zero.
+  std::string Values[_countof(Columns)] = {
+      R.Path,
+      std::to_string(R.Size),
+      R.Status,
+      R.ContainerHash,
+      R.ShaderHash,
+      R.ShaderKind,
+      R.ShaderModel,
+      R.DxilVersion,
+      R.EntryName,
+      R.ContainerHash.empty() ? "" : Flags,
+      R.ContainerHash.empty() ? "" : std::to_string(R.PartCount),
+      R.HasPSV ? std::to_string(R.PSVVersion) : "",
+      R.HasPSV ? std::to_string(R.Resources) : "",
+      R.HasPSV ? std::to_string(R.CBVs) : "",
+      R.HasPSV ? std::to_string(R.Samplers) : "",
+      R.HasPSV ? std::to_string(R.SRVs) : "",
+      R.HasPSV ? std::to_string(R.UAVs) : "",
+      R.HasRDAT ? std::to_string(R.RDATFunctions) : "",
+      R.HasRDAT ? std::to_string(R.RDATResources) : "",
+      R.HasRDAT ? std::to_string(R.RDATSubobjects) : ""};
+  // Columns written as JSON numbers rather than strings.
+  static const bool IsNumber[_countof(Columns)] = {
+      false, true, false, false, false, false, false, false, false, false,
+      true,  true, true,  true,  true,  true,  true,  true,  true,  true};
+
+  if (!JsonLines) {
+    for (unsigned i = 0; i < _countof(Columns); ++i) {
+      if (i)
+        OS << ',';
+      WriteCsvString(OS, Values[i]);
+    }
+    OS << '\n';
+    return;
+  }
+
+  OS << '{';
+  for (unsigned i = 0; i < _countof(Columns); ++i) {
+    if (i)
+      OS << ',';
+    OS << '"' << Columns[i] << "\":";
+    if (Values[i].empty())
+      OS << "null";
+    else if (IsNumber[i])
+      OS << Values[i];
+    else
+      WriteJsonString(OS, Values[i]);
+  }
+  OS << "}\n";
+}
+
+} // namespace
+
+#ifdef _WIN32
+int __cdecl main(int argc, char **argv) {
+#else
+int main(int argc, const char **argv) {
+#endif
+  if (llvm::sys::fs::SetupPerThreadFileSystem())
+    return 1;
+  llvm::sys::fs::AutoCleanupPerThreadFileSystem auto_cleanup_fs;
+  if (FAILED(DxcInitThreadMalloc()))
+    return 1;
+  DxcSetThreadMallocToDefault();
+
+  const char *pStage = "Operation";
+  try {
+    llvm::sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    pStage = "Argument processing";
+    cl::ParseCommandLineOptions(argc, argv, "dxil container scanner\n");
+    if (Help) {
+      cl::PrintHelpMessage();
+      return 2;
+    }
+
+    pStage = "Collecting files";
+    std::vector<ScanResult> Results;
+    CollectFiles(Results);
+
+    pStage = "Scanning";
+    ScanFiles(Results);
+
+    pStage = "Writing output";
+    std::string Output;
+    raw_string_ostream OS(Output);
+    if (!JsonLines) {
+      for (unsigned i = 0; i < _countof(Columns); ++i)
+        OS << (i ? "," : "") << Columns[i];
+      OS << '\n';
+    }
+    for (const ScanResult &R : Results)
+      WriteResult(OS, R);
+    OS.flush();
+    if (OutputFilename.empty()) {
+      fwrite(Output.data(), 1, Output.size(), stdout);
+    } else {
+      std::wstring WideOutput =
+          Unicode::UTF8ToWideStringOrThrow(OutputFilename.c_str());
+      IFT(WriteBinaryFile(WideOutput.c_str(), Output.data(),
+                          (DWORD)Output.size()));
+    }
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg == nullptr || *msg == '\0')
+      printf("%s failed - error code 0x%08x.\n", pStage, hlslException.hr);
+    else
+      printf("%s\n", msg);
+    return 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    return 1;
+  } catch (...) {
+    printf("%s failed - unknown error.\n", pStage);
+    return 1;
+  }
+
+  return 0;
+}
@@ -1441,6 +1441,18 @@ HRESULT DxcTranslationUnit::Reparse(IDxcUnsavedFile **unsaved_files,
       SetupUnsavedFiles(unsaved_files, num_unsaved_files, &local_unsaved_files);
   if (FAILED(hr))
     return hr;
+
+  // Included files are read again on reparse, so provide the same file system
+  // that the translation unit was parsed with.
+  ::llvm::sys::fs::MSFileSystem *msfPtr;
+  hr = CreateMSFileSystemForDisk(&msfPtr);
+  if (FAILED(hr)) {
+    CleanupUnsavedFiles(local_unsaved_files, num_unsaved_files);
+    return hr;
+  }
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+
   int reparseResult =
       clang_reparseTranslationUnit(m_tu, num_unsaved_files, local_unsaved_files,
                                    clang_defaultReparseOptions(m_tu));
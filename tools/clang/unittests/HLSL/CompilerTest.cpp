@@ -47,6 +47,7 @@
 #include "dxc/Test/DxcTestUtils.h"
 
 #include "llvm/Support/raw_os_ostream.h"
+#include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/microcom.h"
@@ -152,6 +153,7 @@ public:
   TEST_METHOD(CompileWhenEmptyThenFails)
   TEST_METHOD(CompileWhenIncorrectThenFails)
   TEST_METHOD(CompileWhenWorksThenDisassembleWorks)
+  TEST_METHOD(CompileWhenWorksThenDisassembleToStreamWorks)
   TEST_METHOD(CompileWhenDebugWorksThenStripDebug)
   TEST_METHOD(CompileWhenWorksThenAddRemovePrivate)
   TEST_METHOD(CompileThenAddCustomDebugName)
@@ -162,6 +164,7 @@ public:
   TEST_METHOD(CompileThenTestPdbUtilsStripped)
   TEST_METHOD(CompileThenTestPdbUtilsEmptyEntry)
   TEST_METHOD(CompileThenTestPdbUtilsRelativePath)
+  TEST_METHOD(CompileThenTestPdbUtilsPerFileCompressedSources)
   TEST_METHOD(CompileSameFilenameAndEntryThenTestPdbUtilsArgs)
   TEST_METHOD(CompileWithRootSignatureThenStripRootSignature)
   TEST_METHOD(CompileThenSetRootSignatureThenValidate)
@@ -184,6 +187,7 @@ public:
 
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
+  TEST_METHOD(CompileWhenIncludeBlobRepeatedThenReadEach)
   TEST_METHOD(CompileWhenIncludeAbsoluteThenLoadAbsolute)
   TEST_METHOD(CompileWhenIncludeLocalThenLoadRelative)
   TEST_METHOD(CompileWhenIncludeSystemThenLoadNotRelative)
@@ -195,6 +199,8 @@ public:
   TEST_METHOD(CompileThenCheckDisplayIncludeProcess)
   TEST_METHOD(CompileThenPrintTimeReport)
   TEST_METHOD(CompileThenPrintTimeTrace)
+  TEST_METHOD(CompileThenPrintMemoryReport)
+  TEST_METHOD(CompileThenPrintContentionReport)
   TEST_METHOD(CompileWhenIncludeMissingThenFail)
   TEST_METHOD(CompileWhenIncludeHasPathThenOK)
   TEST_METHOD(CompileWhenIncludeEmptyThenOK)
@@ -913,6 +919,65 @@ TEST_F(CompilerTest, CompileWhenWorksThenDisassembleWorks) {
   // WEX::Logging::Log::Comment(disassembleStringW.m_psz);
 }
 
+static std::string DisassembleToString(IDxcCompiler4 *pCompiler,
+                                       IDxcBlob *pProgram,
+                                       const DxcDisassembleOptions *pOptions) {
+  CComPtr<IMalloc> pMalloc;
+  VERIFY_SUCCEEDED(DxcCoGetMalloc(1, &pMalloc));
+  CComPtr<hlsl::AbstractMemoryStream> pStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pStream));
+  DxcBuffer buf = {pProgram->GetBufferPointer(), pProgram->GetBufferSize(), 0};
+  VERIFY_SUCCEEDED(pCompiler->DisassembleToStream(&buf, pOptions, pStream));
+  return std::string((const char *)pStream->GetPtr(), pStream->GetPtrSize());
+}
+
+TEST_F(CompilerTest, CompileWhenWorksThenDisassembleToStreamWorks) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("export float Foo(float x) { return x * 2; }\n"
+                     "export float Bar(float x) { return x + 1; }",
+                     &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"",
+                                      L"lib_6_3", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  CComPtr<IDxcBlobEncoding> pDisassembleBlob;
+  VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pDisassembleBlob));
+  std::string disassembleString(BlobToUtf8(pDisassembleBlob));
+
+  CComPtr<IDxcCompiler4> pCompiler4;
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler4));
+
+  // Without options the text is the same as from Disassemble.
+  std::string streamString =
+      DisassembleToString(pCompiler4, pProgram, nullptr);
+  VERIFY_ARE_EQUAL_STR(disassembleString.c_str(), streamString.c_str());
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, streamString.find("?Foo@@"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, streamString.find("?Bar@@"));
+
+  // Only the body of Foo is printed; Bar is left as a declaration.
+  LPCSTR names[] = {"\01?Foo@@YAMM@Z"};
+  DxcDisassembleOptions options = {DxcDisassembleSection_Module, 1, names};
+  streamString = DisassembleToString(pCompiler4, pProgram, &options);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       streamString.find("define float @\"\\01?Foo@@YAMM@Z\""));
+  VERIFY_ARE_NOT_EQUAL(
+      std::string::npos,
+      streamString.find("declare float @\"\\01?Bar@@YAMM@Z\"(float)"));
+  VERIFY_ARE_EQUAL(std::string::npos, streamString.find("; shader hash:"));
+
+  // Container sections only, without the module.
+  options = {DxcDisassembleSection_Header, 0, nullptr};
+  streamString = DisassembleToString(pCompiler4, pProgram, &options);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, streamString.find("; shader hash:"));
+  VERIFY_ARE_EQUAL(std::string::npos, streamString.find("define "));
+}
+
 TEST_F(CompilerTest, CompileWhenDebugWorksThenStripDebug) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2073,6 +2138,56 @@ TEST_F(CompilerTest, CompileThenTestPdbUtilsRelativePath) {
   VERIFY_SUCCEEDED(pPdbUtils->Load(pPdb));
 }
 
+TEST_F(CompilerTest, CompileThenTestPdbUtilsPerFileCompressedSources) {
+  std::string main_source = R"x(
+      #include "helper.h"
+      float4 main() : SV_Target {
+        return ZERO;
+      }
+  )x";
+
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  const WCHAR *args[] = {L"/Tps_6_0", L"/Zs", L"/Qsource_compress_per_file",
+                         L"source.hlsl"};
+
+  CComPtr<TestIncludeHandler> pInclude;
+  std::string included_File = "#define ZERO 0";
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(included_File.c_str());
+
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pInclude, IID_PPV_ARGS(&pResult)));
+
+  CComPtr<IDxcBlob> pPdb;
+  VERIFY_SUCCEEDED(
+      pResult->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(&pPdb), nullptr));
+
+  CComPtr<IDxcPdbUtils2> pPdbUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcPdbUtils, &pPdbUtils));
+  VERIFY_SUCCEEDED(pPdbUtils->Load(pPdb));
+
+  UINT32 uSourceCount = 0;
+  VERIFY_SUCCEEDED(pPdbUtils->GetSourceCount(&uSourceCount));
+  VERIFY_ARE_EQUAL(uSourceCount, 2u);
+
+  // Read the included file first, so it is decompressed on its own.
+  CComPtr<IDxcBlobEncoding> pIncludedContent;
+  VERIFY_SUCCEEDED(pPdbUtils->GetSource(1, &pIncludedContent));
+  VERIFY_ARE_EQUAL(BlobToUtf8(pIncludedContent), included_File);
+
+  CComPtr<IDxcBlobEncoding> pMainContent;
+  VERIFY_SUCCEEDED(pPdbUtils->GetSource(0, &pMainContent));
+  VERIFY_ARE_EQUAL(BlobToUtf8(pMainContent), main_source);
+}
+
 TEST_F(CompilerTest, CompileSameFilenameAndEntryThenTestPdbUtilsArgs) {
   // This is a regression test for a bug where if entry point has the same
   // value as the input filename, the entry point gets omitted from the arg
@@ -2882,6 +2997,51 @@ TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
                         pInclude->GetAllFileNames().c_str());
 }
 
+// Returns the same blob for every file name, like a handler with a cache.
+class SameBlobIncludeHandler : public IDxcIncludeHandler {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  CComPtr<IDxcBlob> Blob;
+  unsigned CallCount = 0;
+  SameBlobIncludeHandler(IDxcBlob *pBlob) : m_dwRef(0), Blob(pBlob) {}
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+  HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename,
+                                       IDxcBlob **ppIncludeSource) override {
+    ++CallCount;
+    return Blob.QueryInterface(ppIncludeSource);
+  }
+};
+
+TEST_F(CompilerTest, CompileWhenIncludeBlobRepeatedThenReadEach) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlobEncoding> pHeader;
+  CComPtr<SameBlobIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("#include \"one.h\"\r\n"
+                     "#include \"two.h\"\r\n"
+                     "float4 main() : SV_Target { return ONE + TWO; }",
+                     &pSource);
+  // The header is converted once and read from the start under both names.
+  MultiByteStringToBlob(m_dllSupport,
+                        "#ifndef ONE\n#define ONE 1\n#else\n#define TWO 2\n"
+                        "#endif\n",
+                        CP_ACP, &pHeader);
+  pInclude = new SameBlobIncludeHandler(pHeader);
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL(2u, pInclude->CallCount);
+}
+
 static std::wstring NormalizeForPlatform(const std::wstring &s) {
 #ifdef _WIN32
   wchar_t From = L'/';
@@ -3454,6 +3614,100 @@ TEST_F(CompilerTest, CompileThenPrintTimeTrace) {
   VERIFY_ARE_NOT_EQUAL(string::npos, text.find("{ \"traceEvents\": ["));
 }
 
+TEST_F(CompilerTest, CompileThenPrintMemoryReport) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0.0; }", &pSource);
+
+  LPCWSTR args[] = {L"-fmemory-report"};
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args), nullptr,
+                                      0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+
+  CComPtr<IDxcResult> pCompileResult;
+  CComPtr<IDxcBlob> pReportBlob;
+  pResult->QueryInterface(&pCompileResult);
+  VERIFY_SUCCEEDED(pCompileResult->GetOutput(
+      DXC_OUT_MEMORY_REPORT, IID_PPV_ARGS(&pReportBlob), nullptr));
+  std::string text(BlobToUtf8(pReportBlob));
+
+  VERIFY_ARE_EQUAL(0u, text.find("{ \"includesOperatorNew\": "));
+  for (const char *phase :
+       {"other", "parse", "sema", "codegen", "hl-passes", "dxil-passes",
+        "validation", "container"}) {
+    std::string entry = std::string("{ \"name\": \"") + phase + "\"";
+    VERIFY_ARE_NOT_EQUAL(string::npos, text.find(entry));
+  }
+
+  // Where operator new goes through the compile's IMalloc, the front end
+  // phases must have been charged for their allocations.
+  if (text.find("{ \"includesOperatorNew\": true") == 0) {
+    for (const char *phase : {"parse", "codegen"}) {
+      std::string entry =
+          std::string("{ \"name\": \"") + phase + "\", \"allocations\": ";
+      size_t pos = text.find(entry);
+      VERIFY_ARE_NOT_EQUAL(string::npos, pos);
+      VERIFY_ARE_NOT_EQUAL(0ul, strtoul(text.c_str() + pos + entry.size(),
+                                        nullptr, 10));
+    }
+  }
+
+  // Without the option, there is no report.
+  pResult.Release();
+  pCompileResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  pResult->QueryInterface(&pCompileResult);
+  VERIFY_IS_FALSE(pCompileResult->HasOutput(DXC_OUT_MEMORY_REPORT));
+}
+
+TEST_F(CompilerTest, CompileThenPrintContentionReport) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0.0; }", &pSource);
+
+  LPCWSTR args[] = {L"-fcontention-report"};
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args), nullptr,
+                                      0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+
+  CComPtr<IDxcResult> pCompileResult;
+  CComPtr<IDxcBlob> pReportBlob;
+  pResult->QueryInterface(&pCompileResult);
+  VERIFY_SUCCEEDED(pCompileResult->GetOutput(
+      DXC_OUT_CONTENTION_REPORT, IID_PPV_ARGS(&pReportBlob), nullptr));
+  std::string text(BlobToUtf8(pReportBlob));
+
+  VERIFY_ARE_EQUAL(0u, text.find("{ \"sites\": ["));
+  for (const char *site :
+       {"managed-static", "pass-registry", "dxil-library", "args-cache"}) {
+    std::string entry = std::string("{ \"name\": \"") + site + "\"";
+    VERIFY_ARE_NOT_EQUAL(string::npos, text.find(entry));
+  }
+
+  // Without the option, there is no report.
+  pResult.Release();
+  pCompileResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  pResult->QueryInterface(&pCompileResult);
+  VERIFY_IS_FALSE(pCompileResult->HasOutput(DXC_OUT_CONTENTION_REPORT));
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeMissingThenFail) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
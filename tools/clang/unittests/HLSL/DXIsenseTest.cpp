@@ -106,6 +106,7 @@ protected:
 
   TEST_METHOD(InclusionWhenMissingThenError)
   TEST_METHOD(InclusionWhenValidThenAvailable)
+  TEST_METHOD(InclusionWhenPrecompiledPreambleThenBodiesSkipped)
 
   TEST_METHOD(TUWhenGetFileMissingThenFail)
   TEST_METHOD(TUWhenGetFilePresentThenOK)
@@ -288,6 +289,48 @@ TEST_F(DXIntellisenseTest, InclusionWhenValidThenAvailable) {
   }
 }
 
+TEST_F(DXIntellisenseTest, InclusionWhenPrecompiledPreambleThenBodiesSkipped) {
+  const char main_text[] = "#include \"inc.h\"\r\n"
+                           "float4 main() : SV_Target { return foo(); }";
+  const char unsaved_text[] = "float4 foo() { return undeclared; }";
+  const char main_text_edited[] =
+      "#include \"inc.h\"\r\n"
+      "float4 main() : SV_Target { return foo() + undeclared; }";
+  DxcTranslationUnitFlags optionsList[] = {
+      DxcTranslationUnitFlags_UseCallerThread,
+      (DxcTranslationUnitFlags)(DxcTranslationUnitFlags_UseCallerThread |
+                                DxcTranslationUnitFlags_PrecompiledPreamble)};
+  // Errors within the included body are only reported when it is parsed, but
+  // errors in the main file always are, including after a reparse.
+  unsigned expectedDiagCounts[] = {1U, 0U};
+  for (unsigned i = 0; i < _countof(optionsList); ++i) {
+    CComPtr<IDxcIntelliSense> isense;
+    CComPtr<IDxcIndex> index;
+    CComPtr<IDxcUnsavedFile> unsaved[2];
+    CComPtr<IDxcTranslationUnit> TU;
+    unsigned diagCount;
+    VERIFY_SUCCEEDED(
+        CompilationResult::DefaultHlslSupport->CreateIntellisense(&isense));
+    VERIFY_SUCCEEDED(isense->CreateIndex(&index));
+    VERIFY_SUCCEEDED(isense->CreateUnsavedFile(
+        "./inc.h", unsaved_text, strlen(unsaved_text), &unsaved[0]));
+    VERIFY_SUCCEEDED(isense->CreateUnsavedFile(
+        "file.hlsl", main_text, strlen(main_text), &unsaved[1]));
+    VERIFY_SUCCEEDED(index->ParseTranslationUnit(
+        "file.hlsl", nullptr, 0, &unsaved[0].p, 2, optionsList[i], &TU));
+    VERIFY_SUCCEEDED(TU->GetNumDiagnostics(&diagCount));
+    VERIFY_ARE_EQUAL(expectedDiagCounts[i], diagCount);
+
+    unsaved[1].Release();
+    VERIFY_SUCCEEDED(isense->CreateUnsavedFile("file.hlsl", main_text_edited,
+                                               strlen(main_text_edited),
+                                               &unsaved[1]));
+    VERIFY_SUCCEEDED(TU->Reparse(&unsaved[0].p, 2));
+    VERIFY_SUCCEEDED(TU->GetNumDiagnostics(&diagCount));
+    VERIFY_ARE_EQUAL(expectedDiagCounts[i] + 1, diagCount);
+  }
+}
+
 TEST_F(DXIntellisenseTest, TUWhenGetFileMissingThenFail) {
   const char program[] = "int i;";
   CompilationResult result =
@@ -51,10 +51,12 @@
 #include "dxc/Test/HlslTestUtils.h"
 #include "dxc/Test/DxcTestUtils.h"
 
+#include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilRDATBuilder.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
@@ -105,6 +107,7 @@ public:
   TEST_METHOD(CompileWhenOkThenCheckRDAT2)
   TEST_METHOD(CompileWhenOkThenCheckReflection1)
   TEST_METHOD(DxcUtils_CreateReflection)
+  TEST_METHOD(LibraryReflectionWhenBitcodeCorruptThenRDATQueriesWork)
   TEST_METHOD(CheckReflectionQueryInterface)
   TEST_METHOD(CompileWhenOKThenIncludesFeatureInfo)
   TEST_METHOD(CompileWhenOKThenIncludesSignatures)
@@ -116,7 +119,14 @@ public:
   TEST_METHOD(ValidateFromLL_Abs2)
   TEST_METHOD(DxilContainerUnitTest)
   TEST_METHOD(DxilContainerCompilerVersionTest)
+  TEST_METHOD(ContainerWhenMappedFromFileThenReadInPlace)
   TEST_METHOD(ContainerBuilder_AddPrivateForceLast)
+  TEST_METHOD(RDATBuilderWhenDuplicatesThenShared)
+  TEST_METHOD(RDATBuilderWhenLargeLibraryThenLayoutUnchanged)
+  BEGIN_TEST_METHOD(RDATBuilderBenchmark)
+  // Only for timing the builder; run it explicitly.
+  TEST_METHOD_PROPERTY(L"Ignore", L"true")
+  END_TEST_METHOD()
 
   TEST_METHOD(ReflectionMatchesDXBC_CheckIn)
   BEGIN_TEST_METHOD(ReflectionMatchesDXBC_Full)
@@ -2117,6 +2127,101 @@ TEST_F(DxilContainerTest, DxcUtils_CreateReflection) {
   }
 }
 
+TEST_F(DxilContainerTest,
+       LibraryReflectionWhenBitcodeCorruptThenRDATQueriesWork) {
+  if (m_ver.SkipDxilVersion(1, 3))
+    return;
+
+  const char *pShader = "Texture2D<float4> T : register(t0);\n"
+                        "SamplerState S : register(s0);\n"
+                        "cbuffer CB : register(b0) { float4 Color; };\n"
+                        "RWStructuredBuffer<float4> U : register(u0);\n"
+                        "export float4 Sample(float2 uv) {\n"
+                        "  return T.SampleLevel(S, uv, 0) * Color;\n"
+                        "}\n"
+                        "[shader(\"raygeneration\")]\n"
+                        "void RayGen() { U[0] = Color; }\n";
+  CComPtr<IDxcUtils> pUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CComPtr<IDxcBlobEncoding> pSource;
+  CreateBlobFromText(pShader, &pSource);
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"", L"lib_6_3",
+                                      nullptr, 0, nullptr, 0, nullptr,
+                                      &pResult));
+  HRESULT hr;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&hr));
+  VERIFY_SUCCEEDED(hr);
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // Keep the program headers but wipe the bitcode of every module, so anything
+  // that still works below was answered from RDAT.
+  std::vector<char> corrupt((const char *)pProgram->GetBufferPointer(),
+                            (const char *)pProgram->GetBufferPointer() +
+                                pProgram->GetBufferSize());
+  hlsl::DxilContainerHeader *pHeader =
+      (hlsl::DxilContainerHeader *)corrupt.data();
+  for (hlsl::DxilPartIterator it = hlsl::begin(pHeader),
+                              E = hlsl::end(pHeader);
+       it != E; ++it) {
+    uint32_t fourCC = (*it)->PartFourCC;
+    if (fourCC != hlsl::DFCC_DXIL && fourCC != hlsl::DFCC_ShaderDebugInfoDXIL &&
+        fourCC != hlsl::DFCC_ShaderStatistics)
+      continue;
+    const hlsl::DxilProgramHeader *pProgramHeader =
+        (const hlsl::DxilProgramHeader *)hlsl::GetDxilPartData(*it);
+    const char *pBitcode;
+    uint32_t bitcodeLength;
+    hlsl::GetDxilProgramBitcode(pProgramHeader, &pBitcode, &bitcodeLength);
+    memset(const_cast<char *>(pBitcode), 0, bitcodeLength);
+  }
+
+  DxcBuffer goodBuffer = {pProgram->GetBufferPointer(),
+                          pProgram->GetBufferSize(), 0};
+  DxcBuffer corruptBuffer = {corrupt.data(), corrupt.size(), 0};
+  CComPtr<ID3D12LibraryReflection> pGood, pCorrupt;
+  VERIFY_SUCCEEDED(
+      pUtils->CreateReflection(&goodBuffer, IID_PPV_ARGS(&pGood)));
+  VERIFY_SUCCEEDED(
+      pUtils->CreateReflection(&corruptBuffer, IID_PPV_ARGS(&pCorrupt)));
+
+  D3D12_LIBRARY_DESC goodLibDesc, corruptLibDesc;
+  VERIFY_SUCCEEDED(pGood->GetDesc(&goodLibDesc));
+  VERIFY_SUCCEEDED(pCorrupt->GetDesc(&corruptLibDesc));
+  VERIFY_ARE_EQUAL(2U, goodLibDesc.FunctionCount);
+  VERIFY_ARE_EQUAL(goodLibDesc.FunctionCount, corruptLibDesc.FunctionCount);
+
+  bool foundRayGen = false;
+  for (INT i = 0; i < (INT)goodLibDesc.FunctionCount; ++i) {
+    ID3D12FunctionReflection *pGoodFunc = pGood->GetFunctionByIndex(i);
+    ID3D12FunctionReflection *pCorruptFunc = pCorrupt->GetFunctionByIndex(i);
+    D3D12_FUNCTION_DESC goodDesc, corruptDesc;
+    VERIFY_SUCCEEDED(pGoodFunc->GetDesc(&goodDesc));
+    VERIFY_SUCCEEDED(pCorruptFunc->GetDesc(&corruptDesc));
+    VERIFY_ARE_EQUAL_STR(goodDesc.Name, corruptDesc.Name);
+    VERIFY_ARE_EQUAL(goodDesc.Version, corruptDesc.Version);
+    VERIFY_ARE_EQUAL(goodDesc.ConstantBuffers, corruptDesc.ConstantBuffers);
+    VERIFY_ARE_EQUAL(goodDesc.BoundResources, corruptDesc.BoundResources);
+    VERIFY_ARE_EQUAL(goodDesc.RequiredFeatureFlags,
+                     corruptDesc.RequiredFeatureFlags);
+    if (goodDesc.Version ==
+        hlsl::EncodeVersion(hlsl::DXIL::ShaderKind::RayGeneration, 6, 3)) {
+      foundRayGen = true;
+      VERIFY_ARE_EQUAL(2U, goodDesc.ConstantBuffers); // CB and U
+      VERIFY_ARE_EQUAL(2U, goodDesc.BoundResources);
+    }
+
+    // Bindings need the module, which only the intact container has.
+    D3D12_SHADER_INPUT_BIND_DESC bindDesc;
+    VERIFY_SUCCEEDED(pGoodFunc->GetResourceBindingDesc(0, &bindDesc));
+    VERIFY_FAILED(pCorruptFunc->GetResourceBindingDesc(0, &bindDesc));
+  }
+  VERIFY_IS_TRUE(foundRayGen);
+}
+
 TEST_F(DxilContainerTest, CheckReflectionQueryInterface) {
   // Minimum version 1.3 required for library support.
   if (m_ver.SkipDxilVersion(1, 3))
@@ -2759,6 +2864,75 @@ TEST_F(DxilContainerTest, ValidateFromLL_Abs2) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\container\\abs2_m.ll");
 }
 
+TEST_F(DxilContainerTest, ContainerWhenMappedFromFileThenReadInPlace) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcOperationResult> pResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, nullptr,
+                                      &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  std::wstring fileName;
+#ifdef _WIN32
+  wchar_t tempPath[MAX_PATH];
+  VERIFY_WIN32_BOOL_SUCCEEDED(GetTempPathW(MAX_PATH, tempPath) != 0);
+  fileName = tempPath;
+#else
+  const char *tempDir = std::getenv("TMPDIR");
+  fileName = std::wstring(CA2W(tempDir ? tempDir : "/tmp")) + L"/";
+#endif
+  fileName += L"DxilContainerTest_mapped.dxo";
+  VERIFY_SUCCEEDED(hlsl::WriteBinaryFile(fileName.c_str(),
+                                         pProgram->GetBufferPointer(),
+                                         pProgram->GetBufferSize()));
+
+  {
+    CComPtr<IDxcBlobEncoding> pMapped;
+    VERIFY_SUCCEEDED(hlsl::DxcCreateBlobFromMappedFile(
+        hlsl::GetGlobalHeapMalloc(), fileName.c_str(), &pMapped));
+    VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pMapped->GetBufferSize());
+    VERIFY_ARE_EQUAL(0, memcmp(pProgram->GetBufferPointer(),
+                               pMapped->GetBufferPointer(),
+                               pProgram->GetBufferSize()));
+    BOOL known;
+    UINT32 codePage;
+    VERIFY_SUCCEEDED(pMapped->GetEncoding(&known, &codePage));
+    VERIFY_IS_FALSE(known);
+
+    // Parts handed out by the reader point into the mapping.
+    CComPtr<IDxcContainerReflection> pReflection;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection,
+                                                 &pReflection));
+    VERIFY_SUCCEEDED(pReflection->Load(pMapped));
+    UINT32 idxPart;
+    VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &idxPart));
+    CComPtr<IDxcBlob> pPart;
+    VERIFY_SUCCEEDED(pReflection->GetPartContent(idxPart, &pPart));
+    const char *pBegin = (const char *)pMapped->GetBufferPointer();
+    const char *pPartData = (const char *)pPart->GetBufferPointer();
+    VERIFY_IS_TRUE(pBegin <= pPartData &&
+                   pPartData + pPart->GetBufferSize() <=
+                       pBegin + pMapped->GetBufferSize());
+
+    // The view is copy-on-write: the blob can be patched, the file can't.
+    *(char *)pMapped->GetBufferPointer() = 0;
+  }
+
+  CComPtr<IDxcBlobEncoding> pReread;
+  VERIFY_SUCCEEDED(hlsl::DxcCreateBlobFromMappedFile(
+      hlsl::GetGlobalHeapMalloc(), fileName.c_str(), &pReread));
+  VERIFY_ARE_EQUAL(0, memcmp(pProgram->GetBufferPointer(),
+                             pReread->GetBufferPointer(),
+                             pProgram->GetBufferSize()));
+  pReread.Release();
+  std::remove(std::string(CW2A(fileName.c_str())).c_str());
+}
+
 // Test to see if the Compiler Version (VERS) part gets added to library shaders
 // with validator version >= 1.8
 TEST_F(DxilContainerTest, DxilContainerCompilerVersionTest) {
@@ -2936,3 +3110,123 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
       hlsl::GetDxilProgramHeader(&header, hlsl::DxilFourCC::DFCC_DXIL));
   VERIFY_IS_NULL(hlsl::GetDxilPartByType(&header, hlsl::DxilFourCC::DFCC_DXIL));
 }
+
+// Builds RDAT for a synthetic library in which each function uses two of a
+// fixed set of resources and depends on two earlier functions.
+static llvm::StringRef
+BuildSyntheticLibraryRDAT(hlsl::DxilRDATBuilder &Builder,
+                          unsigned numFunctions) {
+  using namespace hlsl::RDAT;
+  const unsigned numResources = 64;
+  std::vector<uint32_t> resources;
+  for (unsigned i = 0; i < numResources; ++i) {
+    RuntimeDataResourceInfo info = {};
+    info.Class = (uint32_t)hlsl::DXIL::ResourceClass::SRV;
+    info.Kind = (uint32_t)hlsl::DXIL::ResourceKind::Texture2D;
+    info.ID = i;
+    info.LowerBound = i;
+    info.UpperBound = i;
+    info.Name = Builder.InsertString("res" + std::to_string(i));
+    resources.push_back(Builder.InsertRecord(info));
+  }
+  std::vector<uint32_t> names;
+  for (unsigned i = 0; i < numFunctions; ++i) {
+    std::string unmangled = "f" + std::to_string(i);
+    RuntimeDataFunctionInfo info = {};
+    info.Name = Builder.InsertString("\01?" + unmangled + "@@YAXXZ");
+    info.UnmangledName = Builder.InsertString(unmangled);
+    uint32_t used[] = {resources[i % numResources],
+                       resources[(i * 7) % numResources]};
+    info.Resources = Builder.InsertArray(used, used + 2);
+    if (i) {
+      uint32_t deps[] = {names[i - 1], names[i / 2]};
+      info.FunctionDependencies = Builder.InsertArray(deps, deps + 2);
+    } else {
+      info.FunctionDependencies = RDAT_NULL_REF;
+    }
+    info.ShaderKind = (uint32_t)hlsl::DXIL::ShaderKind::Library;
+    info.ShaderStageFlag = 0xffff;
+    info.MinShaderTarget = 0x60063;
+    names.push_back(info.Name);
+    Builder.InsertRecord(info);
+    uint8_t bytes[16];
+    for (unsigned j = 0; j < 16; ++j)
+      bytes[j] = (uint8_t)(i % 100 + j);
+    Builder.InsertBytesRef(bytes, sizeof(bytes));
+  }
+  return Builder.FinalizeAndGetData();
+}
+
+static uint64_t HashRDAT(llvm::StringRef data) {
+  // FNV-1a, to compare against the layout of earlier builds.
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+TEST_F(DxilContainerTest, RDATBuilderWhenDuplicatesThenShared) {
+  hlsl::DxilRDATBuilder Builder(true);
+  // Offset 0 is the empty string.
+  VERIFY_ARE_EQUAL(0U, Builder.InsertString(""));
+  VERIFY_ARE_EQUAL(1U, Builder.InsertString("a"));
+  VERIFY_ARE_EQUAL(3U, Builder.InsertString("bc"));
+  VERIFY_ARE_EQUAL(1U, Builder.InsertString("a"));
+  VERIFY_ARE_EQUAL(6U, Builder.InsertString(llvm::StringRef("a\0b", 3)));
+  VERIFY_ARE_EQUAL(10U, Builder.GetStringBufferPart().GetPartSize());
+
+  VERIFY_ARE_EQUAL(0U, Builder.InsertBytesRef("abcd", 4).Offset);
+  VERIFY_ARE_EQUAL(4U, Builder.InsertBytesRef("ef", 2).Offset);
+  VERIFY_ARE_EQUAL(0U, Builder.InsertBytesRef("abcd", 4).Offset);
+  VERIFY_ARE_EQUAL(6U, Builder.InsertBytesRef("abc", 3).Offset);
+  VERIFY_ARE_EQUAL(9U, Builder.GetRawBytesPart().GetPartSize());
+
+  hlsl::RDAT::RuntimeDataResourceInfo info = {};
+  info.ID = 1;
+  VERIFY_ARE_EQUAL(0U, Builder.InsertRecord(info));
+  info.ID = 2;
+  VERIFY_ARE_EQUAL(1U, Builder.InsertRecord(info));
+  info.ID = 1;
+  VERIFY_ARE_EQUAL(0U, Builder.InsertRecord(info));
+
+  hlsl::DxilRDATBuilder NoDedupBuilder(false);
+  VERIFY_ARE_EQUAL(0U, NoDedupBuilder.InsertRecord(info));
+  VERIFY_ARE_EQUAL(1U, NoDedupBuilder.InsertRecord(info));
+}
+
+TEST_F(DxilContainerTest, RDATBuilderWhenLargeLibraryThenLayoutUnchanged) {
+  hlsl::DxilRDATBuilder SmallBuilder(true);
+  llvm::StringRef data = BuildSyntheticLibraryRDAT(SmallBuilder, 3);
+  VERIFY_ARE_EQUAL(2792U, data.size());
+  VERIFY_ARE_EQUAL(0xf0a9b695be3bcdcaULL, HashRDAT(data));
+
+  hlsl::DxilRDATBuilder Builder(true);
+  data = BuildSyntheticLibraryRDAT(Builder, 10000);
+  VERIFY_ARE_EQUAL(772644U, data.size());
+  VERIFY_ARE_EQUAL(0x74b3f3b9c966a949ULL, HashRDAT(data));
+
+  hlsl::RDAT::DxilRuntimeData runtimeData(data.data(), data.size());
+  VERIFY_IS_TRUE(runtimeData.Validate());
+  VERIFY_ARE_EQUAL(10000U, runtimeData.GetFunctionTable().Count());
+  VERIFY_ARE_EQUAL(64U, runtimeData.GetResourceTable().Count());
+}
+
+#ifdef _WIN32
+TEST_F(DxilContainerTest, RDATBuilderBenchmark) {
+#else
+// Disabled as it is ignored above
+TEST_F(DxilContainerTest, DISABLED_RDATBuilderBenchmark) {
+#endif
+  const unsigned iterations = 20;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; ++i) {
+    hlsl::DxilRDATBuilder Builder(true);
+    BuildSyntheticLibraryRDAT(Builder, 10000);
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto dur = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  LogCommentFmt(L"RDAT for 10000 functions: %u us",
+                (unsigned)(dur.count() / iterations));
+}
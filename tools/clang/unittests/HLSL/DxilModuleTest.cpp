@@ -19,14 +19,18 @@
 #include "dxc/Test/HlslTestUtils.h"
 #include "dxc/dxcapi.internal.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Regex.h"
 
+#include <chrono>
+
 using namespace hlsl;
 using namespace llvm;
 
@@ -73,6 +77,12 @@ public:
 
   TEST_METHOD(CanonicalSystemValueSemantic)
 
+  TEST_METHOD(OpFuncCache)
+  BEGIN_TEST_METHOD(OpFuncCacheBenchmark)
+  // Only for timing GetOpFunc; run it explicitly.
+  TEST_METHOD_PROPERTY(L"Ignore", L"true")
+  END_TEST_METHOD()
+
   void VerifyValidatorVersionFails(LPCWSTR shaderModel,
                                    const std::vector<LPCWSTR> &arguments,
                                    const std::vector<LPCSTR> &expectedErrors);
@@ -621,3 +631,76 @@ TEST_F(DxilModuleTest, CanonicalSystemValueSemantic) {
                      1, 4, 0, 0, 0, {0});
   VERIFY_ARE_EQUAL_STR("SV_Position", newElt->GetSemanticName().data());
 }
+
+TEST_F(DxilModuleTest, OpFuncCache) {
+  LLVMContext Ctx;
+  Module M("OpFuncCache", Ctx);
+  OP hlslOP(Ctx, &M);
+  hlslOP.InitWithMinPrecision(false);
+  Type *F32 = Type::getFloatTy(Ctx);
+  Type *F16 = Type::getHalfTy(Ctx);
+
+  Function *UnaryF32 = hlslOP.GetOpFunc(OP::OpCode::Sin, F32);
+  VERIFY_IS_NOT_NULL(UnaryF32);
+  VERIFY_ARE_EQUAL_STR("dx.op.unary.f32", UnaryF32->getName().data());
+  VERIFY_ARE_EQUAL(UnaryF32, hlslOP.GetOpFunc(OP::OpCode::Sin, F32));
+  // Opcodes of the same class share their overloads.
+  VERIFY_ARE_EQUAL(UnaryF32, hlslOP.GetOpFunc(OP::OpCode::Cos, F32));
+  Function *UnaryF16 = hlslOP.GetOpFunc(OP::OpCode::Sin, F16);
+  VERIFY_ARE_NOT_EQUAL(UnaryF32, UnaryF16);
+  VERIFY_ARE_EQUAL(UnaryF16, hlslOP.GetOpFunc(OP::OpCode::Cos, F16));
+
+  // Once removed, a function is not handed out again for any opcode of its
+  // class.
+  hlslOP.RemoveFunction(UnaryF32);
+  UnaryF32->eraseFromParent();
+  Function *NewUnaryF32 = hlslOP.GetOpFunc(OP::OpCode::Cos, F32);
+  VERIFY_IS_NOT_NULL(NewUnaryF32);
+  VERIFY_ARE_EQUAL(M.getFunction("dx.op.unary.f32"), NewUnaryF32);
+  VERIFY_ARE_EQUAL(NewUnaryF32, hlslOP.GetOpFunc(OP::OpCode::Sin, F32));
+  VERIFY_ARE_EQUAL(UnaryF16, hlslOP.GetOpFunc(OP::OpCode::Sin, F16));
+}
+
+#ifdef _WIN32
+TEST_F(DxilModuleTest, OpFuncCacheBenchmark) {
+#else
+// Disabled as it is ignored above
+TEST_F(DxilModuleTest, DISABLED_OpFuncCacheBenchmark) {
+#endif
+  // Emits dx.op calls the way HLOperationLower does, asking GetOpFunc for
+  // the overload of every call it creates.
+  const OP::OpCode OpCodes[] = {
+      OP::OpCode::Sin,  OP::OpCode::Cos,  OP::OpCode::Exp,
+      OP::OpCode::Log,  OP::OpCode::Sqrt, OP::OpCode::Saturate,
+      OP::OpCode::FMax, OP::OpCode::FMin, OP::OpCode::FMad,
+      OP::OpCode::Dot3, OP::OpCode::UMax, OP::OpCode::IMad};
+  const unsigned NumCalls = 400000;
+
+  LLVMContext Ctx;
+  Module M("OpFuncCacheBenchmark", Ctx);
+  OP hlslOP(Ctx, &M);
+  hlslOP.InitWithMinPrecision(false);
+  Type *FloatTypes[] = {Type::getFloatTy(Ctx), Type::getHalfTy(Ctx)};
+  Type *IntTypes[] = {Type::getInt32Ty(Ctx), Type::getInt16Ty(Ctx)};
+  Function *Entry = Function::Create(
+      FunctionType::get(Type::getVoidTy(Ctx), false),
+      GlobalValue::ExternalLinkage, "main", &M);
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", Entry));
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < NumCalls; ++i) {
+    OP::OpCode Op = OpCodes[i % _countof(OpCodes)];
+    bool IsInt = Op == OP::OpCode::UMax || Op == OP::OpCode::IMad;
+    Type *Ty = (IsInt ? IntTypes : FloatTypes)[(i / 16) & 1];
+    Function *F = hlslOP.GetOpFunc(Op, Ty);
+    SmallVector<Value *, 8> Args;
+    Args.push_back(hlslOP.GetI32Const((int)Op));
+    for (unsigned j = 1; j < F->getFunctionType()->getNumParams(); ++j)
+      Args.push_back(UndefValue::get(F->getFunctionType()->getParamType(j)));
+    Builder.CreateCall(F, Args);
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto dur = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  hlsl_test::LogCommentFmt(L"%u dx.op calls: %u us", NumCalls,
+                           (unsigned)dur.count());
+}
@@ -688,6 +688,7 @@ public:
   TEST_METHOD(OptionFromDefineLifetimeMarkers)
   TEST_METHOD(TargetTriple)
   TEST_METHOD(IntrinsicWhenAvailableThenUsed)
+  TEST_METHOD(IntrinsicTableReleasedWhenTeardownDiscarded)
   TEST_METHOD(CustomIntrinsicName)
   TEST_METHOD(NoLowering)
   TEST_METHOD(PackedLowering)
@@ -1200,6 +1201,24 @@ TEST_F(ExtensionTest, IntrinsicWhenAvailableThenUsed) {
                                   "01@@V2@@Z.r\"(i32, float) #"));
 }
 
+TEST_F(ExtensionTest, IntrinsicTableReleasedWhenTeardownDiscarded) {
+  Compiler c(m_dllSupport);
+  CComPtr<IDxcIntrinsicTable> pTable = new TestIntrinsicTable();
+  c.RegisterIntrinsicTable(pTable);
+  ULONG refsBefore = pTable.p->AddRef();
+  pTable.p->Release();
+
+  // The abandoned AST must not keep a reference to the table.
+  c.Compile("float2 main(float2 v : V) : SV_Target {\n"
+            "  return test_fn(v);\n"
+            "}\n",
+            {L"/Vd", L"-fdiscard-teardown-at-exit"}, {});
+  c.Disassemble();
+  ULONG refsAfter = pTable.p->AddRef();
+  pTable.p->Release();
+  VERIFY_ARE_EQUAL(refsBefore, refsAfter);
+}
+
 TEST_F(ExtensionTest, CustomIntrinsicName) {
   Compiler c(m_dllSupport);
   c.RegisterIntrinsicTable(new TestIntrinsicTable());
@@ -100,6 +100,8 @@ public:
   TEST_METHOD(OptimizerWhenPassedContainerPreservesViewId_GSNonDependent)
   TEST_METHOD(OptimizerWhenPassedContainerPreservesResourceStats_PSMultiCBTex2D)
 
+  TEST_METHOD(OptimizerSessionWhenForkedThenPassesMatch)
+
   void OptimizerWhenSliceNThenOK(int optLevel);
   void OptimizerWhenSliceNThenOK(int optLevel, LPCSTR pText, LPCWSTR pTarget,
                                  llvm::ArrayRef<LPCWSTR> args = {});
@@ -1500,3 +1502,45 @@ float4 main( PS_INPUT Input ) : SV_TARGET
 )",
       L"main", L"ps_6_5", false /*does not use view id*/, 4);
 }
+
+TEST_F(OptimizerTest, OptimizerSessionWhenForkedThenPassesMatch) {
+  CComPtr<IDxcBlob> pContainer = Compile(R"(
+float4 main(float4 a : A) : SV_Target {
+  float4 unused = a * 2;
+  return a + 1;
+}
+)",
+                                         L"main", L"ps_6_0");
+
+  CComPtr<IDxcOptimizer2> pOptimizer;
+  VERIFY_SUCCEEDED(
+      m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+
+  CComPtr<IDxcOptimizerSession> pSession;
+  VERIFY_SUCCEEDED(pOptimizer->CreateSession(pContainer, &pSession));
+
+  LPCWSTR firstPasses[] = {L"-dce"};
+  VERIFY_SUCCEEDED(
+      pSession->RunPasses(firstPasses, _countof(firstPasses), nullptr));
+
+  CComPtr<IDxcOptimizerSession> pFork;
+  VERIFY_SUCCEEDED(pSession->Fork(&pFork));
+
+  // Both the session and its fork continue from the same module state.
+  LPCWSTR secondPasses[] = {L"-globaldce", L"-S"};
+  CComPtr<IDxcBlobEncoding> pSessionText;
+  CComPtr<IDxcBlobEncoding> pForkText;
+  VERIFY_SUCCEEDED(pSession->RunPasses(secondPasses, _countof(secondPasses),
+                                       &pSessionText));
+  VERIFY_SUCCEEDED(
+      pFork->RunPasses(secondPasses, _countof(secondPasses), &pForkText));
+
+  std::string sessionText = BlobToUtf8(pSessionText);
+  std::string forkText = BlobToUtf8(pForkText);
+  VERIFY_IS_FALSE(sessionText.empty());
+  VERIFY_ARE_EQUAL_STR(sessionText.c_str(), forkText.c_str());
+
+  CComPtr<IDxcBlob> pModule;
+  VERIFY_SUCCEEDED(pSession->GetModule(&pModule));
+  VERIFY_IS_TRUE(pModule->GetBufferSize() > 0);
+}
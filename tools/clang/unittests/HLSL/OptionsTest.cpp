@@ -60,6 +60,7 @@ public:
   END_TEST_CLASS()
 
   TEST_METHOD(ReadOptionsWhenDefinesThenInit)
+  TEST_METHOD(ReadParsedArgsWhenDefinesChangeThenReused)
   TEST_METHOD(ReadOptionsWhenExtensionsThenOK)
   TEST_METHOD(ReadOptionsWhenHelpThenShortcut)
   TEST_METHOD(ReadOptionsWhenInvalidThenFail)
@@ -71,6 +72,9 @@ public:
 
   TEST_METHOD(ReadOptionsForDxcWhenApiArgMissingThenFail)
   TEST_METHOD(ReadOptionsForApiWhenApiArgMissingThenOK)
+  TEST_METHOD(ReadOptionsForBatch)
+  TEST_METHOD(ReadOptionsForServer)
+  TEST_METHOD(ReadOptionsDiscardTeardownOnlyForDriver)
 
   TEST_METHOD(ConvertWhenFailThenThrow)
 
@@ -267,6 +271,56 @@ TEST_F(OptionsTest, ReadOptionsWhenDefinesThenInit) {
   EXPECT_EQ(nullptr, o->Defines.data()[0].Value);
 }
 
+TEST_F(OptionsTest, ReadParsedArgsWhenDefinesChangeThenReused) {
+  const wchar_t *ArgsFirst[] = {L"/DNAME1=1", L"/T",      L"ps_6_0",
+                                L"/D",        L"NAME2=2", L"/E",
+                                L"main",      L"-Zi",     L"hlsl.hlsl"};
+  const wchar_t *ArgsSecond[] = {L"/DNAME1=3", L"/T",      L"ps_6_0",
+                                 L"/D",        L"NAME2=4", L"/E",
+                                 L"main",      L"-Zi",     L"hlsl.hlsl"};
+  const wchar_t *ArgsOther[] = {L"/DNAME1=1", L"/T",      L"ps_6_0",
+                                L"/D",        L"NAME2=2", L"/E",
+                                L"other",     L"-Zi",     L"hlsl.hlsl"};
+
+  DxcParsedArgsCache cache(CompilerFlags);
+  std::shared_ptr<const DxcParsedArgs> first =
+      cache.GetOrParse(getHlslOptTable(), ArgsFirst);
+  std::shared_ptr<const DxcParsedArgs> firstAgain =
+      cache.GetOrParse(getHlslOptTable(), ArgsFirst);
+  std::shared_ptr<const DxcParsedArgs> second =
+      cache.GetOrParse(getHlslOptTable(), ArgsSecond);
+  std::shared_ptr<const DxcParsedArgs> other =
+      cache.GetOrParse(getHlslOptTable(), ArgsOther);
+
+  // Same arguments reuse the parse; different defines share the key.
+  EXPECT_EQ(first.get(), firstAgain.get());
+  VERIFY_ARE_NOT_EQUAL(first.get(), second.get());
+  EXPECT_EQ(first->GetHash(), second->GetHash());
+  VERIFY_ARE_NOT_EQUAL(first->GetHash(), other->GetHash());
+
+  std::string errorString;
+  llvm::raw_string_ostream errorStream(errorString);
+  DxcOpts opts;
+  EXPECT_EQ(0, ReadDxcOpts(*second, opts, errorStream));
+  VERIFY_IS_TRUE(errorStream.str().empty());
+  EXPECT_EQ(2U, opts.Defines.size());
+  EXPECT_STREQW(L"NAME1", opts.Defines.data()[0].Name);
+  EXPECT_STREQW(L"3", opts.Defines.data()[0].Value);
+  EXPECT_STREQW(L"NAME2", opts.Defines.data()[1].Name);
+  EXPECT_STREQW(L"4", opts.Defines.data()[1].Value);
+  VERIFY_ARE_EQUAL_STR("main", opts.EntryPoint.data());
+  VERIFY_ARE_EQUAL_STR("ps_6_0", opts.TargetProfile.data());
+  VERIFY_ARE_EQUAL_STR("hlsl.hlsl", opts.InputFile.data());
+  VERIFY_IS_TRUE(opts.DebugInfo);
+
+  // The cloned argument list matches the one the compiler was given.
+  llvm::ArrayRef<const char *> argv = second->getArrayRef();
+  VERIFY_ARE_EQUAL(9U, argv.size());
+  VERIFY_ARE_EQUAL_STR("/DNAME1=3", argv[0]);
+  VERIFY_ARE_EQUAL_STR("NAME2=4", argv[4]);
+  VERIFY_ARE_EQUAL_STR("/E", opts.Args.getArgString(5));
+}
+
 TEST_F(OptionsTest, ReadOptionsForDxcWhenApiArgMissingThenFail) {
   // When an argument specified through an API argument is not specified (eg the
   // target model), for the command-line dxc.exe tool, then the validation
@@ -290,6 +344,83 @@ TEST_F(OptionsTest, ReadOptionsForApiWhenApiArgMissingThenOK) {
   o = ReadOptsTest(mainArgsArr, CompilerFlags, false, false);
 }
 
+TEST_F(OptionsTest, ReadOptionsForBatch) {
+  // A batch file supplies the input and target of every job.
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"-batch", L"jobs.txt", L"-j",
+                             L"4",       L"-batch-deps", L"jobs.d"};
+    MainArgsArr ArgsArr(Args);
+    std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+    VERIFY_ARE_EQUAL_STR("jobs.txt", o->BatchFile.data());
+    VERIFY_ARE_EQUAL_STR("jobs.d", o->BatchDependencyFile.data());
+    VERIFY_ARE_EQUAL(4U, o->BatchJobs);
+  }
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"-batch", L"jobs.txt", L"-j",
+                             L"many"};
+    MainArgsArr ArgsArr(Args);
+    ReadOptsTest(ArgsArr, DxcFlags, "Invalid job count 'many' for -j.");
+  }
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"/T", L"ps_6_0", L"hlsl.hlsl",
+                             L"-j", L"4"};
+    MainArgsArr ArgsArr(Args);
+    ReadOptsTest(ArgsArr, DxcFlags, "-batch-deps and -j require -batch.");
+  }
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"-batch", L"jobs.txt", L"hlsl.hlsl"};
+    MainArgsArr ArgsArr(Args);
+    ReadOptsTest(ArgsArr, DxcFlags, true, true);
+  }
+}
+
+TEST_F(OptionsTest, ReadOptionsForServer) {
+  // Server clients send their own inputs and targets.
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"--server", L"dxc.sock"};
+    MainArgsArr ArgsArr(Args);
+    std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+    VERIFY_ARE_EQUAL_STR("dxc.sock", o->ServerAddress.data());
+  }
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"-server", L"dxc.sock",
+                             L"hlsl.hlsl"};
+    MainArgsArr ArgsArr(Args);
+    ReadOptsTest(ArgsArr, DxcFlags, true, true);
+  }
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"-connect", L"dxc.sock", L"/T",
+                             L"ps_6_0",  L"hlsl.hlsl"};
+    MainArgsArr ArgsArr(Args);
+    std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+    VERIFY_ARE_EQUAL_STR("dxc.sock", o->ConnectAddress.data());
+  }
+}
+
+TEST_F(OptionsTest, ReadOptionsDiscardTeardownOnlyForDriver) {
+  // The driver exits after compiling; API callers get the hidden spelling
+  // only, so a long-lived host does not discard memory by accident.
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"/T", L"ps_6_0", L"hlsl.hlsl",
+                             L"-fdiscard-teardown"};
+    MainArgsArr ArgsArr(Args);
+    std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+    VERIFY_IS_TRUE(o->DiscardTeardown);
+  }
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"hlsl.hlsl", L"-fdiscard-teardown"};
+    MainArgsArr ArgsArr(Args);
+    ReadOptsTest(ArgsArr, CompilerFlags, true, true);
+  }
+  {
+    const wchar_t *Args[] = {L"exe.exe", L"hlsl.hlsl",
+                             L"-fdiscard-teardown-at-exit"};
+    MainArgsArr ArgsArr(Args);
+    std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, CompilerFlags);
+    VERIFY_IS_TRUE(o->DiscardTeardown);
+  }
+}
+
 TEST_F(OptionsTest, ConvertWhenFailThenThrow) {
   std::wstring wstr;
 
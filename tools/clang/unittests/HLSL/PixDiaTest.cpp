@@ -145,6 +145,7 @@ public:
   TEST_METHOD(DiaLoadBadBitcodeThenFail)
   TEST_METHOD(DiaLoadDebugThenOK)
   TEST_METHOD(DiaTableIndexThenOK)
+  TEST_METHOD(DiaFindLinesByLinenumThenOK)
   TEST_METHOD(DiaLoadDebugSubrangeNegativeThenOK)
   TEST_METHOD(DiaLoadRelocatedBitcode)
   TEST_METHOD(DiaLoadBitcodePlusExtraData)
@@ -1419,6 +1420,81 @@ TEST_F(PixDiaTest, DiaTableIndexThenOK) {
   VERIFY_FAILED(pEnumTables->Item(vtIndex, &pTable));
 }
 
+TEST_F(PixDiaTest, DiaFindLinesByLinenumThenOK) {
+  CComPtr<IDiaDataSource> pDiaSource;
+  CComPtr<IDiaSession> pDiaSession;
+  CComPtr<IDiaEnumTables> pEnumTables;
+  CComPtr<IDiaEnumLineNumbers> pAllLines;
+  VERIFY_SUCCEEDED(CreateDiaSourceForCompile(
+      "float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+      "  float4 local = abs(pos);\r\n"
+      "  local += sin(pos);\r\n"
+      "  return local;\r\n"
+      "}",
+      &pDiaSource));
+  VERIFY_SUCCEEDED(pDiaSource->openSession(&pDiaSession));
+  VERIFY_SUCCEEDED(pDiaSession->getEnumTables(&pEnumTables));
+
+  LONG tableCount;
+  VERIFY_SUCCEEDED(pEnumTables->get_Count(&tableCount));
+  for (LONG i = 0; i < tableCount && !pAllLines; ++i) {
+    CComPtr<IDiaTable> pTable;
+    ULONG fetched;
+    VERIFY_SUCCEEDED(pEnumTables->Next(1, &pTable, &fetched));
+    pTable.QueryInterface(&pAllLines);
+  }
+  VERIFY_IS_NOT_NULL(pAllLines.p);
+
+  // Every entry of the line number table must be found again when looking it
+  // up by its file and line, and by its RVA.
+  LONG lineCount;
+  VERIFY_SUCCEEDED(pAllLines->get_Count(&lineCount));
+  VERIFY_IS_TRUE(lineCount > 0);
+  DWORD maxLine = 0;
+  CComPtr<IDiaSourceFile> pFile;
+  for (LONG i = 0; i < lineCount; ++i) {
+    CComPtr<IDiaLineNumber> pLine;
+    DWORD line, rva;
+    pFile.Release();
+    VERIFY_SUCCEEDED(pAllLines->Item(i, &pLine));
+    VERIFY_SUCCEEDED(pLine->get_lineNumber(&line));
+    VERIFY_SUCCEEDED(pLine->get_relativeVirtualAddress(&rva));
+    VERIFY_SUCCEEDED(pLine->get_sourceFile(&pFile));
+    maxLine = std::max(maxLine, line);
+
+    CComPtr<IDiaEnumLineNumbers> pByLine;
+    VERIFY_ARE_EQUAL(S_OK, pDiaSession->findLinesByLinenum(
+                               nullptr, pFile, line, 0, &pByLine));
+    bool found = false;
+    LONG byLineCount;
+    VERIFY_SUCCEEDED(pByLine->get_Count(&byLineCount));
+    for (LONG j = 0; j < byLineCount; ++j) {
+      CComPtr<IDiaLineNumber> pOther;
+      DWORD otherLine, otherRva;
+      VERIFY_SUCCEEDED(pByLine->Item(j, &pOther));
+      VERIFY_SUCCEEDED(pOther->get_lineNumber(&otherLine));
+      VERIFY_SUCCEEDED(pOther->get_relativeVirtualAddress(&otherRva));
+      VERIFY_ARE_EQUAL(line, otherLine);
+      found |= otherRva == rva;
+    }
+    VERIFY_IS_TRUE(found);
+
+    CComPtr<IDiaEnumLineNumbers> pByRva;
+    LONG byRvaCount;
+    VERIFY_SUCCEEDED(pDiaSession->findLinesByRVA(rva, 1, &pByRva));
+    VERIFY_SUCCEEDED(pByRva->get_Count(&byRvaCount));
+    VERIFY_ARE_EQUAL(1, byRvaCount);
+  }
+
+  // Lines past the end of the source have no instructions.
+  CComPtr<IDiaEnumLineNumbers> pNoLines;
+  LONG noLinesCount;
+  VERIFY_ARE_EQUAL(S_FALSE, pDiaSession->findLinesByLinenum(
+                                nullptr, pFile, maxLine + 1, 0, &pNoLines));
+  VERIFY_SUCCEEDED(pNoLines->get_Count(&noLinesCount));
+  VERIFY_ARE_EQUAL(0, noLinesCount);
+}
+
 TEST_F(PixDiaTest, PixDebugCompileInfo) {
   static const char source[] = R"(
     SamplerState  samp0 : register(s0);
@@ -0,0 +1,319 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// UnicodeTest.cpp                                                           //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides tests for the Unicode conversion and encoding detection helpers. //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef UNICODE
+#define UNICODE
+#endif
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/dxcapi.h"
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dxc/Test/HlslTestUtils.h"
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/dxcapi.use.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/ConvertUTF.h"
+
+using namespace std;
+using namespace hlsl_test;
+
+// The conversions are checked against LLVM's strict reference converters on
+// generated input. The generator is seeded so that failures reproduce.
+static const unsigned kFuzzSeed = 0x5EED;
+static const unsigned kFuzzIterations = 4000;
+
+#ifdef _WIN32
+class UnicodeTest {
+#else
+class UnicodeTest : public ::testing::Test {
+#endif
+public:
+  BEGIN_TEST_CLASS(UnicodeTest)
+  TEST_CLASS_PROPERTY(L"Parallel", L"true")
+  TEST_METHOD_PROPERTY(L"Priority", L"0")
+  END_TEST_CLASS()
+
+  TEST_CLASS_SETUP(InitSupport);
+
+  TEST_METHOD(ASCIIWhenAnyLengthThenMatchesScalar)
+  TEST_METHOD(UTF8ToWideWhenFuzzedThenMatchesReference)
+  TEST_METHOD(WideToUTF8WhenFuzzedThenMatchesReference)
+  TEST_METHOD(ConvertWhenSizeQueriedThenTerminatorCountedIfInput)
+  TEST_METHOD(ConvertWhenMalformedThenFail)
+  TEST_METHOD(BlobAsUtf8WhenFuzzedThenMatchesConversion)
+
+  dxc::DxcDllSupport m_dllSupport;
+};
+
+bool UnicodeTest::InitSupport() {
+  if (!m_dllSupport.IsEnabled()) {
+    VERIFY_SUCCEEDED(m_dllSupport.Initialize());
+  }
+  return true;
+}
+
+// Appends a UTF-8 string made of ASCII runs long enough to cross vector
+// widths, well-formed multi-byte sequences, and occasionally malformed
+// sequences or a null byte.
+static void AppendFuzzedUTF8(std::mt19937 &rng, std::string &text) {
+  std::uniform_int_distribution<unsigned> pieces(0, 12);
+  for (unsigned n = pieces(rng); n; --n) {
+    switch (rng() % 8) {
+    case 0:
+    case 1:
+    case 2: {
+      for (unsigned len = rng() % 40; len; --len)
+        text.push_back((char)(1 + rng() % 0x7F));
+      break;
+    }
+    case 3:
+    case 4:
+    case 5: {
+      // Favor the edges of each sequence length and of the surrogate range.
+      static const unsigned Edges[] = {0x80,    0x7FF,   0x800,   0xD7FF,
+                                       0xE000,  0xFFFD,  0xFFFF,  0x10000,
+                                       0x10FFFF};
+      unsigned value = rng() % 2 ? Edges[rng() % llvm::array_lengthof(Edges)]
+                                 : 0x80 + rng() % 0x10FF80;
+      if (value >= 0xD800 && value <= 0xDFFF)
+        value = 0xFFFD;
+      char buffer[UNI_MAX_UTF8_BYTES_PER_CODE_POINT];
+      char *end = buffer;
+      VERIFY_IS_TRUE(llvm::ConvertCodePointToUTF8(value, end));
+      text.append(buffer, end);
+      break;
+    }
+    case 6: {
+      // Truncated, overlong, surrogate, out of range, or stray bytes.
+      static const char *Malformed[] = {
+          "\xC3",         "\xE2\x82",     "\xF0\x9F\x98", "\xC0\xAF",
+          "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80",
+          "\xF8\x88\x80\x80\x80",         "\x80",         "\xFF"};
+      text.append(Malformed[rng() % llvm::array_lengthof(Malformed)]);
+      break;
+    }
+    case 7:
+      text.push_back(rng() % 2 ? '\0' : (char)(rng() & 0xFF));
+      break;
+    }
+  }
+}
+
+// Converts with the reference converter; returns false if text is malformed.
+static bool ReferenceUTF8ToWide(const std::string &text, std::wstring &wide) {
+  std::vector<char> buffer((text.size() + 1) * sizeof(wchar_t));
+  char *resultPtr = buffer.data();
+  const UTF8 *errorPtr;
+  if (!llvm::ConvertUTF8toWide(sizeof(wchar_t), text, resultPtr, errorPtr))
+    return false;
+  wide.assign((const wchar_t *)buffer.data(),
+              (const wchar_t *)resultPtr - (const wchar_t *)buffer.data());
+  return true;
+}
+
+static bool ReferenceWideToUTF8(const std::wstring &wide, std::string &text) {
+  text.resize(wide.size() * UNI_MAX_UTF8_BYTES_PER_CODE_POINT);
+  UTF8 *target = (UTF8 *)&text[0];
+  ConversionResult result;
+  if (sizeof(wchar_t) == 2) {
+    const UTF16 *source = (const UTF16 *)wide.data();
+    result = ConvertUTF16toUTF8(&source, source + wide.size(), &target,
+                                target + text.size(), strictConversion);
+  } else {
+    const UTF32 *source = (const UTF32 *)wide.data();
+    result = ConvertUTF32toUTF8(&source, source + wide.size(), &target,
+                                target + text.size(), strictConversion);
+  }
+  if (result != conversionOK)
+    return false;
+  text.resize((char *)target - &text[0]);
+  return true;
+}
+
+TEST_F(UnicodeTest, ASCIIWhenAnyLengthThenMatchesScalar) {
+  // Cover every length and alignment around the vector widths, with the
+  // first non-ASCII byte at every position.
+  char text[80];
+  wchar_t wide[80];
+  for (size_t i = 0; i < sizeof(text); ++i)
+    text[i] = (char)('a' + i % 26);
+  for (size_t offset = 0; offset < 16; ++offset) {
+    for (size_t len = 0; offset + len <= sizeof(text); ++len) {
+      VERIFY_IS_TRUE(Unicode::IsASCII(text + offset, len));
+      VERIFY_IS_TRUE(Unicode::IsValidUTF8(text + offset, len));
+      Unicode::ASCIIToWide(text + offset, len, wide);
+      for (size_t i = 0; i < len; ++i)
+        VERIFY_ARE_EQUAL((wchar_t)text[offset + i], wide[i]);
+      for (size_t bad = 0; bad < len; ++bad) {
+        char saved = text[offset + bad];
+        text[offset + bad] = '\x80';
+        VERIFY_IS_FALSE(Unicode::IsASCII(text + offset, len));
+        VERIFY_IS_FALSE(Unicode::IsValidUTF8(text + offset, len));
+        text[offset + bad] = saved;
+      }
+    }
+  }
+}
+
+TEST_F(UnicodeTest, UTF8ToWideWhenFuzzedThenMatchesReference) {
+  std::mt19937 rng(kFuzzSeed);
+  for (unsigned i = 0; i < kFuzzIterations; ++i) {
+    std::string text;
+    AppendFuzzedUTF8(rng, text);
+    std::wstring expected, actual;
+    bool valid = ReferenceUTF8ToWide(text, expected);
+    VERIFY_ARE_EQUAL(valid, Unicode::IsValidUTF8(text.data(), text.size()));
+    VERIFY_ARE_EQUAL(valid, Unicode::UTF8ToWideString(text.data(),
+                                                      text.size(), &actual));
+    if (valid)
+      VERIFY_IS_TRUE(expected == actual);
+  }
+}
+
+TEST_F(UnicodeTest, WideToUTF8WhenFuzzedThenMatchesReference) {
+  std::mt19937 rng(kFuzzSeed);
+  for (unsigned i = 0; i < kFuzzIterations; ++i) {
+    std::string text;
+    AppendFuzzedUTF8(rng, text);
+    std::wstring wide;
+    if (!ReferenceUTF8ToWide(text, wide))
+      continue;
+#ifndef _WIN32
+    // Windows substitutes U+FFFD for these; elsewhere conversion fails.
+    if (rng() % 8 == 0) {
+      static const uint32_t Invalid[] = {0xD800, 0xDFFF, 0x110000};
+      wide.insert(wide.begin() + rng() % (wide.size() + 1),
+                  (wchar_t)Invalid[rng() % llvm::array_lengthof(Invalid)]);
+    }
+#endif
+    std::string expected, actual;
+    bool valid = ReferenceWideToUTF8(wide, expected);
+    VERIFY_ARE_EQUAL(valid, Unicode::WideToUTF8String(wide.data(),
+                                                      wide.size(), &actual));
+    if (valid)
+      VERIFY_IS_TRUE(expected == actual);
+  }
+}
+
+TEST_F(UnicodeTest, ConvertWhenSizeQueriedThenTerminatorCountedIfInput) {
+  // U+00F1, U+20AC and U+1F600 take two, three and four bytes.
+  const char text[] = "a\xC3\xB1\xE2\x82\xAC\xF0\x9F\x98\x80";
+  const int cbText = sizeof(text) - 1;
+  const wchar_t *expected = sizeof(wchar_t) == 2 ? L"a\x00F1\x20AC\xD83D\xDE00"
+                                                 : L"a\x00F1\x20AC\U0001F600";
+  const int cchExpected = (int)wcslen(expected);
+
+  VERIFY_ARE_EQUAL(cchExpected, MultiByteToWideChar(CP_UTF8, 0, text, cbText,
+                                                    nullptr, 0));
+  VERIFY_ARE_EQUAL(cchExpected + 1,
+                   MultiByteToWideChar(CP_UTF8, 0, text, -1, nullptr, 0));
+
+  wchar_t wide[16];
+  VERIFY_ARE_EQUAL(0, MultiByteToWideChar(CP_UTF8, 0, text, cbText, wide,
+                                          cchExpected - 1));
+  VERIFY_ARE_EQUAL((DWORD)ERROR_INSUFFICIENT_BUFFER, (DWORD)GetLastError());
+  VERIFY_ARE_EQUAL(cchExpected + 1,
+                   MultiByteToWideChar(CP_UTF8, 0, text, -1, wide, 16));
+  VERIFY_ARE_EQUAL(0, wcscmp(expected, wide));
+
+  VERIFY_ARE_EQUAL(cbText, WideCharToMultiByte(CP_UTF8, 0, expected,
+                                               cchExpected, nullptr, 0,
+                                               nullptr, nullptr));
+  VERIFY_ARE_EQUAL(cbText + 1, WideCharToMultiByte(CP_UTF8, 0, expected, -1,
+                                                   nullptr, 0, nullptr,
+                                                   nullptr));
+  char narrow[16];
+  VERIFY_ARE_EQUAL(0, WideCharToMultiByte(CP_UTF8, 0, expected, cchExpected,
+                                          narrow, cbText - 1, nullptr,
+                                          nullptr));
+  VERIFY_ARE_EQUAL((DWORD)ERROR_INSUFFICIENT_BUFFER, (DWORD)GetLastError());
+  VERIFY_ARE_EQUAL(cbText + 1, WideCharToMultiByte(CP_UTF8, 0, expected, -1,
+                                                   narrow, 16, nullptr,
+                                                   nullptr));
+  VERIFY_ARE_EQUAL(0, strcmp(text, narrow));
+
+  // Strings without a terminator round-trip without gaining one.
+  std::wstring wideString;
+  VERIFY_IS_TRUE(Unicode::UTF8ToWideString(text, cbText, &wideString));
+  VERIFY_ARE_EQUAL((size_t)cchExpected, wideString.size());
+  std::string narrowString;
+  VERIFY_IS_TRUE(Unicode::WideToUTF8String(wideString.data(),
+                                           wideString.size(), &narrowString));
+  VERIFY_ARE_EQUAL((size_t)cbText, narrowString.size());
+}
+
+TEST_F(UnicodeTest, ConvertWhenMalformedThenFail) {
+  const char *Malformed[] = {"\xC3",         "a\xE2\x82",
+                             "\xC0\xAF",     "\xE0\x80\xAF",
+                             "\xED\xA0\x80", "\xF4\x90\x80\x80",
+                             "\xF5\x80\x80\x80", "abc\x80"};
+  for (const char *text : Malformed) {
+    VERIFY_IS_FALSE(Unicode::IsValidUTF8(text, strlen(text)));
+    VERIFY_ARE_EQUAL(0, MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS,
+                                            text, -1, nullptr, 0));
+    VERIFY_ARE_EQUAL((DWORD)ERROR_NO_UNICODE_TRANSLATION,
+                     (DWORD)GetLastError());
+  }
+}
+
+TEST_F(UnicodeTest, BlobAsUtf8WhenFuzzedThenMatchesConversion) {
+  CComPtr<IDxcUtils> pUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  std::mt19937 rng(kFuzzSeed);
+  for (unsigned i = 0; i < kFuzzIterations / 4; ++i) {
+    // Start with ASCII so that the text is never mistaken for a BOM.
+    std::string text = "x";
+    AppendFuzzedUTF8(rng, text);
+    // Wide blobs end at their first null character.
+    if (text.find('\0') != std::string::npos)
+      continue;
+    bool terminate = rng() % 2 != 0;
+    if (terminate)
+      text.push_back('\0');
+    std::wstring wide;
+    bool valid = ReferenceUTF8ToWide(text, wide);
+#ifdef _WIN32
+    // Only ASCII is the same in UTF-8 and the ANSI code page.
+    if (!Unicode::IsASCII(text.data(), text.size()))
+      continue;
+#endif
+
+    // Text of unknown encoding is taken as UTF-8 without a round trip
+    // through wide characters.
+    CComPtr<IDxcBlobEncoding> pBlob;
+    VERIFY_SUCCEEDED(pUtils->CreateBlob(text.data(), text.size(), CP_ACP,
+                                        &pBlob));
+    CComPtr<IDxcBlobUtf8> pUtf8;
+    HRESULT hr = pUtils->GetBlobAsUtf8(pBlob, &pUtf8);
+    VERIFY_ARE_EQUAL(valid, SUCCEEDED(hr));
+    CComPtr<IDxcBlobWide> pWide;
+    hr = pUtils->GetBlobAsWide(pBlob, &pWide);
+    VERIFY_ARE_EQUAL(valid, SUCCEEDED(hr));
+    if (!valid)
+      continue;
+
+    if (terminate)
+      text.pop_back();
+    VERIFY_IS_TRUE(text == std::string(pUtf8->GetStringPointer(),
+                                       pUtf8->GetStringLength()));
+    VERIFY_ARE_EQUAL('\0', pUtf8->GetStringPointer()[text.size()]);
+    if (terminate)
+      wide.pop_back();
+    VERIFY_IS_TRUE(wide == std::wstring(pWide->GetStringPointer(),
+                                        pWide->GetStringLength()));
+    VERIFY_ARE_EQUAL(L'\0', pWide->GetStringPointer()[wide.size()]);
+  }
+}
@@ -0,0 +1,113 @@
+//===- unittests/SPIRV/FusedVisitorTest.cpp ----- Fused Visitor Tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/SPIRV/FusedVisitor.h"
+#include "clang/SPIRV/SpirvBasicBlock.h"
+#include "clang/SPIRV/SpirvInstruction.h"
+
+#include "SpirvTestBase.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace clang::spirv;
+
+namespace {
+
+/// Records every visit in a log shared between visitors, and stops after
+/// visiting an OpKill if asked to.
+class RecordingVisitor : public Visitor {
+public:
+  RecordingVisitor(SpirvContext &spvCtx, const SpirvCodeGenOptions &opts,
+                   std::string name, std::vector<std::string> &log,
+                   bool stopAtKill = false)
+      : Visitor(opts, spvCtx), name(name), log(log), stopAtKill(stopAtKill) {}
+
+  bool visit(SpirvBasicBlock *, Phase phase) override {
+    log.push_back(name + (phase == Phase::Init ? ":init" : ":done"));
+    return true;
+  }
+
+  bool visit(SpirvKill *) override {
+    log.push_back(name + ":kill");
+    return !stopAtKill;
+  }
+
+  bool visitInstruction(SpirvInstruction *) override {
+    log.push_back(name + ":inst");
+    return true;
+  }
+
+  using Visitor::visit;
+
+private:
+  std::string name;
+  std::vector<std::string> &log;
+  bool stopAtKill;
+};
+
+class FusedVisitorTest : public SpirvTestBase {
+protected:
+  FusedVisitorTest() : opts() {}
+
+  SpirvCodeGenOptions opts;
+};
+
+TEST_F(FusedVisitorTest, MembersVisitEachConstructInOrder) {
+  SpirvContext &context = getSpirvContext();
+  SpirvBasicBlock bb("bb");
+  bb.addInstruction(new (context) SpirvKill({}));
+  bb.addInstruction(new (context) SpirvReturn({}));
+
+  std::vector<std::string> log;
+  RecordingVisitor a(context, opts, "a", log);
+  RecordingVisitor b(context, opts, "b", log);
+  FusedVisitor fused(context, opts, {&a, &b});
+  EXPECT_TRUE(bb.invokeVisitor(&fused, {}, nullptr, {}));
+
+  EXPECT_THAT(log, ::testing::ElementsAre("a:init", "b:init", "a:kill",
+                                          "b:kill", "a:inst", "b:inst",
+                                          "a:done", "b:done"));
+}
+
+TEST_F(FusedVisitorTest, MemberThatStopsIsNotVisitedAgain) {
+  SpirvContext &context = getSpirvContext();
+  SpirvBasicBlock bb("bb");
+  bb.addInstruction(new (context) SpirvKill({}));
+  bb.addInstruction(new (context) SpirvReturn({}));
+
+  std::vector<std::string> log;
+  RecordingVisitor a(context, opts, "a", log, /*stopAtKill*/ true);
+  RecordingVisitor b(context, opts, "b", log);
+  FusedVisitor fused(context, opts, {&a, &b});
+  EXPECT_TRUE(bb.invokeVisitor(&fused, {}, nullptr, {}));
+
+  EXPECT_THAT(log, ::testing::ElementsAre("a:init", "b:init", "a:kill",
+                                          "b:kill", "b:inst", "b:done"));
+}
+
+TEST_F(FusedVisitorTest, WalkStopsWhenAllMembersStop) {
+  SpirvContext &context = getSpirvContext();
+  SpirvBasicBlock bb("bb");
+  bb.addInstruction(new (context) SpirvKill({}));
+  bb.addInstruction(new (context) SpirvReturn({}));
+
+  std::vector<std::string> log;
+  RecordingVisitor a(context, opts, "a", log, /*stopAtKill*/ true);
+  RecordingVisitor b(context, opts, "b", log, /*stopAtKill*/ true);
+  FusedVisitor fused(context, opts, {&a, &b});
+  EXPECT_FALSE(bb.invokeVisitor(&fused, {}, nullptr, {}));
+
+  EXPECT_THAT(log,
+              ::testing::ElementsAre("a:init", "b:init", "a:kill", "b:kill"));
+}
+
+} // anonymous namespace
@@ -0,0 +1,154 @@
+//===- unittests/SPIRV/LegalizationCacheTest.cpp - Legalization Cache Tests ==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/SPIRV/LegalizationCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace clang::spirv;
+
+namespace {
+
+const std::vector<uint32_t> kModule = {0x07230203, 0x00010000, 0, 8, 0};
+
+TEST(LegalizationCacheTest, KeyDependsOnModuleAndConfiguration) {
+  const std::string key = LegalizationCache::computeKey(kModule, "O3");
+  EXPECT_EQ(key.size(), 32u);
+  EXPECT_EQ(key, LegalizationCache::computeKey(kModule, "O3"));
+
+  std::vector<uint32_t> other = kModule;
+  other[3] = 9;
+  EXPECT_NE(key, LegalizationCache::computeKey(other, "O3"));
+  EXPECT_NE(key, LegalizationCache::computeKey(kModule, "O0"));
+}
+
+TEST(LegalizationCacheTest, KeySeparatesModuleFromConfiguration) {
+  // Moving bytes from the end of the module into the configuration must not
+  // produce the same key.
+  const std::vector<uint32_t> shorter(kModule.begin(), kModule.end() - 1);
+  EXPECT_NE(LegalizationCache::computeKey(kModule, ""),
+            LegalizationCache::computeKey(shorter, llvm::StringRef("\0\0\0\0",
+                                                                   4)));
+}
+
+/// Gives each test its own cache directory, removed along with its entries
+/// when the test ends.
+class LegalizationCacheDirTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("legalization-cache-test",
+                                                      directory));
+  }
+
+  void TearDown() override {
+    if (directory.empty())
+      return;
+    std::error_code ec;
+    std::vector<std::string> entries;
+    for (llvm::sys::fs::directory_iterator it(directory.str(), ec), end;
+         !ec && it != end; it.increment(ec))
+      entries.push_back(it->path());
+    for (const std::string &entry : entries)
+      EXPECT_FALSE(llvm::sys::fs::remove(entry));
+    EXPECT_FALSE(llvm::sys::fs::remove(directory.str()));
+  }
+
+  std::string getEntryPath(const std::string &key) const {
+    return directory.str().str() + "/" + key + ".spv";
+  }
+
+  /// Replaces the stored entry for key with at most its first size bytes,
+  /// followed by the given trailing bytes.
+  void rewriteEntry(const std::string &key, size_t size,
+                    llvm::StringRef trailing = "") {
+    std::vector<char> contents(1024);
+    FILE *f = std::fopen(getEntryPath(key).c_str(), "rb");
+    ASSERT_TRUE(f != nullptr);
+    contents.resize(std::fread(contents.data(), 1, contents.size(), f));
+    std::fclose(f);
+    contents.resize(std::min(size, contents.size()));
+    contents.insert(contents.end(), trailing.begin(), trailing.end());
+
+    f = std::fopen(getEntryPath(key).c_str(), "wb");
+    ASSERT_TRUE(f != nullptr);
+    std::fwrite(contents.data(), 1, contents.size(), f);
+    std::fclose(f);
+  }
+
+  llvm::SmallString<128> directory;
+};
+
+TEST_F(LegalizationCacheDirTest, StoredModuleIsFoundAgain) {
+  LegalizationCache cache(directory);
+  const std::string key =
+      LegalizationCache::computeKey(kModule, "StoredModuleIsFoundAgain");
+
+  std::vector<uint32_t> result;
+  cache.store(key, kModule);
+  EXPECT_TRUE(cache.lookup(key, &result));
+  EXPECT_EQ(result, kModule);
+
+  std::remove(getEntryPath(key).c_str());
+  EXPECT_FALSE(cache.lookup(key, &result));
+}
+
+TEST_F(LegalizationCacheDirTest, TruncatedEntryIsAMiss) {
+  LegalizationCache cache(directory);
+  const std::string key = LegalizationCache::computeKey(kModule, "");
+
+  // Cut the entry inside the header, then inside the module.
+  for (size_t size : {6u, 20u}) {
+    cache.store(key, kModule);
+    rewriteEntry(key, size);
+    std::vector<uint32_t> result = {1};
+    EXPECT_FALSE(cache.lookup(key, &result));
+    EXPECT_THAT(result, ::testing::ElementsAre(1u));
+  }
+}
+
+TEST_F(LegalizationCacheDirTest, CorruptEntryIsAMiss) {
+  LegalizationCache cache(directory);
+  const std::string key = LegalizationCache::computeKey(kModule, "");
+  std::vector<uint32_t> result = {1};
+
+  // Extra bytes after the advertised module.
+  cache.store(key, kModule);
+  rewriteEntry(key, 1024, "junk");
+  EXPECT_FALSE(cache.lookup(key, &result));
+
+  // A module that does not start with the SPIR-V magic number.
+  std::vector<uint32_t> notSpirv = kModule;
+  notSpirv[0] = 0;
+  std::remove(getEntryPath(key).c_str());
+  cache.store(key, notSpirv);
+  EXPECT_FALSE(cache.lookup(key, &result));
+
+  // Not a cache entry at all.
+  rewriteEntry(key, 0, "not a cache entry");
+  EXPECT_FALSE(cache.lookup(key, &result));
+  EXPECT_THAT(result, ::testing::ElementsAre(1u));
+}
+
+TEST_F(LegalizationCacheDirTest, MissingDirectoryIsNotAnError) {
+  LegalizationCache cache(directory.str().str() + "/missing/");
+  const std::string key = LegalizationCache::computeKey(kModule, "");
+
+  cache.store(key, kModule);
+  std::vector<uint32_t> result = {1};
+  EXPECT_FALSE(cache.lookup(key, &result));
+  EXPECT_THAT(result, ::testing::ElementsAre(1u));
+}
+
+} // anonymous namespace
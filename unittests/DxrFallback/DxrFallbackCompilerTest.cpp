@@ -0,0 +1,158 @@
+//===- unittests/DxrFallback/DxrFallbackCompilerTest.cpp ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "dxc/DxrFallback/DxrFallbackCompiler.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+// main and other call callee, so both are split at their call sites. The
+// shaders share @g, which has internal linkage, and @h.
+const char *ShadersText =
+    "@g = internal global i32 5\n"
+    "@h = global i32 7\n"
+    "define void @\"\\01?callee@@YAXXZ\"() #0 {\n"
+    "  %a = load i32, i32* @g\n"
+    "  %b = add i32 %a, 1\n"
+    "  store i32 %b, i32* @g\n"
+    "  ret void\n"
+    "}\n"
+    "define void @\"\\01?main@@YAXXZ\"() #0 {\n"
+    "  %a = load i32, i32* @g\n"
+    "  %c = load i32, i32* @h\n"
+    "  call void @\"\\01?callee@@YAXXZ\"()\n"
+    "  %b = add i32 %a, %c\n"
+    "  store i32 %b, i32* @h\n"
+    "  call void @\"\\01?callee@@YAXXZ\"()\n"
+    "  store i32 %a, i32* @g\n"
+    "  ret void\n"
+    "}\n"
+    "define void @\"\\01?other@@YAXXZ\"() #0 {\n"
+    "  %c = load i32, i32* @h\n"
+    "  call void @\"\\01?callee@@YAXXZ\"()\n"
+    "  store i32 %c, i32* @h\n"
+    "  ret void\n"
+    "}\n"
+    "attributes #0 = { \"exp-shader\"=\"internal\" }\n"
+    "!dx.version = !{!0}\n"
+    "!dx.valver = !{!0}\n"
+    "!dx.shaderModel = !{!1}\n"
+    "!dx.entryPoints = !{!2}\n"
+    "!0 = !{i32 1, i32 3}\n"
+    "!1 = !{!\"lib\", i32 6, i32 3}\n"
+    "!2 = !{null, !\"\", null, null, null}\n";
+
+class DxrFallbackCompilerTest : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    sys::fs::SetupPerThreadFileSystem();
+    DxcInitThreadMalloc();
+  }
+  static void TearDownTestCase() {
+    DxcCleanupThreadMalloc();
+    sys::fs::CleanupPerThreadFileSystem();
+  }
+};
+
+// Shaders are transformed on worker threads when more than one core is
+// available, so this also checks that the results are linked back in order.
+TEST_F(DxrFallbackCompilerTest, CompileCreatesStateFunctionsInShaderOrder) {
+  DxcThreadMalloc TM(nullptr);
+  LLVMContext Context;
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M = parseAssemblyString(ShadersText, Error, Context);
+  ASSERT_TRUE(M != nullptr) << Error.getMessage().str();
+
+  std::vector<std::string> ShaderNames = {"main", "callee", "other"};
+  DxrFallbackCompiler Compiler(M.get(), ShaderNames, 32, 1024);
+  std::vector<int> EntryStateIds;
+  std::vector<unsigned int> StackSizes;
+  DxrFallbackCompiler::IntToFuncNameMap StateFunctions;
+  Compiler.compile(EntryStateIds, StackSizes, &StateFunctions);
+
+  EXPECT_EQ((std::vector<int>{1000, 1003, 1004}), EntryStateIds);
+  ASSERT_EQ(3u, StackSizes.size());
+  EXPECT_EQ(0u, StackSizes[1]);
+
+  std::string Names;
+  for (auto &Entry : StateFunctions)
+    Names += std::to_string(Entry.first) + ":" + Entry.second + " ";
+  EXPECT_EQ("1000:main.ss_0 1001:main.ss_1 1002:main.ss_2 1003:callee.ss_0 "
+            "1004:other.ss_0 1005:other.ss_1 ",
+            Names);
+  for (auto &Entry : StateFunctions) {
+    Function *F = M->getFunction(Entry.second);
+    ASSERT_TRUE(F != nullptr);
+    EXPECT_FALSE(F->isDeclaration());
+  }
+
+  GlobalVariable *G = M->getGlobalVariable("g", true);
+  ASSERT_TRUE(G != nullptr);
+  EXPECT_FALSE(G->use_empty());
+  EXPECT_EQ(2u, M->getGlobalList().size());
+
+  std::string Errors;
+  raw_string_ostream OS(Errors);
+  EXPECT_FALSE(verifyModule(*M, &OS)) << OS.str();
+}
+
+struct CompileOutput {
+  std::vector<int> EntryStateIds;
+  std::vector<unsigned int> StackSizes;
+  DxrFallbackCompiler::IntToFuncNameMap StateFunctions;
+  std::string Module;
+};
+
+static CompileOutput compileShaders(unsigned ThreadCount) {
+  LLVMContext Context;
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M = parseAssemblyString(ShadersText, Error, Context);
+  EXPECT_TRUE(M != nullptr) << Error.getMessage().str();
+
+  CompileOutput Output;
+  std::vector<std::string> ShaderNames = {"main", "callee", "other"};
+  DxrFallbackCompiler Compiler(M.get(), ShaderNames, 32, 1024);
+  Compiler.setThreadCount(ThreadCount);
+  Compiler.compile(Output.EntryStateIds, Output.StackSizes,
+                   &Output.StateFunctions);
+
+  raw_string_ostream OS(Output.Module);
+  M->print(OS, nullptr);
+  OS.flush();
+  return Output;
+}
+
+// Transforming the shaders on worker threads must produce what transforming
+// them one at a time does, whatever the machine's core count.
+TEST_F(DxrFallbackCompilerTest, CompileOnThreadsMatchesSequentialCompile) {
+  DxcThreadMalloc TM(nullptr);
+  CompileOutput Sequential = compileShaders(1);
+  CompileOutput Parallel = compileShaders(4);
+
+  EXPECT_EQ(Sequential.EntryStateIds, Parallel.EntryStateIds);
+  EXPECT_EQ(Sequential.StackSizes, Parallel.StackSizes);
+  EXPECT_EQ(Sequential.StateFunctions, Parallel.StateFunctions);
+  EXPECT_EQ(Sequential.Module, Parallel.Module);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,207 @@
+//===- unittests/DxrFallback/LiveValuesTest.cpp - LiveValues tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LiveValues.h"
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+class LiveValuesTest : public testing::Test {
+protected:
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+  std::vector<Instruction *> CallSites;
+
+  // Parses the module and collects the calls to @cs in @f as call sites.
+  void parse(StringRef Assembly) {
+    SMDiagnostic Error;
+    M = parseAssemblyString(Assembly, Error, Context);
+    ASSERT_TRUE(M != nullptr) << Error.getMessage().str();
+    Function *F = M->getFunction("f");
+    ASSERT_TRUE(F != nullptr);
+    CallSites.clear();
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      CallInst *CI = dyn_cast<CallInst>(&*I);
+      if (CI && CI->getCalledFunction()->getName() == "cs")
+        CallSites.push_back(CI);
+    }
+  }
+
+  static std::string names(const InstructionSetVector &Values) {
+    std::string Result;
+    for (Instruction *I : Values) {
+      if (!Result.empty())
+        Result += " ";
+      Result += I->getName();
+    }
+    return Result;
+  }
+};
+
+TEST_F(LiveValuesTest, StraightLine) {
+  parse("declare void @cs()\n"
+        "define i32 @f(i32 %x) {\n"
+        "entry:\n"
+        "  %a = add i32 %x, 1\n"
+        "  %b = add i32 %x, 2\n"
+        "  call void @cs()\n"
+        "  %c = add i32 %a, 1\n"
+        "  call void @cs()\n"
+        "  %d = add i32 %c, %b\n"
+        "  ret i32 %d\n"
+        "}\n");
+  LiveValues LV(CallSites);
+  LV.run();
+  EXPECT_EQ("a b", names(LV.getLiveValues(0)));
+  EXPECT_EQ("b c", names(LV.getLiveValues(1)));
+  EXPECT_EQ("a b c", names(LV.getAllLiveValues()));
+}
+
+TEST_F(LiveValuesTest, ValueUsedInLoopIsLiveInWholeLoop) {
+  parse("declare void @cs()\n"
+        "define i32 @f(i32 %x) {\n"
+        "entry:\n"
+        "  %a = add i32 %x, 1\n"
+        "  br label %loop\n"
+        "loop:\n"
+        "  %i = phi i32 [ 0, %entry ], [ %j, %loop ]\n"
+        "  %j = add i32 %i, %a\n"
+        "  call void @cs()\n"
+        "  %c = icmp slt i32 %j, 10\n"
+        "  br i1 %c, label %loop, label %exit\n"
+        "exit:\n"
+        "  ret i32 %j\n"
+        "}\n");
+  LiveValues LV(CallSites);
+  LV.run();
+  EXPECT_EQ("a j", names(LV.getLiveValues(0)));
+}
+
+TEST_F(LiveValuesTest, PhiOperandIsLiveOnItsEdgeOnly) {
+  parse("declare void @cs()\n"
+        "define i32 @f(i32 %x) {\n"
+        "entry:\n"
+        "  %a = add i32 %x, 1\n"
+        "  %b = add i32 %x, 2\n"
+        "  %c = icmp eq i32 %x, 0\n"
+        "  call void @cs()\n"
+        "  br i1 %c, label %l, label %r\n"
+        "l:\n"
+        "  call void @cs()\n"
+        "  br label %m\n"
+        "r:\n"
+        "  br label %m\n"
+        "m:\n"
+        "  %p = phi i32 [ %a, %l ], [ %b, %r ]\n"
+        "  ret i32 %p\n"
+        "}\n");
+  LiveValues LV(CallSites);
+  LV.run();
+  EXPECT_EQ("a b c", names(LV.getLiveValues(0)));
+  EXPECT_EQ("a", names(LV.getLiveValues(1)));
+
+  Instruction *A = &*inst_begin(M->getFunction("f"));
+  const LiveValues::Indices *Indices = LV.getIndicesWhereLive(A);
+  ASSERT_TRUE(Indices != nullptr);
+  EXPECT_EQ(2u, Indices->size());
+  EXPECT_TRUE(LV.getLiveAtIndex(A, 0));
+  EXPECT_TRUE(LV.getLiveAtIndex(A, 1));
+}
+
+TEST_F(LiveValuesTest, CallResultIsNotLiveAtItself) {
+  parse("declare void @cs()\n"
+        "declare i32 @g(i32)\n"
+        "define i32 @f(i32 %x) {\n"
+        "entry:\n"
+        "  %a = add i32 %x, 1\n"
+        "  call void @cs()\n"
+        "  %r = call i32 @g(i32 %a)\n"
+        "  call void @cs()\n"
+        "  ret i32 %r\n"
+        "}\n");
+  LiveValues LV(CallSites);
+  LV.run();
+  EXPECT_EQ("a", names(LV.getLiveValues(0)));
+  EXPECT_EQ("r", names(LV.getLiveValues(1)));
+}
+
+// Builds a function with NumSegments loops. Each segment defines a value that
+// stays live until the end of the function, and has two call sites.
+static std::string buildManyCallSites(unsigned NumSegments) {
+  std::string Text;
+  raw_string_ostream OS(Text);
+  OS << "declare void @cs()\n"
+     << "define i32 @f(i32 %x) {\n"
+     << "entry:\n"
+     << "  br label %seg0\n";
+  for (unsigned i = 0; i < NumSegments; ++i) {
+    OS << "seg" << i << ":\n"
+       << "  %v" << i << " = add i32 %x, " << i << "\n"
+       << "  call void @cs()\n"
+       << "  br label %loop" << i << "\n"
+       << "loop" << i << ":\n"
+       << "  %p" << i << " = phi i32 [ %v" << i << ", %seg" << i
+       << " ], [ %q" << i << ", %loop" << i << " ]\n"
+       << "  %q" << i << " = add i32 %p" << i << ", %v" << i << "\n"
+       << "  call void @cs()\n"
+       << "  %c" << i << " = icmp slt i32 %q" << i << ", 100\n"
+       << "  br i1 %c" << i << ", label %loop" << i << ", label %seg"
+       << i + 1 << "\n";
+  }
+  OS << "seg" << NumSegments << ":\n"
+     << "  %s0 = add i32 %q0, 0\n";
+  for (unsigned i = 1; i < NumSegments; ++i)
+    OS << "  %s" << i << " = add i32 %s" << i - 1 << ", %q" << i << "\n";
+  OS << "  ret i32 %s" << NumSegments - 1 << "\n"
+     << "}\n";
+  return OS.str();
+}
+
+TEST_F(LiveValuesTest, ManyCallSites) {
+  parse(buildManyCallSites(8));
+  LiveValues LV(CallSites);
+  LV.run();
+  ASSERT_EQ(16u, CallSites.size());
+  // At the call in loop3, q0..q2 are needed at the end, v3 by the next
+  // iteration and q3 by the compare. p3 is dead after q3.
+  EXPECT_EQ("q0 q1 q2 v3 q3", names(LV.getLiveValues(7)));
+}
+
+// Run with --gtest_also_run_disabled_tests to time the analysis on a large
+// synthetic shader.
+TEST_F(LiveValuesTest, DISABLED_BenchmarkManyCallSites) {
+  const unsigned NumSegments = 2000;
+  parse(buildManyCallSites(NumSegments));
+  auto Start = std::chrono::steady_clock::now();
+  LiveValues LV(CallSites);
+  LV.run();
+  auto End = std::chrono::steady_clock::now();
+  EXPECT_EQ(2 * NumSegments, LV.getAllLiveValues().size());
+  printf("%u call sites: %lld ms\n", (unsigned)CallSites.size(),
+         (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+             End - Start)
+             .count());
+}
+
+} // end anonymous namespace
@@ -0,0 +1,142 @@
+//===- llvm/unittest/Support/ContentionProfilerTest.cpp -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - Tests for the lock contention profiler.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ContentionProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using namespace llvm;
+
+namespace {
+
+const ContentionCounters &
+getCounters(const ContentionProfile &Profile, unsigned Phase,
+            ContentionSite Site) {
+  return Profile.Counters[Phase][(unsigned)Site];
+}
+
+TEST(ContentionProfilerTest, RecordsOnlyWhileActive) {
+  std::mutex M;
+  ContentionProfile Profile;
+  {
+    ProfiledLockGuard<std::mutex> Guard(M, ContentionSite::DxilLibrary);
+  }
+  EXPECT_FALSE(contentionProfilerEnabled());
+  {
+    ContentionProfileScope Scope(Profile);
+    EXPECT_TRUE(contentionProfilerEnabled());
+    contentionProfilerSetPhase(2);
+    ProfiledLockGuard<std::mutex> Guard(M, ContentionSite::DxilLibrary);
+  }
+  contentionProfilerSetPhase(0);
+  EXPECT_FALSE(contentionProfilerEnabled());
+  {
+    ProfiledLockGuard<std::mutex> Guard(M, ContentionSite::DxilLibrary);
+  }
+
+  const ContentionCounters &C =
+      getCounters(Profile, 2, ContentionSite::DxilLibrary);
+  EXPECT_EQ(1u, C.Acquisitions);
+  EXPECT_EQ(0u, C.Contended);
+  EXPECT_EQ(0u,
+            getCounters(Profile, 0, ContentionSite::DxilLibrary).Acquisitions);
+}
+
+// A mutex that tells the test when a thread has started waiting on it.
+class WatchedMutex {
+  std::mutex M;
+
+public:
+  std::atomic<bool> Waiting{false};
+
+  bool try_lock() { return M.try_lock(); }
+  void lock() {
+    Waiting = true;
+    M.lock();
+  }
+  void unlock() { M.unlock(); }
+};
+
+TEST(ContentionProfilerTest, CountsWaitForHeldLock) {
+  WatchedMutex M;
+  ContentionProfile Profile;
+
+  M.lock();
+  M.Waiting = false; // Only the waiter's lock() counts.
+  std::thread Waiter([&]() {
+    ContentionProfileScope Scope(Profile);
+    ProfiledLockGuard<WatchedMutex> Guard(M, ContentionSite::ManagedStatic);
+  });
+  // The waiter only calls lock() once try_lock has failed and its wait is
+  // being timed, so the lock is released strictly after both.
+  while (!M.Waiting)
+    std::this_thread::yield();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  M.unlock();
+  Waiter.join();
+
+  const ContentionCounters &C =
+      getCounters(Profile, 0, ContentionSite::ManagedStatic);
+  EXPECT_EQ(1u, C.Acquisitions);
+  EXPECT_EQ(1u, C.Contended);
+  EXPECT_LE(1000000u, C.WaitNanoseconds);
+  // Acquisitions on other threads are not recorded here.
+  EXPECT_FALSE(contentionProfilerEnabled());
+}
+
+TEST(ContentionProfilerTest, AcquireProfiledTimesReaderLocks) {
+  ContentionProfile Profile;
+  bool Acquired = false;
+  {
+    ContentionProfileScope Scope(Profile);
+    acquireProfiled(ContentionSite::PassRegistry,
+                    [&]() { Acquired = true; });
+  }
+  EXPECT_TRUE(Acquired);
+  const ContentionCounters &C =
+      getCounters(Profile, 0, ContentionSite::PassRegistry);
+  EXPECT_EQ(1u, C.Acquisitions);
+  EXPECT_EQ(0u, C.Contended);
+}
+
+TEST(ContentionProfilerTest, WritesJson) {
+  ContentionProfile Profile;
+  Profile.Counters[1][(unsigned)ContentionSite::PassRegistry].Acquisitions = 3;
+  Profile.Counters[1][(unsigned)ContentionSite::PassRegistry]
+      .WaitNanoseconds = 40;
+
+  std::string Out;
+  raw_string_ostream OS(Out);
+  const char *PhaseNames[] = {"first", "second"};
+  writeContentionProfile(OS, Profile, 2,
+                         [&](unsigned Phase) { return PhaseNames[Phase]; });
+  EXPECT_EQ("{ \"sites\": [\n"
+            "    { \"name\": \"managed-static\", \"acquisitions\": 0, "
+            "\"contended\": 0, \"waitNanoseconds\": 0, \"phases\": [] },\n"
+            "    { \"name\": \"pass-registry\", \"acquisitions\": 3, "
+            "\"contended\": 0, \"waitNanoseconds\": 40, \"phases\": [\n"
+            "      { \"name\": \"second\", \"acquisitions\": 3, "
+            "\"contended\": 0, \"waitNanoseconds\": 40 } ] },\n"
+            "    { \"name\": \"dxil-library\", \"acquisitions\": 0, "
+            "\"contended\": 0, \"waitNanoseconds\": 0, \"phases\": [] },\n"
+            "    { \"name\": \"args-cache\", \"acquisitions\": 0, "
+            "\"contended\": 0, \"waitNanoseconds\": 0, \"phases\": [] }\n"
+            "  ]\n"
+            "}\n",
+            OS.str());
+}
+
+} // end anonymous namespace